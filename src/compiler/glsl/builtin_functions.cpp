@@ -39,7 +39,8 @@
  *
  *    The builtin_builder::create_builtins() function contains lists of all
  *    built-in function signatures, where they're available, what types they
- *    take, and so on.
+ *    take, and so on.  A built-in is only created the first time a shader
+ *    looks it up.
  *
  * 4. Implementations of built-in function signatures
  *
@@ -83,6 +84,7 @@
 #include <math.h>
 #include "builtin_functions.h"
 #include "util/hash_table.h"
+#include "util/set.h"
 
 #define M_PIf   ((float) M_PI)
 #define M_PI_2f ((float) M_PI_2)
@@ -654,23 +656,39 @@ public:
    void release();
    ir_function_signature *find(_mesa_glsl_parse_state *state,
                                const char *name, exec_list *actual_parameters);
+   ir_function *get_function(const char *name);
 
    /**
-    * A shader to hold all the built-in signatures; created by this module.
+    * A shader to hold the built-in signatures; created by this module.
     *
-    * This includes signatures for every built-in, regardless of version or
-    * enabled extensions.  The availability predicate associated with each
-    * signature allows matching_signature() to filter out the irrelevant ones.
+    * This includes signatures for every version of the built-ins created so
+    * far, regardless of version or enabled extensions.  The availability
+    * predicate associated with each signature allows matching_signature() to
+    * filter out the irrelevant ones.
     */
    gl_shader *shader;
 
 private:
    void *mem_ctx;
 
+   /**
+    * The built-in create_builtins() is creating, or NULL to create all of
+    * them.
+    */
+   const char *wanted_name;
+
+   /** Names which aren't built-ins, to avoid looking for them again. */
+   struct set *unknown_names;
+
    void create_shader();
    void create_intrinsics();
    void create_builtins();
 
+   bool is_wanted(const char *name)
+   {
+      return wanted_name == NULL || strcmp(name, wanted_name) == 0;
+   }
+
    /**
     * IR builder helpers:
     *
@@ -1011,7 +1029,7 @@ enum image_function_flags {
  *  @{
  */
 builtin_builder::builtin_builder()
-   : shader(NULL)
+   : shader(NULL), wanted_name(NULL), unknown_names(NULL)
 {
    mem_ctx = NULL;
 }
@@ -1034,7 +1052,7 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
     */
    state->uses_builtin_functions = true;
 
-   ir_function *f = shader->symbols->get_function(name);
+   ir_function *f = get_function(name);
    if (f == NULL)
       return NULL;
 
@@ -1046,6 +1064,31 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
    return sig;
 }
 
+/**
+ * Return the built-in function with the given name, creating it if this
+ * is the first time it is asked for.
+ *
+ * Building the IR of the hundreds of built-ins takes a while, and most
+ * programs only use a few of them.
+ */
+ir_function *
+builtin_builder::get_function(const char *name)
+{
+   ir_function *f = shader->symbols->get_function(name);
+   if (f != NULL || _mesa_set_search(unknown_names, name))
+      return f;
+
+   wanted_name = name;
+   create_builtins();
+   wanted_name = NULL;
+
+   f = shader->symbols->get_function(name);
+   if (f == NULL)
+      _mesa_set_add(unknown_names, ralloc_strdup(mem_ctx, name));
+
+   return f;
+}
+
 void
 builtin_builder::initialize()
 {
@@ -1054,9 +1097,10 @@ builtin_builder::initialize()
       return;
 
    mem_ctx = ralloc_context(NULL);
+   unknown_names = _mesa_set_create(mem_ctx, _mesa_key_hash_string,
+                                    _mesa_key_string_equal);
    create_shader();
    create_intrinsics();
-   create_builtins();
 }
 
 void
@@ -1064,6 +1108,7 @@ builtin_builder::release()
 {
    ralloc_free(mem_ctx);
    mem_ctx = NULL;
+   unknown_names = NULL;
 
    ralloc_free(shader);
    shader = NULL;
@@ -1264,7 +1309,18 @@ builtin_builder::create_intrinsics()
 }
 
 /**
- * Create ir_function and ir_function_signature objects for each built-in.
+ * Only evaluate the signature arguments of the built-ins create_builtins()
+ * is asked for.
+ */
+#define add_function(NAME, ...)                 \
+   do {                                         \
+      if (is_wanted(NAME))                      \
+         add_function(NAME, __VA_ARGS__);       \
+   } while (0)
+
+/**
+ * Create ir_function and ir_function_signature objects for each built-in,
+ * or only for builtin_builder::wanted_name if it's set.
  *
  * Contains a list of every available built-in.
  */
@@ -3331,6 +3387,8 @@ builtin_builder::create_builtins()
 #undef FIU2_MIXED
 }
 
+#undef add_function
+
 void
 builtin_builder::add_function(const char *name, ...)
 {
@@ -3401,6 +3459,9 @@ builtin_builder::add_image_function(const char *name,
       glsl_type::uimage2DMSArray_type
    };
 
+   if (!is_wanted(name))
+      return;
+
    ir_function *f = new(mem_ctx) ir_function(name);
 
    for (unsigned i = 0; i < ARRAY_SIZE(types); ++i) {
@@ -6282,11 +6343,45 @@ _mesa_glsl_release_builtin_functions()
    mtx_unlock(&builtins_lock);
 }
 
+/**
+ * Find the built-in signature matching a call and return a copy of it
+ * owned by the shader.
+ *
+ * Only the signatures a shader calls are copied, once each: shaders often
+ * call the same built-ins many times, and functions like texture() have
+ * hundreds of overloads.
+ */
 ir_function_signature *
 _mesa_glsl_find_builtin_function(_mesa_glsl_parse_state *state,
                                  const char *name, exec_list *actual_parameters)
 {
+   ir_function *f = NULL;
    ir_function_signature *s;
+
+   if (state->builtin_functions == NULL) {
+      state->builtin_functions =
+         _mesa_hash_table_create(state, _mesa_key_hash_string,
+                                 _mesa_key_string_equal);
+   }
+   else {
+      struct hash_entry *entry =
+         _mesa_hash_table_search(state->builtin_functions, name);
+
+      if (entry != NULL) {
+         /* An exact match among the signatures already copied is the one
+          * the built-ins would return, and needs no lock.
+          */
+         bool is_exact = false;
+
+         f = (ir_function *) entry->data;
+         s = f->matching_signature(state, actual_parameters, true, &is_exact);
+         if (s != NULL && is_exact) {
+            state->uses_builtin_functions = true;
+            return s;
+         }
+      }
+   }
+
    mtx_lock(&builtins_lock);
    s = builtins.find(state, name, actual_parameters);
    mtx_unlock(&builtins_lock);
@@ -6294,13 +6389,26 @@ _mesa_glsl_find_builtin_function(_mesa_glsl_parse_state *state,
    if (s == NULL)
       return NULL;
 
+   if (f == NULL) {
+      f = new(state) ir_function(s->function_name());
+      _mesa_hash_table_insert(state->builtin_functions, f->name, f);
+   }
+   else {
+      /* The signature may have been copied by an inexact match already. */
+      ir_function_signature *copy =
+         f->exact_matching_signature(state, &s->parameters);
+      if (copy != NULL)
+         return copy;
+   }
+
    struct hash_table *ht =
       _mesa_hash_table_create(NULL, _mesa_hash_pointer, _mesa_key_pointer_equal);
-   void *mem_ctx = state;
-   ir_function *f = s->function()->clone(mem_ctx, ht);
+   ir_function_signature *copy = s->clone(state, ht);
    _mesa_hash_table_destroy(ht, NULL);
 
-   return f->matching_signature(state, actual_parameters, true);
+   f->add_signature(copy);
+
+   return copy;
 }
 
 bool
@@ -6309,7 +6417,7 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    ir_function *f;
    bool ret = false;
    mtx_lock(&builtins_lock);
-   f = builtins.shader->symbols->get_function(name);
+   f = builtins.get_function(name);
    if (f != NULL) {
       foreach_in_list(ir_function_signature, sig, &f->signatures) {
          if (sig->is_builtin_available(state)) {
@@ -6323,10 +6431,15 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    return ret;
 }
 
-gl_shader *
-_mesa_glsl_get_builtin_function_shader()
+ir_function *
+_mesa_glsl_get_builtin_function(const char *name)
 {
-   return builtins.shader;
+   ir_function *f;
+   mtx_lock(&builtins_lock);
+   f = builtins.get_function(name);
+   mtx_unlock(&builtins_lock);
+
+   return f;
 }
 
 
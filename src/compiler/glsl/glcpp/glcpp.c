@@ -115,16 +115,21 @@ usage (void)
 		 "Pre-process the given filename (stdin if no filename given).\n"
 		 "The following options are supported:\n"
 		 "    --disable-line-continuations      Do not interpret lines ending with a\n"
-		 "                                      backslash ('\\') as a line continuation.\n");
+		 "                                      backslash ('\\') as a line continuation.\n"
+		 "    --fast-path                       Only strip the comments of shaders which\n"
+		 "                                      don't need the preprocessor, like the\n"
+		 "                                      compiler does.\n");
 }
 
 enum {
-	DISABLE_LINE_CONTINUATIONS_OPT = CHAR_MAX + 1
+	DISABLE_LINE_CONTINUATIONS_OPT = CHAR_MAX + 1,
+	FAST_PATH_OPT
 };
 
 static const struct option
 long_options[] = {
 	{"disable-line-continuations", no_argument, 0, DISABLE_LINE_CONTINUATIONS_OPT },
+	{"fast-path",                  no_argument, 0, FAST_PATH_OPT },
         {"debug",                      no_argument, 0, 'd'},
 	{0,                            0,           0, 0 }
 };
@@ -138,6 +143,7 @@ main (int argc, char *argv[])
 	const char *shader;
 	int ret;
 	struct gl_context gl_ctx;
+	bool fast_path = false;
 	int c;
 
 	init_fake_gl_context (&gl_ctx);
@@ -147,6 +153,9 @@ main (int argc, char *argv[])
 		case DISABLE_LINE_CONTINUATIONS_OPT:
 			gl_ctx.Const.DisableGLSLLineContinuations = true;
 			break;
+		case FAST_PATH_OPT:
+			fast_path = true;
+			break;
                 case 'd':
 			glcpp_parser_debug = 1;
 			break;
@@ -171,7 +180,11 @@ main (int argc, char *argv[])
 
 	_mesa_locale_init();
 
-	ret = glcpp_preprocess(ctx, &shader, &info_log, NULL, NULL, &gl_ctx);
+	if (fast_path && glcpp_preprocess_trivial(ctx, &shader, &gl_ctx))
+		ret = 0;
+	else
+		ret = glcpp_preprocess(ctx, &shader, &info_log, NULL, NULL,
+				       &gl_ctx);
 
 	printf("%s", shader);
 	fprintf(stderr, "%s", info_log);
@@ -243,6 +243,10 @@ glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
 		 glcpp_extension_iterator extensions, void *state,
 		 struct gl_context *g_ctx);
 
+bool
+glcpp_preprocess_trivial(void *ralloc_ctx, const char **shader,
+			 struct gl_context *gl_ctx);
+
 /* Functions for writing to the info log */
 
 void
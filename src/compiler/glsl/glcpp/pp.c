@@ -247,3 +247,228 @@ glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
 	glcpp_parser_destroy (parser);
 	return errors;
 }
+
+static bool
+is_identifier_char(char c)
+{
+	return isalnum((unsigned char) c) || c == '_';
+}
+
+/* Copy the text between *copy_start and end to the output buffer, which
+ * is allocated on the first call.
+ */
+static void
+flush_trivial_output(void *ralloc_ctx, const char *shader, const char *end,
+		     const char **copy_start, char **out, size_t *out_length)
+{
+	if (*out == NULL)
+		*out = ralloc_size(ralloc_ctx, strlen(shader) + 1);
+
+	memcpy(*out + *out_length, *copy_start, end - *copy_start);
+	*out_length += end - *copy_start;
+	*copy_start = end;
+}
+
+static bool
+is_horizontal_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\v' || c == '\f';
+}
+
+/* Whether s is a carriage return which isn't part of a "\r\n" or "\n\r"
+ * line ending, i.e. the shader uses old Mac line endings.
+ */
+static bool
+is_lone_carriage_return(const char *shader, const char *s)
+{
+	return *s == '\r' && s[1] != '\n' && (s == shader || s[-1] != '\n');
+}
+
+/* Skip the rest of a #version directive, which glcpp parses and prints
+ * back.  Only accept the forms it prints back unchanged: a decimal version
+ * number, optionally followed by a profile.  Returns NULL otherwise.
+ */
+static const char *
+skip_trivial_version(const char *s)
+{
+	if (!is_horizontal_space(*s))
+		return NULL;
+	while (is_horizontal_space(*s))
+		s++;
+
+	if (*s < '1' || *s > '9')
+		return NULL;
+	while (isdigit((unsigned char) *s))
+		s++;
+
+	while (is_horizontal_space(*s))
+		s++;
+	if (isalpha((unsigned char) *s) || *s == '_') {
+		while (is_identifier_char(*s))
+			s++;
+		while (is_horizontal_space(*s))
+			s++;
+	}
+
+	if (*s == '\r' && s[1] == '\n')
+		s++;
+	return *s == '\n' || *s == '\0' ? s : NULL;
+}
+
+/**
+ * Preprocess a shader which doesn't need the preprocessor, without running
+ * it.
+ *
+ * That's the case of shaders whose only directives are #version and
+ * #extension, which the compiler handles itself, and which use none of the
+ * predefined macros.  For those, the only thing left to do is removing the
+ * comments, while keeping the line numbers intact.
+ *
+ * Returns false, leaving \p shader untouched, if the shader needs the full
+ * preprocessor.  This is conservative: anything which could be a macro or
+ * a line continuation is left to glcpp_preprocess.  That includes
+ * backslashes in comments, since line continuations are removed before the
+ * comments are, so a backslash at the end of a // comment comments out the
+ * next line too.
+ */
+bool
+glcpp_preprocess_trivial(void *ralloc_ctx, const char **shader,
+			 struct gl_context *gl_ctx)
+{
+	const bool line_continuations =
+		!gl_ctx->Const.DisableGLSLLineContinuations;
+	const char *s = *shader;
+	const char *copy_start = s;
+	char *out = NULL;
+	size_t out_length = 0;
+	bool line_start = true;
+	bool directive = false;
+	bool seen_token = false;
+
+	while (*s) {
+		const char c = *s;
+
+		if (is_lone_carriage_return(*shader, s))
+			return false;
+
+		if (c == '\n') {
+			line_start = true;
+			directive = false;
+			s++;
+			continue;
+		}
+
+		if (c == '\r' || is_horizontal_space(c)) {
+			s++;
+			continue;
+		}
+
+		if (c == '/' && (s[1] == '/' || s[1] == '*')) {
+			const bool line_comment = s[1] == '/';
+
+			/* glcpp passes #extension lines through verbatim,
+			 * comments included.
+			 */
+			if (directive)
+				return false;
+
+			flush_trivial_output(ralloc_ctx, *shader, s, &copy_start,
+					     &out, &out_length);
+			if (!line_comment)
+				out[out_length++] = ' ';
+
+			for (s += 2; *s; s++) {
+				if (line_comment ? *s == '\n' :
+				    (s[0] == '*' && s[1] == '/'))
+					break;
+				if (*s == '\\' && line_continuations)
+					return false;
+				if (is_lone_carriage_return(*shader, s))
+					return false;
+				if (*s == '\n')
+					out[out_length++] = '\n';
+			}
+
+			if (!line_comment) {
+				/* Let glcpp report unterminated comments. */
+				if (!*s)
+					return false;
+				s += 2;
+				line_start = false;
+			}
+
+			copy_start = s;
+			continue;
+		}
+
+		if (c == '#') {
+			if (!line_start)
+				return false;
+
+			s++;
+			while (is_horizontal_space(*s))
+				s++;
+
+			/* glcpp reports a #version which isn't the first
+			 * token of the shader.
+			 */
+			if (strncmp(s, "version", 7) == 0 && !seen_token) {
+				s = skip_trivial_version(s + 7);
+				if (!s)
+					return false;
+			} else if (strncmp(s, "extension", 9) == 0 &&
+				   !is_identifier_char(s[9])) {
+				s += 9;
+			} else {
+				return false;
+			}
+
+			line_start = false;
+			directive = true;
+			seen_token = true;
+			continue;
+		}
+
+		line_start = false;
+		seen_token = true;
+
+		if (c == '\\')
+			return false;
+
+		if (directive) {
+			s++;
+			continue;
+		}
+
+		if (isalpha((unsigned char) c) || c == '_') {
+			/* All the predefined macros either start with GL_ or
+			 * contain two underscores.
+			 */
+			if (strncmp(s, "GL_", 3) == 0)
+				return false;
+
+			for (; is_identifier_char(*s); s++) {
+				if (s[0] == '_' && s[1] == '_')
+					return false;
+			}
+			continue;
+		}
+
+		if (isdigit((unsigned char) c)) {
+			while (is_identifier_char(*s) || *s == '.')
+				s++;
+			continue;
+		}
+
+		s++;
+	}
+
+	if (out) {
+		flush_trivial_output(ralloc_ctx, *shader, s, &copy_start,
+				     &out, &out_length);
+		out[out_length] = '\0';
+		*shader = out;
+	}
+
+	return true;
+}
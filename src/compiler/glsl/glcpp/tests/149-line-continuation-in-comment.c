@@ -0,0 +1,4 @@
+// This comment continues to the next line, hiding the declaration \
+failure
+success
+
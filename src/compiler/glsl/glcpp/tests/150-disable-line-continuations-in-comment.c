@@ -0,0 +1,3 @@
+// glcpp-args: --disable-line-continuations
+// This comment ends with a backslash \
+success
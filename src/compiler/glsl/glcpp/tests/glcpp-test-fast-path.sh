@@ -0,0 +1,78 @@
+#!/bin/sh
+
+if [ -z "$srcdir" -o -z "$abs_builddir" ]; then
+    echo ""
+    echo "Warning: you're invoking the script manually and things may fail."
+    echo "Attempting to determine/set srcdir and abs_builddir variables."
+    echo ""
+
+    # Should point to `dirname Makefile.glsl.am`
+    srcdir=./../../../
+    cd `dirname "$0"`
+    # Should point to `dirname Makefile` equivalent to the above.
+    abs_builddir=`pwd`/../../../
+fi
+
+testdir=$srcdir/glsl/glcpp/tests
+outdir=$abs_builddir/glsl/glcpp/tests
+glcpp=$abs_builddir/glsl/glcpp/glcpp
+
+# Run every test through glcpp, once as usual and once with --fast-path,
+# which is what the compiler does, and check that both give the same
+# result.  The fast path only strips comments where glcpp also collapses
+# horizontal whitespace, which the GLSL lexer ignores, and adds a newline
+# at the end of the shader, so those are normalized before comparing.
+# Line breaks are compared as they are, since they determine the line
+# numbers in compiler messages.
+
+test_specific_args ()
+{
+    test="$1"
+
+    tr "\r" "\n" < "$test" | grep 'glcpp-args:' | sed -e 's,^.*glcpp-args: *,,'
+}
+
+normalize ()
+{
+    sed -e 's/[[:blank:]][[:blank:]]*/ /g' \
+        -e 's/^ //' \
+        -e 's/ $//' \
+        -e 's/^# */#/' | awk 1
+}
+
+total=0
+pass=0
+
+mkdir -p $outdir
+
+for test in $testdir/*.c; do
+    out=$outdir/${test##*/}.out
+    fast_out=$outdir/${test##*/}.fast-path.out
+
+    printf "Testing `basename $test` with --fast-path... "
+    $glcpp $(test_specific_args $test) < $test 2>&1 | normalize > $out
+    $glcpp --fast-path $(test_specific_args $test) < $test 2>&1 | normalize > $fast_out
+    total=$((total+1))
+    if cmp $out $fast_out >/dev/null 2>&1; then
+	echo "PASS"
+	pass=$((pass+1))
+    else
+	echo "FAIL"
+	diff -u $out $fast_out
+    fi
+done
+
+if [ $total -eq 0 ]; then
+    echo "Could not find any tests."
+    exit 1
+fi
+
+echo ""
+echo "$pass/$total tests returned the same results with --fast-path"
+echo ""
+
+if [ "$pass" = "$total" ]; then
+    exit 0
+else
+    exit 1
+fi
@@ -25,6 +25,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 #include "main/core.h" /* for struct gl_context */
 #include "main/context.h"
@@ -35,12 +36,14 @@
 #include "util/ralloc.h"
 #include "util/disk_cache.h"
 #include "util/mesa-sha1.h"
+#include "util/debug.h"
 #include "ast.h"
 #include "glsl_parser_extras.h"
 #include "glsl_parser.h"
 #include "ir_optimization.h"
 #include "loop_analysis.h"
 #include "builtin_functions.h"
+#include "shader_cache.h"
 
 /**
  * Format a short human-readable description of the given GLSL version.
@@ -79,6 +82,7 @@ _mesa_glsl_parse_state::_mesa_glsl_parse_state(struct gl_context *_ctx,
    this->loop_nesting_ast = NULL;
 
    this->uses_builtin_functions = false;
+   this->builtin_functions = NULL;
 
    /* Set default language version and extensions */
    this->language_version = 110;
@@ -1948,14 +1952,18 @@ opt_shader_and_create_symbol_table(struct gl_context *ctx,
    /* Do some optimization at compile time to reduce shader IR size
     * and reduce later work if the same shader is linked multiple times
     */
-   if (ctx->Const.GLSLOptimizeConservatively) {
+   if (options->OptimizeInNIR) {
+      /* Nothing to do, the linked shader gets optimized in NIR. */
+   } else if (ctx->Const.GLSLOptimizeConservatively) {
       /* Run it just once. */
       do_common_optimization(shader->ir, false, false, options,
                              ctx->Const.NativeIntegers);
    } else {
       /* Repeat it until it stops making changes. */
+      opt_tracker tracker;
+
       while (do_common_optimization(shader->ir, false, false, options,
-                                    ctx->Const.NativeIntegers))
+                                    ctx->Const.NativeIntegers, &tracker))
          ;
    }
 
@@ -2014,6 +2022,41 @@ opt_shader_and_create_symbol_table(struct gl_context *ctx,
    _mesa_glsl_initialize_derived_variables(ctx, shader);
 }
 
+/**
+ * Run the preprocessor, or get its output from the shader cache when a
+ * compile skipped because of a shader cache hit has to be done after all.
+ * Other compiles only get there for shaders which aren't in the cache.
+ */
+static int
+preprocess_shader(struct gl_context *ctx, struct gl_shader *shader,
+                  struct _mesa_glsl_parse_state *state, const char **source,
+                  bool force_recompile)
+{
+   /* Most shaders have no directive other than #version and #extension. */
+   if (glcpp_preprocess_trivial(state, source, ctx))
+      return 0;
+
+#ifdef ENABLE_SHADER_CACHE
+   if (ctx->Cache && force_recompile &&
+       shader_cache_read_preprocessed(ctx, shader, state, source,
+                                      &state->info_log))
+      return 0;
+#endif
+
+   MAYBE_UNUSED const size_t log_start = strlen(state->info_log);
+   int error = glcpp_preprocess(state, source, &state->info_log,
+                                add_builtin_defines, state, ctx);
+
+#ifdef ENABLE_SHADER_CACHE
+   if (!error && ctx->Cache) {
+      shader_cache_write_preprocessed(ctx, shader, *source,
+                                      state->info_log + log_start);
+   }
+#endif
+
+   return error;
+}
+
 void
 _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
                           bool dump_ast, bool dump_hir, bool force_recompile)
@@ -2026,7 +2069,11 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
          char buf[41];
          disk_cache_compute_key(ctx->Cache, source, strlen(source),
                                 shader->sha1);
-         if (disk_cache_has_key(ctx->Cache, shader->sha1)) {
+         const bool hit = disk_cache_has_key(ctx->Cache, shader->sha1);
+#ifdef ENABLE_SHADER_CACHE
+         shader_cache_count_shader_lookup(hit);
+#endif
+         if (hit) {
             /* We've seen this shader before and know it compiles */
             if (ctx->_Shader->Flags & GLSL_CACHE_INFO) {
                _mesa_sha1_format(buf, shader->sha1);
@@ -2061,8 +2108,8 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       (void) p_atomic_cmpxchg(&ir_variable::temporaries_allocate_names,
                               false, true);
 
-   state->error = glcpp_preprocess(state, &source, &state->info_log,
-                                   add_builtin_defines, state, ctx);
+   state->error = preprocess_shader(ctx, shader, state, &source,
+                                    force_recompile);
 
    if (!state->error) {
      _mesa_glsl_lexer_ctor(state, source);
@@ -2126,6 +2173,106 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 }
 
 } /* extern "C" */
+opt_tracker::opt_tracker()
+   : generation(0)
+{
+   for (unsigned i = 0; i < OPT_TRACKER_MAX_PASSES; i++)
+      clean_generation[i] = ~0u;
+
+   timing = env_var_as_boolean("GLSL_OPT_TIMING", false);
+   memset(stats, 0, sizeof(stats));
+}
+
+opt_tracker::~opt_tracker()
+{
+   if (!timing)
+      return;
+
+   fprintf(stderr, "%-32s %6s %8s %8s %10s\n",
+           "GLSL optimization pass", "runs", "progress", "skipped", "usec");
+
+   for (unsigned i = 0; i < OPT_TRACKER_MAX_PASSES; i++) {
+      if (!stats[i].name)
+         continue;
+
+      fprintf(stderr, "%-32s %6u %8u %8u %10.0f\n", stats[i].name,
+              stats[i].runs, stats[i].progress, stats[i].skipped,
+              stats[i].time / 1000.0);
+   }
+}
+
+/**
+ * Return true if the pass already ran without making progress, and no pass
+ * has changed the IR since.
+ */
+bool
+opt_tracker::skip_pass(unsigned pass)
+{
+   if (pass >= OPT_TRACKER_MAX_PASSES || clean_generation[pass] != generation)
+      return false;
+
+   stats[pass].skipped++;
+   return true;
+}
+
+/**
+ * CPU time of the calling thread, so that the passes aren't charged for the
+ * time other threads run, as they would be with clock().
+ */
+static int64_t
+get_thread_time_ns()
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+   return ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+}
+
+int64_t
+opt_tracker::start_pass() const
+{
+   return timing ? get_thread_time_ns() : 0;
+}
+
+void
+opt_tracker::end_pass(unsigned pass, const char *name, int64_t start,
+                      bool progress)
+{
+   if (pass >= OPT_TRACKER_MAX_PASSES)
+      return;
+
+   if (progress) {
+      generation++;
+      stats[pass].progress++;
+   } else {
+      clean_generation[pass] = generation;
+   }
+
+   stats[pass].name = name;
+   stats[pass].runs++;
+   if (timing)
+      stats[pass].time += get_thread_time_ns() - start;
+}
+
+/**
+ * Loop analysis and unrolling, run as one pass by do_common_optimization()
+ * since the loop state can't be kept across runs.
+ */
+static bool
+do_loop_unrolling(exec_list *ir, const struct gl_shader_compiler_options *options)
+{
+   bool progress = false;
+
+   loop_state *ls = analyze_loop_variables(ir);
+   if (ls->loop_found) {
+      progress = set_loop_controls(ir, ls) || progress;
+      progress = unroll_loops(ir, ls, options) || progress;
+   }
+   delete ls;
+
+   return progress;
+}
+
 /**
  * Do the set of common optimizations passes
  *
@@ -2144,27 +2291,41 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
  *                                    implementations supporting integers
  *                                    natively (as opposed to supporting
  *                                    integers in floating point registers).
+ * \param tracker                     Optional tracker shared by repeated
+ *                                    runs on the same IR, used to skip the
+ *                                    passes which can't make progress.
  */
 bool
 do_common_optimization(exec_list *ir, bool linked,
 		       bool uniform_locations_assigned,
                        const struct gl_shader_compiler_options *options,
-                       bool native_integers)
+                       bool native_integers,
+                       opt_tracker *tracker)
 {
    const bool debug = false;
    GLboolean progress = GL_FALSE;
+   unsigned num_passes = 0;
 
+   /* The passes are numbered in the order they are run.  Which passes run
+    * only depends on linked and the options, so the numbering is the same
+    * for every run sharing a tracker.
+    */
 #define OPT(PASS, ...) do {                                             \
-      if (debug) {                                                      \
+      const unsigned pass = num_passes++;                               \
+      if (tracker && tracker->skip_pass(pass))                          \
+         break;                                                         \
+      if (debug)                                                        \
          fprintf(stderr, "START GLSL optimization %s\n", #PASS);        \
-         const bool opt_progress = PASS(__VA_ARGS__);                   \
-         progress = opt_progress || progress;                           \
+      const int64_t start = tracker ? tracker->start_pass() : 0;        \
+      const bool opt_progress = PASS(__VA_ARGS__);                      \
+      if (tracker)                                                      \
+         tracker->end_pass(pass, #PASS, start, opt_progress);           \
+      progress = opt_progress || progress;                              \
+      if (debug) {                                                      \
          if (opt_progress)                                              \
             _mesa_print_ir(stderr, ir, NULL);                           \
          fprintf(stderr, "GLSL optimization %s: %s progress\n",         \
                  #PASS, opt_progress ? "made" : "no");                  \
-      } else {                                                          \
-         progress = PASS(__VA_ARGS__) || progress;                      \
       }                                                                 \
    } while (false)
 
@@ -2214,14 +2375,8 @@ do_common_optimization(exec_list *ir, bool linked,
    OPT(optimize_split_arrays, ir, linked);
    OPT(optimize_redundant_jumps, ir);
 
-   if (options->MaxUnrollIterations) {
-      loop_state *ls = analyze_loop_variables(ir);
-      if (ls->loop_found) {
-         OPT(set_loop_controls, ir, ls);
-         OPT(unroll_loops, ir, ls, options);
-      }
-      delete ls;
-   }
+   if (options->MaxUnrollIterations)
+      OPT(do_loop_unrolling, ir, options);
 
 #undef OPT
 
@@ -2240,6 +2395,10 @@ extern "C" {
 void
 _mesa_destroy_shader_compiler(void)
 {
+#ifdef ENABLE_SHADER_CACHE
+   shader_cache_print_stats();
+#endif
+
    _mesa_destroy_shader_compiler_caches();
 
    _mesa_glsl_release_types();
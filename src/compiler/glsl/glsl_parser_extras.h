@@ -812,6 +812,12 @@ struct _mesa_glsl_parse_state {
    bool uses_builtin_functions;
    bool fs_uses_gl_fragcoord;
 
+   /**
+    * The built-in signatures copied into this shader, in an ir_function per
+    * name.  See _mesa_glsl_find_builtin_function().
+    */
+   struct hash_table *builtin_functions;
+
    /**
     * For geometry shaders, size of the most recently seen input declaration
     * that was a sized array, or 0 if no sized input array declarations have
@@ -945,6 +951,9 @@ extern int glcpp_preprocess(void *ctx, const char **shader, char **info_log,
                             struct _mesa_glsl_parse_state *state,
                             struct gl_context *gl_ctx);
 
+extern bool glcpp_preprocess_trivial(void *ctx, const char **shader,
+                                     struct gl_context *gl_ctx);
+
 extern void _mesa_destroy_shader_compiler(void);
 extern void _mesa_destroy_shader_compiler_caches(void);
 
@@ -86,10 +86,60 @@ enum lower_packing_builtins_op {
    LOWER_PACK_USE_BFE                   = 0x0800,
 };
 
+#define OPT_TRACKER_MAX_PASSES 64
+
+/**
+ * Tracks the passes of do_common_optimization() across repeated runs on the
+ * same IR.
+ *
+ * A pass which made no progress can't make any until some other pass has
+ * changed the IR, so it is skipped until then.  Callers which run other
+ * passes between the do_common_optimization() runs must report their
+ * progress with ir_changed().
+ *
+ * If GLSL_OPT_TIMING is set, the number of runs and the CPU time the
+ * compiling thread spent in each pass are printed when the tracker is
+ * destroyed.
+ */
+class opt_tracker {
+public:
+   opt_tracker();
+   ~opt_tracker();
+
+   void ir_changed()
+   {
+      generation++;
+   }
+
+   bool skip_pass(unsigned pass);
+   int64_t start_pass() const;
+   void end_pass(unsigned pass, const char *name, int64_t start,
+                 bool progress);
+
+private:
+   /** Incremented each time a pass changes the IR. */
+   unsigned generation;
+
+   /** Generation at which each pass last ran without making progress. */
+   unsigned clean_generation[OPT_TRACKER_MAX_PASSES];
+
+   bool timing;
+
+   struct {
+      const char *name;
+      unsigned runs;
+      unsigned progress;
+      unsigned skipped;
+      /** Thread CPU time, in nanoseconds */
+      int64_t time;
+   } stats[OPT_TRACKER_MAX_PASSES];
+};
+
 bool do_common_optimization(exec_list *ir, bool linked,
 			    bool uniform_locations_assigned,
                             const struct gl_shader_compiler_options *options,
-                            bool native_integers);
+                            bool native_integers,
+                            opt_tracker *tracker = NULL);
 
 bool ir_constant_fold(ir_rvalue **rvalue);
 
@@ -4666,16 +4666,19 @@ static void
 linker_optimisation_loop(struct gl_context *ctx, exec_list *ir,
                          unsigned stage)
 {
-      if (ctx->Const.GLSLOptimizeConservatively) {
+      if (ctx->Const.GLSLOptimizeConservatively ||
+          ctx->Const.ShaderCompilerOptions[stage].OptimizeInNIR) {
          /* Run it just once. */
          do_common_optimization(ir, true, false,
                                 &ctx->Const.ShaderCompilerOptions[stage],
                                 ctx->Const.NativeIntegers);
       } else {
          /* Repeat it until it stops making changes. */
+         opt_tracker tracker;
+
          while (do_common_optimization(ir, true, false,
                                        &ctx->Const.ShaderCompilerOptions[stage],
-                                       ctx->Const.NativeIntegers))
+                                       ctx->Const.NativeIntegers, &tracker))
             ;
       }
 }
@@ -42,6 +42,10 @@
  * in the hope that the final linked shader will be found in the cache.
  * If anything goes wrong (shader variant not found, backend cache item is
  * corrupt, etc) we will use a fallback path to compile and link the IR.
+ *
+ * The output of the preprocessor is cached for each shader, so that the
+ * fallback path, which is also taken when already seen shaders are linked
+ * together for the first time, doesn't need to run glcpp again.
  */
 
 #include "blob.h"
@@ -58,8 +62,10 @@
 #include "nir.h"
 #include "program.h"
 #include "shader_cache.h"
+#include "util/debug.h"
 #include "util/mesa-sha1.h"
 #include "util/string_to_uint_map.h"
+#include "util/u_atomic.h"
 
 extern "C" {
 #include "main/enums.h"
@@ -67,6 +73,18 @@ extern "C" {
 #include "program/program.h"
 }
 
+/* Number of lookups of each kind of cache item, printed at exit when
+ * MESA_GLSL_CACHE_STATS is set.
+ */
+static struct {
+   unsigned shader_hits;
+   unsigned shader_misses;
+   unsigned preprocessed_hits;
+   unsigned preprocessed_misses;
+   unsigned program_hits;
+   unsigned program_misses;
+} cache_stats;
+
 static void
 compile_shaders(struct gl_context *ctx, struct gl_shader_program *prog) {
    for (unsigned i = 0; i < prog->NumShaders; i++) {
@@ -1254,6 +1272,39 @@ create_linked_shader_and_program(struct gl_context *ctx,
    prog->_LinkedShaders[stage] = linked;
 }
 
+/**
+ * Append the compiler state which changes the result of compiling the same
+ * source to the string a cache key is computed from.
+ */
+static void
+append_compiler_state(struct gl_context *ctx, char **buf)
+{
+   /* A shader might end up producing different output depending on the glsl
+    * version supported by the compiler. For example a different path might be
+    * taken by the preprocessor, so add the version to the hash input.
+    */
+   ralloc_asprintf_append(buf, "api: %d glsl: %d fglsl: %d\n",
+                          ctx->API, ctx->Const.GLSLVersion,
+                          ctx->Const.ForceGLSLVersion);
+
+   /* We run the preprocessor on shaders after hashing them, so we need to
+    * add any extension override vars to the hash. If we don't do this the
+    * preprocessor could result in different output and we could load the
+    * wrong shader.
+    */
+   char *ext_override = getenv("MESA_EXTENSION_OVERRIDE");
+   if (ext_override) {
+      ralloc_asprintf_append(buf, "ext:%s", ext_override);
+   }
+
+   /* DRI config options may also change the output from the compiler so
+    * include them as an input to sha1 creation.
+    */
+   char sha1buf[41];
+   _mesa_sha1_format(sha1buf, ctx->Const.dri_config_options_sha1);
+   ralloc_strcat(buf, sha1buf);
+}
+
 void
 shader_cache_write_program_metadata(struct gl_context *ctx,
                                     struct gl_shader_program *prog)
@@ -1358,31 +1409,9 @@ shader_cache_read_program_metadata(struct gl_context *ctx,
    ralloc_asprintf_append(&buf, "sso: %s\n",
                           prog->SeparateShader ? "T" : "F");
 
-   /* A shader might end up producing different output depending on the glsl
-    * version supported by the compiler. For example a different path might be
-    * taken by the preprocessor, so add the version to the hash input.
-    */
-   ralloc_asprintf_append(&buf, "api: %d glsl: %d fglsl: %d\n",
-                          ctx->API, ctx->Const.GLSLVersion,
-                          ctx->Const.ForceGLSLVersion);
-
-   /* We run the preprocessor on shaders after hashing them, so we need to
-    * add any extension override vars to the hash. If we don't do this the
-    * preprocessor could result in different output and we could load the
-    * wrong shader.
-    */
-   char *ext_override = getenv("MESA_EXTENSION_OVERRIDE");
-   if (ext_override) {
-      ralloc_asprintf_append(&buf, "ext:%s", ext_override);
-   }
+   append_compiler_state(ctx, &buf);
 
-   /* DRI config options may also change the output from the compiler so
-    * include them as an input to sha1 creation.
-    */
    char sha1buf[41];
-   _mesa_sha1_format(sha1buf, ctx->Const.dri_config_options_sha1);
-   ralloc_strcat(&buf, sha1buf);
-
    for (unsigned i = 0; i < prog->NumShaders; i++) {
       struct gl_shader *sh = prog->Shaders[i];
       _mesa_sha1_format(sha1buf, sh->sha1);
@@ -1396,6 +1425,8 @@ shader_cache_read_program_metadata(struct gl_context *ctx,
    uint8_t *buffer = (uint8_t *) disk_cache_get(cache, prog->data->sha1,
                                                 &size);
    if (buffer == NULL) {
+      p_atomic_inc(&cache_stats.program_misses);
+
       /* Cached program not found. We may have seen the individual shaders
        * before and skipped compiling but they may not have been used together
        * in this combination before. Fall back to linking shaders but first
@@ -1458,12 +1489,16 @@ shader_cache_read_program_metadata(struct gl_context *ctx,
                  "cache item)\n");
       }
 
+      p_atomic_inc(&cache_stats.program_misses);
+
       disk_cache_remove(cache, prog->data->sha1);
       compile_shaders(ctx, prog);
       free(buffer);
       return false;
    }
 
+   p_atomic_inc(&cache_stats.program_hits);
+
    /* This is used to flag a shader retrieved from cache */
    prog->data->LinkStatus = linking_skipped;
 
@@ -1488,3 +1523,135 @@ shader_cache_read_program_metadata(struct gl_context *ctx,
 
    return true;
 }
+
+static void
+compute_preprocessed_key(struct gl_context *ctx, struct gl_shader *shader,
+                         cache_key key)
+{
+   char sha1buf[41];
+   _mesa_sha1_format(sha1buf, shader->sha1);
+
+   char *buf = ralloc_asprintf(NULL, "preprocessed %s: %s\n",
+                               _mesa_shader_stage_to_abbrev(shader->Stage),
+                               sha1buf);
+   append_compiler_state(ctx, &buf);
+
+   disk_cache_compute_key(ctx->Cache, buf, strlen(buf), key);
+   ralloc_free(buf);
+}
+
+/**
+ * Store the output of the preprocessor for a shader, along with the
+ * messages it added to the info log.
+ */
+void
+shader_cache_write_preprocessed(struct gl_context *ctx,
+                                struct gl_shader *shader,
+                                const char *source, const char *info_log)
+{
+   cache_key key;
+   compute_preprocessed_key(ctx, shader, key);
+
+   struct blob *blob = blob_create();
+   blob_write_string(blob, info_log);
+   blob_write_string(blob, source);
+
+   disk_cache_put(ctx->Cache, key, blob->data, blob->size);
+
+   blob_destroy(blob);
+
+   if (ctx->_Shader->Flags & GLSL_CACHE_INFO) {
+      char sha1buf[41];
+      _mesa_sha1_format(sha1buf, shader->sha1);
+      fprintf(stderr, "putting preprocessed shader in cache: %s\n", sha1buf);
+   }
+}
+
+/**
+ * Look up the output of the preprocessor for a shader.
+ *
+ * On success, \p source is replaced by the preprocessed source allocated
+ * from \p mem_ctx, and the preprocessor messages are appended to
+ * \p info_log.
+ */
+bool
+shader_cache_read_preprocessed(struct gl_context *ctx,
+                               struct gl_shader *shader, void *mem_ctx,
+                               const char **source, char **info_log)
+{
+   cache_key key;
+   compute_preprocessed_key(ctx, shader, key);
+
+   size_t size;
+   uint8_t *buffer = (uint8_t *) disk_cache_get(ctx->Cache, key, &size);
+   if (buffer == NULL) {
+      p_atomic_inc(&cache_stats.preprocessed_misses);
+      return false;
+   }
+
+   struct blob_reader blob;
+   blob_reader_init(&blob, buffer, size);
+
+   const char *log = blob_read_string(&blob);
+   const char *text = blob_read_string(&blob);
+
+   if (blob.current != blob.end || blob.overrun) {
+      assert(!"Invalid GLSL preprocessed shader cache item!");
+
+      disk_cache_remove(ctx->Cache, key);
+      free(buffer);
+      p_atomic_inc(&cache_stats.preprocessed_misses);
+      return false;
+   }
+
+   ralloc_strcat(info_log, log);
+   *source = ralloc_strdup(mem_ctx, text);
+   free(buffer);
+
+   p_atomic_inc(&cache_stats.preprocessed_hits);
+
+   if (ctx->_Shader->Flags & GLSL_CACHE_INFO) {
+      char sha1buf[41];
+      _mesa_sha1_format(sha1buf, shader->sha1);
+      fprintf(stderr, "loading preprocessed shader from cache: %s\n",
+              sha1buf);
+   }
+
+   return true;
+}
+
+/**
+ * Count a glCompileShader() which was skipped (\p hit) or not because the
+ * shader had been compiled before.
+ */
+void
+shader_cache_count_shader_lookup(bool hit)
+{
+   if (hit)
+      p_atomic_inc(&cache_stats.shader_hits);
+   else
+      p_atomic_inc(&cache_stats.shader_misses);
+}
+
+static void
+print_stat(const char *name, unsigned hits, unsigned misses)
+{
+   const unsigned lookups = hits + misses;
+
+   fprintf(stderr, "  %-14s %8u hits %8u misses %6.1f%%\n", name, hits,
+           misses, lookups ? 100.0 * hits / lookups : 0.0);
+}
+
+void
+shader_cache_print_stats(void)
+{
+   if (!env_var_as_boolean("MESA_GLSL_CACHE_STATS", false))
+      return;
+
+   fprintf(stderr, "GLSL shader cache:\n");
+   print_stat("shaders", cache_stats.shader_hits, cache_stats.shader_misses);
+   print_stat("preprocessed", cache_stats.preprocessed_hits,
+              cache_stats.preprocessed_misses);
+   print_stat("programs", cache_stats.program_hits,
+              cache_stats.program_misses);
+}
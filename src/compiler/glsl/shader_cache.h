@@ -34,4 +34,20 @@ bool
 shader_cache_read_program_metadata(struct gl_context *ctx,
                                    struct gl_shader_program *prog);
 
+void
+shader_cache_write_preprocessed(struct gl_context *ctx,
+                                struct gl_shader *shader,
+                                const char *source, const char *info_log);
+
+bool
+shader_cache_read_preprocessed(struct gl_context *ctx,
+                               struct gl_shader *shader, void *mem_ctx,
+                               const char **source, char **info_log);
+
+void
+shader_cache_count_shader_lookup(bool hit);
+
+void
+shader_cache_print_stats(void);
+
 #endif /* GLSL_SYMBOL_TABLE */
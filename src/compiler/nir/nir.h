@@ -2636,11 +2636,16 @@ bool nir_lower_ssa_defs_to_regs_block(nir_block *block);
 bool nir_opt_algebraic(nir_shader *shader);
 bool nir_opt_algebraic_before_ffma(nir_shader *shader);
 bool nir_opt_algebraic_late(nir_shader *shader);
+bool nir_opt_algebraic_block(nir_block *block);
+bool nir_opt_algebraic_before_ffma_block(nir_block *block);
+bool nir_opt_algebraic_late_block(nir_block *block);
 bool nir_opt_constant_folding(nir_shader *shader);
+bool nir_opt_constant_folding_block(nir_block *block);
 
 bool nir_opt_global_to_local(nir_shader *shader);
 
 bool nir_copy_prop(nir_shader *shader);
+bool nir_copy_prop_block(nir_block *block);
 
 bool nir_opt_copy_prop_vars(nir_shader *shader);
 
@@ -2670,6 +2675,40 @@ bool nir_opt_undef(nir_shader *shader);
 
 bool nir_opt_conditional_discard(nir_shader *shader);
 
+/** Incremental driver for optimization loops
+ *
+ * Replaces the usual "do { progress |= pass(); ... } while (progress)" loop.
+ * Passes are run in the order they were added, round after round, until a
+ * whole round makes no progress.  Shader passes are skipped while nothing
+ * changed since they last ran without progress, and block passes are only
+ * run on blocks that changed (or whose SSA sources or users changed) since
+ * they were last visited.
+ *
+ * Block passes must not modify the control flow graph.  Passes taking
+ * arguments are added with nir_opt_scheduler_add_shader_pass_with_data(),
+ * which hands them the data pointer; it must stay valid until the last
+ * nir_opt_scheduler_run().
+ */
+typedef struct nir_opt_scheduler nir_opt_scheduler;
+
+typedef bool (*nir_opt_shader_pass)(nir_shader *shader);
+typedef bool (*nir_opt_shader_pass_with_data)(nir_shader *shader,
+                                              const void *data);
+typedef bool (*nir_opt_block_pass)(nir_block *block);
+
+nir_opt_scheduler *nir_opt_scheduler_create(void *mem_ctx);
+void nir_opt_scheduler_add_shader_pass(nir_opt_scheduler *sched,
+                                       const char *name,
+                                       nir_opt_shader_pass pass);
+void nir_opt_scheduler_add_shader_pass_with_data(nir_opt_scheduler *sched,
+                                                 const char *name,
+                                                 nir_opt_shader_pass_with_data pass,
+                                                 const void *data);
+void nir_opt_scheduler_add_block_pass(nir_opt_scheduler *sched,
+                                      const char *name,
+                                      nir_opt_block_pass pass);
+bool nir_opt_scheduler_run(nir_opt_scheduler *sched, nir_shader *shader);
+
 void nir_sweep(nir_shader *shader);
 
 nir_intrinsic_op nir_intrinsic_from_system_value(gl_system_value val);
@@ -525,8 +525,9 @@ static const struct transform ${pass_name}_${opcode}_xforms[] = {
 % endfor
 
 static bool
-${pass_name}_block(nir_block *block, const bool *condition_flags,
-                   void *mem_ctx)
+${pass_name}_block_with_conditions(nir_block *block,
+                                   const bool *condition_flags,
+                                   void *mem_ctx)
 {
    bool progress = false;
 
@@ -560,6 +561,18 @@ ${pass_name}_block(nir_block *block, const bool *condition_flags,
    return progress;
 }
 
+static void
+${pass_name}_get_condition_flags(const nir_shader *shader,
+                                 bool *condition_flags)
+{
+   const nir_shader_compiler_options *options = shader->options;
+   (void) options;
+
+   % for index, condition in enumerate(condition_list):
+   condition_flags[${index}] = ${condition};
+   % endfor
+}
+
 static bool
 ${pass_name}_impl(nir_function_impl *impl, const bool *condition_flags)
 {
@@ -567,7 +580,8 @@ ${pass_name}_impl(nir_function_impl *impl, const bool *condition_flags)
    bool progress = false;
 
    nir_foreach_block_reverse(block, impl) {
-      progress |= ${pass_name}_block(block, condition_flags, mem_ctx);
+      progress |= ${pass_name}_block_with_conditions(block, condition_flags,
+                                                     mem_ctx);
    }
 
    if (progress)
@@ -583,12 +597,8 @@ ${pass_name}(nir_shader *shader)
 {
    bool progress = false;
    bool condition_flags[${len(condition_list)}];
-   const nir_shader_compiler_options *options = shader->options;
-   (void) options;
 
-   % for index, condition in enumerate(condition_list):
-   condition_flags[${index}] = ${condition};
-   % endfor
+   ${pass_name}_get_condition_flags(shader, condition_flags);
 
    nir_foreach_function(function, shader) {
       if (function->impl)
@@ -597,6 +607,23 @@ ${pass_name}(nir_shader *shader)
 
    return progress;
 }
+
+/* Runs the pass on a single block.  This is used by callers that track
+ * which blocks changed, such as nir_opt_scheduler.
+ */
+bool ${pass_name}_block(nir_block *block);
+
+bool
+${pass_name}_block(nir_block *block)
+{
+   nir_function_impl *impl = nir_cf_node_get_function(&block->cf_node);
+   bool condition_flags[${len(condition_list)}];
+
+   ${pass_name}_get_condition_flags(impl->function->shader, condition_flags);
+
+   return ${pass_name}_block_with_conditions(block, condition_flags,
+                                             ralloc_parent(impl));
+}
 """)
 
 class AlgebraicPass(object):
@@ -206,6 +206,14 @@ constant_fold_block(nir_block *block, void *mem_ctx)
    return progress;
 }
 
+bool
+nir_opt_constant_folding_block(nir_block *block)
+{
+   nir_function_impl *impl = nir_cf_node_get_function(&block->cf_node);
+
+   return constant_fold_block(block, ralloc_parent(impl));
+}
+
 static bool
 nir_opt_constant_folding_impl(nir_function_impl *impl)
 {
@@ -303,21 +303,32 @@ copy_prop_if(nir_if *if_stmt)
    return copy_prop_src(&if_stmt->condition, NULL, if_stmt, 1);
 }
 
+bool
+nir_copy_prop_block(nir_block *block)
+{
+   bool progress = false;
+
+   nir_foreach_instr(instr, block) {
+      if (copy_prop_instr(instr))
+         progress = true;
+   }
+
+   nir_if *if_stmt = nir_block_get_following_if(block);
+   if (if_stmt && copy_prop_if(if_stmt))
+      progress = true;
+
+   return progress;
+}
+
 static bool
 nir_copy_prop_impl(nir_function_impl *impl)
 {
    bool progress = false;
 
    nir_foreach_block(block, impl) {
-      nir_foreach_instr(instr, block) {
-         if (copy_prop_instr(instr))
-            progress = true;
-      }
-
-      nir_if *if_stmt = nir_block_get_following_if(block);
-      if (if_stmt && copy_prop_if(if_stmt))
+      if (nir_copy_prop_block(block))
          progress = true;
-      }
+   }
 
    if (progress) {
       nir_metadata_preserve(impl, nir_metadata_block_index |
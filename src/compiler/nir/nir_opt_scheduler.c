@@ -0,0 +1,370 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_worklist.h"
+
+/*
+ * Implements an optimization loop that only re-runs passes on the parts of
+ * the shader that changed since the pass last saw them.
+ *
+ * Two kinds of passes are supported:
+ *
+ *  - Shader passes, which look at the whole shader (DCE, CSE, dead control
+ *    flow, ...).  We keep a generation counter that is bumped every time any
+ *    pass makes progress.  A shader pass which ran without making progress
+ *    is skipped until the generation changes.
+ *
+ *  - Block passes, which only look at the instructions of one block and the
+ *    SSA values they read (copy propagation, constant folding, algebraic).
+ *    Each of them has a nir_block_worklist of dirty blocks per function.
+ *    When a block pass makes progress on a block, that block, the blocks
+ *    defining its sources and the blocks using its results are pushed onto
+ *    the worklists of every block pass.
+ *
+ * Shader passes may rewrite arbitrary instructions and the control flow
+ * graph, so when one of them makes progress every block is considered dirty
+ * again.
+ */
+
+struct opt_pass {
+   const char *name;
+
+   nir_opt_shader_pass shader_pass;
+   nir_opt_shader_pass_with_data shader_pass_with_data;
+   const void *data;
+
+   nir_opt_block_pass block_pass;
+
+   /* Value of nir_opt_scheduler::generation the last time this shader pass
+    * ran without making progress.
+    */
+   unsigned clean_generation;
+
+   /* For block passes, one worklist of dirty blocks per function impl */
+   nir_block_worklist *dirty;
+};
+
+struct nir_opt_scheduler {
+   struct opt_pass *passes;
+   unsigned num_passes;
+
+   /* The function impls of the shader being optimized and their dirty
+    * worklists.  Rebuilt every time a shader pass makes progress.
+    */
+   void *dirty_ctx;
+   nir_function_impl **impls;
+   unsigned num_impls;
+
+   unsigned generation;
+};
+
+nir_opt_scheduler *
+nir_opt_scheduler_create(void *mem_ctx)
+{
+   return rzalloc(mem_ctx, nir_opt_scheduler);
+}
+
+static struct opt_pass *
+add_pass(nir_opt_scheduler *sched, const char *name)
+{
+   sched->passes = reralloc(sched, sched->passes, struct opt_pass,
+                            sched->num_passes + 1);
+
+   struct opt_pass *pass = &sched->passes[sched->num_passes++];
+   memset(pass, 0, sizeof(*pass));
+   pass->name = name;
+
+   return pass;
+}
+
+void
+nir_opt_scheduler_add_shader_pass(nir_opt_scheduler *sched, const char *name,
+                                  nir_opt_shader_pass pass)
+{
+   struct opt_pass *p = add_pass(sched, name);
+   p->shader_pass = pass;
+}
+
+void
+nir_opt_scheduler_add_shader_pass_with_data(nir_opt_scheduler *sched,
+                                            const char *name,
+                                            nir_opt_shader_pass_with_data pass,
+                                            const void *data)
+{
+   struct opt_pass *p = add_pass(sched, name);
+   p->shader_pass_with_data = pass;
+   p->data = data;
+}
+
+void
+nir_opt_scheduler_add_block_pass(nir_opt_scheduler *sched, const char *name,
+                                 nir_opt_block_pass pass)
+{
+   struct opt_pass *p = add_pass(sched, name);
+   p->block_pass = pass;
+}
+
+static void
+mark_all_dirty(nir_opt_scheduler *sched, nir_shader *shader)
+{
+   ralloc_free(sched->dirty_ctx);
+   sched->dirty_ctx = ralloc_context(sched);
+
+   sched->num_impls = 0;
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         sched->num_impls++;
+   }
+
+   sched->impls = ralloc_array(sched->dirty_ctx, nir_function_impl *,
+                               sched->num_impls);
+
+   unsigned i = 0;
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      nir_metadata_require(function->impl, nir_metadata_block_index);
+      sched->impls[i++] = function->impl;
+   }
+
+   for (unsigned p = 0; p < sched->num_passes; p++) {
+      struct opt_pass *pass = &sched->passes[p];
+      if (!pass->block_pass)
+         continue;
+
+      pass->dirty = ralloc_array(sched->dirty_ctx, nir_block_worklist,
+                                 sched->num_impls);
+      for (i = 0; i < sched->num_impls; i++) {
+         nir_block_worklist_init(&pass->dirty[i], sched->impls[i]->num_blocks,
+                                 sched->dirty_ctx);
+         nir_block_worklist_add_all(&pass->dirty[i], sched->impls[i]);
+      }
+   }
+}
+
+struct mark_state {
+   nir_opt_scheduler *sched;
+   unsigned impl_idx;
+};
+
+static void
+mark_block_dirty(struct mark_state *state, nir_block *block)
+{
+   nir_opt_scheduler *sched = state->sched;
+
+   for (unsigned p = 0; p < sched->num_passes; p++) {
+      if (sched->passes[p].block_pass)
+         nir_block_worklist_push_tail(&sched->passes[p].dirty[state->impl_idx],
+                                      block);
+   }
+}
+
+static void
+mark_if_use_dirty(struct mark_state *state, nir_if *if_stmt)
+{
+   nir_cf_node *prev = nir_cf_node_prev(&if_stmt->cf_node);
+   mark_block_dirty(state, nir_cf_node_as_block(prev));
+}
+
+static bool
+mark_ssa_def_uses_dirty(nir_ssa_def *def, void *void_state)
+{
+   struct mark_state *state = void_state;
+
+   nir_foreach_use(use_src, def)
+      mark_block_dirty(state, use_src->parent_instr->block);
+
+   nir_foreach_if_use(use_src, def)
+      mark_if_use_dirty(state, use_src->parent_if);
+
+   return true;
+}
+
+static bool
+mark_reg_uses_dirty(nir_dest *dest, void *void_state)
+{
+   struct mark_state *state = void_state;
+
+   if (dest->is_ssa)
+      return true;
+
+   nir_foreach_use(use_src, dest->reg.reg)
+      mark_block_dirty(state, use_src->parent_instr->block);
+
+   nir_foreach_if_use(use_src, dest->reg.reg)
+      mark_if_use_dirty(state, use_src->parent_if);
+
+   return true;
+}
+
+static bool
+mark_src_def_dirty(nir_src *src, void *void_state)
+{
+   struct mark_state *state = void_state;
+
+   if (src->is_ssa)
+      mark_block_dirty(state, src->ssa->parent_instr->block);
+
+   return true;
+}
+
+/* Marks a block which was changed by a block pass, and every block which
+ * may see a difference because of it, as dirty.
+ */
+static void
+mark_block_and_neighbours_dirty(nir_opt_scheduler *sched, unsigned impl_idx,
+                                nir_block *block)
+{
+   struct mark_state state = {
+      .sched = sched,
+      .impl_idx = impl_idx,
+   };
+
+   mark_block_dirty(&state, block);
+
+   nir_foreach_instr(instr, block) {
+      nir_foreach_ssa_def(instr, mark_ssa_def_uses_dirty, &state);
+      nir_foreach_dest(instr, mark_reg_uses_dirty, &state);
+      nir_foreach_src(instr, mark_src_def_dirty, &state);
+   }
+
+   nir_if *following_if = nir_block_get_following_if(block);
+   if (following_if)
+      mark_src_def_dirty(&following_if->condition, &state);
+}
+
+static bool
+run_shader_pass(nir_opt_scheduler *sched, struct opt_pass *pass,
+                nir_shader *shader)
+{
+   if (pass->clean_generation == sched->generation)
+      return false;
+
+   if (should_print_nir())
+      printf("%s\n", pass->name);
+
+   nir_metadata_set_validation_flag(shader);
+
+   bool progress = pass->shader_pass ? pass->shader_pass(shader) :
+                   pass->shader_pass_with_data(shader, pass->data);
+   if (!progress) {
+      pass->clean_generation = sched->generation;
+      nir_validate_shader(shader);
+      return false;
+   }
+
+   if (should_print_nir())
+      nir_print_shader(shader, stdout);
+   nir_metadata_check_validation_flag(shader);
+   nir_validate_shader(shader);
+
+   sched->generation++;
+   mark_all_dirty(sched, shader);
+
+   return true;
+}
+
+static bool
+run_block_pass(nir_opt_scheduler *sched, struct opt_pass *pass,
+               nir_shader *shader)
+{
+   bool progress = false;
+
+   for (unsigned i = 0; i < sched->num_impls; i++) {
+      nir_block_worklist *w = &pass->dirty[i];
+      bool impl_progress = false;
+
+      if (nir_block_worklist_is_empty(w))
+         continue;
+
+      if (should_print_nir())
+         printf("%s (%u blocks)\n", pass->name, w->count);
+
+      while (!nir_block_worklist_is_empty(w)) {
+         nir_block *block = nir_block_worklist_pop_head(w);
+
+         if (pass->block_pass(block)) {
+            impl_progress = true;
+            mark_block_and_neighbours_dirty(sched, i, block);
+         }
+      }
+
+      if (impl_progress) {
+         nir_metadata_preserve(sched->impls[i], nir_metadata_block_index |
+                                                nir_metadata_dominance);
+         progress = true;
+      }
+   }
+
+   if (progress) {
+      if (should_print_nir())
+         nir_print_shader(shader, stdout);
+      nir_validate_shader(shader);
+
+      sched->generation++;
+   }
+
+   return progress;
+}
+
+/** Runs the passes of the scheduler until none of them makes progress
+ *
+ * Unlike NIR_PASS, this never replaces the shader with a clone, even when
+ * NIR_TEST_CLONE is set, since the dirty tracking holds on to its blocks.
+ */
+bool
+nir_opt_scheduler_run(nir_opt_scheduler *sched, nir_shader *shader)
+{
+   bool progress = false;
+   bool round_progress;
+
+   sched->generation = 1;
+   for (unsigned p = 0; p < sched->num_passes; p++)
+      sched->passes[p].clean_generation = 0;
+
+   mark_all_dirty(sched, shader);
+
+   do {
+      round_progress = false;
+
+      for (unsigned p = 0; p < sched->num_passes; p++) {
+         struct opt_pass *pass = &sched->passes[p];
+
+         if (pass->block_pass)
+            round_progress |= run_block_pass(sched, pass, shader);
+         else
+            round_progress |= run_shader_pass(sched, pass, shader);
+      }
+
+      progress |= round_progress;
+   } while (round_progress);
+
+   ralloc_free(sched->dirty_ctx);
+   sched->dirty_ctx = NULL;
+   sched->impls = NULL;
+   sched->num_impls = 0;
+
+   return progress;
+}
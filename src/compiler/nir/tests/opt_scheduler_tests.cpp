@@ -0,0 +1,174 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+class nir_opt_scheduler_test : public ::testing::Test {
+protected:
+   nir_opt_scheduler_test();
+   ~nir_opt_scheduler_test();
+
+   unsigned count_instrs(nir_instr_type type);
+
+   nir_builder b;
+   nir_opt_scheduler *sched;
+};
+
+nir_opt_scheduler_test::nir_opt_scheduler_test()
+{
+   static const nir_shader_compiler_options options = { };
+   nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_VERTEX, &options);
+   sched = nir_opt_scheduler_create(b.shader);
+}
+
+nir_opt_scheduler_test::~nir_opt_scheduler_test()
+{
+   ralloc_free(b.shader);
+}
+
+unsigned
+nir_opt_scheduler_test::count_instrs(nir_instr_type type)
+{
+   unsigned count = 0;
+
+   nir_foreach_block(block, b.impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type == type)
+            count++;
+      }
+   }
+
+   return count;
+}
+
+struct pass_log {
+   unsigned calls;
+   unsigned progress_calls;
+};
+
+static bool
+no_progress_pass(nir_shader *shader, const void *data)
+{
+   struct pass_log *log = (struct pass_log *) data;
+
+   log->calls++;
+   return false;
+}
+
+/* Makes progress the first progress_calls times it runs */
+static bool
+progress_pass(nir_shader *shader, const void *data)
+{
+   struct pass_log *log = (struct pass_log *) data;
+
+   log->calls++;
+   if (log->progress_calls == 0)
+      return false;
+
+   log->progress_calls--;
+   nir_metadata_preserve(nir_shader_get_entrypoint(shader), nir_metadata_none);
+   return true;
+}
+
+TEST_F(nir_opt_scheduler_test, shader_pass_gets_its_data)
+{
+   struct pass_log log = { };
+
+   nir_opt_scheduler_add_shader_pass_with_data(sched, "no_progress_pass",
+                                               no_progress_pass, &log);
+
+   EXPECT_FALSE(nir_opt_scheduler_run(sched, b.shader));
+   EXPECT_EQ(1u, log.calls);
+}
+
+TEST_F(nir_opt_scheduler_test, clean_shader_pass_is_skipped)
+{
+   struct pass_log dirty = { 0, 1 };
+   struct pass_log clean = { };
+
+   /* The first pass makes progress in the first round, so a second round
+    * is run.  Nothing changed since the second pass last ran in the first
+    * round, so it's skipped in the second one.
+    */
+   nir_opt_scheduler_add_shader_pass_with_data(sched, "progress_pass",
+                                               progress_pass, &dirty);
+   nir_opt_scheduler_add_shader_pass_with_data(sched, "no_progress_pass",
+                                               no_progress_pass, &clean);
+
+   EXPECT_TRUE(nir_opt_scheduler_run(sched, b.shader));
+   EXPECT_EQ(2u, dirty.calls);
+   EXPECT_EQ(1u, clean.calls);
+
+   /* Running again starts from scratch */
+   EXPECT_FALSE(nir_opt_scheduler_run(sched, b.shader));
+   EXPECT_EQ(3u, dirty.calls);
+   EXPECT_EQ(2u, clean.calls);
+}
+
+TEST_F(nir_opt_scheduler_test, block_passes_fold_across_blocks)
+{
+   /* Create IR:
+    *
+    * a = 1 + 2;
+    * if (in != 0) {
+    *    out = mov(a) * 4;
+    * }
+    */
+   nir_variable *in = nir_variable_create(b.shader, nir_var_shader_in,
+                                          glsl_int_type(), "in");
+   nir_variable *out = nir_variable_create(b.shader, nir_var_shader_out,
+                                           glsl_int_type(), "out");
+
+   nir_ssa_def *a = nir_iadd(&b, nir_imm_int(&b, 1), nir_imm_int(&b, 2));
+   nir_ssa_def *cond = nir_ine(&b, nir_load_var(&b, in), nir_imm_int(&b, 0));
+
+   nir_if *nif = nir_push_if(&b, cond);
+   nir_store_var(&b, out, nir_imul(&b, nir_imov(&b, a), nir_imm_int(&b, 4)),
+                 0x1);
+   nir_pop_if(&b, nif);
+
+   nir_opt_scheduler_add_block_pass(sched, "nir_copy_prop",
+                                    nir_copy_prop_block);
+   nir_opt_scheduler_add_block_pass(sched, "nir_opt_constant_folding",
+                                    nir_opt_constant_folding_block);
+   nir_opt_scheduler_add_shader_pass(sched, "nir_opt_dce", nir_opt_dce);
+
+   EXPECT_TRUE(nir_opt_scheduler_run(sched, b.shader));
+
+   /* Only the condition is left */
+   EXPECT_EQ(1u, count_instrs(nir_instr_type_alu));
+
+   nir_block *then_block = nir_if_first_then_block(nif);
+   nir_intrinsic_instr *store =
+      nir_instr_as_intrinsic(nir_block_last_instr(then_block));
+   ASSERT_EQ(nir_intrinsic_store_var, store->intrinsic);
+   ASSERT_TRUE(store->src[0].is_ssa);
+
+   nir_instr *value = store->src[0].ssa->parent_instr;
+   ASSERT_EQ(nir_instr_type_load_const, value->type);
+   EXPECT_EQ(12u, nir_instr_as_load_const(value)->value.u32[0]);
+
+   /* Nothing is left to do */
+   EXPECT_FALSE(nir_opt_scheduler_run(sched, b.shader));
+}
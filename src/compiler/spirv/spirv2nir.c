@@ -29,6 +29,11 @@
  * A simple executable that opens a SPIR-V shader, converts it to NIR, and
  * dumps out the result.  This should be useful for testing the
  * spirv_to_nir code.
+ *
+ * Usage: spirv2nir [-s stage] [-e entry_point] [-b iterations] file.spv
+ *
+ * With -b, the module is translated the given number of times and the
+ * average translation time is printed instead of the NIR.
  */
 
 #include "spirv/nir_spirv.h"
@@ -38,17 +43,82 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 
 #define WORD_SIZE 4
 
+static const char *stage_names[] = {
+   [MESA_SHADER_VERTEX] = "vertex",
+   [MESA_SHADER_TESS_CTRL] = "tess-ctrl",
+   [MESA_SHADER_TESS_EVAL] = "tess-eval",
+   [MESA_SHADER_GEOMETRY] = "geometry",
+   [MESA_SHADER_FRAGMENT] = "fragment",
+   [MESA_SHADER_COMPUTE] = "compute",
+};
+
+static int64_t
+get_time_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static void
+usage(const char *name)
+{
+   fprintf(stderr, "Usage: %s [-s stage] [-e entry_point] [-b iterations] "
+           "file.spv\n", name);
+   fprintf(stderr, "stages: vertex, tess-ctrl, tess-eval, geometry, "
+           "fragment (default), compute\n");
+}
+
 int main(int argc, char **argv)
 {
-   int fd = open(argv[1], O_RDONLY);
+   gl_shader_stage stage = MESA_SHADER_FRAGMENT;
+   const char *entry_point = "main";
+   unsigned iterations = 0;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "s:e:b:")) != -1) {
+      switch (opt) {
+      case 's': {
+         unsigned i;
+         for (i = 0; i < MESA_SHADER_STAGES; i++) {
+            if (strcmp(optarg, stage_names[i]) == 0)
+               break;
+         }
+         if (i == MESA_SHADER_STAGES) {
+            usage(argv[0]);
+            return 1;
+         }
+         stage = i;
+         break;
+      }
+      case 'e':
+         entry_point = optarg;
+         break;
+      case 'b':
+         iterations = strtoul(optarg, NULL, 0);
+         break;
+      default:
+         usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if (optind != argc - 1) {
+      usage(argv[0]);
+      return 1;
+   }
+
+   int fd = open(argv[optind], O_RDONLY);
    if (fd < 0)
    {
-      fprintf(stderr, "Failed to open %s\n", argv[1]);
+      fprintf(stderr, "Failed to open %s\n", argv[optind]);
       return 1;
    }
 
@@ -72,8 +142,35 @@ int main(int argc, char **argv)
       return 1;
    }
 
+   /* spirv_to_nir() returns NULL if there's no such entry point.  This
+    * also serves as a warm-up run when timing.
+    */
    nir_function *func = spirv_to_nir(map, word_count, NULL, 0,
-                                     MESA_SHADER_FRAGMENT, "main", NULL, NULL);
+                                     stage, entry_point, NULL, NULL);
+   if (!func) {
+      fprintf(stderr, "Failed to find entry point \"%s\" in %s\n",
+              entry_point, argv[optind]);
+      return 1;
+   }
+
+   if (iterations) {
+      ralloc_free(func->shader);
+
+      int64_t start = get_time_ns();
+
+      for (unsigned i = 0; i < iterations; i++) {
+         func = spirv_to_nir(map, word_count, NULL, 0,
+                             stage, entry_point, NULL, NULL);
+         ralloc_free(func->shader);
+      }
+
+      int64_t elapsed = get_time_ns() - start;
+      printf("%s: %zu words, %u iterations, %.3f ms per module\n",
+             argv[optind], word_count, iterations,
+             elapsed / 1000000.0 / iterations);
+      return 0;
+   }
+
    nir_print_shader(func->shader, stderr);
 
    return 0;
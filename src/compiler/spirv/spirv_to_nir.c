@@ -57,7 +57,7 @@ _vtn_warn(const char *file, int line, const char *msg, ...)
 static struct vtn_ssa_value *
 vtn_undef_ssa_value(struct vtn_builder *b, const struct glsl_type *type)
 {
-   struct vtn_ssa_value *val = rzalloc(b, struct vtn_ssa_value);
+   struct vtn_ssa_value *val = vtn_zalloc(b, struct vtn_ssa_value);
    val->type = type;
 
    if (glsl_type_is_vector_or_scalar(type)) {
@@ -66,7 +66,7 @@ vtn_undef_ssa_value(struct vtn_builder *b, const struct glsl_type *type)
       val->def = nir_ssa_undef(&b->nb, num_components, bit_size);
    } else {
       unsigned elems = glsl_get_length(val->type);
-      val->elems = ralloc_array(b, struct vtn_ssa_value *, elems);
+      val->elems = vtn_alloc_array(b, struct vtn_ssa_value *, elems);
       if (glsl_type_is_matrix(type)) {
          const struct glsl_type *elem_type =
             glsl_vector_type(glsl_get_base_type(type),
@@ -98,7 +98,7 @@ vtn_const_ssa_value(struct vtn_builder *b, nir_constant *constant,
    if (entry)
       return entry->data;
 
-   struct vtn_ssa_value *val = rzalloc(b, struct vtn_ssa_value);
+   struct vtn_ssa_value *val = vtn_zalloc(b, struct vtn_ssa_value);
    val->type = type;
 
    switch (glsl_get_base_type(type)) {
@@ -123,10 +123,10 @@ vtn_const_ssa_value(struct vtn_builder *b, nir_constant *constant,
          assert(glsl_type_is_matrix(type));
          unsigned rows = glsl_get_vector_elements(val->type);
          unsigned columns = glsl_get_matrix_columns(val->type);
-         val->elems = ralloc_array(b, struct vtn_ssa_value *, columns);
+         val->elems = vtn_alloc_array(b, struct vtn_ssa_value *, columns);
 
          for (unsigned i = 0; i < columns; i++) {
-            struct vtn_ssa_value *col_val = rzalloc(b, struct vtn_ssa_value);
+            struct vtn_ssa_value *col_val = vtn_zalloc(b, struct vtn_ssa_value);
             col_val->type = glsl_get_column_type(val->type);
             nir_load_const_instr *load =
                nir_load_const_instr_create(b->shader, rows, bit_size);
@@ -144,7 +144,7 @@ vtn_const_ssa_value(struct vtn_builder *b, nir_constant *constant,
 
    case GLSL_TYPE_ARRAY: {
       unsigned elems = glsl_get_length(val->type);
-      val->elems = ralloc_array(b, struct vtn_ssa_value *, elems);
+      val->elems = vtn_alloc_array(b, struct vtn_ssa_value *, elems);
       const struct glsl_type *elem_type = glsl_get_array_element(val->type);
       for (unsigned i = 0; i < elems; i++)
          val->elems[i] = vtn_const_ssa_value(b, constant->elements[i],
@@ -154,7 +154,7 @@ vtn_const_ssa_value(struct vtn_builder *b, nir_constant *constant,
 
    case GLSL_TYPE_STRUCT: {
       unsigned elems = glsl_get_length(val->type);
-      val->elems = ralloc_array(b, struct vtn_ssa_value *, elems);
+      val->elems = vtn_alloc_array(b, struct vtn_ssa_value *, elems);
       for (unsigned i = 0; i < elems; i++) {
          const struct glsl_type *elem_type =
             glsl_get_struct_field(val->type, i);
@@ -201,11 +201,16 @@ static char *
 vtn_string_literal(struct vtn_builder *b, const uint32_t *words,
                    unsigned word_count, unsigned *words_used)
 {
-   char *dup = ralloc_strndup(b, (char *)words, word_count * sizeof(*words));
+   const char *str = (const char *)words;
+   unsigned len = strnlen(str, word_count * sizeof(*words));
+
+   char *dup = linear_alloc_child(b->lin_ctx, len + 1);
+   memcpy(dup, str, len);
+   dup[len] = '\0';
+
    if (words_used) {
       /* Ammount of space taken by the string (including the null) */
-      unsigned len = strlen(dup) + 1;
-      *words_used = DIV_ROUND_UP(len, sizeof(*words));
+      *words_used = DIV_ROUND_UP(len + 1, sizeof(*words));
    }
    return dup;
 }
@@ -280,48 +285,30 @@ vtn_handle_extension(struct vtn_builder *b, SpvOp opcode,
    }
 }
 
-static void
-_foreach_decoration_helper(struct vtn_builder *b,
-                           struct vtn_value *base_value,
-                           int parent_member,
-                           struct vtn_value *value,
-                           vtn_decoration_foreach_cb cb, void *data)
+/** Iterates over all of the decorations on a value
+ *
+ * This includes the decorations applied through a decoration group, which
+ * are copied to the value by OpGroupDecorate and OpGroupMemberDecorate.
+ */
+void
+vtn_foreach_decoration(struct vtn_builder *b, struct vtn_value *value,
+                       vtn_decoration_foreach_cb cb, void *data)
 {
    for (struct vtn_decoration *dec = value->decoration; dec; dec = dec->next) {
       int member;
       if (dec->scope == VTN_DEC_DECORATION) {
-         member = parent_member;
+         member = -1;
       } else if (dec->scope >= VTN_DEC_STRUCT_MEMBER0) {
-         assert(parent_member == -1);
          member = dec->scope - VTN_DEC_STRUCT_MEMBER0;
       } else {
          /* Not a decoration */
          continue;
       }
 
-      if (dec->group) {
-         assert(dec->group->value_type == vtn_value_type_decoration_group);
-         _foreach_decoration_helper(b, base_value, member, dec->group,
-                                    cb, data);
-      } else {
-         cb(b, base_value, member, dec, data);
-      }
+      cb(b, value, member, dec, data);
    }
 }
 
-/** Iterates (recursively if needed) over all of the decorations on a value
- *
- * This function iterates over all of the decorations applied to a given
- * value.  If it encounters a decoration group, it recurses into the group
- * and iterates over all of those decorations as well.
- */
-void
-vtn_foreach_decoration(struct vtn_builder *b, struct vtn_value *value,
-                       vtn_decoration_foreach_cb cb, void *data)
-{
-   _foreach_decoration_helper(b, value, -1, value, cb, data);
-}
-
 void
 vtn_foreach_execution_mode(struct vtn_builder *b, struct vtn_value *value,
                            vtn_execution_mode_foreach_cb cb, void *data)
@@ -330,7 +317,6 @@ vtn_foreach_execution_mode(struct vtn_builder *b, struct vtn_value *value,
       if (dec->scope != VTN_DEC_EXECUTION_MODE)
          continue;
 
-      assert(dec->group == NULL);
       cb(b, value, dec, data);
    }
 }
@@ -353,7 +339,7 @@ vtn_handle_decoration(struct vtn_builder *b, SpvOp opcode,
    case SpvOpExecutionMode: {
       struct vtn_value *val = &b->values[target];
 
-      struct vtn_decoration *dec = rzalloc(b, struct vtn_decoration);
+      struct vtn_decoration *dec = vtn_zalloc(b, struct vtn_decoration);
       switch (opcode) {
       case SpvOpDecorate:
          dec->scope = VTN_DEC_DECORATION;
@@ -383,18 +369,29 @@ vtn_handle_decoration(struct vtn_builder *b, SpvOp opcode,
 
       for (; w < w_end; w++) {
          struct vtn_value *val = vtn_untyped_value(b, *w);
-         struct vtn_decoration *dec = rzalloc(b, struct vtn_decoration);
+         int member_scope = VTN_DEC_DECORATION;
+         if (opcode == SpvOpGroupMemberDecorate)
+            member_scope = VTN_DEC_STRUCT_MEMBER0 + *(++w);
+
+         /* All the decorations targeting a group precede its
+          * OpDecorationGroup, so the group is complete by now.  Copy them to
+          * the target so that iterating over the decorations of a value
+          * never has to walk into groups.
+          */
+         for (struct vtn_decoration *group_dec = group->decoration;
+              group_dec; group_dec = group_dec->next) {
+            struct vtn_decoration *dec = vtn_alloc(b, struct vtn_decoration);
+            *dec = *group_dec;
+
+            if (opcode == SpvOpGroupMemberDecorate) {
+               assert(group_dec->scope == VTN_DEC_DECORATION);
+               dec->scope = member_scope;
+            }
 
-         dec->group = group;
-         if (opcode == SpvOpGroupDecorate) {
-            dec->scope = VTN_DEC_DECORATION;
-         } else {
-            dec->scope = VTN_DEC_STRUCT_MEMBER0 + *(++w);
+            /* Link into the list */
+            dec->next = val->decoration;
+            val->decoration = dec;
          }
-
-         /* Link into the list */
-         dec->next = val->decoration;
-         val->decoration = dec;
       }
       break;
    }
@@ -415,7 +412,7 @@ struct member_decoration_ctx {
 static struct vtn_type *
 vtn_type_copy(struct vtn_builder *b, struct vtn_type *src)
 {
-   struct vtn_type *dest = ralloc(b, struct vtn_type);
+   struct vtn_type *dest = vtn_alloc(b, struct vtn_type);
    *dest = *src;
 
    switch (src->base_type) {
@@ -431,17 +428,17 @@ vtn_type_copy(struct vtn_builder *b, struct vtn_type *src)
       break;
 
    case vtn_base_type_struct:
-      dest->members = ralloc_array(b, struct vtn_type *, src->length);
+      dest->members = vtn_alloc_array(b, struct vtn_type *, src->length);
       memcpy(dest->members, src->members,
              src->length * sizeof(src->members[0]));
 
-      dest->offsets = ralloc_array(b, unsigned, src->length);
+      dest->offsets = vtn_alloc_array(b, unsigned, src->length);
       memcpy(dest->offsets, src->offsets,
              src->length * sizeof(src->offsets[0]));
       break;
 
    case vtn_base_type_function:
-      dest->params = ralloc_array(b, struct vtn_type *, src->length);
+      dest->params = vtn_alloc_array(b, struct vtn_type *, src->length);
       memcpy(dest->params, src->params, src->length * sizeof(src->params[0]));
       break;
    }
@@ -735,7 +732,7 @@ vtn_handle_type(struct vtn_builder *b, SpvOp opcode,
 {
    struct vtn_value *val = vtn_push_value(b, w[1], vtn_value_type_type);
 
-   val->type = rzalloc(b, struct vtn_type);
+   val->type = vtn_zalloc(b, struct vtn_type);
    val->type->val = val;
 
    switch (opcode) {
@@ -817,8 +814,8 @@ vtn_handle_type(struct vtn_builder *b, SpvOp opcode,
       unsigned num_fields = count - 2;
       val->type->base_type = vtn_base_type_struct;
       val->type->length = num_fields;
-      val->type->members = ralloc_array(b, struct vtn_type *, num_fields);
-      val->type->offsets = ralloc_array(b, unsigned, num_fields);
+      val->type->members = vtn_alloc_array(b, struct vtn_type *, num_fields);
+      val->type->offsets = vtn_alloc_array(b, unsigned, num_fields);
 
       NIR_VLA(struct glsl_struct_field, fields, count);
       for (unsigned i = 0; i < num_fields; i++) {
@@ -826,7 +823,7 @@ vtn_handle_type(struct vtn_builder *b, SpvOp opcode,
             vtn_value(b, w[i + 2], vtn_value_type_type)->type;
          fields[i] = (struct glsl_struct_field) {
             .type = val->type->members[i]->type,
-            .name = ralloc_asprintf(b, "field%d", i),
+            .name = linear_asprintf(b->lin_ctx, "field%d", i),
             .location = -1,
          };
       }
@@ -854,7 +851,7 @@ vtn_handle_type(struct vtn_builder *b, SpvOp opcode,
 
       const unsigned num_params = count - 3;
       val->type->length = num_params;
-      val->type->params = ralloc_array(b, struct vtn_type *, num_params);
+      val->type->params = vtn_alloc_array(b, struct vtn_type *, num_params);
       for (unsigned i = 0; i < count - 3; i++) {
          val->type->params[i] =
             vtn_value(b, w[i + 3], vtn_value_type_type)->type;
@@ -1437,12 +1434,12 @@ vtn_handle_function_call(struct vtn_builder *b, SpvOp opcode,
 struct vtn_ssa_value *
 vtn_create_ssa_value(struct vtn_builder *b, const struct glsl_type *type)
 {
-   struct vtn_ssa_value *val = rzalloc(b, struct vtn_ssa_value);
+   struct vtn_ssa_value *val = vtn_zalloc(b, struct vtn_ssa_value);
    val->type = type;
 
    if (!glsl_type_is_vector_or_scalar(type)) {
       unsigned elems = glsl_get_length(type);
-      val->elems = ralloc_array(b, struct vtn_ssa_value *, elems);
+      val->elems = vtn_alloc_array(b, struct vtn_ssa_value *, elems);
       for (unsigned i = 0; i < elems; i++) {
          const struct glsl_type *child_type;
 
@@ -1489,7 +1486,7 @@ vtn_handle_texture(struct vtn_builder *b, SpvOp opcode,
    if (opcode == SpvOpSampledImage) {
       struct vtn_value *val =
          vtn_push_value(b, w[2], vtn_value_type_sampled_image);
-      val->sampled_image = ralloc(b, struct vtn_sampled_image);
+      val->sampled_image = vtn_alloc(b, struct vtn_sampled_image);
       val->sampled_image->image =
          vtn_value(b, w[3], vtn_value_type_pointer)->pointer;
       val->sampled_image->sampler =
@@ -1904,7 +1901,7 @@ vtn_handle_image(struct vtn_builder *b, SpvOp opcode,
    if (opcode == SpvOpImageTexelPointer) {
       struct vtn_value *val =
          vtn_push_value(b, w[2], vtn_value_type_image_pointer);
-      val->image = ralloc(b, struct vtn_image_pointer);
+      val->image = vtn_alloc(b, struct vtn_image_pointer);
 
       val->image->image = vtn_value(b, w[3], vtn_value_type_pointer)->pointer;
       val->image->coord = get_image_coord(b, w[4]);
@@ -2257,7 +2254,7 @@ vtn_handle_ssbo_or_shared_atomic(struct vtn_builder *b, SpvOp opcode,
                         glsl_get_bit_size(type->type), NULL);
 
       struct vtn_value *val = vtn_push_value(b, w[2], vtn_value_type_ssa);
-      val->ssa = rzalloc(b, struct vtn_ssa_value);
+      val->ssa = vtn_zalloc(b, struct vtn_ssa_value);
       val->ssa->def = &atomic->dest.ssa;
       val->ssa->type = type->type;
    }
@@ -2435,9 +2432,9 @@ vtn_vector_construct(struct vtn_builder *b, unsigned num_components,
 }
 
 static struct vtn_ssa_value *
-vtn_composite_copy(void *mem_ctx, struct vtn_ssa_value *src)
+vtn_composite_copy(struct vtn_builder *b, struct vtn_ssa_value *src)
 {
-   struct vtn_ssa_value *dest = rzalloc(mem_ctx, struct vtn_ssa_value);
+   struct vtn_ssa_value *dest = vtn_zalloc(b, struct vtn_ssa_value);
    dest->type = src->type;
 
    if (glsl_type_is_vector_or_scalar(src->type)) {
@@ -2445,9 +2442,9 @@ vtn_composite_copy(void *mem_ctx, struct vtn_ssa_value *src)
    } else {
       unsigned elems = glsl_get_length(src->type);
 
-      dest->elems = ralloc_array(mem_ctx, struct vtn_ssa_value *, elems);
+      dest->elems = vtn_alloc_array(b, struct vtn_ssa_value *, elems);
       for (unsigned i = 0; i < elems; i++)
-         dest->elems[i] = vtn_composite_copy(mem_ctx, src->elems[i]);
+         dest->elems[i] = vtn_composite_copy(b, src->elems[i]);
    }
 
    return dest;
@@ -2493,7 +2490,7 @@ vtn_composite_extract(struct vtn_builder *b, struct vtn_ssa_value *src,
           * vector to extract.
           */
 
-         struct vtn_ssa_value *ret = rzalloc(b, struct vtn_ssa_value);
+         struct vtn_ssa_value *ret = vtn_zalloc(b, struct vtn_ssa_value);
          ret->type = glsl_scalar_type(glsl_get_base_type(cur->type));
          ret->def = vtn_vector_extract(b, cur->def, indices[i]);
          return ret;
@@ -2543,7 +2540,7 @@ vtn_handle_composite(struct vtn_builder *b, SpvOp opcode,
             vtn_vector_construct(b, glsl_get_vector_elements(type),
                                  elems, srcs);
       } else {
-         val->ssa->elems = ralloc_array(b, struct vtn_ssa_value *, elems);
+         val->ssa->elems = vtn_alloc_array(b, struct vtn_ssa_value *, elems);
          for (unsigned i = 0; i < elems; i++)
             val->ssa->elems[i] = vtn_ssa_value(b, w[3 + i]);
       }
@@ -3338,6 +3335,7 @@ spirv_to_nir(const uint32_t *words, size_t word_count,
    struct vtn_builder *b = rzalloc(NULL, struct vtn_builder);
    b->value_id_bound = value_id_bound;
    b->values = rzalloc_array(b, struct vtn_value, value_id_bound);
+   b->lin_ctx = linear_alloc_parent(b, 0);
    exec_list_make_empty(&b->functions);
    b->entry_point_stage = stage;
    b->entry_point_name = entry_point_name;
@@ -31,7 +31,7 @@ vtn_cfg_handle_prepass_instruction(struct vtn_builder *b, SpvOp opcode,
    switch (opcode) {
    case SpvOpFunction: {
       assert(b->func == NULL);
-      b->func = rzalloc(b, struct vtn_function);
+      b->func = vtn_zalloc(b, struct vtn_function);
 
       list_inithead(&b->func->body);
       b->func->control = w[3];
@@ -84,7 +84,7 @@ vtn_cfg_handle_prepass_instruction(struct vtn_builder *b, SpvOp opcode,
       nir_variable *param = b->func->impl->params[b->func_param_idx++];
 
       if (type->base_type == vtn_base_type_pointer && type->type == NULL) {
-         struct vtn_variable *vtn_var = rzalloc(b, struct vtn_variable);
+         struct vtn_variable *vtn_var = vtn_zalloc(b, struct vtn_variable);
          vtn_var->type = type->deref;
          vtn_var->var = param;
 
@@ -125,7 +125,7 @@ vtn_cfg_handle_prepass_instruction(struct vtn_builder *b, SpvOp opcode,
 
    case SpvOpLabel: {
       assert(b->block == NULL);
-      b->block = rzalloc(b, struct vtn_block);
+      b->block = vtn_zalloc(b, struct vtn_block);
       b->block->node.type = vtn_cf_node_type_block;
       b->block->label = w;
       vtn_push_value(b, w[1], vtn_value_type_block)->block = b->block;
@@ -180,7 +180,7 @@ vtn_add_case(struct vtn_builder *b, struct vtn_switch *swtch,
       return;
 
    if (case_block->switch_case == NULL) {
-      struct vtn_case *c = ralloc(b, struct vtn_case);
+      struct vtn_case *c = vtn_alloc(b, struct vtn_case);
 
       list_inithead(&c->body);
       c->start_block = case_block;
@@ -263,7 +263,7 @@ vtn_cfg_walk_blocks(struct vtn_builder *b, struct list_head *cf_list,
    while (block != end) {
       if (block->merge && (*block->merge & SpvOpCodeMask) == SpvOpLoopMerge &&
           !block->loop) {
-         struct vtn_loop *loop = ralloc(b, struct vtn_loop);
+         struct vtn_loop *loop = vtn_alloc(b, struct vtn_loop);
 
          loop->node.type = vtn_cf_node_type_loop;
          list_inithead(&loop->body);
@@ -335,7 +335,7 @@ vtn_cfg_walk_blocks(struct vtn_builder *b, struct list_head *cf_list,
          struct vtn_block *else_block =
             vtn_value(b, block->branch[3], vtn_value_type_block)->block;
 
-         struct vtn_if *if_stmt = ralloc(b, struct vtn_if);
+         struct vtn_if *if_stmt = vtn_alloc(b, struct vtn_if);
 
          if_stmt->node.type = vtn_cf_node_type_if;
          if_stmt->condition = block->branch[1];
@@ -404,7 +404,7 @@ vtn_cfg_walk_blocks(struct vtn_builder *b, struct list_head *cf_list,
          struct vtn_block *break_block =
             vtn_value(b, block->merge[1], vtn_value_type_block)->block;
 
-         struct vtn_switch *swtch = ralloc(b, struct vtn_switch);
+         struct vtn_switch *swtch = vtn_alloc(b, struct vtn_switch);
 
          swtch->node.type = vtn_cf_node_type_switch;
          swtch->selector = block->branch[1];
@@ -451,7 +451,6 @@ struct vtn_decoration {
    int scope;
 
    const uint32_t *literals;
-   struct vtn_value *group;
 
    union {
       SpvDecoration decoration;
@@ -506,8 +505,22 @@ struct vtn_builder {
    unsigned func_param_idx;
 
    bool has_loop_continue;
+
+   /* Linear allocator for the vtn_* structures, which all live as long as
+    * the builder.
+    */
+   void *lin_ctx;
 };
 
+#define vtn_alloc(b, type) \
+   ((type *) linear_alloc_child((b)->lin_ctx, sizeof(type)))
+#define vtn_zalloc(b, type) \
+   ((type *) linear_zalloc_child((b)->lin_ctx, sizeof(type)))
+#define vtn_alloc_array(b, type, count) \
+   ((type *) linear_alloc_child((b)->lin_ctx, sizeof(type) * (count)))
+#define vtn_zalloc_array(b, type, count) \
+   ((type *) linear_zalloc_child((b)->lin_ctx, sizeof(type) * (count)))
+
 nir_ssa_def *
 vtn_pointer_to_ssa(struct vtn_builder *b, struct vtn_pointer *ptr);
 struct vtn_pointer *
@@ -36,12 +36,14 @@
   */
 
 #include "pipe/p_state.h"
+#include "os/os_thread.h"
 #include "util/u_draw.h"
 #include "util/u_framebuffer.h"
 #include "util/u_inlines.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_vbuf.h"
+#include "util/list.h"
 #include "tgsi/tgsi_parse.h"
 
 #include "cso_cache/cso_context.h"
@@ -61,9 +63,34 @@ struct sampler_info
 
 
 
+/**
+ * A cso_cache shared by all the cso_contexts of a screen, for drivers
+ * whose states don't depend on the context which created them.
+ *
+ * The cso_contexts hold a reference on it, and the last one deletes the
+ * states.  Entries are evicted like in private caches, except for the
+ * states bound or saved by any of the contexts using it, which is why the
+ * contexts bind states with the mutex held.
+ */
+struct cso_shared_cache {
+   struct pipe_screen *screen;
+   struct cso_cache *cache;
+   mtx_t mutex;
+   unsigned refcount;
+   struct list_head contexts; /**< cso_contexts using it, under mutex */
+   struct cso_shared_cache *next;
+};
+
+/** The shared caches of all screens, protected by shared_caches_mutex. */
+static struct cso_shared_cache *shared_caches;
+static mtx_t shared_caches_mutex = _MTX_INITIALIZER_NP;
+
+
 struct cso_context {
    struct pipe_context *pipe;
    struct cso_cache *cache;
+   struct cso_shared_cache *shared; /**< NULL if the cache is private */
+   struct list_head shared_link;    /**< in shared->contexts */
    struct u_vbuf *vbuf;
 
    boolean has_geometry_shader;
@@ -129,15 +156,89 @@ struct cso_context {
 };
 
 
+/**
+ * Whether the given cso_blend, cso_sampler, etc. is bound or saved by ctx.
+ */
+static boolean
+cso_context_binds(const struct cso_context *ctx, const void *state,
+                  enum cso_cache_type type)
+{
+   unsigned i, j;
+
+   switch (type) {
+   case CSO_BLEND: {
+      const struct cso_blend *cso = state;
+      return ctx->blend == cso->data || ctx->blend_saved == cso->data;
+   }
+   case CSO_DEPTH_STENCIL_ALPHA: {
+      const struct cso_depth_stencil_alpha *cso = state;
+      return ctx->depth_stencil == cso->data ||
+             ctx->depth_stencil_saved == cso->data;
+   }
+   case CSO_RASTERIZER: {
+      const struct cso_rasterizer *cso = state;
+      return ctx->rasterizer == cso->data ||
+             ctx->rasterizer_saved == cso->data;
+   }
+   case CSO_VELEMENTS: {
+      const struct cso_velements *cso = state;
+      return ctx->velements == cso->data || ctx->velements_saved == cso->data;
+   }
+   case CSO_SAMPLER:
+      for (i = 0; i < PIPE_SHADER_TYPES; i++) {
+         for (j = 0; j < PIPE_MAX_SAMPLERS; j++) {
+            if (ctx->samplers[i].cso_samplers[j] == state)
+               return TRUE;
+         }
+      }
+      for (j = 0; j < PIPE_MAX_SAMPLERS; j++) {
+         if (ctx->fragment_samplers_saved.cso_samplers[j] == state)
+            return TRUE;
+      }
+      return FALSE;
+   default:
+      return FALSE;
+   }
+}
+
+/**
+ * Whether a state can't be deleted because a context still uses it.
+ */
+static boolean
+cso_state_in_use(const struct cso_context *ctx, const void *state,
+                 enum cso_cache_type type)
+{
+   const struct cso_context *other;
+
+   if (!ctx->shared)
+      return cso_context_binds(ctx, state, type);
+
+   LIST_FOR_EACH_ENTRY(other, &ctx->shared->contexts, shared_link) {
+      if (cso_context_binds(other, state, type))
+         return TRUE;
+   }
+   return FALSE;
+}
+
+/**
+ * The context to delete a state with.  Shared states don't depend on the
+ * context which created them, which may be gone already.
+ */
+static inline struct pipe_context *
+cso_delete_context(const struct cso_context *ctx, struct pipe_context *owner)
+{
+   return ctx->shared ? ctx->pipe : owner;
+}
+
 static boolean delete_blend_state(struct cso_context *ctx, void *state)
 {
    struct cso_blend *cso = (struct cso_blend *)state;
 
-   if (ctx->blend == cso->data)
+   if (cso_state_in_use(ctx, cso, CSO_BLEND))
       return FALSE;
 
    if (cso->delete_state)
-      cso->delete_state(cso->context, cso->data);
+      cso->delete_state(cso_delete_context(ctx, cso->context), cso->data);
    FREE(state);
    return TRUE;
 }
@@ -147,11 +248,11 @@ static boolean delete_depth_stencil_state(struct cso_context *ctx, void *state)
    struct cso_depth_stencil_alpha *cso =
       (struct cso_depth_stencil_alpha *)state;
 
-   if (ctx->depth_stencil == cso->data)
+   if (cso_state_in_use(ctx, cso, CSO_DEPTH_STENCIL_ALPHA))
       return FALSE;
 
    if (cso->delete_state)
-      cso->delete_state(cso->context, cso->data);
+      cso->delete_state(cso_delete_context(ctx, cso->context), cso->data);
    FREE(state);
 
    return TRUE;
@@ -160,8 +261,12 @@ static boolean delete_depth_stencil_state(struct cso_context *ctx, void *state)
 static boolean delete_sampler_state(struct cso_context *ctx, void *state)
 {
    struct cso_sampler *cso = (struct cso_sampler *)state;
+
+   if (cso_state_in_use(ctx, cso, CSO_SAMPLER))
+      return FALSE;
+
    if (cso->delete_state)
-      cso->delete_state(cso->context, cso->data);
+      cso->delete_state(cso_delete_context(ctx, cso->context), cso->data);
    FREE(state);
    return TRUE;
 }
@@ -170,10 +275,10 @@ static boolean delete_rasterizer_state(struct cso_context *ctx, void *state)
 {
    struct cso_rasterizer *cso = (struct cso_rasterizer *)state;
 
-   if (ctx->rasterizer == cso->data)
+   if (cso_state_in_use(ctx, cso, CSO_RASTERIZER))
       return FALSE;
    if (cso->delete_state)
-      cso->delete_state(cso->context, cso->data);
+      cso->delete_state(cso_delete_context(ctx, cso->context), cso->data);
    FREE(state);
    return TRUE;
 }
@@ -183,11 +288,11 @@ static boolean delete_vertex_elements(struct cso_context *ctx,
 {
    struct cso_velements *cso = (struct cso_velements *)state;
 
-   if (ctx->velements == cso->data)
+   if (cso_state_in_use(ctx, cso, CSO_VELEMENTS))
       return FALSE;
 
    if (cso->delete_state)
-      cso->delete_state(cso->context, cso->data);
+      cso->delete_state(cso_delete_context(ctx, cso->context), cso->data);
    FREE(state);
    return TRUE;
 }
@@ -225,8 +330,6 @@ sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
    int max_entries = (max_size > hash_size) ? max_size : hash_size;
    int to_remove =  (max_size < max_entries) * max_entries/4;
    struct cso_hash_iter iter;
-   struct cso_sampler **samplers_to_restore = NULL;
-   unsigned to_restore = 0;
 
    if (hash_size > max_size)
       to_remove += hash_size - max_size;
@@ -234,25 +337,6 @@ sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
    if (to_remove == 0)
       return;
 
-   if (type == CSO_SAMPLER) {
-      int i, j;
-
-      samplers_to_restore = MALLOC(PIPE_SHADER_TYPES * PIPE_MAX_SAMPLERS *
-                                   sizeof(*samplers_to_restore));
-
-      /* Temporarily remove currently bound sampler states from the hash
-       * table, to prevent them from being deleted
-       */
-      for (i = 0; i < PIPE_SHADER_TYPES; i++) {
-         for (j = 0; j < PIPE_MAX_SAMPLERS; j++) {
-            struct cso_sampler *sampler = ctx->samplers[i].cso_samplers[j];
-
-            if (sampler && cso_hash_take(hash, sampler->hash_key))
-               samplers_to_restore[to_restore++] = sampler;
-         }
-      }
-   }
-
    iter = cso_hash_first_node(hash);
    while (to_remove) {
       /*remove elements until we're good */
@@ -262,23 +346,147 @@ sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
       if (!cso)
          break;
 
+      /* states still bound are skipped by delete_cso() */
       if (delete_cso(ctx, cso, type)) {
          iter = cso_hash_erase(hash, iter);
          --to_remove;
       } else
          iter = cso_hash_iter_next(iter);
    }
+}
+
+/**
+ * Sanitize callback of shared caches.  The states are deleted with the
+ * first context using the cache, the one inserting the new state holds
+ * the mutex.
+ */
+static void
+sanitize_shared_hash(struct cso_hash *hash, enum cso_cache_type type,
+                     int max_size, void *user_data)
+{
+   struct cso_shared_cache *sc = (struct cso_shared_cache *)user_data;
+
+   assert(!LIST_IS_EMPTY(&sc->contexts));
+   sanitize_hash(hash, type, max_size,
+                 LIST_ENTRY(struct cso_context, sc->contexts.next,
+                            shared_link));
+}
+
+static struct cso_shared_cache *
+cso_shared_cache_reference(struct pipe_screen *screen)
+{
+   struct cso_shared_cache *sc;
 
-   if (type == CSO_SAMPLER) {
-      /* Put currently bound sampler states back into the hash table */
-      while (to_restore--) {
-         struct cso_sampler *sampler = samplers_to_restore[to_restore];
+   mtx_lock(&shared_caches_mutex);
 
-         cso_hash_insert(hash, sampler->hash_key, sampler);
+   for (sc = shared_caches; sc; sc = sc->next) {
+      if (sc->screen == screen)
+         break;
+   }
+
+   if (!sc) {
+      sc = CALLOC_STRUCT(cso_shared_cache);
+      if (!sc)
+         goto out;
+
+      sc->cache = cso_cache_create();
+      if (!sc->cache) {
+         FREE(sc);
+         sc = NULL;
+         goto out;
       }
+      cso_cache_set_sanitize_callback(sc->cache, sanitize_shared_hash, sc);
 
-      FREE(samplers_to_restore);
+      (void) mtx_init(&sc->mutex, mtx_plain);
+      list_inithead(&sc->contexts);
+      sc->screen = screen;
+      sc->next = shared_caches;
+      shared_caches = sc;
    }
+
+   sc->refcount++;
+
+out:
+   mtx_unlock(&shared_caches_mutex);
+   return sc;
+}
+
+static void
+set_blend_context(void *state, void *pipe)
+{
+   ((struct cso_blend *)state)->context = pipe;
+}
+
+static void
+set_depth_stencil_context(void *state, void *pipe)
+{
+   ((struct cso_depth_stencil_alpha *)state)->context = pipe;
+}
+
+static void
+set_rasterizer_context(void *state, void *pipe)
+{
+   ((struct cso_rasterizer *)state)->context = pipe;
+}
+
+static void
+set_sampler_context(void *state, void *pipe)
+{
+   ((struct cso_sampler *)state)->context = pipe;
+}
+
+static void
+set_velements_context(void *state, void *pipe)
+{
+   ((struct cso_velements *)state)->context = pipe;
+}
+
+static void
+cso_shared_cache_unreference(struct cso_shared_cache *sc,
+                             struct pipe_context *pipe)
+{
+   struct cso_shared_cache **link;
+
+   mtx_lock(&shared_caches_mutex);
+
+   if (--sc->refcount) {
+      mtx_unlock(&shared_caches_mutex);
+      return;
+   }
+
+   for (link = &shared_caches; *link != sc; link = &(*link)->next)
+      ;
+   *link = sc->next;
+
+   mtx_unlock(&shared_caches_mutex);
+
+   /* The contexts which created the states may be gone already, so
+    * delete all of them with the last context.
+    */
+   cso_for_each_state(sc->cache, CSO_BLEND, set_blend_context, pipe);
+   cso_for_each_state(sc->cache, CSO_DEPTH_STENCIL_ALPHA,
+                      set_depth_stencil_context, pipe);
+   cso_for_each_state(sc->cache, CSO_RASTERIZER, set_rasterizer_context, pipe);
+   cso_for_each_state(sc->cache, CSO_SAMPLER, set_sampler_context, pipe);
+   cso_for_each_state(sc->cache, CSO_VELEMENTS, set_velements_context, pipe);
+
+   cso_cache_delete(sc->cache);
+   mtx_destroy(&sc->mutex);
+   FREE(sc);
+}
+
+static inline void
+cso_cache_lock(struct cso_context *ctx)
+{
+   if (ctx->shared)
+      mtx_lock(&ctx->shared->mutex);
+}
+
+static inline void
+cso_cache_unlock(struct cso_context *ctx)
+{
+   if (ctx->shared)
+      mtx_unlock(&ctx->shared->mutex);
 }
 
 static void cso_init_vbuf(struct cso_context *cso, unsigned flags)
@@ -299,16 +507,29 @@ cso_create_context(struct pipe_context *pipe, unsigned u_vbuf_flags)
    if (!ctx)
       return NULL;
 
-   ctx->cache = cso_cache_create();
-   if (ctx->cache == NULL)
-      goto out;
-   cso_cache_set_sanitize_callback(ctx->cache,
-                                   sanitize_hash,
-                                   ctx);
+   if (pipe->screen->get_param(pipe->screen, PIPE_CAP_SHAREABLE_CSOS))
+      ctx->shared = cso_shared_cache_reference(pipe->screen);
+
+   if (ctx->shared) {
+      ctx->cache = ctx->shared->cache;
+   } else {
+      ctx->cache = cso_cache_create();
+      if (ctx->cache == NULL)
+         goto out;
+      cso_cache_set_sanitize_callback(ctx->cache,
+                                      sanitize_hash,
+                                      ctx);
+   }
 
    ctx->pipe = pipe;
    ctx->sample_mask = ~0;
 
+   if (ctx->shared) {
+      cso_cache_lock(ctx);
+      list_addtail(&ctx->shared_link, &ctx->shared->contexts);
+      cso_cache_unlock(ctx);
+   }
+
    ctx->aux_vertex_buffer_index = 0; /* 0 for now */
 
    cso_init_vbuf(ctx, u_vbuf_flags);
@@ -427,7 +648,16 @@ void cso_destroy_context( struct cso_context *ctx )
       pipe_so_target_reference(&ctx->so_targets_saved[i], NULL);
    }
 
-   if (ctx->cache) {
+   if (ctx->shared) {
+      cso_cache_lock(ctx);
+      list_del(&ctx->shared_link);
+      cso_cache_unlock(ctx);
+
+      cso_shared_cache_unreference(ctx->shared, ctx->pipe);
+      ctx->shared = NULL;
+      ctx->cache = NULL;
+   }
+   else if (ctx->cache) {
       cso_cache_delete( ctx->cache );
       ctx->cache = NULL;
    }
@@ -459,13 +689,17 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
       sizeof(struct pipe_blend_state) :
       (char *)&(templ->rt[1]) - (char *)templ;
    hash_key = cso_construct_key((void*)templ, key_size);
+
+   cso_cache_lock(ctx);
    iter = cso_find_state_template(ctx->cache, hash_key, CSO_BLEND,
                                   (void*)templ, key_size);
 
    if (cso_hash_iter_is_null(iter)) {
       struct cso_blend *cso = MALLOC(sizeof(struct cso_blend));
-      if (!cso)
+      if (!cso) {
+         cso_cache_unlock(ctx);
          return PIPE_ERROR_OUT_OF_MEMORY;
+      }
 
       memset(&cso->state, 0, sizeof cso->state);
       memcpy(&cso->state, templ, key_size);
@@ -475,6 +709,7 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
 
       iter = cso_insert_state(ctx->cache, hash_key, CSO_BLEND, cso);
       if (cso_hash_iter_is_null(iter)) {
+         cso_cache_unlock(ctx);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -485,10 +720,12 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
       handle = ((struct cso_blend *)cso_hash_iter_data(iter))->data;
    }
 
+   /* Bind it before unlocking, so that no other context evicts it. */
    if (ctx->blend != handle) {
       ctx->blend = handle;
       ctx->pipe->bind_blend_state(ctx->pipe, handle);
    }
+   cso_cache_unlock(ctx);
    return PIPE_OK;
 }
 
@@ -502,11 +739,13 @@ cso_save_blend(struct cso_context *ctx)
 static void
 cso_restore_blend(struct cso_context *ctx)
 {
+   cso_cache_lock(ctx);
    if (ctx->blend != ctx->blend_saved) {
       ctx->blend = ctx->blend_saved;
       ctx->pipe->bind_blend_state(ctx->pipe, ctx->blend_saved);
    }
    ctx->blend_saved = NULL;
+   cso_cache_unlock(ctx);
 }
 
 
@@ -517,17 +756,21 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
 {
    unsigned key_size = sizeof(struct pipe_depth_stencil_alpha_state);
    unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_DEPTH_STENCIL_ALPHA,
-                                                       (void*)templ, key_size);
+   struct cso_hash_iter iter;
    void *handle;
 
+   cso_cache_lock(ctx);
+   iter = cso_find_state_template(ctx->cache, hash_key,
+                                  CSO_DEPTH_STENCIL_ALPHA,
+                                  (void*)templ, key_size);
+
    if (cso_hash_iter_is_null(iter)) {
       struct cso_depth_stencil_alpha *cso =
          MALLOC(sizeof(struct cso_depth_stencil_alpha));
-      if (!cso)
+      if (!cso) {
+         cso_cache_unlock(ctx);
          return PIPE_ERROR_OUT_OF_MEMORY;
+      }
 
       memcpy(&cso->state, templ, sizeof(*templ));
       cso->data = ctx->pipe->create_depth_stencil_alpha_state(ctx->pipe,
@@ -539,6 +782,7 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
       iter = cso_insert_state(ctx->cache, hash_key,
                               CSO_DEPTH_STENCIL_ALPHA, cso);
       if (cso_hash_iter_is_null(iter)) {
+         cso_cache_unlock(ctx);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -550,10 +794,12 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
                 cso_hash_iter_data(iter))->data;
    }
 
+   /* Bind it before unlocking, so that no other context evicts it. */
    if (ctx->depth_stencil != handle) {
       ctx->depth_stencil = handle;
       ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe, handle);
    }
+   cso_cache_unlock(ctx);
    return PIPE_OK;
 }
 
@@ -567,12 +813,14 @@ cso_save_depth_stencil_alpha(struct cso_context *ctx)
 static void
 cso_restore_depth_stencil_alpha(struct cso_context *ctx)
 {
+   cso_cache_lock(ctx);
    if (ctx->depth_stencil != ctx->depth_stencil_saved) {
       ctx->depth_stencil = ctx->depth_stencil_saved;
       ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe,
                                                 ctx->depth_stencil_saved);
    }
    ctx->depth_stencil_saved = NULL;
+   cso_cache_unlock(ctx);
 }
 
 
@@ -582,16 +830,19 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
 {
    unsigned key_size = sizeof(struct pipe_rasterizer_state);
    unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_RASTERIZER,
-                                                       (void*)templ, key_size);
+   struct cso_hash_iter iter;
    void *handle = NULL;
 
+   cso_cache_lock(ctx);
+   iter = cso_find_state_template(ctx->cache, hash_key, CSO_RASTERIZER,
+                                  (void*)templ, key_size);
+
    if (cso_hash_iter_is_null(iter)) {
       struct cso_rasterizer *cso = MALLOC(sizeof(struct cso_rasterizer));
-      if (!cso)
+      if (!cso) {
+         cso_cache_unlock(ctx);
          return PIPE_ERROR_OUT_OF_MEMORY;
+      }
 
       memcpy(&cso->state, templ, sizeof(*templ));
       cso->data = ctx->pipe->create_rasterizer_state(ctx->pipe, &cso->state);
@@ -601,6 +852,7 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
 
       iter = cso_insert_state(ctx->cache, hash_key, CSO_RASTERIZER, cso);
       if (cso_hash_iter_is_null(iter)) {
+         cso_cache_unlock(ctx);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -611,10 +863,12 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
       handle = ((struct cso_rasterizer *)cso_hash_iter_data(iter))->data;
    }
 
+   /* Bind it before unlocking, so that no other context evicts it. */
    if (ctx->rasterizer != handle) {
       ctx->rasterizer = handle;
       ctx->pipe->bind_rasterizer_state(ctx->pipe, handle);
    }
+   cso_cache_unlock(ctx);
    return PIPE_OK;
 }
 
@@ -628,11 +882,13 @@ cso_save_rasterizer(struct cso_context *ctx)
 static void
 cso_restore_rasterizer(struct cso_context *ctx)
 {
+   cso_cache_lock(ctx);
    if (ctx->rasterizer != ctx->rasterizer_saved) {
       ctx->rasterizer = ctx->rasterizer_saved;
       ctx->pipe->bind_rasterizer_state(ctx->pipe, ctx->rasterizer_saved);
    }
    ctx->rasterizer_saved = NULL;
+   cso_cache_unlock(ctx);
 }
 
 
@@ -1041,42 +1297,52 @@ void cso_delete_compute_shader(struct cso_context *ctx, void *handle)
    ctx->pipe->delete_compute_state(ctx->pipe, handle);
 }
 
+/* Need to include the count into the stored state data too.
+ * Otherwise first few count pipe_vertex_elements could be identical
+ * even if count is different, and there's no guarantee the hash would
+ * be different in that case neither.
+ */
+static inline unsigned
+velems_key_size(const struct cso_velems_state *velems)
+{
+   return sizeof(struct pipe_vertex_element) * velems->count +
+          sizeof(unsigned);
+}
+
+unsigned
+cso_hash_vertex_elements(const struct cso_velems_state *velems)
+{
+   return cso_construct_key((void*)velems, velems_key_size(velems));
+}
+
 enum pipe_error
-cso_set_vertex_elements(struct cso_context *ctx,
-                        unsigned count,
-                        const struct pipe_vertex_element *states)
+cso_set_vertex_elements_hashed(struct cso_context *ctx,
+                               const struct cso_velems_state *velems,
+                               unsigned hash_key)
 {
-   struct u_vbuf *vbuf = ctx->vbuf;
-   unsigned key_size, hash_key;
+   unsigned key_size = velems_key_size(velems);
    struct cso_hash_iter iter;
    void *handle;
-   struct cso_velems_state velems_state;
 
-   if (vbuf) {
-      u_vbuf_set_vertex_elements(vbuf, count, states);
+   if (ctx->vbuf) {
+      u_vbuf_set_vertex_elements(ctx->vbuf, velems->count, velems->velems);
       return PIPE_OK;
    }
 
-   /* Need to include the count into the stored state data too.
-    * Otherwise first few count pipe_vertex_elements could be identical
-    * even if count is different, and there's no guarantee the hash would
-    * be different in that case neither.
-    */
-   key_size = sizeof(struct pipe_vertex_element) * count + sizeof(unsigned);
-   velems_state.count = count;
-   memcpy(velems_state.velems, states,
-          sizeof(struct pipe_vertex_element) * count);
-   hash_key = cso_construct_key((void*)&velems_state, key_size);
+   cso_cache_lock(ctx);
    iter = cso_find_state_template(ctx->cache, hash_key, CSO_VELEMENTS,
-                                  (void*)&velems_state, key_size);
+                                  (void*)velems, key_size);
 
    if (cso_hash_iter_is_null(iter)) {
       struct cso_velements *cso = MALLOC(sizeof(struct cso_velements));
-      if (!cso)
+      if (!cso) {
+         cso_cache_unlock(ctx);
          return PIPE_ERROR_OUT_OF_MEMORY;
+      }
 
-      memcpy(&cso->state, &velems_state, key_size);
-      cso->data = ctx->pipe->create_vertex_elements_state(ctx->pipe, count,
+      memcpy(&cso->state, velems, key_size);
+      cso->data = ctx->pipe->create_vertex_elements_state(ctx->pipe,
+                                                      velems->count,
                                                       &cso->state.velems[0]);
       cso->delete_state =
          (cso_state_callback) ctx->pipe->delete_vertex_elements_state;
@@ -1084,6 +1350,7 @@ cso_set_vertex_elements(struct cso_context *ctx,
 
       iter = cso_insert_state(ctx->cache, hash_key, CSO_VELEMENTS, cso);
       if (cso_hash_iter_is_null(iter)) {
+         cso_cache_unlock(ctx);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -1094,13 +1361,34 @@ cso_set_vertex_elements(struct cso_context *ctx,
       handle = ((struct cso_velements *)cso_hash_iter_data(iter))->data;
    }
 
+   /* Bind it before unlocking, so that no other context evicts it. */
    if (ctx->velements != handle) {
       ctx->velements = handle;
       ctx->pipe->bind_vertex_elements_state(ctx->pipe, handle);
    }
+   cso_cache_unlock(ctx);
    return PIPE_OK;
 }
 
+enum pipe_error
+cso_set_vertex_elements(struct cso_context *ctx,
+                        unsigned count,
+                        const struct pipe_vertex_element *states)
+{
+   struct cso_velems_state velems_state;
+
+   if (ctx->vbuf) {
+      u_vbuf_set_vertex_elements(ctx->vbuf, count, states);
+      return PIPE_OK;
+   }
+
+   velems_state.count = count;
+   memcpy(velems_state.velems, states,
+          sizeof(struct pipe_vertex_element) * count);
+   return cso_set_vertex_elements_hashed(ctx, &velems_state,
+                                         cso_hash_vertex_elements(&velems_state));
+}
+
 static void
 cso_save_vertex_elements(struct cso_context *ctx)
 {
@@ -1125,11 +1413,13 @@ cso_restore_vertex_elements(struct cso_context *ctx)
       return;
    }
 
+   cso_cache_lock(ctx);
    if (ctx->velements != ctx->velements_saved) {
       ctx->velements = ctx->velements_saved;
       ctx->pipe->bind_vertex_elements_state(ctx->pipe, ctx->velements_saved);
    }
    ctx->velements_saved = NULL;
+   cso_cache_unlock(ctx);
 }
 
 /* vertex buffers */
@@ -1206,15 +1496,19 @@ cso_single_sampler(struct cso_context *ctx, enum pipe_shader_type shader_stage,
       unsigned key_size = sizeof(struct pipe_sampler_state);
       unsigned hash_key = cso_construct_key((void*)templ, key_size);
       struct cso_sampler *cso;
-      struct cso_hash_iter iter =
-         cso_find_state_template(ctx->cache,
-                                 hash_key, CSO_SAMPLER,
-                                 (void *) templ, key_size);
+      struct cso_hash_iter iter;
+
+      cso_cache_lock(ctx);
+      iter = cso_find_state_template(ctx->cache,
+                                     hash_key, CSO_SAMPLER,
+                                     (void *) templ, key_size);
 
       if (cso_hash_iter_is_null(iter)) {
          cso = MALLOC(sizeof(struct cso_sampler));
-         if (!cso)
+         if (!cso) {
+            cso_cache_unlock(ctx);
             return;
+         }
 
          memcpy(&cso->state, templ, sizeof(*templ));
          cso->data = ctx->pipe->create_sampler_state(ctx->pipe, &cso->state);
@@ -1225,6 +1519,7 @@ cso_single_sampler(struct cso_context *ctx, enum pipe_shader_type shader_stage,
 
          iter = cso_insert_state(ctx->cache, hash_key, CSO_SAMPLER, cso);
          if (cso_hash_iter_is_null(iter)) {
+            cso_cache_unlock(ctx);
             FREE(cso);
             return;
          }
@@ -1235,6 +1530,7 @@ cso_single_sampler(struct cso_context *ctx, enum pipe_shader_type shader_stage,
 
       ctx->samplers[shader_stage].cso_samplers[idx] = cso;
       ctx->samplers[shader_stage].samplers[idx] = cso->data;
+      cso_cache_unlock(ctx);
       ctx->max_sampler_seen = MAX2(ctx->max_sampler_seen, (int)idx);
    }
 }
@@ -1294,6 +1590,7 @@ cso_restore_fragment_samplers(struct cso_context *ctx)
    struct sampler_info *info = &ctx->samplers[PIPE_SHADER_FRAGMENT];
    struct sampler_info *saved = &ctx->fragment_samplers_saved;
 
+   cso_cache_lock(ctx);
    memcpy(info->cso_samplers, saved->cso_samplers,
           sizeof(info->cso_samplers));
    memcpy(info->samplers, saved->samplers, sizeof(info->samplers));
@@ -1306,6 +1603,7 @@ cso_restore_fragment_samplers(struct cso_context *ctx)
    }
 
    cso_single_sampler_done(ctx, PIPE_SHADER_FRAGMENT);
+   cso_cache_unlock(ctx);
 }
 
 
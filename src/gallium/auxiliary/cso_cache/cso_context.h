@@ -82,6 +82,18 @@ enum pipe_error cso_set_vertex_elements(struct cso_context *ctx,
                                         unsigned count,
                                         const struct pipe_vertex_element *states);
 
+struct cso_velems_state;
+
+/* For callers which keep their vertex elements around: the hash returned
+ * by cso_hash_vertex_elements() can be computed once and passed to
+ * cso_set_vertex_elements_hashed() every time the elements are bound. */
+unsigned cso_hash_vertex_elements(const struct cso_velems_state *velems);
+
+enum pipe_error
+cso_set_vertex_elements_hashed(struct cso_context *ctx,
+                               const struct cso_velems_state *velems,
+                               unsigned hash_key);
+
 void cso_set_vertex_buffers(struct cso_context *ctx,
                             unsigned start_slot, unsigned count,
                             const struct pipe_vertex_buffer *buffers);
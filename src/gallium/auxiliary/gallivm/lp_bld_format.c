@@ -26,6 +26,8 @@
  **************************************************************************/
 
 
+#include "util/u_format.h"
+
 #include "lp_bld_format.h"
 
 
@@ -42,15 +44,55 @@ lp_build_format_cache_type(struct gallivm_state *gallivm)
    elem_types[LP_BUILD_FORMAT_CACHE_MEMBER_TAGS] =
          LLVMArrayType(LLVMInt64TypeInContext(gallivm->context),
                        LP_BUILD_FORMAT_CACHE_SIZE);
-#if LP_BUILD_FORMAT_CACHE_DEBUG
+   elem_types[LP_BUILD_FORMAT_CACHE_MEMBER_VICTIMS] =
+         LLVMArrayType(LLVMInt32TypeInContext(gallivm->context),
+                       LP_BUILD_FORMAT_CACHE_SETS);
    elem_types[LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_TOTAL] =
          LLVMInt64TypeInContext(gallivm->context);
    elem_types[LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS] =
          LLVMInt64TypeInContext(gallivm->context);
-#endif
 
    s = LLVMStructTypeInContext(gallivm->context, elem_types,
                                LP_BUILD_FORMAT_CACHE_MEMBER_COUNT, 0);
 
    return s;
 }
+
+
+/**
+ * Whether texels of this format can be fetched through the decoded block
+ * cache (see lp_build_fetch_cached_texels()).
+ *
+ * That is the case for all 4x4 block compressed formats which can be
+ * decoded a whole block at a time to rgba8 without losing precision.
+ */
+boolean
+lp_build_format_cache_supported(const struct util_format_description *format_desc)
+{
+   if (format_desc->layout == UTIL_FORMAT_LAYOUT_PLAIN ||
+       format_desc->block.width != 4 ||
+       format_desc->block.height != 4 ||
+       !format_desc->unpack_rgba_8unorm) {
+      return FALSE;
+   }
+
+   /* srgb s3tc formats don't fit 8unorm, but are decoded to (srgb) rgba8 */
+   return format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC ||
+          util_format_fits_8unorm(format_desc);
+}
+
+
+/**
+ * Drop all cached blocks, and reset the access statistics.
+ *
+ * Needs to be called whenever the memory the cached blocks were decoded
+ * from may have changed.
+ */
+void
+lp_build_format_cache_invalidate(struct lp_build_format_cache *cache)
+{
+   memset(cache->cache_tags, 0, sizeof cache->cache_tags);
+   memset(cache->cache_victims, 0, sizeof cache->cache_victims);
+   cache->cache_access_total = 0;
+   cache->cache_access_miss = 0;
+}
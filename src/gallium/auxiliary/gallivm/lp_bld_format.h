@@ -44,37 +44,42 @@ struct lp_type;
 struct lp_build_context;
 
 
-#define LP_BUILD_FORMAT_CACHE_DEBUG 0
 /*
  * Block cache
  *
  * Optional block cache to be used when unpacking big pixel blocks.
- * Must be a power of 2
+ * The cache is set associative, each block address maps to one set of
+ * LP_BUILD_FORMAT_CACHE_WAYS entries which are replaced round-robin.
+ * Both sets and ways must be a power of 2.
  */
 
-#define LP_BUILD_FORMAT_CACHE_SIZE 128
+#define LP_BUILD_FORMAT_CACHE_SETS 64
+#define LP_BUILD_FORMAT_CACHE_WAYS 4
+#define LP_BUILD_FORMAT_CACHE_SIZE (LP_BUILD_FORMAT_CACHE_SETS * \
+                                    LP_BUILD_FORMAT_CACHE_WAYS)
 
 /*
  * Note: cache_data needs 16 byte alignment.
+ * The decoded blocks are stored row by row, i.e. cache_data[entry][y][x].
+ * A zero tag marks an empty entry.
  */
 struct lp_build_format_cache
 {
    PIPE_ALIGN_VAR(16) uint32_t cache_data[LP_BUILD_FORMAT_CACHE_SIZE][4][4];
    uint64_t cache_tags[LP_BUILD_FORMAT_CACHE_SIZE];
-#if LP_BUILD_FORMAT_CACHE_DEBUG
+   /* next way to replace, per set */
+   uint32_t cache_victims[LP_BUILD_FORMAT_CACHE_SETS];
    uint64_t cache_access_total;
    uint64_t cache_access_miss;
-#endif
 };
 
 
 enum {
    LP_BUILD_FORMAT_CACHE_MEMBER_DATA = 0,
    LP_BUILD_FORMAT_CACHE_MEMBER_TAGS,
-#if LP_BUILD_FORMAT_CACHE_DEBUG
+   LP_BUILD_FORMAT_CACHE_MEMBER_VICTIMS,
    LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_TOTAL,
    LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS,
-#endif
    LP_BUILD_FORMAT_CACHE_MEMBER_COUNT
 };
 
@@ -82,6 +87,12 @@ enum {
 LLVMTypeRef
 lp_build_format_cache_type(struct gallivm_state *gallivm);
 
+boolean
+lp_build_format_cache_supported(const struct util_format_description *format_desc);
+
+void
+lp_build_format_cache_invalidate(struct lp_build_format_cache *cache);
+
 
 /*
  * AoS
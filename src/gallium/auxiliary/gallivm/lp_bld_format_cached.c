@@ -35,6 +35,7 @@
 #include "util/u_math.h"
 
 
+
 /**
  * @file
  * Complex block-compression based formats are handled here by using a cache,
@@ -43,15 +44,15 @@
  * a small cache helps.
  * The elements in the cache are the decoded blocks - currently things
  * are restricted to formats which are 4x4 block based, and the decoded
- * texels must fit into 4x8 bits.
- * The cache is direct mapped so hitrates aren't all that great and cache
- * thrashing could happen.
+ * texels must fit into 4x8 bits (see lp_build_format_cache_supported()).
+ * The cache is set associative with round-robin replacement within a set,
+ * so that a few blocks hashing to the same set (as happens when sampling
+ * several textures, or mipmap levels, at once) don't thrash each other.
  *
  * @author Roland Scheidegger <sroland@vmware.com>
  */
 
 
-#if LP_BUILD_FORMAT_CACHE_DEBUG
 static void
 update_cache_access(struct gallivm_state *gallivm,
                     LLVMValueRef ptr,
@@ -71,39 +72,20 @@ update_cache_access(struct gallivm_state *gallivm,
                                                                    count, 0), "");
    LLVMBuildStore(builder, cache_access, member_ptr);
 }
-#endif
 
 
-static void
-store_cached_block(struct gallivm_state *gallivm,
-                   LLVMValueRef *col,
-                   LLVMValueRef tag_value,
-                   LLVMValueRef hash_index,
-                   LLVMValueRef cache)
+static LLVMValueRef
+get_cache_member_ptr(struct gallivm_state *gallivm,
+                     LLVMValueRef ptr,
+                     unsigned member,
+                     LLVMValueRef index)
 {
-   LLVMBuilderRef builder = gallivm->builder;
-   LLVMValueRef ptr, indices[3];
-   LLVMTypeRef type_ptr4x32;
-   unsigned count;
+   LLVMValueRef indices[3];
 
-   type_ptr4x32 = LLVMPointerType(LLVMVectorType(LLVMInt32TypeInContext(gallivm->context), 4), 0);
    indices[0] = lp_build_const_int32(gallivm, 0);
-   indices[1] = lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_MEMBER_TAGS);
-   indices[2] = hash_index;
-   ptr = LLVMBuildGEP(builder, cache, indices, ARRAY_SIZE(indices), "");
-   LLVMBuildStore(builder, tag_value, ptr);
-
-   indices[1] = lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_MEMBER_DATA);
-   hash_index = LLVMBuildMul(builder, hash_index,
-                             lp_build_const_int32(gallivm, 16), "");
-   for (count = 0; count < 4; count++) {
-      indices[2] = hash_index;
-      ptr = LLVMBuildGEP(builder, cache, indices, ARRAY_SIZE(indices), "");
-      ptr = LLVMBuildBitCast(builder, ptr, type_ptr4x32, "");
-      LLVMBuildStore(builder, col[count], ptr);
-      hash_index = LLVMBuildAdd(builder, hash_index,
-                                lp_build_const_int32(gallivm, 4), "");
-   }
+   indices[1] = lp_build_const_int32(gallivm, member);
+   indices[2] = index;
+   return LLVMBuildGEP(gallivm->builder, ptr, indices, ARRAY_SIZE(indices), "");
 }
 
 
@@ -112,14 +94,11 @@ lookup_cached_pixel(struct gallivm_state *gallivm,
                     LLVMValueRef ptr,
                     LLVMValueRef index)
 {
-   LLVMBuilderRef builder = gallivm->builder;
-   LLVMValueRef member_ptr, indices[3];
+   LLVMValueRef member_ptr;
 
-   indices[0] = lp_build_const_int32(gallivm, 0);
-   indices[1] = lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_MEMBER_DATA);
-   indices[2] = index;
-   member_ptr = LLVMBuildGEP(builder, ptr, indices, ARRAY_SIZE(indices), "");
-   return LLVMBuildLoad(builder, member_ptr, "cache_data");
+   member_ptr = get_cache_member_ptr(gallivm, ptr,
+                                     LP_BUILD_FORMAT_CACHE_MEMBER_DATA, index);
+   return LLVMBuildLoad(gallivm->builder, member_ptr, "cache_data");
 }
 
 
@@ -128,22 +107,23 @@ lookup_tag_data(struct gallivm_state *gallivm,
                 LLVMValueRef ptr,
                 LLVMValueRef index)
 {
-   LLVMBuilderRef builder = gallivm->builder;
-   LLVMValueRef member_ptr, indices[3];
+   LLVMValueRef member_ptr;
 
-   indices[0] = lp_build_const_int32(gallivm, 0);
-   indices[1] = lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_MEMBER_TAGS);
-   indices[2] = index;
-   member_ptr = LLVMBuildGEP(builder, ptr, indices, ARRAY_SIZE(indices), "");
-   return LLVMBuildLoad(builder, member_ptr, "tag_data");
+   member_ptr = get_cache_member_ptr(gallivm, ptr,
+                                     LP_BUILD_FORMAT_CACHE_MEMBER_TAGS, index);
+   return LLVMBuildLoad(gallivm->builder, member_ptr, "tag_data");
 }
 
 
+/**
+ * Decode the block at ptr_addr into cache entry entry_index, and update
+ * the entry's tag.
+ */
 static void
 update_cached_block(struct gallivm_state *gallivm,
                     const struct util_format_description *format_desc,
                     LLVMValueRef ptr_addr,
-                    LLVMValueRef hash_index,
+                    LLVMValueRef entry_index,
                     LLVMValueRef cache)
 
 {
@@ -151,41 +131,36 @@ update_cached_block(struct gallivm_state *gallivm,
    LLVMTypeRef i8t = LLVMInt8TypeInContext(gallivm->context);
    LLVMTypeRef pi8t = LLVMPointerType(i8t, 0);
    LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
-   LLVMTypeRef i32x4 = LLVMVectorType(LLVMInt32TypeInContext(gallivm->context), 4);
    LLVMValueRef function;
-   LLVMValueRef tag_value, tmp_ptr;
-   LLVMValueRef col[4];
-   unsigned i, j;
-
-   /*
-    * Use format_desc->fetch_rgba_8unorm() for each pixel in the block.
-    * This doesn't actually make any sense whatsoever, someone would need
-    * to write a function doing this for all pixels in a block (either as
-    * an external c function or with generated code). Don't ask.
-    */
+   LLVMValueRef tag_value, dst_ptr, index;
+   LLVMValueRef args[6];
 
    {
       /*
        * Function to call looks like:
-       *   fetch(uint8_t *dst, const uint8_t *src, unsigned i, unsigned j)
+       *   unpack(uint8_t *dst, unsigned dst_stride,
+       *          const uint8_t *src, unsigned src_stride,
+       *          unsigned width, unsigned height)
        */
       LLVMTypeRef ret_type;
-      LLVMTypeRef arg_types[4];
+      LLVMTypeRef arg_types[6];
       LLVMTypeRef function_type;
 
-      assert(format_desc->fetch_rgba_8unorm);
+      assert(format_desc->unpack_rgba_8unorm);
 
       ret_type = LLVMVoidTypeInContext(gallivm->context);
       arg_types[0] = pi8t;
-      arg_types[1] = pi8t;
-      arg_types[2] = i32t;
+      arg_types[1] = i32t;
+      arg_types[2] = pi8t;
       arg_types[3] = i32t;
+      arg_types[4] = i32t;
+      arg_types[5] = i32t;
       function_type = LLVMFunctionType(ret_type, arg_types,
                                        ARRAY_SIZE(arg_types), 0);
 
-      /* make const pointer for the C fetch_rgba_8unorm function */
+      /* make const pointer for the C unpack_rgba_8unorm function */
       function = lp_build_const_int_pointer(gallivm,
-         func_to_pointer((func_pointer) format_desc->fetch_rgba_8unorm));
+         func_to_pointer((func_pointer) format_desc->unpack_rgba_8unorm));
 
       /* cast the callee pointer to the function's type */
       function = LLVMBuildBitCast(builder, function,
@@ -193,45 +168,100 @@ update_cached_block(struct gallivm_state *gallivm,
                                   "cast callee");
    }
 
-   tmp_ptr = lp_build_array_alloca(gallivm, i32x4,
-                                   lp_build_const_int32(gallivm, 16),
-                                   "tmp_decode_store");
-   tmp_ptr = LLVMBuildBitCast(builder, tmp_ptr, pi8t, "");
-
    /*
-    * Invoke format_desc->fetch_rgba_8unorm() for each pixel.
-    * This is going to be really really slow.
-    * Note: the block store format is actually
-    * x0y0x0y1x0y2x0y3 x1y0x1y1x1y2x1y3 ...
+    * Decode the whole block with a single call, straight into the cache.
+    * The entry is stored row by row, hence the 16 byte dst stride.
     */
-   for (i = 0; i < 4; ++i) {
-      for (j = 0; j < 4; ++j) {
-         LLVMValueRef args[4];
-         LLVMValueRef dst_offset = lp_build_const_int32(gallivm, (i * 4 + j) * 4);
-
-         /*
-          * Note we actually supply a pointer to the start of the block,
-          * not the start of the texture.
-          */
-         args[0] = LLVMBuildGEP(gallivm->builder, tmp_ptr, &dst_offset, 1, "");
-         args[1] = ptr_addr;
-         args[2] = LLVMConstInt(i32t, i, 0);
-         args[3] = LLVMConstInt(i32t, j, 0);
-         LLVMBuildCall(builder, function, args, ARRAY_SIZE(args), "");
-      }
+   index = LLVMBuildMul(builder, entry_index,
+                        lp_build_const_int32(gallivm, 16), "");
+   dst_ptr = get_cache_member_ptr(gallivm, cache,
+                                  LP_BUILD_FORMAT_CACHE_MEMBER_DATA, index);
+
+   args[0] = LLVMBuildBitCast(builder, dst_ptr, pi8t, "");
+   args[1] = lp_build_const_int32(gallivm, 4 * 4);
+   args[2] = ptr_addr;
+   args[3] = lp_build_const_int32(gallivm, format_desc->block.bits / 8);
+   args[4] = lp_build_const_int32(gallivm, format_desc->block.width);
+   args[5] = lp_build_const_int32(gallivm, format_desc->block.height);
+   LLVMBuildCall(builder, function, args, ARRAY_SIZE(args), "");
+
+   tag_value = LLVMBuildPtrToInt(builder, ptr_addr,
+                                 LLVMInt64TypeInContext(gallivm->context), "");
+   LLVMBuildStore(builder, tag_value,
+                  get_cache_member_ptr(gallivm, cache,
+                                       LP_BUILD_FORMAT_CACHE_MEMBER_TAGS,
+                                       entry_index));
+}
+
+
+/**
+ * Find the cache entry holding the block at addr, which maps to set
+ * set_index, decoding the block into the set if it isn't there yet.
+ *
+ * Returns the (scalar) entry index.
+ */
+static LLVMValueRef
+lookup_cached_block(struct gallivm_state *gallivm,
+                    const struct util_format_description *format_desc,
+                    LLVMValueRef addr,
+                    LLVMValueRef set_index,
+                    LLVMValueRef cache)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i8t = LLVMInt8TypeInContext(gallivm->context);
+   LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
+   LLVMValueRef first_entry, entry, hit, entry_var;
+   LLVMValueRef way_mask = lp_build_const_int32(gallivm,
+                                                LP_BUILD_FORMAT_CACHE_WAYS - 1);
+   struct lp_build_if_state if_ctx;
+   unsigned way;
+
+   first_entry = LLVMBuildShl(builder, set_index,
+                              lp_build_const_int32(gallivm,
+                                 util_logbase2(LP_BUILD_FORMAT_CACHE_WAYS)), "");
+
+   /* compare all tags of the set, no need for branches here */
+   entry = first_entry;
+   hit = LLVMConstInt(LLVMInt1TypeInContext(gallivm->context), 0, 0);
+   for (way = 0; way < LP_BUILD_FORMAT_CACHE_WAYS; way++) {
+      LLVMValueRef way_entry, tag, match;
+
+      way_entry = LLVMBuildAdd(builder, first_entry,
+                               lp_build_const_int32(gallivm, way), "");
+      tag = lookup_tag_data(gallivm, cache, way_entry);
+      match = LLVMBuildICmp(builder, LLVMIntEQ, tag, addr, "");
+      entry = LLVMBuildSelect(builder, match, way_entry, entry, "");
+      hit = LLVMBuildOr(builder, hit, match, "");
    }
 
-   /* Finally store the block - pointless mem copy + update tag. */
-   tmp_ptr = LLVMBuildBitCast(builder, tmp_ptr, LLVMPointerType(i32x4, 0), "");
-   for (i = 0; i < 4; ++i) {
-      LLVMValueRef tmp_offset = lp_build_const_int32(gallivm, i);
-      LLVMValueRef ptr = LLVMBuildGEP(gallivm->builder, tmp_ptr, &tmp_offset, 1, "");
-      col[i] = LLVMBuildLoad(builder, ptr, "");
+   entry_var = lp_build_alloca(gallivm, i32t, "cache_entry");
+   LLVMBuildStore(builder, entry, entry_var);
+
+   lp_build_if(&if_ctx, gallivm, LLVMBuildNot(builder, hit, ""));
+   {
+      LLVMValueRef victim_ptr, victim, ptr_addr;
+
+      victim_ptr = get_cache_member_ptr(gallivm, cache,
+                                        LP_BUILD_FORMAT_CACHE_MEMBER_VICTIMS,
+                                        set_index);
+      victim = LLVMBuildLoad(builder, victim_ptr, "victim");
+      victim = LLVMBuildAnd(builder, victim, way_mask, "");
+      entry = LLVMBuildAdd(builder, first_entry, victim, "");
+
+      ptr_addr = LLVMBuildIntToPtr(builder, addr, LLVMPointerType(i8t, 0), "");
+      update_cached_block(gallivm, format_desc, ptr_addr, entry, cache);
+
+      victim = LLVMBuildAdd(builder, victim, lp_build_const_int32(gallivm, 1), "");
+      victim = LLVMBuildAnd(builder, victim, way_mask, "");
+      LLVMBuildStore(builder, victim, victim_ptr);
+      LLVMBuildStore(builder, entry, entry_var);
+
+      update_cache_access(gallivm, cache, 1,
+                          LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS);
    }
+   lp_build_endif(&if_ctx);
 
-   tag_value = LLVMBuildPtrToInt(gallivm->builder, ptr_addr,
-                                 LLVMInt64TypeInContext(gallivm->context), "");
-   store_cached_block(gallivm, col, tag_value, hash_index, cache);
+   return LLVMBuildLoad(builder, entry_var, "");
 }
 
 
@@ -253,8 +283,8 @@ lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
 {
    LLVMBuilderRef builder = gallivm->builder;
    unsigned count, low_bit, log2size;
-   LLVMValueRef color, offset_stored, addr, ptr_addrtrunc, tmp;
-   LLVMValueRef ij_index, hash_index, hash_mask, block_index;
+   LLVMValueRef color, addr, ptr_addrtrunc, tmp;
+   LLVMValueRef ij_index, hash_index, hash_mask;
    LLVMTypeRef i8t = LLVMInt8TypeInContext(gallivm->context);
    LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
    LLVMTypeRef i64t = LLVMInt64TypeInContext(gallivm->context);
@@ -270,11 +300,11 @@ lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
    lp_build_context_init(&bld32, gallivm, type);
 
    /*
-    * compute hash - we use direct mapped cache, the hash function could
+    * compute hash - the hash selects the set, the hash function could
     *                be better but it needs to be simple
     * per-element:
-    *    compare offset with offset stored at tag (hash)
-    *    if not equal decode/store block, update tag
+    *    compare offset with offsets stored at the tags of the set
+    *    if none is equal decode/store block into the next way, update tag
     *    extract color from cache
     *    assemble result vector
     */
@@ -282,7 +312,7 @@ lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
    /* TODO: not ideal with 32bit pointers... */
 
    low_bit = util_logbase2(format_desc->block.bits / 8);
-   log2size = util_logbase2(LP_BUILD_FORMAT_CACHE_SIZE);
+   log2size = util_logbase2(LP_BUILD_FORMAT_CACHE_SETS);
    addr = LLVMBuildPtrToInt(builder, base_ptr, i64t, "");
    ptr_addrtrunc = LLVMBuildPtrToInt(builder, base_ptr, i32t, "");
    ptr_addrtrunc = lp_build_broadcast_scalar(&bld32, ptr_addrtrunc);
@@ -300,75 +330,49 @@ lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
                        lp_build_const_int_vec(gallivm, type, log2size), "");
    hash_index = LLVMBuildXor(builder, hash_index, tmp, "");
 
-   hash_mask = lp_build_const_int_vec(gallivm, type, LP_BUILD_FORMAT_CACHE_SIZE - 1);
+   hash_mask = lp_build_const_int_vec(gallivm, type, LP_BUILD_FORMAT_CACHE_SETS - 1);
    hash_index = LLVMBuildAnd(builder, hash_index, hash_mask, "");
-   ij_index = LLVMBuildShl(builder, i, lp_build_const_int_vec(gallivm, type, 2), "");
-   ij_index = LLVMBuildAdd(builder, ij_index, j, "");
-   block_index = LLVMBuildShl(builder, hash_index,
-                              lp_build_const_int_vec(gallivm, type, 4), "");
-   block_index = LLVMBuildAdd(builder, ij_index, block_index, "");
+   /* entries are stored row by row */
+   ij_index = LLVMBuildShl(builder, j, lp_build_const_int_vec(gallivm, type, 2), "");
+   ij_index = LLVMBuildAdd(builder, ij_index, i, "");
 
    if (n > 1) {
       color = LLVMGetUndef(LLVMVectorType(i32t, n));
       for (count = 0; count < n; count++) {
-         LLVMValueRef index, cond, colorx;
-         LLVMValueRef block_indexx, hash_indexx, addrx, offsetx, ptr_addrx;
-         struct lp_build_if_state if_ctx;
+         LLVMValueRef index, colorx, entry;
+         LLVMValueRef ij_indexx, hash_indexx, addrx, offsetx;
 
          index = lp_build_const_int32(gallivm, count);
          offsetx = LLVMBuildExtractElement(builder, offset, index, "");
          addrx = LLVMBuildZExt(builder, offsetx, i64t, "");
          addrx = LLVMBuildAdd(builder, addrx, addr, "");
-         block_indexx = LLVMBuildExtractElement(builder, block_index, index, "");
-         hash_indexx = LLVMBuildLShr(builder, block_indexx,
-                                     lp_build_const_int32(gallivm, 4), "");
-         offset_stored = lookup_tag_data(gallivm, cache, hash_indexx);
-         cond = LLVMBuildICmp(builder, LLVMIntNE, offset_stored, addrx, "");
-
-         lp_build_if(&if_ctx, gallivm, cond);
-         {
-            ptr_addrx = LLVMBuildIntToPtr(builder, addrx,
-                                          LLVMPointerType(i8t, 0), "");
-            update_cached_block(gallivm, format_desc, ptr_addrx, hash_indexx, cache);
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-            update_cache_access(gallivm, cache, 1,
-                                LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS);
-#endif
-         }
-         lp_build_endif(&if_ctx);
-
-         colorx = lookup_cached_pixel(gallivm, cache, block_indexx);
-
-         color = LLVMBuildInsertElement(builder, color, colorx,
-                                        lp_build_const_int32(gallivm, count), "");
+         hash_indexx = LLVMBuildExtractElement(builder, hash_index, index, "");
+         ij_indexx = LLVMBuildExtractElement(builder, ij_index, index, "");
+
+         entry = lookup_cached_block(gallivm, format_desc, addrx,
+                                     hash_indexx, cache);
+         entry = LLVMBuildShl(builder, entry, lp_build_const_int32(gallivm, 4), "");
+         entry = LLVMBuildAdd(builder, entry, ij_indexx, "");
+         colorx = lookup_cached_pixel(gallivm, cache, entry);
+
+         color = LLVMBuildInsertElement(builder, color, colorx, index, "");
       }
    }
    else {
-      LLVMValueRef cond;
-      struct lp_build_if_state if_ctx;
+      LLVMValueRef entry;
 
       tmp = LLVMBuildZExt(builder, offset, i64t, "");
       addr = LLVMBuildAdd(builder, tmp, addr, "");
-      offset_stored = lookup_tag_data(gallivm, cache, hash_index);
-      cond = LLVMBuildICmp(builder, LLVMIntNE, offset_stored, addr, "");
-
-      lp_build_if(&if_ctx, gallivm, cond);
-      {
-         tmp = LLVMBuildIntToPtr(builder, addr, LLVMPointerType(i8t, 0), "");
-         update_cached_block(gallivm, format_desc, tmp, hash_index, cache);
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-         update_cache_access(gallivm, cache, 1,
-                             LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS);
-#endif
-      }
-      lp_build_endif(&if_ctx);
 
-      color = lookup_cached_pixel(gallivm, cache, block_index);
+      entry = lookup_cached_block(gallivm, format_desc, addr,
+                                  hash_index, cache);
+      entry = LLVMBuildShl(builder, entry, lp_build_const_int32(gallivm, 4), "");
+      entry = LLVMBuildAdd(builder, entry, ij_index, "");
+      color = lookup_cached_pixel(gallivm, cache, entry);
    }
-#if LP_BUILD_FORMAT_CACHE_DEBUG
+
    update_cache_access(gallivm, cache, n,
                        LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_TOTAL);
-#endif
+
    return LLVMBuildBitCast(builder, color, LLVMVectorType(i8t, n * 4), "");
 }
-
@@ -39,6 +39,22 @@
 extern "C" {
 #endif
 
+/**
+ * Object code of a module, so that drivers can keep it in a shader cache.
+ *
+ * If data_size is non-zero when the module is compiled, the JIT loads data
+ * instead of generating code for the module.  Otherwise the generated code
+ * is returned in data, which the caller must free(), unless the module
+ * refers to process-specific addresses, in which case dont_cache is set.
+ */
+struct lp_cached_code
+{
+   void *data;
+   size_t data_size;
+   boolean dont_cache;
+   void *jit_obj_cache;
+};
+
 struct gallivm_state
 {
    char *module_name;
@@ -50,6 +66,7 @@ struct gallivm_state
    LLVMBuilderRef builder;
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
+   struct lp_cached_code *cache;   /**< optional, set before compiling */
    unsigned compiled;
 };
 
@@ -67,6 +67,8 @@ struct lp_build_mask_context;
 struct gallivm_state;
 struct lp_derivatives;
 struct lp_build_tgsi_gs_iface;
+struct lp_build_tgsi_cs_iface;
+struct lp_build_tgsi_tess_iface;
 
 
 enum lp_build_tex_modifier {
@@ -170,6 +172,20 @@ struct lp_bld_tgsi_system_values {
    LLVMValueRef prim_id;
    LLVMValueRef basevertex;
    LLVMValueRef invocation_id;
+
+   /* compute shaders: thread_id is a vector per channel, the rest are
+    * uniform scalars */
+   LLVMValueRef thread_id[3];
+   LLVMValueRef block_id[3];
+   LLVMValueRef grid_size[3];
+   LLVMValueRef block_size[3];
+
+   /* tessellation shaders: tess_coord is a vector per channel, the rest are
+    * uniform scalars */
+   LLVMValueRef vertices_in;
+   LLVMValueRef tess_coord[3];
+   LLVMValueRef tess_outer[4];
+   LLVMValueRef tess_inner[2];
 };
 
 
@@ -230,7 +246,9 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef thread_data_ptr,
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface);
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface,
+                  const struct lp_build_tgsi_tess_iface *tess_iface);
 
 
 void
@@ -429,6 +447,66 @@ struct lp_build_tgsi_gs_iface
                        LLVMValueRef emitted_prims_vec);
 };
 
+/**
+ * Memory interface of compute shaders, used to implement LOAD, STORE,
+ * RESQ and the atomic opcodes on TGSI_FILE_BUFFER and TGSI_FILE_MEMORY.
+ */
+struct lp_build_tgsi_cs_iface
+{
+   /** Pointer to an array of PIPE_MAX_SHADER_BUFFERS buffer pointers (i8*) */
+   LLVMValueRef ssbo_ptr;
+   /** Pointer to an array of PIPE_MAX_SHADER_BUFFERS buffer sizes in bytes */
+   LLVMValueRef ssbo_sizes_ptr;
+   /** Shared memory of the work group (i8*) and its size in bytes (i32) */
+   LLVMValueRef shared_ptr;
+   LLVMValueRef shared_size;
+
+   /** Waits until all the invocations of the work group reached the
+     * barrier.  Optional if the shader doesn't use TGSI_OPCODE_BARRIER.
+     */
+   void (*emit_barrier)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                        struct lp_build_tgsi_context * bld_base);
+};
+
+/**
+ * Interface of tessellation control and evaluation shaders.
+ *
+ * Their inputs, and the outputs of control shaders, are indexed by vertex
+ * and may be read by the other invocations of the patch, so they live in
+ * driver memory rather than in the inputs/outputs arrays.  vertex_index is
+ * NULL for per-patch registers.
+ */
+struct lp_build_tgsi_tess_iface
+{
+   LLVMValueRef (*fetch_input)(const struct lp_build_tgsi_tess_iface *tess_iface,
+                               struct lp_build_tgsi_context * bld_base,
+                               boolean is_vindex_indirect,
+                               LLVMValueRef vertex_index,
+                               boolean is_aindex_indirect,
+                               LLVMValueRef attrib_index,
+                               LLVMValueRef swizzle_index);
+
+   /** Control shaders only */
+   LLVMValueRef (*fetch_output)(const struct lp_build_tgsi_tess_iface *tess_iface,
+                                struct lp_build_tgsi_context * bld_base,
+                                boolean is_vindex_indirect,
+                                LLVMValueRef vertex_index,
+                                boolean is_aindex_indirect,
+                                LLVMValueRef attrib_index,
+                                LLVMValueRef swizzle_index);
+   void (*emit_store_output)(const struct lp_build_tgsi_tess_iface *tess_iface,
+                             struct lp_build_tgsi_context * bld_base,
+                             boolean is_vindex_indirect,
+                             LLVMValueRef vertex_index,
+                             boolean is_aindex_indirect,
+                             LLVMValueRef attrib_index,
+                             LLVMValueRef swizzle_index,
+                             LLVMValueRef value,
+                             LLVMValueRef mask_vec);
+   void (*emit_barrier)(const struct lp_build_tgsi_tess_iface *tess_iface,
+                        struct lp_build_tgsi_context * bld_base);
+};
+
 struct lp_build_tgsi_soa_context
 {
    struct lp_build_tgsi_context bld_base;
@@ -437,6 +515,8 @@ struct lp_build_tgsi_soa_context
    struct lp_build_context elem_bld;
 
    const struct lp_build_tgsi_gs_iface *gs_iface;
+   const struct lp_build_tgsi_cs_iface *cs_iface;
+   const struct lp_build_tgsi_tess_iface *tess_iface;
    LLVMValueRef emitted_prims_vec_ptr;
    LLVMValueRef total_emitted_vertices_vec_ptr;
    LLVMValueRef emitted_vertices_vec_ptr;
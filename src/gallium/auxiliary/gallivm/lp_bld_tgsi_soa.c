@@ -1064,14 +1064,14 @@ emit_mask_scatter(struct lp_build_tgsi_soa_context *bld,
 
 /**
  * Read the current value of the ADDR register, convert the floats to
- * ints, add the base index and return the vector of offsets.
- * The offsets will be used to index into the constant buffer or
- * temporary register file.
+ * ints, add the base index and return the vector of offsets, clamped to
+ * index_limit unless it is negative.
  */
 static LLVMValueRef
-get_indirect_index(struct lp_build_tgsi_soa_context *bld,
-                   unsigned reg_file, unsigned reg_index,
-                   const struct tgsi_ind_register *indirect_reg)
+get_indirect_index_limit(struct lp_build_tgsi_soa_context *bld,
+                         unsigned reg_index,
+                         const struct tgsi_ind_register *indirect_reg,
+                         int index_limit)
 {
    LLVMBuilderRef builder = bld->bld_base.base.gallivm->builder;
    struct lp_build_context *uint_bld = &bld->bld_base.uint_bld;
@@ -1082,8 +1082,6 @@ get_indirect_index(struct lp_build_tgsi_soa_context *bld,
    LLVMValueRef max_index;
    LLVMValueRef index;
 
-   assert(bld->indirect_files & (1 << reg_file));
-
    base = lp_build_const_int_vec(bld->bld_base.base.gallivm, uint_bld->type, reg_index);
 
    assert(swizzle < 4);
@@ -1108,6 +1106,31 @@ get_indirect_index(struct lp_build_tgsi_soa_context *bld,
 
    index = lp_build_add(uint_bld, base, rel);
 
+   if (index_limit >= 0) {
+      max_index = lp_build_const_int_vec(bld->bld_base.base.gallivm,
+                                         uint_bld->type,
+                                         index_limit);
+
+      assert(!uint_bld->type.sign);
+      index = lp_build_min(uint_bld, index, max_index);
+   }
+
+   return index;
+}
+
+/**
+ * Read the current value of the ADDR register, convert the floats to
+ * ints, add the base index and return the vector of offsets.
+ * The offsets will be used to index into the constant buffer or
+ * temporary register file.
+ */
+static LLVMValueRef
+get_indirect_index(struct lp_build_tgsi_soa_context *bld,
+                   unsigned reg_file, unsigned reg_index,
+                   const struct tgsi_ind_register *indirect_reg)
+{
+   assert(bld->indirect_files & (1 << reg_file));
+
    /*
     * emit_fetch_constant handles constant buffer overflow so this code
     * is pointless for them.
@@ -1117,16 +1140,10 @@ get_indirect_index(struct lp_build_tgsi_soa_context *bld,
     * to return incorrect data (not necessarily 0) for indices that are
     * larger than the declared size but smaller than the buffer size.
     */
-   if (reg_file != TGSI_FILE_CONSTANT) {
-      max_index = lp_build_const_int_vec(bld->bld_base.base.gallivm,
-                                         uint_bld->type,
-                                         bld->bld_base.info->file_max[reg_file]);
-
-      assert(!uint_bld->type.sign);
-      index = lp_build_min(uint_bld, index, max_index);
-   }
-
-   return index;
+   return get_indirect_index_limit(bld, reg_index, indirect_reg,
+                                   reg_file != TGSI_FILE_CONSTANT ?
+                                   (int)bld->bld_base.info->file_max[reg_file] :
+                                   -1);
 }
 
 static struct lp_build_context *
@@ -1557,6 +1574,85 @@ emit_fetch_gs_input(
    return res;
 }
 
+/**
+ * Fetch of the inputs of tessellation shaders, and of the outputs of
+ * tessellation control shaders, which may be indexed by vertex.
+ * The vertex index isn't clamped, the driver knows the size of the patch.
+ */
+static LLVMValueRef
+emit_fetch_tess_reg(
+   struct lp_build_tgsi_context * bld_base,
+   const struct tgsi_full_src_register * reg,
+   enum tgsi_opcode_type stype,
+   unsigned swizzle)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   const struct lp_build_tgsi_tess_iface *tess_iface = bld->tess_iface;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef attrib_index = NULL;
+   LLVMValueRef vertex_index = NULL;
+   LLVMValueRef swizzle_index = lp_build_const_int32(gallivm, swizzle);
+   LLVMValueRef res;
+   LLVMValueRef (*fetch)(const struct lp_build_tgsi_tess_iface *,
+                         struct lp_build_tgsi_context *,
+                         boolean, LLVMValueRef,
+                         boolean, LLVMValueRef,
+                         LLVMValueRef);
+
+   if (reg->Register.File == TGSI_FILE_OUTPUT)
+      fetch = tess_iface->fetch_output;
+   else
+      fetch = tess_iface->fetch_input;
+
+   if (reg->Register.Indirect) {
+      attrib_index = get_indirect_index(bld,
+                                        reg->Register.File,
+                                        reg->Register.Index,
+                                        &reg->Indirect);
+   } else {
+      attrib_index = lp_build_const_int32(gallivm, reg->Register.Index);
+   }
+
+   if (reg->Register.Dimension) {
+      if (reg->Dimension.Indirect) {
+         vertex_index = get_indirect_index_limit(bld,
+                                                 reg->Dimension.Index,
+                                                 &reg->DimIndirect,
+                                                 -1);
+      } else {
+         vertex_index = lp_build_const_int32(gallivm, reg->Dimension.Index);
+      }
+   }
+
+   res = fetch(tess_iface, bld_base,
+               reg->Register.Dimension && reg->Dimension.Indirect,
+               vertex_index,
+               reg->Register.Indirect,
+               attrib_index,
+               swizzle_index);
+
+   assert(res);
+   if (tgsi_type_is_64bit(stype)) {
+      LLVMValueRef swizzle_index = lp_build_const_int32(gallivm, swizzle + 1);
+      LLVMValueRef res2;
+      res2 = fetch(tess_iface, bld_base,
+                   reg->Register.Dimension && reg->Dimension.Indirect,
+                   vertex_index,
+                   reg->Register.Indirect,
+                   attrib_index,
+                   swizzle_index);
+      assert(res2);
+      res = emit_fetch_64bit(bld_base, stype, res, res2);
+   } else if (stype == TGSI_TYPE_UNSIGNED) {
+      res = LLVMBuildBitCast(builder, res, bld_base->uint_bld.vec_type, "");
+   } else if (stype == TGSI_TYPE_SIGNED) {
+      res = LLVMBuildBitCast(builder, res, bld_base->int_bld.vec_type, "");
+   }
+
+   return res;
+}
+
 static LLVMValueRef
 emit_fetch_temporary(
    struct lp_build_tgsi_context * bld_base,
@@ -1671,6 +1767,56 @@ emit_fetch_system_value(
       atype = TGSI_TYPE_UNSIGNED;
       break;
 
+   case TGSI_SEMANTIC_THREAD_ID:
+      assert(swizzle < 3);
+      res = bld->system_values.thread_id[swizzle];
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_ID:
+      assert(swizzle < 3);
+      res = lp_build_broadcast_scalar(&bld_base->uint_bld, bld->system_values.block_id[swizzle]);
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_GRID_SIZE:
+      assert(swizzle < 3);
+      res = lp_build_broadcast_scalar(&bld_base->uint_bld, bld->system_values.grid_size[swizzle]);
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_SIZE:
+      assert(swizzle < 3);
+      res = lp_build_broadcast_scalar(&bld_base->uint_bld, bld->system_values.block_size[swizzle]);
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_VERTICESIN:
+      res = lp_build_broadcast_scalar(&bld_base->uint_bld, bld->system_values.vertices_in);
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_TESSCOORD:
+      if (swizzle < 3)
+         res = bld->system_values.tess_coord[swizzle];
+      else
+         res = bld_base->base.zero;
+      atype = TGSI_TYPE_FLOAT;
+      break;
+
+   case TGSI_SEMANTIC_TESSOUTER:
+      res = lp_build_broadcast_scalar(&bld_base->base, bld->system_values.tess_outer[swizzle]);
+      atype = TGSI_TYPE_FLOAT;
+      break;
+
+   case TGSI_SEMANTIC_TESSINNER:
+      if (swizzle < 2)
+         res = lp_build_broadcast_scalar(&bld_base->base, bld->system_values.tess_inner[swizzle]);
+      else
+         res = bld_base->base.zero;
+      atype = TGSI_TYPE_FLOAT;
+      break;
+
    default:
       assert(!"unexpected semantic in emit_fetch_system_value");
       res = bld_base->base.zero;
@@ -1757,6 +1903,20 @@ emit_store_64bit_chan(struct lp_build_tgsi_context *bld_base,
    lp_exec_mask_store(&bld->exec_mask, float_bld, temp2, chan_ptr2);
 }
 
+static LLVMValueRef
+mask_vec(struct lp_build_tgsi_context *bld_base)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   LLVMBuilderRef builder = bld->bld_base.base.gallivm->builder;
+   struct lp_exec_mask *exec_mask = &bld->exec_mask;
+
+   if (!exec_mask->has_mask) {
+      return lp_build_mask_value(bld->mask);
+   }
+   return LLVMBuildAnd(builder, lp_build_mask_value(bld->mask),
+                       exec_mask->exec_mask, "");
+}
+
 /**
  * Register store.
  */
@@ -1813,7 +1973,39 @@ emit_store_chan(
       /* Outputs are always stored as floats */
       value = LLVMBuildBitCast(builder, value, float_bld->vec_type, "");
 
-      if (reg->Register.Indirect) {
+      if (bld->tess_iface && bld->tess_iface->emit_store_output) {
+         LLVMValueRef attrib_index;
+         LLVMValueRef vertex_index = NULL;
+
+         if (reg->Register.Indirect)
+            attrib_index = indirect_index;
+         else
+            attrib_index = lp_build_const_int32(gallivm, reg->Register.Index);
+
+         if (reg->Register.Dimension) {
+            if (reg->Dimension.Indirect) {
+               vertex_index = get_indirect_index_limit(bld,
+                                                       reg->Dimension.Index,
+                                                       &reg->DimIndirect,
+                                                       -1);
+            } else {
+               vertex_index = lp_build_const_int32(gallivm,
+                                                   reg->Dimension.Index);
+            }
+         }
+
+         bld->tess_iface->emit_store_output(bld->tess_iface, bld_base,
+                                            reg->Register.Dimension &&
+                                            reg->Dimension.Indirect,
+                                            vertex_index,
+                                            reg->Register.Indirect,
+                                            attrib_index,
+                                            lp_build_const_int32(gallivm,
+                                                                 chan_index),
+                                            value,
+                                            mask_vec(bld_base));
+      }
+      else if (reg->Register.Indirect) {
          LLVMValueRef index_vec;  /* indexes into the output registers */
          LLVMValueRef outputs_array;
          LLVMTypeRef fptr_type;
@@ -3285,20 +3477,6 @@ sviewinfo_emit(
    emit_size_query(bld, emit_data->inst, emit_data->output, TRUE);
 }
 
-static LLVMValueRef
-mask_vec(struct lp_build_tgsi_context *bld_base)
-{
-   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
-   LLVMBuilderRef builder = bld->bld_base.base.gallivm->builder;
-   struct lp_exec_mask *exec_mask = &bld->exec_mask;
-
-   if (!exec_mask->has_mask) {
-      return lp_build_mask_value(bld->mask);
-   }
-   return LLVMBuildAnd(builder, lp_build_mask_value(bld->mask),
-                       exec_mask->exec_mask, "");
-}
-
 static void
 increment_vec_ptr_by_mask(struct lp_build_tgsi_context * bld_base,
                           LLVMValueRef ptr,
@@ -3444,6 +3622,269 @@ end_primitive(
    }
 }
 
+/**
+ * Return the base pointer (i8*) and the size in bytes of the buffer or of
+ * the shared memory accessed by a LOAD/STORE/RESQ/ATOM* instruction.
+ */
+static void
+get_memory_ptr(struct lp_build_tgsi_soa_context *bld,
+               const struct tgsi_full_instruction *inst,
+               LLVMValueRef *base_ptr,
+               LLVMValueRef *size)
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   const struct lp_build_tgsi_cs_iface *cs_iface = bld->cs_iface;
+   unsigned file, index;
+   LLVMValueRef idx;
+
+   if (inst->Instruction.Opcode == TGSI_OPCODE_STORE) {
+      assert(!inst->Dst[0].Register.Indirect);
+      file = inst->Dst[0].Register.File;
+      index = inst->Dst[0].Register.Index;
+   } else {
+      assert(!inst->Src[0].Register.Indirect);
+      file = inst->Src[0].Register.File;
+      index = inst->Src[0].Register.Index;
+   }
+
+   if (file == TGSI_FILE_MEMORY) {
+      *base_ptr = cs_iface->shared_ptr;
+      *size = cs_iface->shared_size;
+      return;
+   }
+
+   assert(file == TGSI_FILE_BUFFER);
+   assert(index < PIPE_MAX_SHADER_BUFFERS);
+   idx = lp_build_const_int32(gallivm, index);
+   *base_ptr = lp_build_array_get(gallivm, cs_iface->ssbo_ptr, idx);
+   *size = lp_build_array_get(gallivm, cs_iface->ssbo_sizes_ptr, idx);
+}
+
+#if HAVE_LLVM >= 0x0309
+static LLVMAtomicRMWBinOp
+atomic_op_from_opcode(unsigned opcode)
+{
+   switch (opcode) {
+   case TGSI_OPCODE_ATOMUADD:
+      return LLVMAtomicRMWBinOpAdd;
+   case TGSI_OPCODE_ATOMXCHG:
+      return LLVMAtomicRMWBinOpXchg;
+   case TGSI_OPCODE_ATOMAND:
+      return LLVMAtomicRMWBinOpAnd;
+   case TGSI_OPCODE_ATOMOR:
+      return LLVMAtomicRMWBinOpOr;
+   case TGSI_OPCODE_ATOMXOR:
+      return LLVMAtomicRMWBinOpXor;
+   case TGSI_OPCODE_ATOMUMIN:
+      return LLVMAtomicRMWBinOpUMin;
+   case TGSI_OPCODE_ATOMUMAX:
+      return LLVMAtomicRMWBinOpUMax;
+   case TGSI_OPCODE_ATOMIMIN:
+      return LLVMAtomicRMWBinOpMin;
+   case TGSI_OPCODE_ATOMIMAX:
+      return LLVMAtomicRMWBinOpMax;
+   default:
+      assert(0);
+      return LLVMAtomicRMWBinOpAdd;
+   }
+}
+#endif
+
+/**
+ * Emit LOAD, STORE and the atomic opcodes.
+ *
+ * Buffer accesses aren't vectorized: the addresses are arbitrary, so we
+ * loop over the active lanes and access one dword at a time.  Accesses
+ * which fall outside of the buffer are dropped, and loads return zero.
+ */
+static void
+memory_op_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const unsigned opcode = inst->Instruction.Opcode;
+   LLVMTypeRef i32_ptr_type =
+      LLVMPointerType(LLVMInt32TypeInContext(gallivm->context), 0);
+   LLVMValueRef values[TGSI_NUM_CHANNELS] = { NULL };
+   LLVMValueRef results[TGSI_NUM_CHANNELS] = { NULL };
+   LLVMValueRef cas_value = NULL;
+   LLVMValueRef base_ptr, size, addr_vec, exec_mask, addr_src;
+   struct lp_build_loop_state loop;
+   struct lp_build_if_state ifthen;
+   unsigned chan_mask, chan;
+
+   get_memory_ptr(bld, inst, &base_ptr, &size);
+
+   if (opcode == TGSI_OPCODE_STORE) {
+      chan_mask = inst->Dst[0].Register.WriteMask;
+      addr_src = lp_build_emit_fetch(bld_base, inst, 0, TGSI_CHAN_X);
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         if (chan_mask & (1 << chan)) {
+            values[chan] = lp_build_emit_fetch(bld_base, inst, 1, chan);
+            values[chan] = LLVMBuildBitCast(builder, values[chan],
+                                            uint_bld->vec_type, "");
+         }
+      }
+   } else {
+      addr_src = lp_build_emit_fetch(bld_base, inst, 1, TGSI_CHAN_X);
+      if (opcode == TGSI_OPCODE_LOAD) {
+         chan_mask = inst->Dst[0].Register.WriteMask;
+      } else {
+         chan_mask = TGSI_WRITEMASK_X;
+         values[0] = lp_build_emit_fetch(bld_base, inst, 2, TGSI_CHAN_X);
+         values[0] = LLVMBuildBitCast(builder, values[0],
+                                      uint_bld->vec_type, "");
+         if (opcode == TGSI_OPCODE_ATOMCAS) {
+            cas_value = lp_build_emit_fetch(bld_base, inst, 3, TGSI_CHAN_X);
+            cas_value = LLVMBuildBitCast(builder, cas_value,
+                                         uint_bld->vec_type, "");
+         }
+      }
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         if (chan_mask & (1 << chan))
+            results[chan] = lp_build_alloca(gallivm, uint_bld->vec_type, "");
+      }
+   }
+
+   addr_vec = LLVMBuildBitCast(builder, addr_src, uint_bld->vec_type, "");
+   exec_mask = mask_vec(bld_base);
+
+   lp_build_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0));
+   {
+      LLVMValueRef lane = loop.counter;
+      LLVMValueRef addr = LLVMBuildExtractElement(builder, addr_vec, lane, "");
+      LLVMValueRef end, cond, ptr;
+
+      end = LLVMBuildAdd(builder, addr,
+                         lp_build_const_int32(gallivm,
+                                              4 * util_last_bit(chan_mask)),
+                         "");
+      cond = LLVMBuildICmp(builder, LLVMIntNE,
+                           LLVMBuildExtractElement(builder, exec_mask,
+                                                   lane, ""),
+                           lp_build_const_int32(gallivm, 0), "");
+      cond = LLVMBuildAnd(builder, cond,
+                          LLVMBuildICmp(builder, LLVMIntULE, end, size, ""),
+                          "");
+      cond = LLVMBuildAnd(builder, cond,
+                          LLVMBuildICmp(builder, LLVMIntULT, addr, end, ""),
+                          "");
+
+      lp_build_if(&ifthen, gallivm, cond);
+
+      ptr = LLVMBuildGEP(builder, base_ptr, &addr, 1, "");
+      ptr = LLVMBuildBitCast(builder, ptr, i32_ptr_type, "");
+
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         LLVMValueRef chan_idx = lp_build_const_int32(gallivm, chan);
+         LLVMValueRef chan_ptr, value = NULL, res = NULL;
+
+         if (!(chan_mask & (1 << chan)))
+            continue;
+
+         chan_ptr = LLVMBuildGEP(builder, ptr, &chan_idx, 1, "");
+         if (values[chan])
+            value = LLVMBuildExtractElement(builder, values[chan], lane, "");
+
+         switch (opcode) {
+         case TGSI_OPCODE_LOAD:
+            res = LLVMBuildLoad(builder, chan_ptr, "");
+            break;
+         case TGSI_OPCODE_STORE:
+            LLVMBuildStore(builder, value, chan_ptr);
+            break;
+#if HAVE_LLVM >= 0x0309
+         case TGSI_OPCODE_ATOMCAS:
+            res = LLVMBuildAtomicCmpXchg(builder, chan_ptr, value,
+                                         LLVMBuildExtractElement(builder,
+                                                                 cas_value,
+                                                                 lane, ""),
+                                         LLVMAtomicOrderingSequentiallyConsistent,
+                                         LLVMAtomicOrderingSequentiallyConsistent,
+                                         false);
+            res = LLVMBuildExtractValue(builder, res, 0, "");
+            break;
+         default:
+            res = LLVMBuildAtomicRMW(builder, atomic_op_from_opcode(opcode),
+                                     chan_ptr, value,
+                                     LLVMAtomicOrderingSequentiallyConsistent,
+                                     false);
+            break;
+#else
+         default:
+            assert(0);
+            break;
+#endif
+         }
+
+         if (res) {
+            LLVMValueRef vec = LLVMBuildLoad(builder, results[chan], "");
+            vec = LLVMBuildInsertElement(builder, vec, res, lane, "");
+            LLVMBuildStore(builder, vec, results[chan]);
+         }
+      }
+
+      lp_build_endif(&ifthen);
+   }
+   lp_build_loop_end_cond(&loop,
+                          lp_build_const_int32(gallivm, uint_bld->type.length),
+                          NULL, LLVMIntUGE);
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (results[chan])
+         emit_data->output[chan] = LLVMBuildLoad(builder, results[chan], "");
+   }
+}
+
+static void
+resq_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   LLVMValueRef base_ptr, size;
+
+   get_memory_ptr(bld, emit_data->inst, &base_ptr, &size);
+   emit_data->output[TGSI_CHAN_X] =
+      lp_build_broadcast_scalar(&bld_base->uint_bld, size);
+}
+
+static void
+barrier_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+
+   if (bld->tess_iface) {
+      assert(bld->tess_iface->emit_barrier);
+      bld->tess_iface->emit_barrier(bld->tess_iface, bld_base);
+   } else {
+      assert(bld->cs_iface->emit_barrier);
+      bld->cs_iface->emit_barrier(bld->cs_iface, bld_base);
+   }
+}
+
+#if HAVE_LLVM >= 0x0309
+static void
+membar_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   LLVMBuildFence(bld_base->base.gallivm->builder,
+                  LLVMAtomicOrderingSequentiallyConsistent, false, "");
+}
+#endif
+
 static void
 cal_emit(
    const struct lp_build_tgsi_action * action,
@@ -3680,7 +4121,8 @@ static void emit_prologue(struct lp_build_tgsi_context * bld_base)
 
    /* If we have indirect addressing in inputs we need to copy them into
     * our alloca array to be able to iterate over them */
-   if (bld->indirect_files & (1 << TGSI_FILE_INPUT) && !bld->gs_iface) {
+   if (bld->indirect_files & (1 << TGSI_FILE_INPUT) &&
+       !bld->gs_iface && !bld->tess_iface) {
       unsigned index, chan;
       LLVMTypeRef vec_type = bld_base->base.vec_type;
       LLVMValueRef array_size = lp_build_const_int32(gallivm,
@@ -3732,7 +4174,7 @@ static void emit_prologue(struct lp_build_tgsi_context * bld_base)
    if (DEBUG_EXECUTION) {
       lp_build_printf(gallivm, "\n");
       emit_dump_file(bld, TGSI_FILE_CONSTANT);
-      if (!bld->gs_iface)
+      if (!bld->gs_iface && !bld->tess_iface)
          emit_dump_file(bld, TGSI_FILE_INPUT);
    }
 }
@@ -3789,7 +4231,9 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef thread_data_ptr,
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface)
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface,
+                  const struct lp_build_tgsi_tess_iface *tess_iface)
 {
    struct lp_build_tgsi_soa_context bld;
 
@@ -3942,6 +4386,38 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                                 max_output_vertices);
    }
 
+   if (cs_iface) {
+      bld.cs_iface = cs_iface;
+      bld.bld_base.op_actions[TGSI_OPCODE_LOAD].emit = memory_op_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_STORE].emit = memory_op_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_RESQ].emit = resq_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_BARRIER].emit = barrier_emit;
+#if HAVE_LLVM >= 0x0309
+      bld.bld_base.op_actions[TGSI_OPCODE_MEMBAR].emit = membar_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMUADD].emit = memory_op_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMXCHG].emit = memory_op_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMCAS].emit = memory_op_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMAND].emit = memory_op_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMOR].emit = memory_op_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMXOR].emit = memory_op_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMUMIN].emit = memory_op_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMUMAX].emit = memory_op_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMIMIN].emit = memory_op_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMIMAX].emit = memory_op_emit;
+#endif
+   }
+
+   if (tess_iface) {
+      /* inputs are always indirect with tessellation shaders */
+      bld.indirect_files |= (1 << TGSI_FILE_INPUT);
+      bld.tess_iface = tess_iface;
+      bld.bld_base.emit_fetch_funcs[TGSI_FILE_INPUT] = emit_fetch_tess_reg;
+      if (tess_iface->fetch_output)
+         bld.bld_base.emit_fetch_funcs[TGSI_FILE_OUTPUT] = emit_fetch_tess_reg;
+      if (tess_iface->emit_barrier)
+         bld.bld_base.op_actions[TGSI_OPCODE_BARRIER].emit = barrier_emit;
+   }
+
    lp_exec_mask_init(&bld.exec_mask, &bld.bld_base.int_bld);
 
    bld.system_values = *system_values;
@@ -32,12 +32,34 @@
 
 #include "pipe/p_config.h"
 #include "pipe/p_state.h"
+#include "util/u_debug.h"
 #include "translate.h"
 
+#if HAVE_LLVM
+/**
+ * The gallivm backend processes several vertices at once, but compiling
+ * with LLVM takes much longer than with translate_sse, and translate keys
+ * often change, so it's only used when TRANSLATE_GALLIVM is set.
+ */
+static boolean
+use_gallivm(void)
+{
+   return debug_get_bool_option("TRANSLATE_GALLIVM", FALSE);
+}
+#endif
+
 struct translate *translate_create( const struct translate_key *key )
 {
    struct translate *translate = NULL;
 
+#if HAVE_LLVM
+   if (use_gallivm()) {
+      translate = translate_gallivm_create( key );
+      if (translate)
+         return translate;
+   }
+#endif
+
 #if defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)
    translate = translate_sse2_create( key );
    if (translate)
@@ -163,6 +163,8 @@ struct translate *translate_sse2_create( const struct translate_key *key );
 
 struct translate *translate_generic_create( const struct translate_key *key );
 
+struct translate *translate_gallivm_create( const struct translate_key *key );
+
 boolean translate_generic_is_output_format_supported(enum pipe_format format);
 
 #endif
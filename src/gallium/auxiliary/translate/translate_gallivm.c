@@ -0,0 +1,802 @@
+/**************************************************************************
+ *
+ * Copyright 2017 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Translate backend which generates code with gallivm.
+ *
+ * The vertices are processed in groups of the native vector width (8 with
+ * AVX, 4 with SSE, NEON or AltiVec): the attributes of a group are fetched
+ * and converted in SoA form with lp_build_fetch_rgba_soa(), then written to
+ * the output vertices.
+ *
+ * Only float outputs and conversions which don't change the channel
+ * encoding (copies and channel widening, like R8G8B8 to R8G8B8A8) are
+ * handled.  translate_create() falls back to the other backends for the
+ * rest.
+ *
+ * A function is compiled for each of the run/run_elts* entrypoints the
+ * first time it is called, since most users only call one or two.
+ */
+
+#include "pipe/p_compiler.h"
+#include "util/u_memory.h"
+#include "util/u_format.h"
+#include "util/u_math.h"
+
+#include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_format.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_swizzle.h"
+#include "gallivm/lp_bld_type.h"
+
+#include "translate.h"
+
+
+/** Input buffer, as read by the generated code */
+struct translate_gallivm_buffer {
+   const uint8_t *base_ptr;
+   uint32_t stride;
+   uint32_t max_index;
+};
+
+typedef void
+(*translate_gallivm_func)(const struct translate_gallivm_buffer *buffers,
+                          const void *elts,
+                          uint32_t start,
+                          uint32_t count,
+                          uint32_t start_instance,
+                          uint32_t instance_id,
+                          void *output_buffer);
+
+enum translate_gallivm_variant {
+   TRANSLATE_GALLIVM_LINEAR,
+   TRANSLATE_GALLIVM_ELTS8,
+   TRANSLATE_GALLIVM_ELTS16,
+   TRANSLATE_GALLIVM_ELTS32,
+   TRANSLATE_GALLIVM_NUM_VARIANTS
+};
+
+/** How an element is converted */
+enum translate_gallivm_path {
+   /** Fetched as float rgba, stored as 32-bit floats */
+   TRANSLATE_GALLIVM_FLOAT,
+   /** Input channels copied as is, missing channels filled with (0,0,0,1) */
+   TRANSLATE_GALLIVM_RAW,
+   /** Instance id stored as an integer */
+   TRANSLATE_GALLIVM_INSTANCE_ID,
+   /** Instance id stored as a float */
+   TRANSLATE_GALLIVM_INSTANCE_ID_FLOAT,
+};
+
+struct translate_gallivm {
+   struct translate translate;
+
+   enum translate_gallivm_path path[TRANSLATE_MAX_ATTRIBS];
+
+   struct translate_gallivm_buffer buffers[PIPE_MAX_ATTRIBS];
+
+   struct {
+      LLVMContextRef context;
+      struct gallivm_state *gallivm;
+      translate_gallivm_func func;
+   } variants[TRANSLATE_GALLIVM_NUM_VARIANTS];
+};
+
+static inline struct translate_gallivm *
+translate_gallivm(struct translate *translate)
+{
+   return (struct translate_gallivm *)translate;
+}
+
+
+static boolean
+has_identity_swizzle(const struct util_format_description *desc)
+{
+   unsigned i;
+
+   for (i = 0; i < desc->nr_channels; i++) {
+      if (desc->swizzle[i] != i)
+         return FALSE;
+   }
+   return TRUE;
+}
+
+static boolean
+is_float32_array(const struct util_format_description *desc)
+{
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN || !desc->is_array ||
+       !has_identity_swizzle(desc))
+      return FALSE;
+
+   for (i = 0; i < desc->nr_channels; i++) {
+      if (desc->channel[i].type != UTIL_FORMAT_TYPE_FLOAT ||
+          desc->channel[i].size != 32)
+         return FALSE;
+   }
+   return TRUE;
+}
+
+/**
+ * Whether the output is the input with the same channel encoding and
+ * possibly more channels, so it can be written without converting.
+ */
+static boolean
+is_raw_copy(const struct util_format_description *input,
+            const struct util_format_description *output)
+{
+   unsigned i;
+
+   if (input->format == output->format)
+      return input->block.width == 1 && input->block.height == 1 &&
+             input->block.bits % 8 == 0;
+
+   if (input->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       output->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       !input->is_array || !output->is_array ||
+       input->colorspace != output->colorspace ||
+       input->nr_channels > output->nr_channels ||
+       !has_identity_swizzle(input) || !has_identity_swizzle(output) ||
+       output->channel[0].size % 8 != 0)
+      return FALSE;
+
+   for (i = 0; i < output->nr_channels; i++) {
+      if (output->channel[i].type != output->channel[0].type ||
+          output->channel[i].normalized != output->channel[0].normalized ||
+          output->channel[i].pure_integer != output->channel[0].pure_integer ||
+          output->channel[i].size != output->channel[0].size)
+         return FALSE;
+   }
+
+   for (i = 0; i < input->nr_channels; i++) {
+      if (memcmp(&input->channel[i], &output->channel[i],
+                 sizeof(input->channel[i])) != 0)
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+static boolean
+choose_path(const struct translate_element *element,
+            enum translate_gallivm_path *path)
+{
+   const struct util_format_description *input =
+      util_format_description(element->input_format);
+   const struct util_format_description *output =
+      util_format_description(element->output_format);
+
+   if (!input || !output)
+      return FALSE;
+
+   if (element->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+      if (element->output_format == PIPE_FORMAT_R32_UINT ||
+          element->output_format == PIPE_FORMAT_R32_SINT) {
+         *path = TRANSLATE_GALLIVM_INSTANCE_ID;
+         return TRUE;
+      }
+      if (element->output_format == PIPE_FORMAT_R32_FLOAT) {
+         *path = TRANSLATE_GALLIVM_INSTANCE_ID_FLOAT;
+         return TRUE;
+      }
+      return FALSE;
+   }
+
+   if (is_raw_copy(input, output)) {
+      *path = TRANSLATE_GALLIVM_RAW;
+      return TRUE;
+   }
+
+   if (is_float32_array(output) &&
+       input->layout == UTIL_FORMAT_LAYOUT_PLAIN &&
+       input->colorspace == UTIL_FORMAT_COLORSPACE_RGB &&
+       input->block.width == 1 && input->block.height == 1 &&
+       !util_format_is_pure_integer(input->format)) {
+      *path = TRANSLATE_GALLIVM_FLOAT;
+      return TRUE;
+   }
+
+   return FALSE;
+}
+
+
+/*
+ * Code generation.
+ */
+
+struct translate_gallivm_build {
+   struct gallivm_state *gallivm;
+   const struct translate_key *key;
+   const enum translate_gallivm_path *path;
+   enum translate_gallivm_variant variant;
+
+   /** Number of vertices processed at once */
+   unsigned length;
+
+   struct lp_type float_type;
+   struct lp_type uint_type;
+   struct lp_build_context uint_bld;
+
+   LLVMValueRef buffers;
+   LLVMValueRef elts;
+   LLVMValueRef start;
+   LLVMValueRef count;
+   LLVMValueRef start_instance;
+   LLVMValueRef instance_id;
+   LLVMValueRef output;
+};
+
+static LLVMValueRef
+byte_offset(struct gallivm_state *gallivm, LLVMValueRef ptr,
+            LLVMValueRef offset)
+{
+   return LLVMBuildGEP(gallivm->builder, ptr, &offset, 1, "");
+}
+
+static LLVMValueRef
+typed_pointer(struct gallivm_state *gallivm, LLVMValueRef ptr,
+              LLVMTypeRef type)
+{
+   return LLVMBuildBitCast(gallivm->builder, ptr,
+                           LLVMPointerType(type, 0), "");
+}
+
+/** Load a member of a translate_gallivm_buffer. */
+static LLVMValueRef
+load_buffer_member(struct translate_gallivm_build *b, unsigned buffer,
+                   unsigned member_offset, LLVMTypeRef type)
+{
+   struct gallivm_state *gallivm = b->gallivm;
+   unsigned offset = buffer * sizeof(struct translate_gallivm_buffer) +
+                     member_offset;
+   LLVMValueRef ptr;
+
+   ptr = byte_offset(gallivm, b->buffers,
+                     lp_build_const_int32(gallivm, offset));
+   return LLVMBuildLoad(gallivm->builder, typed_pointer(gallivm, ptr, type),
+                        "");
+}
+
+static void
+store_unaligned(struct gallivm_state *gallivm, LLVMValueRef value,
+                LLVMValueRef dst)
+{
+   LLVMValueRef store;
+
+   store = LLVMBuildStore(gallivm->builder, value,
+                          typed_pointer(gallivm, dst, LLVMTypeOf(value)));
+   LLVMSetAlignment(store, 1);
+}
+
+/** Copy size bytes between byte pointers, with the widest integers. */
+static void
+emit_copy(struct gallivm_state *gallivm, LLVMValueRef dst, LLVMValueRef src,
+          unsigned size)
+{
+   unsigned offset = 0;
+
+   while (offset < size) {
+      unsigned chunk = 8;
+      LLVMTypeRef type;
+      LLVMValueRef offset_val, value;
+
+      while (chunk > size - offset)
+         chunk /= 2;
+
+      type = LLVMIntTypeInContext(gallivm->context, chunk * 8);
+      offset_val = lp_build_const_int32(gallivm, offset);
+
+      value = LLVMBuildLoad(gallivm->builder,
+                            typed_pointer(gallivm,
+                                          byte_offset(gallivm, src, offset_val),
+                                          type), "");
+      LLVMSetAlignment(value, 1);
+      store_unaligned(gallivm, value, byte_offset(gallivm, dst, offset_val));
+
+      offset += chunk;
+   }
+}
+
+/**
+ * The value of a missing channel of a raw copy, as an integer of the
+ * channel size: 0 for red, green and blue and 1 for alpha.
+ */
+static LLVMValueRef
+default_channel_value(struct gallivm_state *gallivm,
+                      const struct util_format_channel_description *channel,
+                      unsigned chan)
+{
+   LLVMTypeRef type = LLVMIntTypeInContext(gallivm->context, channel->size);
+   unsigned long long one;
+
+   if (chan != 3)
+      return LLVMConstNull(type);
+
+   if (channel->type == UTIL_FORMAT_TYPE_FLOAT) {
+      switch (channel->size) {
+      case 16:
+         one = 0x3c00;
+         break;
+      case 32:
+         one = 0x3f800000;
+         break;
+      default:
+         assert(channel->size == 64);
+         one = 0x3ff0000000000000ull;
+         break;
+      }
+   }
+   else if (channel->normalized) {
+      if (channel->type == UTIL_FORMAT_TYPE_SIGNED)
+         one = (1ull << (channel->size - 1)) - 1;
+      else
+         one = channel->size == 64 ? ~0ull : (1ull << channel->size) - 1;
+   }
+   else {
+      one = 1;
+   }
+
+   return LLVMConstInt(type, one, 0);
+}
+
+/**
+ * Return the vertex index of each lane of a group starting at vertex i.
+ * In the last group, the lanes past the end repeat the last vertex.
+ */
+static LLVMValueRef
+build_vertex_ids(struct translate_gallivm_build *b, LLVMValueRef i,
+                 boolean tail)
+{
+   struct gallivm_state *gallivm = b->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef last = NULL;
+   LLVMValueRef ids = b->uint_bld.undef;
+   unsigned lane;
+
+   if (tail)
+      last = LLVMBuildSub(builder, b->count,
+                          lp_build_const_int32(gallivm, 1), "");
+
+   for (lane = 0; lane < b->length; lane++) {
+      LLVMValueRef lane_val = lp_build_const_int32(gallivm, lane);
+      LLVMValueRef pos = LLVMBuildAdd(builder, i, lane_val, "");
+      LLVMValueRef id;
+
+      if (tail) {
+         LLVMValueRef past_end = LLVMBuildICmp(builder, LLVMIntUGT,
+                                               pos, last, "");
+         pos = LLVMBuildSelect(builder, past_end, last, pos, "");
+      }
+
+      if (b->variant == TRANSLATE_GALLIVM_LINEAR) {
+         id = LLVMBuildAdd(builder, b->start, pos, "");
+      }
+      else {
+         unsigned bits = b->variant == TRANSLATE_GALLIVM_ELTS8 ? 8 :
+                         b->variant == TRANSLATE_GALLIVM_ELTS16 ? 16 : 32;
+         LLVMTypeRef elt_type = LLVMIntTypeInContext(gallivm->context, bits);
+         LLVMValueRef elts = typed_pointer(gallivm, b->elts, elt_type);
+
+         id = LLVMBuildLoad(builder, LLVMBuildGEP(builder, elts, &pos, 1, ""),
+                            "");
+         if (bits < 32)
+            id = LLVMBuildZExt(builder, id,
+                               LLVMInt32TypeInContext(gallivm->context), "");
+      }
+
+      ids = LLVMBuildInsertElement(builder, ids, id, lane_val, "");
+   }
+
+   return ids;
+}
+
+/**
+ * Translate a group of vertices starting at vertex i.  If tail is set,
+ * only the vertices before count are written.
+ */
+static void
+build_group(struct translate_gallivm_build *b, LLVMValueRef i, boolean tail)
+{
+   struct gallivm_state *gallivm = b->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct translate_key *key = b->key;
+   LLVMValueRef rgba[TRANSLATE_MAX_ATTRIBS][4];
+   LLVMValueRef offsets[TRANSLATE_MAX_ATTRIBS];
+   LLVMValueRef base_ptrs[TRANSLATE_MAX_ATTRIBS];
+   LLVMValueRef vertex_ids, output;
+   unsigned lane, e, chan;
+
+   vertex_ids = build_vertex_ids(b, i, tail);
+
+   /* Fetch the attributes of all the lanes. */
+   for (e = 0; e < key->nr_elements; e++) {
+      const struct translate_element *element = &key->element[e];
+      LLVMValueRef index, stride;
+
+      if (b->path[e] == TRANSLATE_GALLIVM_INSTANCE_ID ||
+          b->path[e] == TRANSLATE_GALLIVM_INSTANCE_ID_FLOAT)
+         continue;
+
+      base_ptrs[e] = load_buffer_member(b, element->input_buffer,
+                        offsetof(struct translate_gallivm_buffer, base_ptr),
+                        LLVMPointerType(LLVMInt8TypeInContext(gallivm->context),
+                                        0));
+      stride = load_buffer_member(b, element->input_buffer,
+                        offsetof(struct translate_gallivm_buffer, stride),
+                        LLVMInt32TypeInContext(gallivm->context));
+
+      if (element->instance_divisor) {
+         index = LLVMBuildUDiv(builder, b->instance_id,
+                               lp_build_const_int32(gallivm,
+                                                    element->instance_divisor),
+                               "");
+         index = LLVMBuildAdd(builder, b->start_instance, index, "");
+         index = lp_build_broadcast_scalar(&b->uint_bld, index);
+      }
+      else {
+         LLVMValueRef max_index =
+            load_buffer_member(b, element->input_buffer,
+                     offsetof(struct translate_gallivm_buffer, max_index),
+                     LLVMInt32TypeInContext(gallivm->context));
+
+         /* clamp to avoid going out of bounds */
+         index = lp_build_min(&b->uint_bld, vertex_ids,
+                              lp_build_broadcast_scalar(&b->uint_bld,
+                                                        max_index));
+      }
+
+      offsets[e] = lp_build_mul(&b->uint_bld, index,
+                                lp_build_broadcast_scalar(&b->uint_bld,
+                                                          stride));
+      offsets[e] = lp_build_add(&b->uint_bld, offsets[e],
+                                lp_build_const_int_vec(gallivm, b->uint_type,
+                                                       element->input_offset));
+
+      if (b->path[e] == TRANSLATE_GALLIVM_FLOAT) {
+         lp_build_fetch_rgba_soa(gallivm,
+                                 util_format_description(element->input_format),
+                                 b->float_type, FALSE, base_ptrs[e],
+                                 offsets[e],
+                                 lp_build_const_int32(gallivm, 0),
+                                 lp_build_const_int32(gallivm, 0),
+                                 NULL, rgba[e]);
+      }
+   }
+
+   output = byte_offset(gallivm, b->output,
+                        LLVMBuildMul(builder, i,
+                                     lp_build_const_int32(gallivm,
+                                                          key->output_stride),
+                                     ""));
+
+   /* Write the output vertices. */
+   for (lane = 0; lane < b->length; lane++) {
+      LLVMValueRef lane_val = lp_build_const_int32(gallivm, lane);
+      struct lp_build_if_state if_ctx;
+      LLVMValueRef vertex;
+
+      if (tail) {
+         LLVMValueRef pos = LLVMBuildAdd(builder, i, lane_val, "");
+         lp_build_if(&if_ctx, gallivm,
+                     LLVMBuildICmp(builder, LLVMIntULT, pos, b->count, ""));
+      }
+
+      vertex = byte_offset(gallivm, output,
+                           lp_build_const_int32(gallivm,
+                                                lane * key->output_stride));
+
+      for (e = 0; e < key->nr_elements; e++) {
+         const struct translate_element *element = &key->element[e];
+         const struct util_format_description *input =
+            util_format_description(element->input_format);
+         const struct util_format_description *out_desc =
+            util_format_description(element->output_format);
+         LLVMValueRef dst =
+            byte_offset(gallivm, vertex,
+                        lp_build_const_int32(gallivm, element->output_offset));
+
+         switch (b->path[e]) {
+         case TRANSLATE_GALLIVM_FLOAT:
+            for (chan = 0; chan < out_desc->nr_channels; chan++) {
+               LLVMValueRef value =
+                  LLVMBuildExtractElement(builder, rgba[e][chan], lane_val, "");
+               store_unaligned(gallivm, value,
+                               byte_offset(gallivm, dst,
+                                           lp_build_const_int32(gallivm,
+                                                                chan * 4)));
+            }
+            break;
+
+         case TRANSLATE_GALLIVM_RAW: {
+            LLVMValueRef src =
+               byte_offset(gallivm, base_ptrs[e],
+                           LLVMBuildExtractElement(builder, offsets[e],
+                                                   lane_val, ""));
+            unsigned chan_bytes = out_desc->channel[0].size / 8;
+
+            emit_copy(gallivm, dst, src, input->block.bits / 8);
+
+            for (chan = input->nr_channels;
+                 input->format != out_desc->format &&
+                 chan < out_desc->nr_channels; chan++) {
+               store_unaligned(gallivm,
+                               default_channel_value(gallivm,
+                                                     &out_desc->channel[chan],
+                                                     chan),
+                               byte_offset(gallivm, dst,
+                                           lp_build_const_int32(gallivm,
+                                                   chan * chan_bytes)));
+            }
+            break;
+         }
+
+         case TRANSLATE_GALLIVM_INSTANCE_ID:
+            store_unaligned(gallivm, b->instance_id, dst);
+            break;
+
+         case TRANSLATE_GALLIVM_INSTANCE_ID_FLOAT:
+            store_unaligned(gallivm,
+                            LLVMBuildUIToFP(builder, b->instance_id,
+                                  LLVMFloatTypeInContext(gallivm->context),
+                                  ""),
+                            dst);
+            break;
+         }
+      }
+
+      if (tail)
+         lp_build_endif(&if_ctx);
+   }
+}
+
+static LLVMValueRef
+build_function(struct translate_gallivm_build *b)
+{
+   struct gallivm_state *gallivm = b->gallivm;
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i8_ptr = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+   LLVMTypeRef i32 = LLVMInt32TypeInContext(context);
+   LLVMTypeRef args[7];
+   LLVMValueRef func, full_groups;
+   struct lp_build_for_loop_state loop;
+   struct lp_build_if_state if_ctx;
+   LLVMBasicBlockRef block;
+
+   args[0] = i8_ptr;  /* buffers */
+   args[1] = i8_ptr;  /* elts */
+   args[2] = i32;     /* start */
+   args[3] = i32;     /* count */
+   args[4] = i32;     /* start_instance */
+   args[5] = i32;     /* instance_id */
+   args[6] = i8_ptr;  /* output_buffer */
+
+   func = LLVMAddFunction(gallivm->module, "translate",
+                          LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                           args, ARRAY_SIZE(args), 0));
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+
+   b->buffers = LLVMGetParam(func, 0);
+   b->elts = LLVMGetParam(func, 1);
+   b->start = LLVMGetParam(func, 2);
+   b->count = LLVMGetParam(func, 3);
+   b->start_instance = LLVMGetParam(func, 4);
+   b->instance_id = LLVMGetParam(func, 5);
+   b->output = LLVMGetParam(func, 6);
+
+   block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&b->uint_bld, gallivm, b->uint_type);
+
+   /* Whole groups of vertices... */
+   full_groups = LLVMBuildAnd(builder, b->count,
+                              lp_build_const_int32(gallivm, ~(b->length - 1)),
+                              "");
+   lp_build_for_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0),
+                           LLVMIntULT, full_groups,
+                           lp_build_const_int32(gallivm, b->length));
+   build_group(b, loop.counter, FALSE);
+   lp_build_for_loop_end(&loop);
+
+   /* ...and the remaining vertices. */
+   lp_build_if(&if_ctx, gallivm,
+               LLVMBuildICmp(builder, LLVMIntULT, full_groups, b->count, ""));
+   build_group(b, full_groups, TRUE);
+   lp_build_endif(&if_ctx);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+static translate_gallivm_func
+get_variant(struct translate_gallivm *tg, enum translate_gallivm_variant v)
+{
+   struct translate_gallivm_build b;
+   LLVMValueRef func;
+
+   if (tg->variants[v].func)
+      return tg->variants[v].func;
+
+   tg->variants[v].context = LLVMContextCreate();
+   tg->variants[v].gallivm = gallivm_create("translate",
+                                            tg->variants[v].context);
+
+   memset(&b, 0, sizeof(b));
+   b.gallivm = tg->variants[v].gallivm;
+   b.key = &tg->translate.key;
+   b.path = tg->path;
+   b.variant = v;
+   b.length = lp_native_vector_width / 32;
+   b.float_type = lp_type_float_vec(32, lp_native_vector_width);
+   b.uint_type = lp_type_uint_vec(32, lp_native_vector_width);
+
+   func = build_function(&b);
+
+   gallivm_compile_module(b.gallivm);
+   tg->variants[v].func =
+      (translate_gallivm_func) gallivm_jit_function(b.gallivm, func);
+   gallivm_free_ir(b.gallivm);
+
+   return tg->variants[v].func;
+}
+
+
+/*
+ * Translate interface.
+ */
+
+static void
+translate_gallivm_set_buffer(struct translate *translate,
+                             unsigned buf,
+                             const void *ptr,
+                             unsigned stride,
+                             unsigned max_index)
+{
+   struct translate_gallivm *tg = translate_gallivm(translate);
+
+   if (buf < ARRAY_SIZE(tg->buffers)) {
+      tg->buffers[buf].base_ptr = ptr;
+      tg->buffers[buf].stride = stride;
+      tg->buffers[buf].max_index = max_index;
+   }
+}
+
+static void PIPE_CDECL
+translate_gallivm_run_elts(struct translate *translate,
+                           const unsigned *elts,
+                           unsigned count,
+                           unsigned start_instance,
+                           unsigned instance_id,
+                           void *output_buffer)
+{
+   struct translate_gallivm *tg = translate_gallivm(translate);
+
+   get_variant(tg, TRANSLATE_GALLIVM_ELTS32)(tg->buffers, elts, 0, count,
+                                             start_instance, instance_id,
+                                             output_buffer);
+}
+
+static void PIPE_CDECL
+translate_gallivm_run_elts16(struct translate *translate,
+                             const uint16_t *elts,
+                             unsigned count,
+                             unsigned start_instance,
+                             unsigned instance_id,
+                             void *output_buffer)
+{
+   struct translate_gallivm *tg = translate_gallivm(translate);
+
+   get_variant(tg, TRANSLATE_GALLIVM_ELTS16)(tg->buffers, elts, 0, count,
+                                             start_instance, instance_id,
+                                             output_buffer);
+}
+
+static void PIPE_CDECL
+translate_gallivm_run_elts8(struct translate *translate,
+                            const uint8_t *elts,
+                            unsigned count,
+                            unsigned start_instance,
+                            unsigned instance_id,
+                            void *output_buffer)
+{
+   struct translate_gallivm *tg = translate_gallivm(translate);
+
+   get_variant(tg, TRANSLATE_GALLIVM_ELTS8)(tg->buffers, elts, 0, count,
+                                            start_instance, instance_id,
+                                            output_buffer);
+}
+
+static void PIPE_CDECL
+translate_gallivm_run(struct translate *translate,
+                      unsigned start,
+                      unsigned count,
+                      unsigned start_instance,
+                      unsigned instance_id,
+                      void *output_buffer)
+{
+   struct translate_gallivm *tg = translate_gallivm(translate);
+
+   get_variant(tg, TRANSLATE_GALLIVM_LINEAR)(tg->buffers, NULL, start, count,
+                                             start_instance, instance_id,
+                                             output_buffer);
+}
+
+static void
+translate_gallivm_release(struct translate *translate)
+{
+   struct translate_gallivm *tg = translate_gallivm(translate);
+   unsigned v;
+
+   for (v = 0; v < TRANSLATE_GALLIVM_NUM_VARIANTS; v++) {
+      if (tg->variants[v].gallivm)
+         gallivm_destroy(tg->variants[v].gallivm);
+      if (tg->variants[v].context)
+         LLVMContextDispose(tg->variants[v].context);
+   }
+
+   FREE(tg);
+}
+
+struct translate *
+translate_gallivm_create(const struct translate_key *key)
+{
+   struct translate_gallivm *tg;
+   unsigned i;
+
+   if (!lp_build_init())
+      return NULL;
+
+   tg = CALLOC_STRUCT(translate_gallivm);
+   if (!tg)
+      return NULL;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      if (key->element[i].input_buffer >= ARRAY_SIZE(tg->buffers) ||
+          !choose_path(&key->element[i], &tg->path[i])) {
+         FREE(tg);
+         return NULL;
+      }
+   }
+
+   tg->translate.key = *key;
+   tg->translate.release = translate_gallivm_release;
+   tg->translate.set_buffer = translate_gallivm_set_buffer;
+   tg->translate.run_elts = translate_gallivm_run_elts;
+   tg->translate.run_elts16 = translate_gallivm_run_elts16;
+   tg->translate.run_elts8 = translate_gallivm_run_elts8;
+   tg->translate.run = translate_gallivm_run;
+
+   return &tg->translate;
+}
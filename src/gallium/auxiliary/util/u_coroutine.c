@@ -0,0 +1,308 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "pipe/p_config.h"
+#include "util/u_memory.h"
+#include "util/u_coroutine.h"
+
+#if defined(PIPE_OS_WINDOWS)
+#include <windows.h>
+#else
+#include <stdint.h>
+#include <ucontext.h>
+#endif
+
+
+struct util_coroutine {
+#if defined(PIPE_OS_WINDOWS)
+   LPVOID fiber;
+#else
+   ucontext_t context;
+   void *stack;
+#endif
+   boolean done;
+};
+
+struct util_coroutine_group {
+   unsigned stack_size;
+
+   /* Coroutines are created on demand and reused by the next runs */
+   struct util_coroutine *coroutines;
+   unsigned num_coroutines;
+
+   util_coroutine_func func;
+   void *data;
+   unsigned current;
+   boolean running;
+
+#if defined(PIPE_OS_WINDOWS)
+   LPVOID main_fiber;
+#else
+   ucontext_t main_context;
+#endif
+};
+
+
+struct util_coroutine_group *
+util_coroutine_group_create(unsigned stack_size)
+{
+   struct util_coroutine_group *group = CALLOC_STRUCT(util_coroutine_group);
+
+   if (group)
+      group->stack_size = stack_size;
+
+   return group;
+}
+
+
+void
+util_coroutine_group_destroy(struct util_coroutine_group *group)
+{
+   unsigned i;
+
+   for (i = 0; i < group->num_coroutines; i++) {
+#if defined(PIPE_OS_WINDOWS)
+      DeleteFiber(group->coroutines[i].fiber);
+#else
+      FREE(group->coroutines[i].stack);
+#endif
+   }
+
+   FREE(group->coroutines);
+   FREE(group);
+}
+
+
+#if defined(PIPE_OS_WINDOWS)
+
+/* A fiber must never return, so it loops and runs whichever task the
+ * scheduler switched it to.
+ */
+static void WINAPI
+coroutine_entry(LPVOID param)
+{
+   struct util_coroutine_group *group = param;
+
+   for (;;) {
+      unsigned index = group->current;
+
+      group->func(group->data, index);
+      group->coroutines[index].done = TRUE;
+      SwitchToFiber(group->main_fiber);
+   }
+}
+
+static boolean
+coroutine_alloc(struct util_coroutine_group *group, unsigned index)
+{
+   struct util_coroutine *co = &group->coroutines[index];
+
+   if (!co->fiber)
+      co->fiber = CreateFiber(group->stack_size, coroutine_entry, group);
+
+   return co->fiber != NULL;
+}
+
+static boolean
+coroutine_start(struct util_coroutine_group *group, unsigned index)
+{
+   group->coroutines[index].done = FALSE;
+   return TRUE;
+}
+
+static inline void
+coroutine_resume(struct util_coroutine_group *group, unsigned index)
+{
+   SwitchToFiber(group->coroutines[index].fiber);
+}
+
+#else
+
+/* makecontext() only passes int arguments, so the group pointer is split in
+ * two halves.
+ */
+static void
+coroutine_entry(int hi, int lo)
+{
+   struct util_coroutine_group *group = (struct util_coroutine_group *)
+      (uintptr_t)(((uint64_t)(unsigned)hi << 32) | (unsigned)lo);
+   unsigned index = group->current;
+
+   group->func(group->data, index);
+   group->coroutines[index].done = TRUE;
+
+   /* returning resumes uc_link, i.e. the scheduler */
+}
+
+static boolean
+coroutine_alloc(struct util_coroutine_group *group, unsigned index)
+{
+   struct util_coroutine *co = &group->coroutines[index];
+
+   if (!co->stack)
+      co->stack = MALLOC(group->stack_size);
+
+   return co->stack != NULL;
+}
+
+static boolean
+coroutine_start(struct util_coroutine_group *group, unsigned index)
+{
+   struct util_coroutine *co = &group->coroutines[index];
+   uint64_t ptr = (uintptr_t)group;
+
+   if (getcontext(&co->context) != 0)
+      return FALSE;
+
+   co->context.uc_stack.ss_sp = co->stack;
+   co->context.uc_stack.ss_size = group->stack_size;
+   co->context.uc_link = &group->main_context;
+   makecontext(&co->context, (void (*)(void))coroutine_entry, 2,
+               (int)(ptr >> 32), (int)(ptr & 0xffffffff));
+
+   co->done = FALSE;
+   return TRUE;
+}
+
+static inline void
+coroutine_resume(struct util_coroutine_group *group, unsigned index)
+{
+   swapcontext(&group->main_context, &group->coroutines[index].context);
+}
+
+#endif
+
+
+/**
+ * Allocate the coroutines and stacks for running count tasks, so that
+ * util_coroutine_group_run() can't fail for lack of memory.
+ */
+boolean
+util_coroutine_group_reserve(struct util_coroutine_group *group,
+                             unsigned count)
+{
+   unsigned i;
+
+   if (count > group->num_coroutines) {
+      struct util_coroutine *coroutines =
+         REALLOC(group->coroutines,
+                 group->num_coroutines * sizeof(*coroutines),
+                 count * sizeof(*coroutines));
+      if (!coroutines)
+         return FALSE;
+
+      memset(&coroutines[group->num_coroutines], 0,
+             (count - group->num_coroutines) * sizeof(*coroutines));
+      group->coroutines = coroutines;
+      group->num_coroutines = count;
+   }
+
+   for (i = 0; i < count; i++) {
+      if (!coroutine_alloc(group, i))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Run func(data, i) for i in [0, count), interleaving the calls at every
+ * util_coroutine_group_barrier().
+ *
+ * Returns FALSE without running any task if the coroutines can't be
+ * created.  Running the tasks one after the other instead would be wrong
+ * for tasks with barriers, so that is left to the caller.
+ */
+boolean
+util_coroutine_group_run(struct util_coroutine_group *group, unsigned count,
+                         util_coroutine_func func, void *data)
+{
+   unsigned remaining = count;
+   unsigned i;
+#if defined(PIPE_OS_WINDOWS)
+   boolean converted = FALSE;
+#endif
+
+   if (!util_coroutine_group_reserve(group, count))
+      return FALSE;
+
+   group->func = func;
+   group->data = data;
+
+   for (i = 0; i < count; i++) {
+      if (!coroutine_start(group, i))
+         return FALSE;
+   }
+
+#if defined(PIPE_OS_WINDOWS)
+   if (IsThreadAFiber()) {
+      group->main_fiber = GetCurrentFiber();
+   } else {
+      group->main_fiber = ConvertThreadToFiber(NULL);
+      if (!group->main_fiber)
+         return FALSE;
+      converted = TRUE;
+   }
+#endif
+
+   group->running = TRUE;
+   while (remaining) {
+      for (i = 0; i < count; i++) {
+         if (group->coroutines[i].done)
+            continue;
+
+         group->current = i;
+         coroutine_resume(group, i);
+
+         if (group->coroutines[i].done)
+            remaining--;
+      }
+   }
+   group->running = FALSE;
+
+#if defined(PIPE_OS_WINDOWS)
+   if (converted)
+      ConvertFiberToThread();
+#endif
+   return TRUE;
+}
+
+
+/**
+ * Suspend the current task until all the other tasks of the group reached
+ * a barrier or finished.
+ */
+void
+util_coroutine_group_barrier(struct util_coroutine_group *group)
+{
+   if (!group->running)
+      return;
+
+#if defined(PIPE_OS_WINDOWS)
+   SwitchToFiber(group->main_fiber);
+#else
+   swapcontext(&group->coroutines[group->current].context,
+               &group->main_context);
+#endif
+}
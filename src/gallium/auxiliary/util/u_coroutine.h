@@ -0,0 +1,74 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * Cooperative coroutines, used to run the invocations of a compute shader
+ * work group on a single thread while still honouring barriers.
+ *
+ * util_coroutine_group_run() starts one coroutine per task and runs them
+ * round-robin: each coroutine runs until it finishes or calls
+ * util_coroutine_group_barrier(), at which point the next one is resumed.
+ * Once every task reached the barrier, the first one is resumed again.
+ *
+ * util_coroutine_group_run() fails if the coroutines can't be created,
+ * util_coroutine_group_reserve() allows creating them ahead of time.
+ *
+ * A group must only be used by one thread at a time.
+ */
+
+#ifndef U_COROUTINE_H
+#define U_COROUTINE_H
+
+#include "pipe/p_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct util_coroutine_group;
+
+typedef void (*util_coroutine_func)(void *data, unsigned index);
+
+struct util_coroutine_group *
+util_coroutine_group_create(unsigned stack_size);
+
+void
+util_coroutine_group_destroy(struct util_coroutine_group *group);
+
+boolean
+util_coroutine_group_reserve(struct util_coroutine_group *group,
+                             unsigned count);
+
+boolean
+util_coroutine_group_run(struct util_coroutine_group *group, unsigned count,
+                         util_coroutine_func func, void *data);
+
+void
+util_coroutine_group_barrier(struct util_coroutine_group *group);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_COROUTINE_H */
@@ -313,6 +313,7 @@ i915_get_param(struct pipe_screen *screen, enum pipe_cap cap)
    case PIPE_CAP_NIR_SAMPLERS_AS_DEREF:
    case PIPE_CAP_QUERY_SO_OVERFLOW:
    case PIPE_CAP_MEMOBJ:
+   case PIPE_CAP_SHAREABLE_CSOS:
       return 0;
 
    case PIPE_CAP_MAX_VIEWPORTS:
@@ -93,4 +93,15 @@
  */
 #define LP_MAX_SETUP_VARIANTS 64
 
+/**
+ * Max shared memory of a compute work group, allocated once per
+ * rasterizer thread.
+ */
+#define LP_MAX_SHARED_MEM_SIZE (32 * 1024)
+
+/**
+ * Max number of invocations in a compute work group.
+ */
+#define LP_MAX_THREADS_PER_BLOCK 1024
+
 #endif /* LP_LIMITS_H */
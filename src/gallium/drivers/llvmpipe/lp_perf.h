@@ -62,6 +62,9 @@ struct lp_counters
    unsigned nr_color_tile_clear;
    unsigned nr_color_tile_load;
    unsigned nr_color_tile_store;
+
+   uint64_t nr_tex_cache_access;
+   uint64_t nr_tex_cache_miss;
 };
 
 
@@ -26,6 +26,7 @@
  **************************************************************************/
 
 #include <limits.h>
+#include "util/u_atomic.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_rect.h"
@@ -668,12 +669,7 @@ rasterize_scene(struct lp_rasterizer_task *task,
    /* Clear the cache tags. This should not always be necessary but
       simpler for now. */
 #if LP_USE_TEXTURE_CACHE
-   memset(task->thread_data.cache->cache_tags, 0,
-          sizeof(task->thread_data.cache->cache_tags));
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-   task->thread_data.cache->cache_access_total = 0;
-   task->thread_data.cache->cache_access_miss = 0;
-#endif
+   lp_build_format_cache_invalidate(task->thread_data.cache);
 #endif
 
    if (!task->rast->no_rast && !scene->discard) {
@@ -691,18 +687,11 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 
 
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-   {
-      uint64_t total, miss;
-      total = task->thread_data.cache->cache_access_total;
-      miss = task->thread_data.cache->cache_access_miss;
-      if (total) {
-         debug_printf("thread %d cache access %llu miss %llu hit rate %f\n",
-                 task->thread_index, (long long unsigned)total,
-                 (long long unsigned)miss,
-                 (float)(total - miss)/(float)total);
-      }
-   }
+#if LP_USE_TEXTURE_CACHE
+   LP_COUNT_ADD(nr_tex_cache_access,
+                task->thread_data.cache->cache_access_total);
+   LP_COUNT_ADD(nr_tex_cache_miss,
+                task->thread_data.cache->cache_access_miss);
 #endif
 
    if (scene->fence) {
@@ -774,6 +763,69 @@ lp_rast_finish( struct lp_rasterizer *rast )
 }
 
 
+/**
+ * Run the jobs posted by lp_rast_run_jobs() until there are none left.
+ */
+static void
+run_jobs(struct lp_rasterizer_task *task)
+{
+   struct lp_rasterizer *rast = task->rast;
+   int32_t job;
+
+   while ((job = p_atomic_inc_return(&rast->jobs.next_job) - 1) <
+          (int32_t)rast->jobs.num_jobs) {
+      rast->jobs.func(rast->jobs.data, task->thread_index, job);
+   }
+}
+
+
+/**
+ * Run func(data, thread_index, job) for every job in [0, num_jobs) on the
+ * rasterizer threads, and wait for all of them to complete.
+ *
+ * This is how compute grids are dispatched: they don't need any binning,
+ * the threads just pull the next job until they're all taken.  The caller
+ * must hold the screen's rast_mutex.
+ */
+void
+lp_rast_run_jobs( struct lp_rasterizer *rast,
+                  unsigned num_jobs,
+                  lp_rast_job_func func,
+                  void *data )
+{
+   unsigned i;
+
+   if (!num_jobs)
+      return;
+
+   rast->jobs.func = func;
+   rast->jobs.data = data;
+   rast->jobs.num_jobs = num_jobs;
+   rast->jobs.next_job = 0;
+
+   if (rast->num_threads == 0) {
+      /* no threading */
+      unsigned fpstate = util_fpstate_get();
+
+      util_fpstate_set_denorms_to_zero(fpstate);
+
+      run_jobs(&rast->tasks[0]);
+
+      util_fpstate_set(fpstate);
+   }
+   else {
+      for (i = 0; i < rast->num_threads; i++) {
+         pipe_semaphore_signal(&rast->tasks[i].work_ready);
+      }
+
+      lp_rast_finish(rast);
+   }
+
+   rast->jobs.func = NULL;
+   rast->jobs.data = NULL;
+}
+
+
 /**
  * This is the thread's main entrypoint.
  * It's a simple loop:
@@ -808,6 +860,12 @@ thread_function(void *init_data)
       if (rast->exit_flag)
          break;
 
+      if (rast->jobs.func) {
+         run_jobs(task);
+         pipe_semaphore_signal(&task->work_done);
+         continue;
+      }
+
       if (task->thread_index == 0) {
          /* thread[0]:
           *  - get next scene to rasterize
@@ -170,6 +170,20 @@ void
 lp_rast_finish( struct lp_rasterizer *rast );
 
 
+/**
+ * Job run by lp_rast_run_jobs().  thread_index identifies the rasterizer
+ * thread running it, so that jobs can keep per-thread resources.
+ */
+typedef void (*lp_rast_job_func)(void *data, unsigned thread_index,
+                                 unsigned job);
+
+void
+lp_rast_run_jobs( struct lp_rasterizer *rast,
+                  unsigned num_jobs,
+                  lp_rast_job_func func,
+                  void *data );
+
+
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
    struct {
@@ -123,6 +123,16 @@ struct lp_rasterizer
    /** The scene currently being rasterized by the threads */
    struct lp_scene *curr_scene;
 
+   /** Jobs being run by the threads instead of a scene, see
+    * lp_rast_run_jobs()
+    */
+   struct {
+      lp_rast_job_func func;
+      void *data;
+      unsigned num_jobs;
+      int32_t next_job;
+   } jobs;
+
    /** A task object for each rasterization thread */
    struct lp_rasterizer_task tasks[LP_MAX_THREADS];
 
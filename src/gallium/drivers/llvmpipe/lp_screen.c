@@ -48,6 +48,7 @@
 #include "lp_public.h"
 #include "lp_limits.h"
 #include "lp_rast.h"
+#include "lp_state_cs.h"
 
 #include "state_tracker/sw_winsys.h"
 
@@ -212,7 +213,7 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_QUADS_FOLLOW_PROVOKING_VERTEX_CONVENTION:
       return 0;
    case PIPE_CAP_COMPUTE:
-      return 0;
+      return 1;
    case PIPE_CAP_USER_VERTEX_BUFFERS:
       return 1;
    case PIPE_CAP_USER_CONSTANT_BUFFERS:
@@ -360,6 +361,8 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_QUERY_SO_OVERFLOW:
    case PIPE_CAP_MEMOBJ:
       return 0;
+   case PIPE_CAP_SHAREABLE_CSOS:
+      return 1;
    }
    /* should only get here on unhandled cases */
    debug_printf("Unexpected PIPE_CAP %d query\n", param);
@@ -398,11 +401,137 @@ llvmpipe_get_shader_param(struct pipe_screen *screen,
       default:
          return draw_get_shader_param(shader, param);
       }
+   case PIPE_SHADER_COMPUTE:
+      switch (param) {
+      case PIPE_SHADER_CAP_MAX_SHADER_BUFFERS:
+         return PIPE_MAX_SHADER_BUFFERS;
+      default:
+         return gallivm_get_shader_param(param);
+      }
    default:
       return 0;
    }
 }
 
+static int
+llvmpipe_get_compute_param(struct pipe_screen *screen,
+                           enum pipe_shader_ir ir_type,
+                           enum pipe_compute_cap param,
+                           void *ret)
+{
+   struct llvmpipe_screen *lp_screen = llvmpipe_screen(screen);
+
+   switch (param) {
+   case PIPE_COMPUTE_CAP_IR_TARGET:
+      /* Only TGSI is supported, which doesn't need a target. */
+      return 0;
+   case PIPE_COMPUTE_CAP_GRID_DIMENSION:
+      if (ret) {
+         uint64_t *dim = (uint64_t *)ret;
+         dim[0] = 3;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_GRID_SIZE:
+      if (ret) {
+         uint64_t *grid_size = (uint64_t *)ret;
+         grid_size[0] = 65535;
+         grid_size[1] = 65535;
+         grid_size[2] = 65535;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_BLOCK_SIZE:
+      if (ret) {
+         uint64_t *block_size = (uint64_t *)ret;
+         block_size[0] = LP_MAX_THREADS_PER_BLOCK;
+         block_size[1] = LP_MAX_THREADS_PER_BLOCK;
+         block_size[2] = 64;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_THREADS_PER_BLOCK:
+      if (ret) {
+         uint64_t *max_threads = (uint64_t *)ret;
+         *max_threads = LP_MAX_THREADS_PER_BLOCK;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_LOCAL_SIZE:
+      if (ret) {
+         uint64_t *max_local = (uint64_t *)ret;
+         *max_local = LP_MAX_SHARED_MEM_SIZE;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_SUBGROUP_SIZE:
+      /* the invocations of a work group run in chunks of a native vector */
+      if (ret) {
+         uint32_t *subgroup_size = (uint32_t *)ret;
+         *subgroup_size = MIN2(lp_native_vector_width / 32, 16);
+      }
+      return sizeof(uint32_t);
+   case PIPE_COMPUTE_CAP_MAX_VARIABLE_THREADS_PER_BLOCK:
+      if (ret) {
+         uint64_t *max_variable = (uint64_t *)ret;
+         *max_variable = 0;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_ADDRESS_BITS:
+      if (ret) {
+         uint32_t *address_bits = (uint32_t *)ret;
+         *address_bits = sizeof(void *) * 8;
+      }
+      return sizeof(uint32_t);
+   case PIPE_COMPUTE_CAP_MAX_GLOBAL_SIZE:
+      if (ret) {
+         uint64_t *max_global = (uint64_t *)ret;
+         /* Same as PIPE_CAP_VIDEO_MEMORY. */
+         *max_global = (uint64_t)screen->get_param(screen,
+                                                   PIPE_CAP_VIDEO_MEMORY) << 20;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_MEM_ALLOC_SIZE:
+      if (ret) {
+         uint64_t *max_alloc = (uint64_t *)ret;
+         /* Buffer sizes are stored in pipe_resource::width0. */
+         *max_alloc = MIN2((uint64_t)screen->get_param(screen,
+                                                       PIPE_CAP_VIDEO_MEMORY) << 18,
+                           1u << 31);
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_PRIVATE_SIZE:
+      /* Temporaries live on the stack of the rasterizer threads. */
+      if (ret) {
+         uint64_t *max_private = (uint64_t *)ret;
+         *max_private = 64 * 1024;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_INPUT_SIZE:
+      if (ret) {
+         uint64_t *max_input = (uint64_t *)ret;
+         *max_input = LP_MAX_TGSI_CONST_BUFFER_SIZE;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_CLOCK_FREQUENCY:
+      /* There is no portable way to query it, report 1 GHz. */
+      if (ret) {
+         uint32_t *max_clock = (uint32_t *)ret;
+         *max_clock = 1000;
+      }
+      return sizeof(uint32_t);
+   case PIPE_COMPUTE_CAP_MAX_COMPUTE_UNITS:
+      /* Work groups run on the rasterizer threads. */
+      if (ret) {
+         uint32_t *max_compute_units = (uint32_t *)ret;
+         *max_compute_units = MAX2(lp_screen->num_threads, 1);
+      }
+      return sizeof(uint32_t);
+   case PIPE_COMPUTE_CAP_IMAGES_SUPPORTED:
+      if (ret) {
+         uint32_t *images_supported = (uint32_t *)ret;
+         *images_supported = 0;
+      }
+      return sizeof(uint32_t);
+   }
+   return 0;
+}
+
 static float
 llvmpipe_get_paramf(struct pipe_screen *screen, enum pipe_capf param)
 {
@@ -571,6 +700,7 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
    if (screen->rast)
       lp_rast_destroy(screen->rast);
 
+   lp_cs_screen_cleanup(screen);
    lp_jit_screen_cleanup(screen);
 
    if(winsys->destroy)
@@ -659,6 +789,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.get_param = llvmpipe_get_param;
    screen->base.get_shader_param = llvmpipe_get_shader_param;
    screen->base.get_paramf = llvmpipe_get_paramf;
+   screen->base.get_compute_param = llvmpipe_get_compute_param;
    screen->base.is_format_supported = llvmpipe_is_format_supported;
 
    screen->base.context_create = llvmpipe_create_context;
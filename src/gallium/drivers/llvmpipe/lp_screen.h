@@ -38,9 +38,22 @@
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
 #include "gallivm/lp_bld.h"
+#include "lp_limits.h"
 
 
 struct sw_winsys;
+struct util_coroutine_group;
+
+
+/**
+ * Resources of the compute jobs which are kept per rasterizer thread, and
+ * reused by all the dispatches.
+ */
+struct lp_cs_thread
+{
+   uint8_t *shared;
+   struct util_coroutine_group *coroutines;
+};
 
 
 struct llvmpipe_screen
@@ -57,6 +70,9 @@ struct llvmpipe_screen
 
    struct lp_rasterizer *rast;
    mtx_t rast_mutex;
+
+   /** Only used while holding rast_mutex, see lp_state_cs.c */
+   struct lp_cs_thread cs_threads[LP_MAX_THREADS];
 };
 
 
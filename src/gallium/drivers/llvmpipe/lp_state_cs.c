@@ -0,0 +1,910 @@
+/**************************************************************************
+ *
+ * Copyright 2017 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+
+/**
+ * Compute shaders.
+ *
+ * A compute shader variant runs one SIMD chunk of the invocations of a work
+ * group.  The work groups of a grid are spread over the rasterizer threads
+ * with lp_rast_run_jobs(), and each thread runs all the chunks of a work
+ * group in turn.  Work groups with barriers run their chunks as coroutines
+ * instead, so that every chunk reaches the barrier before any of them goes
+ * past it.
+ */
+
+#include "pipe/p_defines.h"
+#include "pipe/p_shader_tokens.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_pointer.h"
+#include "util/u_format.h"
+#include "util/u_string.h"
+#include "util/u_coroutine.h"
+#include "util/simple_list.h"
+#include "os/os_time.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
+#include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_intr.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_tgsi.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_struct.h"
+#include "gallivm/lp_bld_swizzle.h"
+#include "gallivm/lp_bld_debug.h"
+#include "state_tracker/sw_winsys.h"
+#include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_flush.h"
+#include "lp_limits.h"
+#include "lp_perf.h"
+#include "lp_query.h"
+#include "lp_rast.h"
+#include "lp_screen.h"
+#include "lp_state.h"
+#include "lp_state_cs.h"
+#include "lp_tex_sample.h"
+#include "lp_texture.h"
+
+
+/** Stack of each coroutine running a chunk of a work group with barriers */
+#define LP_CS_COROUTINE_STACK_SIZE (128 * 1024)
+
+
+static unsigned cs_no = 0;
+
+
+struct lp_cs_llvm_iface {
+   struct lp_build_tgsi_cs_iface base;
+
+   LLVMValueRef thread_data_ptr;
+};
+
+
+/**
+ * Called by the JIT code when a chunk of a work group reaches a barrier.
+ */
+static void
+lp_cs_barrier(void *coroutines)
+{
+   if (coroutines)
+      util_coroutine_group_barrier((struct util_coroutine_group *) coroutines);
+}
+
+
+static void
+lp_cs_llvm_emit_barrier(const struct lp_build_tgsi_cs_iface *cs_iface,
+                        struct lp_build_tgsi_context *bld_base)
+{
+   const struct lp_cs_llvm_iface *iface =
+      (const struct lp_cs_llvm_iface *) cs_iface;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef arg_type = LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   LLVMValueRef function;
+   LLVMValueRef coroutines;
+
+   function = lp_build_const_func_pointer(gallivm,
+                                          func_to_pointer((func_pointer)lp_cs_barrier),
+                                          LLVMVoidTypeInContext(gallivm->context),
+                                          &arg_type, 1, "lp_cs_barrier");
+
+   coroutines = lp_jit_cs_thread_data_coroutines(gallivm, iface->thread_data_ptr);
+
+   LLVMBuildCall(builder, function, &coroutines, 1, "");
+}
+
+
+/**
+ * Generate the compute shader function of a variant.
+ */
+static void
+generate_compute(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant *variant)
+{
+   struct gallivm_state *gallivm = variant->gallivm;
+   const struct lp_compute_shader_variant_key *key = &variant->key;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(gallivm->context);
+   char func_name[64];
+   struct lp_type cs_type;
+   struct lp_type int_type;
+   struct lp_build_context int_bld;
+   LLVMTypeRef arg_types[2];
+   LLVMTypeRef func_type;
+   LLVMValueRef function;
+   LLVMValueRef context_ptr;
+   LLVMValueRef thread_data_ptr;
+   LLVMValueRef consts_ptr, num_consts_ptr;
+   LLVMValueRef lanes[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef first_invocation;
+   LLVMValueRef flat_id;
+   LLVMValueRef block_id_ptr, grid_size_ptr;
+   LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
+   LLVMBasicBlockRef block;
+   struct lp_build_sampler_soa *sampler;
+   struct lp_bld_tgsi_system_values system_values;
+   struct lp_build_mask_context mask;
+   struct lp_cs_llvm_iface cs_iface;
+   const unsigned *block_size = shader->block_size;
+   unsigned group_size = block_size[0] * block_size[1] * block_size[2];
+   unsigned i;
+
+   memset(&cs_type, 0, sizeof cs_type);
+   cs_type.floating = TRUE;      /* floating point values */
+   cs_type.sign = TRUE;          /* values are signed */
+   cs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
+   cs_type.width = 32;           /* 32-bit float */
+   cs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
+
+   int_type = lp_int_type(cs_type);
+   int_type.sign = FALSE;
+   lp_build_context_init(&int_bld, gallivm, int_type);
+
+   /*
+    * Generate the function prototype. Any change here must be reflected in
+    * lp_jit.h's lp_jit_cs_func function pointer type, and vice-versa.
+    */
+
+   util_snprintf(func_name, sizeof(func_name), "cs%u_variant%u",
+                 shader->no, variant->no);
+
+   arg_types[0] = variant->jit_cs_context_ptr_type;    /* context */
+   arg_types[1] = variant->jit_cs_thread_data_ptr_type; /* thread_data */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(gallivm->context),
+                                arg_types, ARRAY_SIZE(arg_types), 0);
+
+   function = LLVMAddFunction(gallivm->module, func_name, func_type);
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+
+   variant->function = function;
+
+   for (i = 0; i < ARRAY_SIZE(arg_types); ++i)
+      if (LLVMGetTypeKind(arg_types[i]) == LLVMPointerTypeKind)
+         lp_add_function_attr(function, i + 1, LP_FUNC_ATTR_NOALIAS);
+
+   context_ptr = LLVMGetParam(function, 0);
+   thread_data_ptr = LLVMGetParam(function, 1);
+
+   lp_build_name(context_ptr, "context");
+   lp_build_name(thread_data_ptr, "thread_data");
+
+   block = LLVMAppendBasicBlockInContext(gallivm->context, function, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   /* flattened id of each lane within the work group */
+   for (i = 0; i < int_type.length; i++)
+      lanes[i] = LLVMConstInt(int32_type, i, 0);
+   first_invocation = lp_jit_cs_thread_data_first_invocation(gallivm,
+                                                             thread_data_ptr);
+   flat_id = LLVMBuildAdd(builder,
+                          lp_build_broadcast_scalar(&int_bld, first_invocation),
+                          LLVMConstVector(lanes, int_type.length), "flat_id");
+
+   memset(&system_values, 0, sizeof system_values);
+   system_values.thread_id[0] =
+      LLVMBuildURem(builder, flat_id,
+                    lp_build_const_int_vec(gallivm, int_type, block_size[0]), "");
+   system_values.thread_id[1] =
+      LLVMBuildURem(builder,
+                    LLVMBuildUDiv(builder, flat_id,
+                                  lp_build_const_int_vec(gallivm, int_type,
+                                                         block_size[0]), ""),
+                    lp_build_const_int_vec(gallivm, int_type, block_size[1]), "");
+   system_values.thread_id[2] =
+      LLVMBuildUDiv(builder, flat_id,
+                    lp_build_const_int_vec(gallivm, int_type,
+                                           block_size[0] * block_size[1]), "");
+
+   block_id_ptr = lp_jit_cs_thread_data_block_id(gallivm, thread_data_ptr);
+   grid_size_ptr = lp_jit_cs_thread_data_grid_size(gallivm, thread_data_ptr);
+   for (i = 0; i < 3; i++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, i);
+      system_values.block_id[i] = lp_build_array_get(gallivm, block_id_ptr, index);
+      system_values.grid_size[i] = lp_build_array_get(gallivm, grid_size_ptr, index);
+      system_values.block_size[i] = lp_build_const_int32(gallivm, block_size[i]);
+   }
+
+   /* the last chunk of the work group may be partial */
+   lp_build_mask_begin(&mask, gallivm, cs_type,
+                       lp_build_cmp(&int_bld, PIPE_FUNC_LESS, flat_id,
+                                    lp_build_const_int_vec(gallivm, int_type,
+                                                           group_size)));
+
+   consts_ptr = lp_jit_cs_context_constants(gallivm, context_ptr);
+   num_consts_ptr = lp_jit_cs_context_num_constants(gallivm, context_ptr);
+
+   cs_iface.base.ssbo_ptr = lp_jit_cs_context_ssbos(gallivm, context_ptr);
+   cs_iface.base.ssbo_sizes_ptr = lp_jit_cs_context_num_ssbos(gallivm, context_ptr);
+   cs_iface.base.shared_ptr = lp_jit_cs_thread_data_shared(gallivm, thread_data_ptr);
+   cs_iface.base.shared_size = lp_build_const_int32(gallivm,
+                                                    shader->base.req_local_mem);
+   cs_iface.base.emit_barrier = lp_cs_llvm_emit_barrier;
+   cs_iface.thread_data_ptr = thread_data_ptr;
+
+   /* code generated texture sampling */
+   sampler = lp_llvm_cs_sampler_soa_create(key->state);
+
+   memset(outputs, 0, sizeof outputs);
+
+   lp_build_tgsi_soa(gallivm, (const struct tgsi_token *) shader->base.prog,
+                     cs_type, &mask,
+                     consts_ptr, num_consts_ptr, &system_values,
+                     NULL, outputs, context_ptr, NULL,
+                     sampler, &shader->info.base, NULL,
+                     &cs_iface.base, NULL);
+
+   lp_build_mask_end(&mask);
+
+   sampler->destroy(sampler);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, function);
+}
+
+
+/**
+ * Generate a new compute shader variant from the shader code and
+ * other state indicated by the key.
+ */
+static struct lp_compute_shader_variant *
+generate_variant(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *shader,
+                 const struct lp_compute_shader_variant_key *key)
+{
+   struct lp_compute_shader_variant *variant;
+   char module_name[64];
+
+   variant = CALLOC_STRUCT(lp_compute_shader_variant);
+   if (!variant)
+      return NULL;
+
+   util_snprintf(module_name, sizeof(module_name), "cs%u_variant%u",
+                 shader->no, shader->variants_created);
+
+   variant->gallivm = gallivm_create(module_name, lp->context);
+   if (!variant->gallivm) {
+      FREE(variant);
+      return NULL;
+   }
+
+   variant->shader = shader;
+   variant->list_item_local.base = variant;
+   variant->no = shader->variants_created++;
+
+   memcpy(&variant->key, key, shader->variant_key_size);
+
+   lp_jit_init_cs_types(variant);
+
+   generate_compute(lp, shader, variant);
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+
+   variant->jit_function = (lp_jit_cs_func)
+         gallivm_jit_function(variant->gallivm, variant->function);
+
+   gallivm_free_ir(variant->gallivm);
+
+   return variant;
+}
+
+
+static void
+make_variant_key(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant_key *key)
+{
+   unsigned i;
+
+   memset(key, 0, shader->variant_key_size);
+
+   /* This value will be the same for all the variants of a given shader:
+    */
+   key->nr_samplers = shader->info.base.file_max[TGSI_FILE_SAMPLER] + 1;
+
+   for (i = 0; i < key->nr_samplers; ++i) {
+      if (shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
+         lp_sampler_static_sampler_state(&key->state[i].sampler_state,
+                                         lp->samplers[PIPE_SHADER_COMPUTE][i]);
+      }
+   }
+
+   /* See the fragment shader key for the dx10-style sampler view handling */
+   if (shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] != -1) {
+      key->nr_sampler_views = shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] + 1;
+      for (i = 0; i < key->nr_sampler_views; ++i) {
+         if (shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1 << i)) {
+            lp_sampler_static_texture_state(&key->state[i].texture_state,
+                                            lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+         }
+      }
+   }
+   else {
+      key->nr_sampler_views = key->nr_samplers;
+      for (i = 0; i < key->nr_sampler_views; ++i) {
+         if (shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
+            lp_sampler_static_texture_state(&key->state[i].texture_state,
+                                            lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+         }
+      }
+   }
+}
+
+
+static void
+remove_cs_variant(struct lp_compute_shader_variant *variant)
+{
+   gallivm_destroy(variant->gallivm);
+
+   remove_from_list(&variant->list_item_local);
+   variant->shader->variants_cached--;
+
+   FREE(variant);
+}
+
+
+/**
+ * Return the variant of the bound compute shader matching the current
+ * samplers and sampler views, generating it if needed.
+ */
+static struct lp_compute_shader_variant *
+llvmpipe_update_cs(struct llvmpipe_context *lp)
+{
+   struct lp_compute_shader *shader = lp->cs;
+   struct lp_compute_shader_variant_key key;
+   struct lp_compute_shader_variant *variant = NULL;
+   struct lp_cs_variant_list_item *li;
+   int64_t t0, t1, dt;
+
+   make_variant_key(lp, shader, &key);
+
+   /* Search the variants for one which matches the key */
+   li = first_elem(&shader->variants);
+   while (!at_end(&shader->variants, li)) {
+      if (memcmp(&li->base->key, &key, shader->variant_key_size) == 0) {
+         variant = li->base;
+         break;
+      }
+      li = next_elem(li);
+   }
+
+   if (variant) {
+      /* Move this variant to the head of the list to implement LRU
+       * deletion of shader's when we have too many.
+       */
+      move_to_head(&shader->variants, &variant->list_item_local);
+      return variant;
+   }
+
+   /* Grids are complete when launch_grid returns, so no variant can be in
+    * use here.
+    */
+   if (shader->variants_cached >= LP_MAX_SHADER_VARIANTS)
+      remove_cs_variant(last_elem(&shader->variants)->base);
+
+   t0 = os_time_get();
+   variant = generate_variant(lp, shader, &key);
+   t1 = os_time_get();
+   dt = t1 - t0;
+   LP_COUNT_ADD(llvm_compile_time, dt);
+   LP_COUNT_ADD(nr_llvm_compiles, 1);
+
+   if (variant) {
+      insert_at_head(&shader->variants, &variant->list_item_local);
+      shader->variants_cached++;
+   }
+
+   return variant;
+}
+
+
+static void *
+llvmpipe_create_compute_state(struct pipe_context *pipe,
+                              const struct pipe_compute_state *templ)
+{
+   struct lp_compute_shader *shader;
+   int nr_samplers;
+   int nr_sampler_views;
+
+   /* Only TGSI is supported */
+   if (templ->ir_type != PIPE_SHADER_IR_TGSI)
+      return NULL;
+
+   if (templ->req_local_mem > LP_MAX_SHARED_MEM_SIZE)
+      return NULL;
+
+   shader = CALLOC_STRUCT(lp_compute_shader);
+   if (!shader)
+      return NULL;
+
+   shader->no = cs_no++;
+   make_empty_list(&shader->variants);
+
+   shader->base = *templ;
+
+   /* we need to keep a local copy of the tokens */
+   shader->base.prog = tgsi_dup_tokens((const struct tgsi_token *) templ->prog);
+
+   /* get/save the summary info for this shader */
+   lp_build_tgsi_info((const struct tgsi_token *) shader->base.prog,
+                      &shader->info);
+
+   shader->block_size[0] =
+      shader->info.base.properties[TGSI_PROPERTY_CS_FIXED_BLOCK_WIDTH];
+   shader->block_size[1] =
+      shader->info.base.properties[TGSI_PROPERTY_CS_FIXED_BLOCK_HEIGHT];
+   shader->block_size[2] =
+      shader->info.base.properties[TGSI_PROPERTY_CS_FIXED_BLOCK_DEPTH];
+   shader->has_barrier =
+      shader->info.base.opcode_count[TGSI_OPCODE_BARRIER] > 0;
+
+   nr_samplers = shader->info.base.file_max[TGSI_FILE_SAMPLER] + 1;
+   nr_sampler_views = shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] + 1;
+
+   shader->variant_key_size = Offset(struct lp_compute_shader_variant_key,
+                                     state[MAX2(nr_samplers, nr_sampler_views)]);
+
+   if (LP_DEBUG & DEBUG_TGSI) {
+      debug_printf("llvmpipe: Create compute shader #%u %p:\n",
+                   shader->no, (void *) shader);
+      tgsi_dump((const struct tgsi_token *) shader->base.prog, 0);
+   }
+
+   return shader;
+}
+
+
+static void
+llvmpipe_bind_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+
+   llvmpipe->cs = (struct lp_compute_shader *) cs;
+}
+
+
+static void
+llvmpipe_delete_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct lp_compute_shader *shader = cs;
+   struct lp_cs_variant_list_item *li;
+
+   assert(cs != llvmpipe->cs);
+   (void) llvmpipe;
+
+   /* Delete all the variants */
+   li = first_elem(&shader->variants);
+   while (!at_end(&shader->variants, li)) {
+      struct lp_cs_variant_list_item *next = next_elem(li);
+      remove_cs_variant(li->base);
+      li = next;
+   }
+
+   assert(shader->variants_cached == 0);
+   FREE((void *) shader->base.prog);
+   FREE(shader);
+}
+
+
+static void
+llvmpipe_set_shader_buffers(struct pipe_context *pipe,
+                            enum pipe_shader_type shader,
+                            unsigned start_slot, unsigned count,
+                            const struct pipe_shader_buffer *buffers)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(shader < PIPE_SHADER_TYPES);
+   assert(start_slot + count <= ARRAY_SIZE(llvmpipe->ssbos[shader]));
+
+   for (i = 0; i < count; i++) {
+      struct pipe_shader_buffer *dst = &llvmpipe->ssbos[shader][start_slot + i];
+
+      if (buffers) {
+         pipe_resource_reference(&dst->buffer, buffers[i].buffer);
+         dst->buffer_offset = buffers[i].buffer_offset;
+         dst->buffer_size = buffers[i].buffer_size;
+      }
+      else {
+         pipe_resource_reference(&dst->buffer, NULL);
+         dst->buffer_offset = 0;
+         dst->buffer_size = 0;
+      }
+   }
+}
+
+
+/**
+ * Fill in the jit texture of a compute sampler view.
+ *
+ * Returns the mapped display target, if any, which must be unmapped once
+ * the grid is done.
+ */
+static struct sw_displaytarget *
+setup_cs_texture(struct lp_jit_texture *jit_tex,
+                 struct pipe_sampler_view *view)
+{
+   struct pipe_resource *res = view->texture;
+   struct llvmpipe_resource *lp_tex = llvmpipe_resource(res);
+   unsigned j;
+
+   if (lp_tex->dt) {
+      /* display target texture/surface */
+      struct llvmpipe_screen *screen = llvmpipe_screen(res->screen);
+      struct sw_winsys *winsys = screen->winsys;
+
+      jit_tex->base = winsys->displaytarget_map(winsys, lp_tex->dt,
+                                                PIPE_TRANSFER_READ);
+      jit_tex->row_stride[0] = lp_tex->row_stride[0];
+      jit_tex->img_stride[0] = lp_tex->img_stride[0];
+      jit_tex->mip_offsets[0] = 0;
+      jit_tex->width = res->width0;
+      jit_tex->height = res->height0;
+      jit_tex->depth = res->depth0;
+      jit_tex->first_level = jit_tex->last_level = 0;
+      assert(jit_tex->base);
+      return lp_tex->dt;
+   }
+
+   jit_tex->width = res->width0;
+   jit_tex->height = res->height0;
+   jit_tex->depth = res->depth0;
+
+   if (llvmpipe_resource_is_texture(res)) {
+      jit_tex->base = lp_tex->tex_data;
+      jit_tex->first_level = view->u.tex.first_level;
+      jit_tex->last_level = view->u.tex.last_level;
+      assert(jit_tex->first_level <= jit_tex->last_level);
+      assert(jit_tex->last_level <= res->last_level);
+
+      for (j = jit_tex->first_level; j <= jit_tex->last_level; j++) {
+         jit_tex->mip_offsets[j] = lp_tex->mip_offsets[j];
+         jit_tex->row_stride[j] = lp_tex->row_stride[j];
+         jit_tex->img_stride[j] = lp_tex->img_stride[j];
+      }
+
+      if (res->target == PIPE_TEXTURE_1D_ARRAY ||
+          res->target == PIPE_TEXTURE_2D_ARRAY ||
+          res->target == PIPE_TEXTURE_CUBE ||
+          res->target == PIPE_TEXTURE_CUBE_ARRAY) {
+         /* Same as for fragment shaders, see lp_setup_set_fragment_sampler_views */
+         jit_tex->depth = view->u.tex.last_layer - view->u.tex.first_layer + 1;
+         for (j = jit_tex->first_level; j <= jit_tex->last_level; j++) {
+            jit_tex->mip_offsets[j] += view->u.tex.first_layer *
+                                       lp_tex->img_stride[j];
+         }
+         assert(view->u.tex.first_layer <= view->u.tex.last_layer);
+         assert(view->u.tex.last_layer < res->array_size);
+      }
+   }
+   else {
+      /* buffers are specified in number of elements */
+      unsigned view_blocksize = util_format_get_blocksize(view->format);
+
+      jit_tex->base = (uint8_t *)lp_tex->data + view->u.buf.offset;
+      jit_tex->width = view->u.buf.size / view_blocksize;
+      jit_tex->first_level = jit_tex->last_level = 0;
+      jit_tex->mip_offsets[0] = 0;
+      jit_tex->row_stride[0] = 0;
+      jit_tex->img_stride[0] = 0;
+      assert(view->u.buf.offset + view->u.buf.size <= res->width0);
+   }
+
+   return NULL;
+}
+
+
+struct lp_cs_dispatch {
+   struct llvmpipe_screen *screen;
+   const struct lp_compute_shader *shader;
+   lp_jit_cs_func jit_function;
+   const struct lp_jit_cs_context *jit_context;
+   uint32_t grid_size[3];
+   unsigned num_chunks;
+   boolean use_coroutines;
+   boolean failed;
+};
+
+
+/** A work group running on the chunks' coroutines */
+struct lp_cs_group {
+   const struct lp_cs_dispatch *dispatch;
+   const struct lp_jit_cs_thread_data *thread_data;
+   unsigned chunk_size;
+};
+
+
+static void
+run_cs_chunk(void *data, unsigned index)
+{
+   const struct lp_cs_group *group = data;
+   struct lp_jit_cs_thread_data thread_data = *group->thread_data;
+
+   thread_data.first_invocation = index * group->chunk_size;
+   group->dispatch->jit_function(group->dispatch->jit_context, &thread_data);
+}
+
+
+/**
+ * lp_rast_job_func running one work group of the grid.
+ */
+static void
+run_cs_group(void *data, unsigned thread_index, unsigned job)
+{
+   struct lp_cs_dispatch *dispatch = data;
+   struct lp_cs_thread *thread = &dispatch->screen->cs_threads[thread_index];
+   struct lp_jit_cs_thread_data thread_data;
+   unsigned chunk_size = MIN2(lp_native_vector_width / 32, 16);
+   unsigned chunk;
+
+   thread_data.block_id[0] = job % dispatch->grid_size[0];
+   thread_data.block_id[1] = (job / dispatch->grid_size[0]) % dispatch->grid_size[1];
+   thread_data.block_id[2] = job / (dispatch->grid_size[0] * dispatch->grid_size[1]);
+   thread_data.grid_size[0] = dispatch->grid_size[0];
+   thread_data.grid_size[1] = dispatch->grid_size[1];
+   thread_data.grid_size[2] = dispatch->grid_size[2];
+   thread_data.first_invocation = 0;
+   thread_data.shared = thread->shared;
+   thread_data.coroutines = NULL;
+
+   if (dispatch->use_coroutines) {
+      struct lp_cs_group group;
+
+      group.dispatch = dispatch;
+      group.thread_data = &thread_data;
+      group.chunk_size = chunk_size;
+
+      /* The coroutines were allocated by reserve_cs_threads(), but the
+       * group can still fail to switch to them.
+       */
+      thread_data.coroutines = thread->coroutines;
+      if (!util_coroutine_group_run(thread->coroutines, dispatch->num_chunks,
+                                    run_cs_chunk, &group))
+         dispatch->failed = TRUE;
+      return;
+   }
+
+   for (chunk = 0; chunk < dispatch->num_chunks; chunk++) {
+      thread_data.first_invocation = chunk * chunk_size;
+      dispatch->jit_function(dispatch->jit_context, &thread_data);
+   }
+}
+
+
+/**
+ * Allocate the shared memory and coroutines the rasterizer threads need to
+ * run the dispatch, so that running it can't fail for lack of memory.
+ * Must be called with the screen's rast_mutex held.
+ */
+static boolean
+reserve_cs_threads(struct llvmpipe_screen *screen,
+                   const struct lp_cs_dispatch *dispatch)
+{
+   unsigned num_threads = MAX2(screen->num_threads, 1);
+   unsigned i;
+
+   for (i = 0; i < num_threads; i++) {
+      struct lp_cs_thread *thread = &screen->cs_threads[i];
+
+      if (dispatch->shader->base.req_local_mem && !thread->shared) {
+         thread->shared = align_malloc(LP_MAX_SHARED_MEM_SIZE, 64);
+         if (!thread->shared)
+            return FALSE;
+      }
+
+      if (dispatch->use_coroutines) {
+         if (!thread->coroutines)
+            thread->coroutines =
+               util_coroutine_group_create(LP_CS_COROUTINE_STACK_SIZE);
+
+         if (!thread->coroutines ||
+             !util_coroutine_group_reserve(thread->coroutines,
+                                           dispatch->num_chunks))
+            return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+static void
+llvmpipe_launch_grid(struct pipe_context *pipe,
+                     const struct pipe_grid_info *info)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   struct lp_compute_shader *shader = llvmpipe->cs;
+   struct lp_compute_shader_variant *variant;
+   struct lp_jit_cs_context jit_context;
+   struct sw_displaytarget *mapped_dt[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   struct lp_cs_dispatch dispatch;
+   unsigned group_size, num_groups;
+   unsigned i;
+
+   if (!shader)
+      return;
+
+   if (!llvmpipe_check_render_cond(llvmpipe))
+      return;
+
+   /* Buffers and textures the grid reads may still be written by binned
+    * draws, and the ones it writes may be read by them.
+    */
+   llvmpipe_flush(pipe, NULL, __FUNCTION__);
+
+   if (info->indirect) {
+      const uint32_t *indirect = (const uint32_t *)
+         ((const uint8_t *) llvmpipe_resource_data(info->indirect) +
+          info->indirect_offset);
+
+      dispatch.grid_size[0] = indirect[0];
+      dispatch.grid_size[1] = indirect[1];
+      dispatch.grid_size[2] = indirect[2];
+   }
+   else {
+      dispatch.grid_size[0] = info->grid[0];
+      dispatch.grid_size[1] = info->grid[1];
+      dispatch.grid_size[2] = info->grid[2];
+   }
+
+   num_groups = dispatch.grid_size[0] * dispatch.grid_size[1] *
+                dispatch.grid_size[2];
+   group_size = shader->block_size[0] * shader->block_size[1] *
+                shader->block_size[2];
+   if (!num_groups || !group_size)
+      return;
+
+   variant = llvmpipe_update_cs(llvmpipe);
+   if (!variant)
+      return;
+
+   memset(&jit_context, 0, sizeof jit_context);
+   memset(mapped_dt, 0, sizeof mapped_dt);
+
+   for (i = 0; i < LP_MAX_TGSI_CONST_BUFFERS; i++) {
+      const struct pipe_constant_buffer *cb =
+         &llvmpipe->constants[PIPE_SHADER_COMPUTE][i];
+      const ubyte *data;
+
+      if (cb->buffer)
+         data = (const ubyte *) llvmpipe_resource_data(cb->buffer);
+      else
+         data = cb->user_buffer;
+
+      if (data) {
+         jit_context.constants[i] = (const float *)(data + cb->buffer_offset);
+         jit_context.num_constants[i] = cb->buffer_size / (4 * sizeof(float));
+      }
+   }
+
+   for (i = 0; i < llvmpipe->num_sampler_views[PIPE_SHADER_COMPUTE]; i++) {
+      struct pipe_sampler_view *view =
+         llvmpipe->sampler_views[PIPE_SHADER_COMPUTE][i];
+
+      if (view)
+         mapped_dt[i] = setup_cs_texture(&jit_context.textures[i], view);
+   }
+
+   for (i = 0; i < llvmpipe->num_samplers[PIPE_SHADER_COMPUTE]; i++) {
+      const struct pipe_sampler_state *sampler =
+         llvmpipe->samplers[PIPE_SHADER_COMPUTE][i];
+      struct lp_jit_sampler *jit_sam = &jit_context.samplers[i];
+
+      if (sampler) {
+         jit_sam->min_lod = sampler->min_lod;
+         jit_sam->max_lod = sampler->max_lod;
+         jit_sam->lod_bias = sampler->lod_bias;
+         COPY_4V(jit_sam->border_color, sampler->border_color.f);
+      }
+   }
+
+   for (i = 0; i < PIPE_MAX_SHADER_BUFFERS; i++) {
+      const struct pipe_shader_buffer *sb =
+         &llvmpipe->ssbos[PIPE_SHADER_COMPUTE][i];
+
+      if (sb->buffer) {
+         jit_context.ssbos[i] =
+            (uint8_t *) llvmpipe_resource_data(sb->buffer) + sb->buffer_offset;
+         jit_context.num_ssbos[i] = sb->buffer_size;
+      }
+   }
+
+   dispatch.screen = screen;
+   dispatch.shader = shader;
+   dispatch.jit_function = variant->jit_function;
+   dispatch.jit_context = &jit_context;
+   dispatch.num_chunks = DIV_ROUND_UP(group_size,
+                                      MIN2(lp_native_vector_width / 32, 16));
+   /* Invocations of work groups with barriers run as coroutines, so that
+    * all of them reach the barrier before any of them goes past it.
+    */
+   dispatch.use_coroutines = shader->has_barrier && dispatch.num_chunks > 1;
+   dispatch.failed = FALSE;
+
+   mtx_lock(&screen->rast_mutex);
+   if (reserve_cs_threads(screen, &dispatch))
+      lp_rast_run_jobs(screen->rast, num_groups, run_cs_group, &dispatch);
+   else
+      dispatch.failed = TRUE;
+   mtx_unlock(&screen->rast_mutex);
+
+   if (dispatch.failed) {
+      debug_printf("llvmpipe: out of memory for a compute dispatch, "
+                   "skipping it\n");
+      pipe_debug_message(&llvmpipe->debug, OUT_OF_MEMORY,
+                         "llvmpipe: out of memory for a compute dispatch, "
+                         "skipping it");
+   }
+
+   for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+      if (mapped_dt[i])
+         screen->winsys->displaytarget_unmap(screen->winsys, mapped_dt[i]);
+   }
+}
+
+
+/**
+ * Free the per-thread shared memory and coroutines of the compute jobs.
+ */
+void
+lp_cs_screen_cleanup(struct llvmpipe_screen *screen)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(screen->cs_threads); i++) {
+      struct lp_cs_thread *thread = &screen->cs_threads[i];
+
+      if (thread->coroutines)
+         util_coroutine_group_destroy(thread->coroutines);
+      align_free(thread->shared);
+      thread->coroutines = NULL;
+      thread->shared = NULL;
+   }
+}
+
+
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe)
+{
+   llvmpipe->pipe.create_compute_state = llvmpipe_create_compute_state;
+   llvmpipe->pipe.bind_compute_state   = llvmpipe_bind_compute_state;
+   llvmpipe->pipe.delete_compute_state = llvmpipe_delete_compute_state;
+
+   llvmpipe->pipe.set_shader_buffers = llvmpipe_set_shader_buffers;
+   llvmpipe->pipe.launch_grid = llvmpipe_launch_grid;
+}
@@ -0,0 +1,413 @@
+/**************************************************************************
+ *
+ * Copyright 2017 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+
+/**
+ * @file
+ * Compute shader tests and benchmarks.
+ *
+ * Runs a work group reduction and a work group scan through launch_grid,
+ * checks the results, and reports the throughput in millions of elements
+ * per second.  Both kernels use shared memory and barriers.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "os/os_time.h"
+#include "state_tracker/sw_winsys.h"
+
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+#define BLOCK_SIZE 64
+
+
+struct compute_test_case
+{
+   const char *name;
+   const char *text;
+
+   /** Number of uint32_t results per work group */
+   unsigned results_per_group;
+
+   void (*reference)(const uint32_t *src, uint32_t *dst, unsigned num_groups);
+};
+
+
+static const char reduce_text[] =
+   "COMP\n"
+   "PROPERTY CS_FIXED_BLOCK_WIDTH 64\n"
+   "PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+   "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+   "DCL SV[0], THREAD_ID\n"
+   "DCL SV[1], BLOCK_ID\n"
+   "DCL BUFFER[0]\n"
+   "DCL BUFFER[1]\n"
+   "DCL MEMORY[0], SHARED\n"
+   "DCL TEMP[0..3]\n"
+   "IMM[0] UINT32 {64, 4, 1, 0}\n"
+   "IMM[1] UINT32 {32, 0, 0, 0}\n"
+   "  0: UMAD TEMP[0].x, SV[1].xxxx, IMM[0].xxxx, SV[0].xxxx\n"
+   "  1: UMUL TEMP[0].x, TEMP[0].xxxx, IMM[0].yyyy\n"
+   "  2: UMUL TEMP[2].x, SV[0].xxxx, IMM[0].yyyy\n"
+   "  3: LOAD TEMP[1].x, BUFFER[0], TEMP[0].xxxx\n"
+   "  4: STORE MEMORY[0].x, TEMP[2].xxxx, TEMP[1].xxxx\n"
+   "  5: MOV TEMP[3].x, IMM[1].xxxx\n"
+   "  6: BGNLOOP\n"
+   "  7:   BARRIER\n"
+   "  8:   USEQ TEMP[1].y, TEMP[3].xxxx, IMM[0].wwww\n"
+   "  9:   UIF TEMP[1].yyyy\n"
+   " 10:     BRK\n"
+   " 11:   ENDIF\n"
+   " 12:   USLT TEMP[1].y, SV[0].xxxx, TEMP[3].xxxx\n"
+   " 13:   UIF TEMP[1].yyyy\n"
+   " 14:     UADD TEMP[1].z, SV[0].xxxx, TEMP[3].xxxx\n"
+   " 15:     UMUL TEMP[1].z, TEMP[1].zzzz, IMM[0].yyyy\n"
+   " 16:     LOAD TEMP[1].w, MEMORY[0], TEMP[1].zzzz\n"
+   " 17:     LOAD TEMP[1].x, MEMORY[0], TEMP[2].xxxx\n"
+   " 18:     UADD TEMP[1].x, TEMP[1].xxxx, TEMP[1].wwww\n"
+   " 19:     STORE MEMORY[0].x, TEMP[2].xxxx, TEMP[1].xxxx\n"
+   " 20:   ENDIF\n"
+   " 21:   USHR TEMP[3].x, TEMP[3].xxxx, IMM[0].zzzz\n"
+   " 22: ENDLOOP\n"
+   " 23: USEQ TEMP[1].y, SV[0].xxxx, IMM[0].wwww\n"
+   " 24: UIF TEMP[1].yyyy\n"
+   " 25:   LOAD TEMP[1].x, MEMORY[0], IMM[0].wwww\n"
+   " 26:   UMUL TEMP[1].z, SV[1].xxxx, IMM[0].yyyy\n"
+   " 27:   STORE BUFFER[1].x, TEMP[1].zzzz, TEMP[1].xxxx\n"
+   " 28: ENDIF\n"
+   " 29: END\n";
+
+
+static const char scan_text[] =
+   "COMP\n"
+   "PROPERTY CS_FIXED_BLOCK_WIDTH 64\n"
+   "PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+   "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+   "DCL SV[0], THREAD_ID\n"
+   "DCL SV[1], BLOCK_ID\n"
+   "DCL BUFFER[0]\n"
+   "DCL BUFFER[1]\n"
+   "DCL MEMORY[0], SHARED\n"
+   "DCL TEMP[0..3]\n"
+   "IMM[0] UINT32 {64, 4, 1, 0}\n"
+   "  0: UMAD TEMP[0].x, SV[1].xxxx, IMM[0].xxxx, SV[0].xxxx\n"
+   "  1: UMUL TEMP[0].x, TEMP[0].xxxx, IMM[0].yyyy\n"
+   "  2: UMUL TEMP[2].x, SV[0].xxxx, IMM[0].yyyy\n"
+   "  3: LOAD TEMP[1].x, BUFFER[0], TEMP[0].xxxx\n"
+   "  4: STORE MEMORY[0].x, TEMP[2].xxxx, TEMP[1].xxxx\n"
+   "  5: MOV TEMP[3].x, IMM[0].zzzz\n"
+   "  6: BGNLOOP\n"
+   "  7:   USGE TEMP[1].y, TEMP[3].xxxx, IMM[0].xxxx\n"
+   "  8:   UIF TEMP[1].yyyy\n"
+   "  9:     BRK\n"
+   " 10:   ENDIF\n"
+   " 11:   BARRIER\n"
+   " 12:   MOV TEMP[1].w, IMM[0].wwww\n"
+   " 13:   USGE TEMP[1].y, SV[0].xxxx, TEMP[3].xxxx\n"
+   " 14:   UIF TEMP[1].yyyy\n"
+   " 15:     INEG TEMP[1].z, TEMP[3].xxxx\n"
+   " 16:     UADD TEMP[1].z, SV[0].xxxx, TEMP[1].zzzz\n"
+   " 17:     UMUL TEMP[1].z, TEMP[1].zzzz, IMM[0].yyyy\n"
+   " 18:     LOAD TEMP[1].w, MEMORY[0], TEMP[1].zzzz\n"
+   " 19:   ENDIF\n"
+   " 20:   BARRIER\n"
+   " 21:   LOAD TEMP[1].x, MEMORY[0], TEMP[2].xxxx\n"
+   " 22:   UADD TEMP[1].x, TEMP[1].xxxx, TEMP[1].wwww\n"
+   " 23:   STORE MEMORY[0].x, TEMP[2].xxxx, TEMP[1].xxxx\n"
+   " 24:   SHL TEMP[3].x, TEMP[3].xxxx, IMM[0].zzzz\n"
+   " 25: ENDLOOP\n"
+   " 26: LOAD TEMP[1].x, MEMORY[0], TEMP[2].xxxx\n"
+   " 27: STORE BUFFER[1].x, TEMP[0].xxxx, TEMP[1].xxxx\n"
+   " 28: END\n";
+
+
+static void
+reduce_reference(const uint32_t *src, uint32_t *dst, unsigned num_groups)
+{
+   unsigned i, j;
+
+   for (i = 0; i < num_groups; i++) {
+      dst[i] = 0;
+      for (j = 0; j < BLOCK_SIZE; j++)
+         dst[i] += src[i * BLOCK_SIZE + j];
+   }
+}
+
+
+static void
+scan_reference(const uint32_t *src, uint32_t *dst, unsigned num_groups)
+{
+   unsigned i, j;
+
+   for (i = 0; i < num_groups; i++) {
+      uint32_t sum = 0;
+      for (j = 0; j < BLOCK_SIZE; j++) {
+         sum += src[i * BLOCK_SIZE + j];
+         dst[i * BLOCK_SIZE + j] = sum;
+      }
+   }
+}
+
+
+static const struct compute_test_case
+test_cases[] = {
+   { "reduce", reduce_text, 1, reduce_reference },
+   { "scan", scan_text, BLOCK_SIZE, scan_reference },
+};
+
+
+/** Test grid sizes, in work groups */
+static const unsigned
+test_num_groups[] = { 1, 3, 256, 16384 };
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "kernel\t"
+           "groups\t"
+           "melems_per_sec\n");
+
+   fflush(fp);
+}
+
+
+static void
+write_tsv_row(FILE *fp,
+              const struct compute_test_case *test,
+              unsigned num_groups,
+              double melems_per_sec,
+              boolean success)
+{
+   fprintf(fp, "%s\t", success ? "pass" : "fail");
+
+   fprintf(fp, "%s\t%u\t%.1f\n", test->name, num_groups, melems_per_sec);
+
+   fflush(fp);
+}
+
+
+static struct pipe_resource *
+create_buffer(struct pipe_screen *screen, unsigned size)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_BUFFER;
+   templ.format = PIPE_FORMAT_R8_UNORM;
+   templ.bind = PIPE_BIND_SHADER_BUFFER;
+   templ.usage = PIPE_USAGE_DEFAULT;
+   templ.width0 = size;
+   templ.height0 = 1;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+
+   return screen->resource_create(screen, &templ);
+}
+
+
+static boolean
+test_one(struct pipe_context *pipe,
+         unsigned verbose,
+         FILE *fp,
+         const struct compute_test_case *test,
+         unsigned num_groups)
+{
+   struct pipe_screen *screen = pipe->screen;
+   const unsigned num_elems = num_groups * BLOCK_SIZE;
+   const unsigned num_results = num_groups * test->results_per_group;
+   const unsigned num_iterations = 16;
+   struct tgsi_token tokens[1024];
+   struct pipe_compute_state cs_templ;
+   struct pipe_shader_buffer sb[2];
+   struct pipe_grid_info info;
+   struct pipe_transfer *transfer;
+   uint32_t *src, *ref;
+   const uint32_t *res;
+   void *cs;
+   int64_t t0, t1;
+   double melems_per_sec;
+   boolean success = TRUE;
+   unsigned i;
+
+   if (!tgsi_text_translate(test->text, tokens, ARRAY_SIZE(tokens))) {
+      fprintf(stderr, "failed to translate %s kernel\n", test->name);
+      return FALSE;
+   }
+
+   memset(&cs_templ, 0, sizeof cs_templ);
+   cs_templ.ir_type = PIPE_SHADER_IR_TGSI;
+   cs_templ.prog = tokens;
+   cs_templ.req_local_mem = BLOCK_SIZE * sizeof(uint32_t);
+
+   cs = pipe->create_compute_state(pipe, &cs_templ);
+   if (!cs)
+      return FALSE;
+
+   src = MALLOC(num_elems * sizeof *src);
+   ref = MALLOC(num_results * sizeof *ref);
+   for (i = 0; i < num_elems; i++)
+      src[i] = rand() & 0xffff;
+   test->reference(src, ref, num_groups);
+
+   memset(sb, 0, sizeof sb);
+   sb[0].buffer = create_buffer(screen, num_elems * sizeof *src);
+   sb[0].buffer_size = num_elems * sizeof *src;
+   sb[1].buffer = create_buffer(screen, num_results * sizeof *ref);
+   sb[1].buffer_size = num_results * sizeof *ref;
+   pipe_buffer_write(pipe, sb[0].buffer, 0, sb[0].buffer_size, src);
+
+   pipe->bind_compute_state(pipe, cs);
+   pipe->set_shader_buffers(pipe, PIPE_SHADER_COMPUTE, 0, 2, sb);
+
+   memset(&info, 0, sizeof info);
+   info.work_dim = 1;
+   info.block[0] = BLOCK_SIZE;
+   info.block[1] = 1;
+   info.block[2] = 1;
+   info.grid[0] = num_groups;
+   info.grid[1] = 1;
+   info.grid[2] = 1;
+
+   /* The first launch compiles the shader */
+   pipe->launch_grid(pipe, &info);
+
+   res = pipe_buffer_map(pipe, sb[1].buffer, PIPE_TRANSFER_READ, &transfer);
+   for (i = 0; i < num_results; i++) {
+      if (res[i] != ref[i]) {
+         if (verbose || success)
+            fprintf(stderr, "%s, %u groups: result[%u] = %u, expected %u\n",
+                    test->name, num_groups, i, res[i], ref[i]);
+         success = FALSE;
+      }
+   }
+   pipe_buffer_unmap(pipe, transfer);
+
+   t0 = os_time_get();
+   for (i = 0; i < num_iterations; i++)
+      pipe->launch_grid(pipe, &info);
+   t1 = os_time_get();
+
+   melems_per_sec = (double)num_elems * num_iterations / MAX2(t1 - t0, 1);
+
+   if (verbose)
+      printf("%s\t%u groups\t%.1f Melems/s\t%s\n",
+             test->name, num_groups, melems_per_sec,
+             success ? "pass" : "fail");
+
+   if (fp)
+      write_tsv_row(fp, test, num_groups, melems_per_sec, success);
+
+   pipe->set_shader_buffers(pipe, PIPE_SHADER_COMPUTE, 0, 2, NULL);
+   pipe->bind_compute_state(pipe, NULL);
+   pipe->delete_compute_state(pipe, cs);
+   pipe_resource_reference(&sb[0].buffer, NULL);
+   pipe_resource_reference(&sb[1].buffer, NULL);
+   FREE(src);
+   FREE(ref);
+
+   return success;
+}
+
+
+static boolean
+test_grids(unsigned verbose, FILE *fp, unsigned max_groups)
+{
+   struct sw_winsys *winsys;
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   boolean success = TRUE;
+   unsigned i, j;
+
+   /* Only buffers are used, which don't need the winsys */
+   winsys = CALLOC_STRUCT(sw_winsys);
+   if (!winsys)
+      return FALSE;
+
+   screen = llvmpipe_create_screen(winsys);
+   if (!screen) {
+      FREE(winsys);
+      return FALSE;
+   }
+
+   pipe = screen->context_create(screen, NULL, 0);
+   if (!pipe) {
+      screen->destroy(screen);
+      FREE(winsys);
+      return FALSE;
+   }
+
+   for (i = 0; i < ARRAY_SIZE(test_cases); i++) {
+      for (j = 0; j < ARRAY_SIZE(test_num_groups); j++) {
+         if (test_num_groups[j] > max_groups)
+            continue;
+         if (!test_one(pipe, verbose, fp, &test_cases[i], test_num_groups[j]))
+            success = FALSE;
+      }
+   }
+
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+   FREE(winsys);
+
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   return test_grids(verbose, fp, ~0u);
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_grids(verbose, fp, MIN2(n, 256));
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_grids(verbose, fp, 1);
+}
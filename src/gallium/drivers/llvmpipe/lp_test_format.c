@@ -175,6 +175,11 @@ test_format_float(unsigned verbose, FILE *fp,
          /* To ensure it's 16-byte aligned */
          memcpy(packed, test->packed, sizeof packed);
 
+         /* The cache is keyed by address, and packed is reused */
+         if (cache_ptr) {
+            lp_build_format_cache_invalidate(cache_ptr);
+         }
+
          for (i = 0; i < desc->block.height; ++i) {
             for (j = 0; j < desc->block.width; ++j) {
                boolean match = TRUE;
@@ -274,6 +279,11 @@ test_format_unorm8(unsigned verbose, FILE *fp,
          /* Could skip this and use unaligned lp_build_fetch_rgba_aos */
          memcpy(packed, test->packed, sizeof packed);
 
+         /* The cache is keyed by address, and packed is reused */
+         if (cache_ptr) {
+            lp_build_format_cache_invalidate(cache_ptr);
+         }
+
          for (i = 0; i < desc->block.height; ++i) {
             for (j = 0; j < desc->block.width; ++j) {
                boolean match;
@@ -35,9 +35,9 @@
 struct lp_sampler_static_state;
 
 /**
- * Whether texture cache is used for s3tc textures.
+ * Whether the decoded block cache is used for block compressed textures.
  */
-#define LP_USE_TEXTURE_CACHE 0
+#define LP_USE_TEXTURE_CACHE 1
 
 /**
  * Pure-LLVM texture sampling code generator.
@@ -46,4 +46,7 @@ struct lp_sampler_static_state;
 struct lp_build_sampler_soa *
 lp_llvm_sampler_soa_create(const struct lp_sampler_static_state *key);
 
+struct lp_build_sampler_soa *
+lp_llvm_cs_sampler_soa_create(const struct lp_sampler_static_state *key);
+
 #endif /* LP_TEX_SAMPLE_H */
@@ -245,6 +245,7 @@ static int r300_get_param(struct pipe_screen* pscreen, enum pipe_cap param)
         case PIPE_CAP_NIR_SAMPLERS_AS_DEREF:
         case PIPE_CAP_QUERY_SO_OVERFLOW:
         case PIPE_CAP_MEMOBJ:
+        case PIPE_CAP_SHAREABLE_CSOS:
             return 0;
 
         /* SWTCL-only features. */
@@ -606,6 +606,7 @@ static int si_get_param(struct pipe_screen* pscreen, enum pipe_cap param)
 	case PIPE_CAP_UMA:
 	case PIPE_CAP_POLYGON_MODE_FILL_RECTANGLE:
 	case PIPE_CAP_POST_DEPTH_COVERAGE:
+	case PIPE_CAP_SHAREABLE_CSOS:
 		return 0;
 
 	case PIPE_CAP_QUERY_BUFFER_OBJECT:
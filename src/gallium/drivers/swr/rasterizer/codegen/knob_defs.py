@@ -165,14 +165,8 @@ KNOBS = [
     ['JIT_ENABLE_CACHE', {
         'type'      : 'bool',
         'default'   : 'false',
-        'desc'      : ['Enables caching of compiled shaders'],
-        'category'  : 'debug',
-    }],
-
-    ['JIT_CACHE_DIR', {
-        'type'      : 'std::string',
-        'default'   : r'%TEMP%\SWR\JitCache' if sys.platform == 'win32' else '${HOME}/.swr/jitcache',
-        'desc'      : ['Cache directory for compiled shaders.'],
+        'desc'      : ['Enables caching of compiled shaders in the Mesa shader',
+                       'disk cache (see MESA_GLSL_CACHE_DIR).'],
         'category'  : 'debug',
     }],
 
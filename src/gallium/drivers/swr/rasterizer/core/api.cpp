@@ -59,6 +59,25 @@ void WakeAllThreads(SWR_CONTEXT *pContext)
     pContext->FifosNotEmpty.notify_all();
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Threading knobs of a context, from the KNOBs unless overridden.
+/// @param pThreadInfo - optional override.
+static SWR_THREADING_INFO GetThreadingInfo(const SWR_THREADING_INFO* pThreadInfo)
+{
+    if (pThreadInfo)
+    {
+        return *pThreadInfo;
+    }
+
+    SWR_THREADING_INFO threadInfo;
+    threadInfo.MAX_WORKER_THREADS        = KNOB_MAX_WORKER_THREADS;
+    threadInfo.MAX_NUMA_NODES            = KNOB_MAX_NUMA_NODES;
+    threadInfo.MAX_CORES_PER_NUMA_NODE   = KNOB_MAX_CORES_PER_NUMA_NODE;
+    threadInfo.MAX_THREADS_PER_CORE      = KNOB_MAX_THREADS_PER_CORE;
+    threadInfo.SINGLE_THREADED           = KNOB_SINGLE_THREADED;
+    return threadInfo;
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Create SWR Context.
 /// @param pCreateInfo - pointer to creation info.
@@ -89,16 +108,7 @@ HANDLE SwrCreateContext(
         pContext->dsRing[dc].pArena = new CachingArena(pContext->cachingArenaAllocator);
     }
 
-    pContext->threadInfo.MAX_WORKER_THREADS        = KNOB_MAX_WORKER_THREADS;
-    pContext->threadInfo.MAX_NUMA_NODES            = KNOB_MAX_NUMA_NODES;
-    pContext->threadInfo.MAX_CORES_PER_NUMA_NODE   = KNOB_MAX_CORES_PER_NUMA_NODE;
-    pContext->threadInfo.MAX_THREADS_PER_CORE      = KNOB_MAX_THREADS_PER_CORE;
-    pContext->threadInfo.SINGLE_THREADED           = KNOB_SINGLE_THREADED;
-
-    if (pCreateInfo->pThreadInfo)
-    {
-        pContext->threadInfo = *pCreateInfo->pThreadInfo;
-    }
+    pContext->threadInfo = GetThreadingInfo(pCreateInfo->pThreadInfo);
 
     memset(&pContext->WaitLock, 0, sizeof(pContext->WaitLock));
     memset(&pContext->FifosNotEmpty, 0, sizeof(pContext->FifosNotEmpty));
@@ -1665,6 +1675,16 @@ void SwrInit()
     InitRasterizerFunctions();
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns the number of worker threads of contexts created with
+///        the given threading info.
+/// @param pThreadInfo - optional threading info overriding the KNOBs.
+uint32_t SwrGetNumWorkerThreads(
+    const SWR_THREADING_INFO* pThreadInfo)
+{
+    return GetNumWorkerThreads(GetThreadingInfo(pThreadInfo));
+}
+
 void SwrGetInterface(SWR_INTERFACE &out_funcs)
 {
     out_funcs.pfnSwrCreateContext = SwrCreateContext;
@@ -1715,4 +1735,5 @@ void SwrGetInterface(SWR_INTERFACE &out_funcs)
     out_funcs.pfnSwrLoadHotTile = SwrLoadHotTile;
     out_funcs.pfnSwrStoreHotTileToSurface = SwrStoreHotTileToSurface;
     out_funcs.pfnSwrStoreHotTileClear = SwrStoreHotTileClear;
+    out_funcs.pfnSwrGetNumWorkerThreads = SwrGetNumWorkerThreads;
 }
@@ -702,6 +702,13 @@ SWR_FUNC(void, SwrStoreHotTileClear,
          uint32_t renderTargetArrayIndex,
          const float* pClearColor);
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns the number of worker threads of contexts created with
+///        the given threading info.
+/// @param pThreadInfo - optional threading info overriding the KNOBs.
+SWR_FUNC(uint32_t, SwrGetNumWorkerThreads,
+         const SWR_THREADING_INFO* pThreadInfo);
+
 struct SWR_INTERFACE
 {
     PFNSwrCreateContext pfnSwrCreateContext;
@@ -752,6 +759,7 @@ struct SWR_INTERFACE
     PFNSwrLoadHotTile pfnSwrLoadHotTile;
     PFNSwrStoreHotTileToSurface pfnSwrStoreHotTileToSurface;
     PFNSwrStoreHotTileClear pfnSwrStoreHotTileClear;
+    PFNSwrGetNumWorkerThreads pfnSwrGetNumWorkerThreads;
 };
 
 extern "C" {
@@ -875,17 +875,20 @@ DWORD workerThreadInit(LPVOID pData)
 template<> DWORD workerThreadInit<false, false>(LPVOID pData) = delete;
 
 //////////////////////////////////////////////////////////////////////////
-/// @brief Creates thread pool info but doesn't launch threads.
-/// @param pContext - pointer to context
-/// @param pPool - pointer to thread pool object.
-void CreateThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
+/// @brief Calculates the number of worker threads and how they are spread
+///        over the HW threads.  Sets SINGLE_THREADED if there's only the
+///        API thread to run on.
+/// @param threadInfo - threading knobs, may be updated.
+/// @param nodes - processor topology.
+/// @return number of worker threads.
+static uint32_t CalculateNumThreads(
+    SWR_THREADING_INFO& threadInfo,
+    const CPUNumaNodes& nodes,
+    uint32_t& numNodes,
+    uint32_t& numCoresPerNode,
+    uint32_t& numHyperThreads,
+    uint32_t& numAPIReservedThreads)
 {
-    bindThread(pContext, 0);
-
-    CPUNumaNodes nodes;
-    uint32_t numThreadsPerProcGroup = 0;
-    CalculateProcessorTopology(nodes, numThreadsPerProcGroup);
-
     uint32_t numHWNodes         = (uint32_t)nodes.size();
     uint32_t numHWCoresPerNode  = (uint32_t)nodes[0].cores.size();
     uint32_t numHWHyperThreads  = (uint32_t)nodes[0].cores[0].threadIds.size();
@@ -901,27 +904,27 @@ void CreateThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
         }
     }
 
-    uint32_t numNodes           = numHWNodes;
-    uint32_t numCoresPerNode    = numHWCoresPerNode;
-    uint32_t numHyperThreads    = numHWHyperThreads;
+    numNodes            = numHWNodes;
+    numCoresPerNode     = numHWCoresPerNode;
+    numHyperThreads     = numHWHyperThreads;
 
-    if (pContext->threadInfo.MAX_NUMA_NODES)
+    if (threadInfo.MAX_NUMA_NODES)
     {
-        numNodes = std::min(numNodes, pContext->threadInfo.MAX_NUMA_NODES);
+        numNodes = std::min(numNodes, threadInfo.MAX_NUMA_NODES);
     }
 
-    if (pContext->threadInfo.MAX_CORES_PER_NUMA_NODE)
+    if (threadInfo.MAX_CORES_PER_NUMA_NODE)
     {
-        numCoresPerNode = std::min(numCoresPerNode, pContext->threadInfo.MAX_CORES_PER_NUMA_NODE);
+        numCoresPerNode = std::min(numCoresPerNode, threadInfo.MAX_CORES_PER_NUMA_NODE);
     }
 
-    if (pContext->threadInfo.MAX_THREADS_PER_CORE)
+    if (threadInfo.MAX_THREADS_PER_CORE)
     {
-        numHyperThreads = std::min(numHyperThreads, pContext->threadInfo.MAX_THREADS_PER_CORE);
+        numHyperThreads = std::min(numHyperThreads, threadInfo.MAX_THREADS_PER_CORE);
     }
 
 #if defined(_WIN32) && !defined(_WIN64)
-    if (!pContext->threadInfo.MAX_WORKER_THREADS)
+    if (!threadInfo.MAX_WORKER_THREADS)
     {
         // Limit 32-bit windows to bindable HW threads only
         if ((numCoresPerNode * numHWHyperThreads) > 32)
@@ -935,13 +938,13 @@ void CreateThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
     uint32_t numThreads = numNodes * numCoresPerNode * numHyperThreads;
     numThreads = std::min(numThreads, numHWThreads);
 
-    if (pContext->threadInfo.MAX_WORKER_THREADS)
+    if (threadInfo.MAX_WORKER_THREADS)
     {
         uint32_t maxHWThreads = numHWNodes * numHWCoresPerNode * numHWHyperThreads;
-        numThreads = std::min(pContext->threadInfo.MAX_WORKER_THREADS, maxHWThreads);
+        numThreads = std::min(threadInfo.MAX_WORKER_THREADS, maxHWThreads);
     }
 
-    uint32_t numAPIReservedThreads = 1;
+    numAPIReservedThreads = 1;
 
 
     if (numThreads == 1)
@@ -962,7 +965,7 @@ void CreateThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
         }
         else
         {
-            pContext->threadInfo.SINGLE_THREADED = true;
+            threadInfo.SINGLE_THREADED = true;
         }
     }
     else
@@ -978,11 +981,47 @@ void CreateThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
         }
     }
 
-    if (pContext->threadInfo.SINGLE_THREADED)
+    if (threadInfo.SINGLE_THREADED)
     {
         numThreads = 1;
     }
 
+    return numThreads;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns the number of worker threads a context created with the
+///        given threading knobs runs.
+/// @param threadInfo - threading knobs.
+uint32_t GetNumWorkerThreads(SWR_THREADING_INFO threadInfo)
+{
+    CPUNumaNodes nodes;
+    uint32_t numThreadsPerProcGroup = 0;
+    CalculateProcessorTopology(nodes, numThreadsPerProcGroup);
+
+    uint32_t numNodes, numCoresPerNode, numHyperThreads, numAPIReservedThreads;
+    return CalculateNumThreads(threadInfo, nodes, numNodes, numCoresPerNode,
+                               numHyperThreads, numAPIReservedThreads);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Creates thread pool info but doesn't launch threads.
+/// @param pContext - pointer to context
+/// @param pPool - pointer to thread pool object.
+void CreateThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool)
+{
+    bindThread(pContext, 0);
+
+    CPUNumaNodes nodes;
+    uint32_t numThreadsPerProcGroup = 0;
+    CalculateProcessorTopology(nodes, numThreadsPerProcGroup);
+
+    uint32_t numNodes, numCoresPerNode, numHyperThreads, numAPIReservedThreads;
+    uint32_t numThreads = CalculateNumThreads(pContext->threadInfo, nodes,
+                                              numNodes, numCoresPerNode,
+                                              numHyperThreads,
+                                              numAPIReservedThreads);
+
     // Initialize DRAW_CONTEXT's per-thread stats
     for (uint32_t dc = 0; dc < KNOB_MAX_DRAWS_IN_FLIGHT; ++dc)
     {
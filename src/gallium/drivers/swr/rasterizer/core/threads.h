@@ -59,6 +59,7 @@ struct THREAD_POOL
 
 typedef std::unordered_set<uint32_t> TileSet;
 
+uint32_t GetNumWorkerThreads(SWR_THREADING_INFO threadInfo);
 void CreateThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool);
 void StartThreadPool(SWR_CONTEXT* pContext, THREAD_POOL* pPool);
 void DestroyThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool);
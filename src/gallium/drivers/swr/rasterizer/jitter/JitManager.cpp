@@ -80,11 +80,6 @@
 #define JITTER_OUTPUT_DIR SWR_OUTPUT_DIR "\\Jitter"
 #endif // _WIN32
 
-#if defined(__APPLE) || defined(FORCE_LINUX) || defined(__linux__) || defined(__gnu_linux__)
-#include <pwd.h>
-#include <sys/stat.h>
-#endif
-
 
 using namespace llvm;
 using namespace SwrJit;
@@ -137,8 +132,11 @@ JitManager::JitManager(uint32_t simdWidth, const char *arch, const char* core)
 
     if (KNOB_JIT_ENABLE_CACHE)
     {
-        mCache.SetCpu(hostCPUName);
-        mpExec->setObjectCache(&mCache);
+        mCache.Init(hostCPUName, mCore);
+        if (mCache.IsEnabled())
+        {
+            mpExec->setObjectCache(&mCache);
+        }
     }
 
 #if LLVM_USE_INTEL_JITEVENTS
@@ -219,6 +217,23 @@ void JitManager::SetupNewModule()
     mIsModuleFinalized = false;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Create a stand-in for a function of the current module whose
+///        object was found by JitCache::SetModuleKey. MCJIT loads the cached
+///        object instead of compiling the stub, and the function address
+///        can then be looked up by name as usual.
+Function* JitManager::CreateCachedFunction(const std::string& name)
+{
+    FunctionType* pStubTy = FunctionType::get(Type::getVoidTy(mContext), false);
+    Function* pFunc = Function::Create(pStubTy, GlobalValue::ExternalLinkage, name, mpCurrentModule);
+    BasicBlock* pEntry = BasicBlock::Create(mContext, "entry", pFunc);
+
+    ReturnInst::Create(mContext, pEntry);
+    mpCurrentModule->setModuleIdentifier(name);
+
+    return pFunc;
+}
+
 
 //////////////////////////////////////////////////////////////////////////
 /// @brief Dump function x86 assembly to file.
@@ -330,69 +345,6 @@ extern "C"
 /// JitCache
 //////////////////////////////////////////////////////////////////////////
 
-//////////////////////////////////////////////////////////////////////////
-/// JitCacheFileHeader
-//////////////////////////////////////////////////////////////////////////
-struct JitCacheFileHeader
-{
-    void Init(uint32_t llCRC, uint32_t objCRC, const std::string& moduleID, const std::string& cpu, uint64_t bufferSize)
-    {
-        m_MagicNumber = JC_MAGIC_NUMBER;
-        m_BufferSize = bufferSize;
-        m_llCRC = llCRC;
-        m_platformKey = JC_PLATFORM_KEY;
-        m_objCRC = objCRC;
-        strncpy(m_ModuleID, moduleID.c_str(), JC_STR_MAX_LEN - 1);
-        m_ModuleID[JC_STR_MAX_LEN - 1] = 0;
-        strncpy(m_Cpu, cpu.c_str(), JC_STR_MAX_LEN - 1);
-        m_Cpu[JC_STR_MAX_LEN - 1] = 0;
-    }
-
-    bool IsValid(uint32_t llCRC, const std::string& moduleID, const std::string& cpu)
-    {
-        if ((m_MagicNumber != JC_MAGIC_NUMBER) ||
-            (m_llCRC != llCRC) ||
-            (m_platformKey != JC_PLATFORM_KEY))
-        {
-            return false;
-        }
-
-        m_ModuleID[JC_STR_MAX_LEN - 1] = 0;
-        if (strncmp(moduleID.c_str(), m_ModuleID, JC_STR_MAX_LEN - 1))
-        {
-            return false;
-        }
-
-        m_Cpu[JC_STR_MAX_LEN - 1] = 0;
-        if (strncmp(cpu.c_str(), m_Cpu, JC_STR_MAX_LEN - 1))
-        {
-            return false;
-        }
-
-        return true;
-    }
-
-    uint64_t GetBufferSize() const { return m_BufferSize; }
-    uint64_t GetBufferCRC() const { return m_objCRC; }
-
-private:
-    static const uint64_t   JC_MAGIC_NUMBER = 0xfedcba9876543211ULL;
-    static const size_t     JC_STR_MAX_LEN = 32;
-    static const uint32_t   JC_PLATFORM_KEY =
-        (LLVM_VERSION_MAJOR << 24)  |
-        (LLVM_VERSION_MINOR << 16)  |
-        (LLVM_VERSION_PATCH << 8)   |
-        ((sizeof(void*) > sizeof(uint32_t)) ? 1 : 0);
-
-    uint64_t m_MagicNumber;
-    uint64_t m_BufferSize;
-    uint32_t m_llCRC;
-    uint32_t m_platformKey;
-    uint32_t m_objCRC;
-    char m_ModuleID[JC_STR_MAX_LEN];
-    char m_Cpu[JC_STR_MAX_LEN];
-};
-
 static inline uint32_t ComputeModuleCRC(const llvm::Module* M)
 {
     std::string bitcodeBuffer;
@@ -408,111 +360,102 @@ static inline uint32_t ComputeModuleCRC(const llvm::Module* M)
 
 /// constructor
 JitCache::JitCache()
+    : mpDiskCache(nullptr), mHasModuleKey(false)
 {
-#if defined(__APPLE) || defined(FORCE_LINUX) || defined(__linux__) || defined(__gnu_linux__)
-    if (strncmp(KNOB_JIT_CACHE_DIR.c_str(), "~/", 2) == 0) {
-        char *homedir;
-        if (!(homedir = getenv("HOME"))) {
-            homedir = getpwuid(getuid())->pw_dir;
-        }
-        mCacheDir = homedir;
-        mCacheDir += (KNOB_JIT_CACHE_DIR.c_str() + 1);
-    } else
-#endif
-    {
-        mCacheDir = KNOB_JIT_CACHE_DIR;
-    }
 }
 
-/// notifyObjectCompiled - Provides a pointer to compiled code for Module M.
-void JitCache::notifyObjectCompiled(const llvm::Module *M, llvm::MemoryBufferRef Obj)
+JitCache::~JitCache()
 {
-    const std::string& moduleID = M->getModuleIdentifier();
-    if (!moduleID.length())
-    {
-        return;
-    }
+    disk_cache_destroy(mpDiskCache);
+}
+
+void JitCache::Init(const llvm::StringRef& cpu, const std::string& core)
+{
+    uint32_t timestamp;
 
-    if (!llvm::sys::fs::exists(mCacheDir.str()) &&
-        llvm::sys::fs::create_directories(mCacheDir.str()))
+    // The build-id of the driver, LLVM version, pointer size, target core
+    // and cpu name are part of the keys of the disk cache.
+    if (!disk_cache_get_function_timestamp((void*)JitCreateContext, &timestamp))
     {
-        SWR_INVALID("Unable to create directory: %s", mCacheDir.c_str());
         return;
     }
 
-    llvm::SmallString<MAX_PATH> filePath = mCacheDir;
-    llvm::sys::path::append(filePath, moduleID);
+    std::stringstream id;
+    id << timestamp << "-llvm" << LLVM_VERSION_MAJOR << "." << LLVM_VERSION_MINOR;
 
-    std::error_code err;
-    llvm::raw_fd_ostream fileObj(filePath.c_str(), err, llvm::sys::fs::F_None);
+    std::string gpuName = "swr_" + core + "_" + cpu.str();
+    mpDiskCache = disk_cache_create(gpuName.c_str(), id.str().c_str(), 0);
+}
 
-    uint32_t objcrc = ComputeCRC(0, Obj.getBufferStart(), Obj.getBufferSize());
+void JitCache::ComputeKey(const char* pName, const void* pState, size_t stateSize, cache_key key)
+{
+    std::string keyData(pName);
+    keyData.append(1, '\0');
+    keyData.append((const char*)pState, stateSize);
 
-    JitCacheFileHeader header;
-    header.Init(mCurrentModuleCRC, objcrc, moduleID, mCpu, Obj.getBufferSize());
+    disk_cache_compute_key(mpDiskCache, keyData.data(), keyData.size(), key);
+}
 
-    fileObj.write((const char*)&header, sizeof(header));
-    fileObj << Obj.getBuffer();
-    fileObj.flush();
+void* JitCache::LoadObject(const cache_key key, size_t* pSize)
+{
+    return disk_cache_get(mpDiskCache, key, pSize);
 }
 
-/// Returns a pointer to a newly allocated MemoryBuffer that contains the
-/// object which corresponds with Module M, or 0 if an object is not
-/// available.
-std::unique_ptr<llvm::MemoryBuffer> JitCache::getObject(const llvm::Module* M)
+void JitCache::StoreObject(const cache_key key, const void* pData, size_t size)
 {
-    const std::string& moduleID = M->getModuleIdentifier();
-    mCurrentModuleCRC = ComputeModuleCRC(M);
+    disk_cache_put(mpDiskCache, key, pData, size);
+}
 
-    if (!moduleID.length())
+bool JitCache::SetModuleKey(const cache_key key)
+{
+    memcpy(mCurrentModuleKey, key, sizeof(cache_key));
+    mHasModuleKey = true;
+    mpModuleObject = nullptr;
+
+    size_t size;
+    void* pData = LoadObject(key, &size);
+    if (!pData)
     {
-        return nullptr;
+        return false;
     }
 
-    if (!llvm::sys::fs::exists(mCacheDir))
+    mpModuleObject = llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef((const char*)pData, size));
+    free(pData);
+
+    return true;
+}
+
+/// notifyObjectCompiled - Provides a pointer to compiled code for Module M.
+void JitCache::notifyObjectCompiled(const llvm::Module *M, llvm::MemoryBufferRef Obj)
+{
+    StoreObject(mCurrentModuleKey, Obj.getBufferStart(), Obj.getBufferSize());
+}
+
+/// Returns a pointer to a newly allocated MemoryBuffer that contains the
+/// object which corresponds with Module M, or 0 if an object is not
+/// available.
+std::unique_ptr<llvm::MemoryBuffer> JitCache::getObject(const llvm::Module* M)
+{
+    if (mHasModuleKey)
     {
-        return nullptr;
+        mHasModuleKey = false;
+        return std::move(mpModuleObject);
     }
 
-    llvm::SmallString<MAX_PATH> filePath = mCacheDir;
-    llvm::sys::path::append(filePath, moduleID);
+    const std::string& moduleID = M->getModuleIdentifier();
+    uint32_t moduleCRC = ComputeModuleCRC(M);
+    ComputeKey(moduleID.c_str(), &moduleCRC, sizeof(moduleCRC), mCurrentModuleKey);
 
-    FILE* fpIn = fopen(filePath.c_str(), "rb");
-    if (!fpIn)
+    size_t size;
+    void* pData = LoadObject(mCurrentModuleKey, &size);
+    if (!pData)
     {
         return nullptr;
     }
 
-    std::unique_ptr<llvm::MemoryBuffer> pBuf = nullptr;
-    do
-    {
-        JitCacheFileHeader header;
-        if (!fread(&header, sizeof(header), 1, fpIn))
-        {
-            break;
-        }
-
-        if (!header.IsValid(mCurrentModuleCRC, moduleID, mCpu))
-        {
-            break;
-        }
-
-        pBuf = llvm::MemoryBuffer::getNewUninitMemBuffer(size_t(header.GetBufferSize()));
-        if (!fread(const_cast<char*>(pBuf->getBufferStart()), header.GetBufferSize(), 1, fpIn))
-        {
-            pBuf = nullptr;
-            break;
-        }
-
-        if (header.GetBufferCRC() != ComputeCRC(0, pBuf->getBufferStart(), pBuf->getBufferSize()))
-        {
-            SWR_TRACE("Invalid object cache file, ignoring: %s", filePath.c_str());
-            pBuf = nullptr;
-            break;
-        }
-    } while (0);
-
-    fclose(fpIn);
+    std::unique_ptr<llvm::MemoryBuffer> pBuf =
+        llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef((const char*)pData, size));
+    free(pData);
 
     return pBuf;
 }
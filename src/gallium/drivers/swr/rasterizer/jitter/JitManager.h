@@ -78,6 +78,7 @@ using PassManager = llvm::legacy::PassManager;
 
 #include "common/os.h"
 #include "common/isa.hpp"
+#include "util/disk_cache.h"
 
 #include <mutex>
 
@@ -138,15 +139,37 @@ struct JitLLVMContext : llvm::LLVMContext
 
 //////////////////////////////////////////////////////////////////////////
 /// JitCache
+/// Object cache of the jitter, kept in the Mesa disk cache.
+///
+/// Objects are looked up by a key computed from the compile state of a
+/// shader, so that a hit needs neither IR construction nor codegen. Modules
+/// compiled without a key are looked up by a hash of their bitcode.
 //////////////////////////////////////////////////////////////////////////
 class JitCache : public llvm::ObjectCache
 {
 public:
     /// constructor
     JitCache();
-    virtual ~JitCache() {}
+    virtual ~JitCache();
 
-    void SetCpu(const llvm::StringRef& cpu) { mCpu = cpu.str(); }
+    /// Creates the disk cache for objects compiled for @p core on @p cpu.
+    void Init(const llvm::StringRef& cpu, const std::string& core);
+
+    bool IsEnabled() const { return mpDiskCache != nullptr; }
+
+    /// Computes the key of the object compiled from a compile state.
+    void ComputeKey(const char* pName, const void* pState, size_t stateSize, cache_key key);
+
+    /// Returns the malloc'ed object stored under @p key, or nullptr.
+    void* LoadObject(const cache_key key, size_t* pSize);
+
+    /// Stores an object under @p key.
+    void StoreObject(const cache_key key, const void* pData, size_t size);
+
+    /// Sets the key of the next module compiled by the JitManager.
+    /// Returns true if its object is cached, in which case the module only
+    /// needs stubs of its functions (see JitManager::CreateCachedFunction).
+    bool SetModuleKey(const cache_key key);
 
     /// notifyObjectCompiled - Provides a pointer to compiled code for Module M.
     virtual void notifyObjectCompiled(const llvm::Module *M, llvm::MemoryBufferRef Obj);
@@ -157,9 +180,10 @@ public:
     virtual std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* M);
 
 private:
-    std::string mCpu;
-    llvm::SmallString<MAX_PATH> mCacheDir;
-    uint32_t mCurrentModuleCRC;
+    struct disk_cache* mpDiskCache;
+    cache_key mCurrentModuleKey;
+    bool mHasModuleKey;
+    std::unique_ptr<llvm::MemoryBuffer> mpModuleObject;
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -209,6 +233,7 @@ struct JitManager
     std::string mCore;
 
     void SetupNewModule();
+    llvm::Function* CreateCachedFunction(const std::string& name);
 
     void DumpAsm(llvm::Function* pFunction, const char* fileName);
     static void DumpToFile(llvm::Function *f, const char *fileName);
@@ -103,12 +103,21 @@ struct FetchJit : public Builder
     Value* mpFetchInfo;
 };
 
-Function* FetchJit::Create(const FETCH_COMPILE_STATE& fetchState)
+//////////////////////////////////////////////////////////////////////////
+/// @brief Name of the fetch shader built from a fetch state
+static std::string FetchShaderName(const FETCH_COMPILE_STATE& fetchState)
 {
     std::stringstream fnName("FetchShader_", std::ios_base::in | std::ios_base::out | std::ios_base::ate);
     fnName << ComputeCRC(0, &fetchState, sizeof(fetchState));
 
-    Function*    fetch = Function::Create(JM()->mFetchShaderTy, GlobalValue::ExternalLinkage, fnName.str(), JM()->mpCurrentModule);
+    return fnName.str();
+}
+
+Function* FetchJit::Create(const FETCH_COMPILE_STATE& fetchState)
+{
+    std::string fnName = FetchShaderName(fetchState);
+
+    Function*    fetch = Function::Create(JM()->mFetchShaderTy, GlobalValue::ExternalLinkage, fnName, JM()->mpCurrentModule);
     BasicBlock*    entry = BasicBlock::Create(JM()->mContext, "entry", fetch);
 
     fetch->getParent()->setModuleIdentifier(fetch->getName());
@@ -1973,6 +1982,19 @@ extern "C" PFN_FETCH_FUNC JITCALL JitCompileFetch(HANDLE hJitMgr, const FETCH_CO
 
     pJitMgr->SetupNewModule();
 
+    // The fetch shader only depends on its state, so its cached object can
+    // be found without building the IR.
+    if (pJitMgr->mCache.IsEnabled())
+    {
+        cache_key key;
+        pJitMgr->mCache.ComputeKey("FetchShader", &state, sizeof(state), key);
+        if (pJitMgr->mCache.SetModuleKey(key))
+        {
+            HANDLE hFunc = pJitMgr->CreateCachedFunction(FetchShaderName(state));
+            return JitFetchFunc(hJitMgr, hFunc);
+        }
+    }
+
     FetchJit theJit(pJitMgr);
     HANDLE hFunc = theJit.Create(state);
 
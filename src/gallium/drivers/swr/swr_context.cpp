@@ -319,6 +319,8 @@ swr_blit(struct pipe_context *pipe, const struct pipe_blit_info *blit_info)
    util_blitter_save_vertex_elements(ctx->blitter, (void *)ctx->velems);
    util_blitter_save_vertex_shader(ctx->blitter, (void *)ctx->vs);
    util_blitter_save_geometry_shader(ctx->blitter, (void*)ctx->gs);
+   util_blitter_save_tessctrl_shader(ctx->blitter, (void*)ctx->tcs);
+   util_blitter_save_tesseval_shader(ctx->blitter, (void*)ctx->tes);
    util_blitter_save_so_targets(
       ctx->blitter,
       ctx->num_so_targets,
@@ -378,6 +380,20 @@ swr_destroy(struct pipe_context *pipe)
       pipe_sampler_view_reference(&ctx->sampler_views[PIPE_SHADER_VERTEX][i], NULL);
    }
 
+   for (unsigned i = 0; i < ARRAY_SIZE(ctx->sampler_views[0]); i++) {
+      pipe_sampler_view_reference(&ctx->sampler_views[PIPE_SHADER_COMPUTE][i], NULL);
+   }
+
+   for (unsigned i = 0; i < ARRAY_SIZE(ctx->sampler_views[0]); i++) {
+      pipe_sampler_view_reference(&ctx->sampler_views[PIPE_SHADER_TESS_CTRL][i], NULL);
+      pipe_sampler_view_reference(&ctx->sampler_views[PIPE_SHADER_TESS_EVAL][i], NULL);
+   }
+
+   for (unsigned j = 0; j < PIPE_SHADER_TYPES; j++) {
+      for (unsigned i = 0; i < PIPE_MAX_SHADER_BUFFERS; i++)
+         pipe_resource_reference(&ctx->ssbos[j][i].buffer, NULL);
+   }
+
    if (ctx->pipe.stream_uploader)
       u_upload_destroy(ctx->pipe.stream_uploader);
 
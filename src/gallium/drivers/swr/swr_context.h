@@ -52,6 +52,10 @@
 #define SWR_NEW_CLIP (1 << 16)
 #define SWR_NEW_SO (1 << 17)
 #define SWR_LARGE_CLIENT_DRAW (1<<18) // Indicates client draw will block
+#define SWR_NEW_TCS (1 << 19)
+#define SWR_NEW_TES (1 << 20)
+#define SWR_NEW_TCSCONSTANTS (1 << 21)
+#define SWR_NEW_TESCONSTANTS (1 << 22)
 
 namespace std
 {
@@ -63,6 +67,16 @@ template <> struct hash<BLEND_COMPILE_STATE> {
 };
 };
 
+struct swr_cs_dispatch;
+struct swr_cs_context;
+
+typedef void(__cdecl *PFN_SWR_CS_BARRIER)(swr_cs_context *pCsCtx);
+
+struct swr_tcs_dispatch;
+struct swr_tcs_context;
+
+typedef void(__cdecl *PFN_SWR_TCS_BARRIER)(swr_tcs_context *pTcsCtx);
+
 struct swr_jit_texture {
    uint32_t width; // same as number of elements
    uint32_t height;
@@ -89,6 +103,12 @@ struct swr_draw_context {
    uint32_t num_constantsFS[PIPE_MAX_CONSTANT_BUFFERS];
    const float *constantGS[PIPE_MAX_CONSTANT_BUFFERS];
    uint32_t num_constantsGS[PIPE_MAX_CONSTANT_BUFFERS];
+   const float *constantCS[PIPE_MAX_CONSTANT_BUFFERS];
+   uint32_t num_constantsCS[PIPE_MAX_CONSTANT_BUFFERS];
+   const float *constantTCS[PIPE_MAX_CONSTANT_BUFFERS];
+   uint32_t num_constantsTCS[PIPE_MAX_CONSTANT_BUFFERS];
+   const float *constantTES[PIPE_MAX_CONSTANT_BUFFERS];
+   uint32_t num_constantsTES[PIPE_MAX_CONSTANT_BUFFERS];
 
    swr_jit_texture texturesVS[PIPE_MAX_SHADER_SAMPLER_VIEWS];
    swr_jit_sampler samplersVS[PIPE_MAX_SAMPLERS];
@@ -96,16 +116,47 @@ struct swr_draw_context {
    swr_jit_sampler samplersFS[PIPE_MAX_SAMPLERS];
    swr_jit_texture texturesGS[PIPE_MAX_SHADER_SAMPLER_VIEWS];
    swr_jit_sampler samplersGS[PIPE_MAX_SAMPLERS];
+   swr_jit_texture texturesCS[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   swr_jit_sampler samplersCS[PIPE_MAX_SAMPLERS];
+   swr_jit_texture texturesTCS[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   swr_jit_sampler samplersTCS[PIPE_MAX_SAMPLERS];
+   swr_jit_texture texturesTES[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   swr_jit_sampler samplersTES[PIPE_MAX_SAMPLERS];
+
+   uint8_t *ssboCS[PIPE_MAX_SHADER_BUFFERS];
+   uint32_t ssbo_sizesCS[PIPE_MAX_SHADER_BUFFERS];
 
    float userClipPlanes[PIPE_MAX_CLIP_PLANES][4];
 
+   uint32_t tesVerticesIn; // control points of the patches read by the TES
+
    uint32_t polyStipple[32];
 
    SWR_SURFACE_STATE renderTargets[SWR_NUM_ATTACHMENTS];
+   swr_cs_dispatch *pCsDispatch; // @llvm_struct - current compute dispatch
+   swr_tcs_dispatch *pTcsDispatch; // @llvm_struct - current draw's hull stage
    struct swr_query_result *pStats; // @llvm_struct
    SWR_INTERFACE *pAPI; // @llvm_struct - Needed for the swr_memory callbacks
 };
 
+/* Per SIMD chunk of a compute work group, see swr_cs_run_group() */
+struct swr_cs_context {
+   uint32_t block_id[3];
+   uint32_t grid_size[3];
+   uint32_t first_invocation; // flattened id of the first SIMD lane
+   uint8_t *pSharedMem;
+   void *pCoroutines;
+   PFN_SWR_CS_BARRIER pfnBarrier; // @llvm_pfn
+};
+
+/* Per output control point of the patches, see swr_tcs_run() */
+struct swr_tcs_context {
+   uint32_t invocation_id;
+   uint32_t vertices_in;
+   void *pCoroutines;
+   PFN_SWR_TCS_BARRIER pfnBarrier; // @llvm_pfn
+};
+
 /* gen_llvm_types FINI */
 
 struct swr_context {
@@ -122,6 +173,9 @@ struct swr_context {
    struct swr_vertex_shader *vs;
    struct swr_fragment_shader *fs;
    struct swr_geometry_shader *gs;
+   struct swr_tess_ctrl_shader *tcs;
+   struct swr_tess_eval_shader *tes;
+   struct swr_compute_shader *cs;
    struct swr_vertex_element_state *velems;
 
    /** Other rendering state */
@@ -130,6 +184,8 @@ struct swr_context {
    struct pipe_clip_state clip;
    struct pipe_constant_buffer
       constants[PIPE_SHADER_TYPES][PIPE_MAX_CONSTANT_BUFFERS];
+   struct pipe_shader_buffer
+      ssbos[PIPE_SHADER_TYPES][PIPE_MAX_SHADER_BUFFERS];
    struct pipe_framebuffer_state framebuffer;
    struct swr_poly_stipple poly_stipple;
    struct pipe_scissor_state scissor;
@@ -140,6 +196,10 @@ struct swr_context {
    struct pipe_viewport_state viewport;
    struct pipe_vertex_buffer vertex_buffer[PIPE_MAX_ATTRIBS];
 
+   /* Tessellation levels used when no control shader is bound */
+   float default_tess_outer[4];
+   float default_tess_inner[2];
+
    struct blitter_context *blitter;
 
    /** Conditional query object and mode */
@@ -181,6 +241,24 @@ swr_context(struct pipe_context *pipe)
    return (struct swr_context *)pipe;
 }
 
+/* Shader feeding the geometry shader, or the rasterizer if there's none */
+static INLINE struct tgsi_shader_info *
+swr_pre_gs_info(struct swr_context *ctx)
+{
+   if (ctx->tes)
+      return &ctx->tes->info.base;
+   return &ctx->vs->info.base;
+}
+
+/* Last shader of the frontend */
+static INLINE struct tgsi_shader_info *
+swr_last_fe_info(struct swr_context *ctx)
+{
+   if (ctx->gs)
+      return &ctx->gs->info.base;
+   return swr_pre_gs_info(ctx);
+}
+
 static INLINE void
 swr_update_draw_context(struct swr_context *ctx,
       struct swr_query_result *pqr = nullptr)
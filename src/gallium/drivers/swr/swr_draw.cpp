@@ -29,6 +29,7 @@
 #include "jit_api.h"
 
 #include "util/u_draw.h"
+#include "util/u_inlines.h"
 #include "util/u_prim.h"
 
 /*
@@ -136,8 +137,12 @@ swr_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    // between all the shader stages, so it has to be large enough to
    // incorporate all interfaces between stages
 
-   // max of gs and vs num_outputs
+   // max of gs, tes and vs num_outputs
    feState.vsVertexSize = ctx->vs->info.base.num_outputs;
+   if (ctx->tes &&
+       ctx->tes->info.base.num_outputs > feState.vsVertexSize) {
+      feState.vsVertexSize = ctx->tes->info.base.num_outputs;
+   }
    if (ctx->gs &&
        ctx->gs->info.base.num_outputs > feState.vsVertexSize) {
       feState.vsVertexSize = ctx->gs->info.base.num_outputs;
@@ -172,6 +177,11 @@ swr_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    enum pipe_prim_type topology;
    if (ctx->gs)
       topology = (pipe_prim_type)ctx->gs->info.base.properties[TGSI_PROPERTY_GS_OUTPUT_PRIM];
+   else if (ctx->tes)
+      topology = ctx->tes->tsState.postDSTopology == TOP_POINT_LIST ?
+         PIPE_PRIM_POINTS :
+         ctx->tes->tsState.postDSTopology == TOP_LINE_LIST ?
+         PIPE_PRIM_LINES : PIPE_PRIM_TRIANGLES;
    else
       topology = info->mode;
 
@@ -202,9 +212,22 @@ swr_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    feState.bEnableCutIndex = info->primitive_restart;
    ctx->api.pfnSwrSetFrontendState(ctx->swrContext, &feState);
 
+   SWR_TS_STATE tsState = {0};
+   if (ctx->tes) {
+      tsState = ctx->tes->tsState;
+      // the HS gets the whole VS vertex, see swr_hs_input_slot()
+      tsState.numHsInputAttribs =
+         std::min(feState.vsVertexSize,
+                  (uint32_t)(SWR_VTX_NUM_SLOTS - VERTEX_ATTRIB_START_SLOT));
+      tsState.numDsOutputAttribs = feState.vsVertexSize;
+      tsState.vertexAttribOffset = 0;
+   }
+   ctx->api.pfnSwrSetTsState(ctx->swrContext, &tsState);
+
    if (info->index_size)
       ctx->api.pfnSwrDrawIndexedInstanced(ctx->swrContext,
-                                          swr_convert_prim_topology(info->mode),
+                                          swr_convert_prim_topology(info->mode,
+                                                                    info->vertices_per_patch),
                                           info->count,
                                           info->instance_count,
                                           info->start,
@@ -212,7 +235,8 @@ swr_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
                                           info->start_instance);
    else
       ctx->api.pfnSwrDrawInstanced(ctx->swrContext,
-                                   swr_convert_prim_topology(info->mode),
+                                   swr_convert_prim_topology(info->mode,
+                                                             info->vertices_per_patch),
                                    info->count,
                                    info->instance_count,
                                    info->start,
@@ -340,9 +364,57 @@ swr_store_dirty_resource(struct pipe_context *pipe,
    }
 }
 
+/*
+ * Compute dispatch.  Each thread group is handed to a core worker thread
+ * as one tile of the dispatch; swr_cs_run_group runs its invocations.
+ */
+static void
+swr_launch_grid(struct pipe_context *pipe, const struct pipe_grid_info *info)
+{
+   struct swr_context *ctx = swr_context(pipe);
+   uint32_t grid[3];
+
+   if (!ctx->cs)
+      return;
+
+   if (info->indirect) {
+      pipe_buffer_read(pipe, info->indirect, info->indirect_offset,
+                       sizeof(grid), grid);
+   } else {
+      grid[0] = info->grid[0];
+      grid[1] = info->grid[1];
+      grid[2] = info->grid[2];
+   }
+
+   if (!grid[0] || !grid[1] || !grid[2])
+      return;
+
+   /* The state tracker always sets the block size of the dispatch, fall
+    * back to the fixed block size of the shader for callers which don't.
+    */
+   swr_compute_shader *cs = ctx->cs;
+   uint32_t block[3];
+   for (unsigned i = 0; i < 3; i++)
+      block[i] = info->block[i] ? info->block[i] : cs->block_size[i];
+
+   uint32_t group_size = block[0] * block[1] * block[2];
+   if (!group_size)
+      return;
+
+   swr_update_compute_state(pipe, block);
+   swr_update_draw_context(ctx);
+
+   ctx->api.pfnSwrSetCsFunc(ctx->swrContext,
+                            swr_cs_run_group,
+                            group_size,
+                            0, 0, 0);
+   ctx->api.pfnSwrDispatch(ctx->swrContext, grid[0], grid[1], grid[2]);
+}
+
 void
 swr_draw_init(struct pipe_context *pipe)
 {
    pipe->draw_vbo = swr_draw_vbo;
+   pipe->launch_grid = swr_launch_grid;
    pipe->flush = swr_flush;
 }
@@ -177,6 +177,8 @@ swr_get_param(struct pipe_screen *screen, enum pipe_cap param)
       return 1024;
    case PIPE_CAP_MAX_VERTEX_STREAMS:
       return 1;
+   case PIPE_CAP_MAX_SHADER_PATCH_VARYINGS:
+      return 32;
    case PIPE_CAP_MAX_VERTEX_ATTRIB_STRIDE:
       return 2048;
    case PIPE_CAP_MAX_TEXTURE_ARRAY_LAYERS:
@@ -262,6 +264,8 @@ swr_get_param(struct pipe_screen *screen, enum pipe_cap param)
       return swr_screen(screen)->msaa_max_count ? 1 : 0;
    case PIPE_CAP_FAKE_SW_MSAA:
       return swr_screen(screen)->msaa_max_count ? 0 : 1;
+   case PIPE_CAP_COMPUTE:
+      return 1;
 
       /* unsupported features */
    case PIPE_CAP_ANISOTROPIC_FILTER:
@@ -271,7 +275,6 @@ swr_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_TEXTURE_BARRIER:
    case PIPE_CAP_FRAGMENT_COLOR_CLAMPED:
    case PIPE_CAP_VERTEX_COLOR_CLAMPED:
-   case PIPE_CAP_COMPUTE:
    case PIPE_CAP_TGSI_VS_LAYER_VIEWPORT:
    case PIPE_CAP_TGSI_CAN_COMPACT_CONSTANTS:
    case PIPE_CAP_VERTEX_BUFFER_OFFSET_4BYTE_ALIGNED_ONLY:
@@ -290,7 +293,6 @@ swr_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_VERTEXID_NOBASE:
    case PIPE_CAP_RESOURCE_FROM_USER_MEMORY:
    case PIPE_CAP_DEVICE_RESET_STATUS_QUERY:
-   case PIPE_CAP_MAX_SHADER_PATCH_VARYINGS:
    case PIPE_CAP_TGSI_TXQS:
    case PIPE_CAP_FORCE_PERSAMPLE_INTERP:
    case PIPE_CAP_SHAREABLE_SHADERS:
@@ -342,6 +344,7 @@ swr_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_NIR_SAMPLERS_AS_DEREF:
    case PIPE_CAP_QUERY_SO_OVERFLOW:
    case PIPE_CAP_MEMOBJ:
+   case PIPE_CAP_SHAREABLE_CSOS:
       return 0;
 
    case PIPE_CAP_VENDOR_ID:
@@ -376,7 +379,147 @@ swr_get_shader_param(struct pipe_screen *screen,
        shader == PIPE_SHADER_GEOMETRY)
       return gallivm_get_shader_param(param);
 
-   // Todo: tesselation, compute
+   if (shader == PIPE_SHADER_COMPUTE) {
+      switch (param) {
+      case PIPE_SHADER_CAP_MAX_SHADER_BUFFERS:
+         return PIPE_MAX_SHADER_BUFFERS;
+      default:
+         return gallivm_get_shader_param(param);
+      }
+   }
+
+   if (shader == PIPE_SHADER_TESS_CTRL ||
+       shader == PIPE_SHADER_TESS_EVAL) {
+      switch (param) {
+      case PIPE_SHADER_CAP_MAX_INPUTS:
+      case PIPE_SHADER_CAP_MAX_OUTPUTS:
+         // control points of a ScalarPatch hold 32 generic attributes
+         return 32;
+      default:
+         return gallivm_get_shader_param(param);
+      }
+   }
+
+   return 0;
+}
+
+static int
+swr_get_compute_param(struct pipe_screen *screen,
+                      enum pipe_shader_ir ir_type,
+                      enum pipe_compute_cap param,
+                      void *ret)
+{
+   switch (param) {
+   case PIPE_COMPUTE_CAP_IR_TARGET:
+      /* Only TGSI is supported, which doesn't need a target */
+      return 0;
+   case PIPE_COMPUTE_CAP_GRID_DIMENSION:
+      if (ret) {
+         uint64_t *dim = (uint64_t *)ret;
+         dim[0] = 3;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_GRID_SIZE:
+      if (ret) {
+         uint64_t *grid_size = (uint64_t *)ret;
+         grid_size[0] = 65535;
+         grid_size[1] = 65535;
+         grid_size[2] = 65535;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_BLOCK_SIZE:
+      if (ret) {
+         uint64_t *block_size = (uint64_t *)ret;
+         block_size[0] = 1024;
+         block_size[1] = 1024;
+         block_size[2] = 64;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_THREADS_PER_BLOCK:
+      if (ret) {
+         uint64_t *max_threads = (uint64_t *)ret;
+         *max_threads = 1024;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_LOCAL_SIZE:
+      if (ret) {
+         uint64_t *max_local = (uint64_t *)ret;
+         *max_local = SWR_MAX_SHARED_MEM_SIZE;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_SUBGROUP_SIZE:
+      if (ret) {
+         uint32_t *subgroup_size = (uint32_t *)ret;
+         *subgroup_size = 8;
+      }
+      return sizeof(uint32_t);
+   case PIPE_COMPUTE_CAP_MAX_VARIABLE_THREADS_PER_BLOCK:
+      if (ret) {
+         uint64_t *max_variable = (uint64_t *)ret;
+         *max_variable = 0;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_ADDRESS_BITS:
+      if (ret) {
+         uint32_t *address_bits = (uint32_t *)ret;
+         *address_bits = sizeof(void *) * 8;
+      }
+      return sizeof(uint32_t);
+   case PIPE_COMPUTE_CAP_MAX_GLOBAL_SIZE:
+      /* Same as PIPE_CAP_VIDEO_MEMORY */
+      if (ret) {
+         uint64_t *max_global = (uint64_t *)ret;
+         *max_global = (uint64_t)swr_get_param(screen,
+                                               PIPE_CAP_VIDEO_MEMORY) << 20;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_MEM_ALLOC_SIZE:
+      /* Buffer sizes are stored in pipe_resource::width0 */
+      if (ret) {
+         uint64_t *max_alloc = (uint64_t *)ret;
+         *max_alloc = MIN2((uint64_t)swr_get_param(screen,
+                                                   PIPE_CAP_VIDEO_MEMORY) << 18,
+                           1u << 31);
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_PRIVATE_SIZE:
+      /* Temporaries live on the worker thread's stack */
+      if (ret) {
+         uint64_t *max_private = (uint64_t *)ret;
+         *max_private = 64 * 1024;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_INPUT_SIZE:
+      if (ret) {
+         uint64_t *max_input = (uint64_t *)ret;
+         *max_input = swr_get_shader_param(screen, PIPE_SHADER_COMPUTE,
+                                           PIPE_SHADER_CAP_MAX_CONST_BUFFER_SIZE);
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_CLOCK_FREQUENCY:
+      /* There is no portable way to query it, report 1 GHz */
+      if (ret) {
+         uint32_t *max_clock = (uint32_t *)ret;
+         *max_clock = 1000;
+      }
+      return sizeof(uint32_t);
+   case PIPE_COMPUTE_CAP_MAX_COMPUTE_UNITS:
+      /* Work groups are dispatched to the worker threads of the context */
+      if (ret) {
+         SWR_INTERFACE api;
+         swr_screen(screen)->pfnSwrGetInterface(api);
+
+         uint32_t *max_compute_units = (uint32_t *)ret;
+         *max_compute_units = api.pfnSwrGetNumWorkerThreads(NULL);
+      }
+      return sizeof(uint32_t);
+   case PIPE_COMPUTE_CAP_IMAGES_SUPPORTED:
+      if (ret) {
+         uint32_t *images_supported = (uint32_t *)ret;
+         *images_supported = 0;
+      }
+      return sizeof(uint32_t);
+   }
    return 0;
 }
 
@@ -1131,6 +1274,7 @@ swr_create_screen_internal(struct sw_winsys *winsys)
    screen->base.destroy = swr_destroy_screen;
    screen->base.get_param = swr_get_param;
    screen->base.get_shader_param = swr_get_shader_param;
+   screen->base.get_compute_param = swr_get_compute_param;
    screen->base.get_paramf = swr_get_paramf;
 
    screen->base.resource_create = swr_resource_create;
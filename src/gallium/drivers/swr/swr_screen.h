@@ -35,6 +35,9 @@
 
 struct sw_winsys;
 
+/* Thread group shared memory is the core's per worker thread scratch */
+#define SWR_MAX_SHARED_MEM_SIZE (32 * 1024)
+
 struct swr_screen {
    struct pipe_screen base;
    struct pipe_context *pipe;
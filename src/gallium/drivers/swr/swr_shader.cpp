@@ -34,6 +34,7 @@
 #include "builder.h"
 
 #include "tgsi/tgsi_strings.h"
+#include "util/u_coroutine.h"
 #include "util/u_format.h"
 #include "util/u_prim.h"
 #include "gallivm/lp_bld_init.h"
@@ -47,6 +48,8 @@
 #include "swr_state.h"
 #include "swr_screen.h"
 
+#include <functional>
+
 using namespace SwrJit;
 using namespace llvm;
 
@@ -73,6 +76,21 @@ bool operator==(const swr_jit_gs_key &lhs, const swr_jit_gs_key &rhs)
    return !memcmp(&lhs, &rhs, sizeof(lhs));
 }
 
+bool operator==(const swr_jit_tcs_key &lhs, const swr_jit_tcs_key &rhs)
+{
+   return !memcmp(&lhs, &rhs, sizeof(lhs));
+}
+
+bool operator==(const swr_jit_tes_key &lhs, const swr_jit_tes_key &rhs)
+{
+   return !memcmp(&lhs, &rhs, sizeof(lhs));
+}
+
+bool operator==(const swr_jit_cs_key &lhs, const swr_jit_cs_key &rhs)
+{
+   return !memcmp(&lhs, &rhs, sizeof(lhs));
+}
+
 static void
 swr_generate_sampler_key(const struct lp_tgsi_info &info,
                          struct swr_context *ctx,
@@ -145,11 +163,7 @@ swr_generate_fs_key(struct swr_jit_fs_key &key,
    key.light_twoside = ctx->rasterizer->light_twoside;
    key.sprite_coord_enable = ctx->rasterizer->sprite_coord_enable;
 
-   struct tgsi_shader_info *pPrevShader;
-   if (ctx->gs)
-      pPrevShader = &ctx->gs->info.base;
-   else
-      pPrevShader = &ctx->vs->info.base;
+   struct tgsi_shader_info *pPrevShader = swr_last_fe_info(ctx);
 
    memcpy(&key.vs_output_semantic_name,
           &pPrevShader->output_semantic_name,
@@ -195,7 +209,7 @@ swr_generate_gs_key(struct swr_jit_gs_key &key,
 {
    memset(&key, 0, sizeof(key));
 
-   struct tgsi_shader_info *pPrevShader = &ctx->vs->info.base;
+   struct tgsi_shader_info *pPrevShader = swr_pre_gs_info(ctx);
 
    memcpy(&key.vs_output_semantic_name,
           &pPrevShader->output_semantic_name,
@@ -207,6 +221,65 @@ swr_generate_gs_key(struct swr_jit_gs_key &key,
    swr_generate_sampler_key(swr_gs->info, ctx, PIPE_SHADER_GEOMETRY, key);
 }
 
+void
+swr_generate_tcs_key(struct swr_jit_tcs_key &key,
+                     struct swr_context *ctx,
+                     swr_tess_ctrl_shader *swr_tcs)
+{
+   memset(&key, 0, sizeof(key));
+
+   struct tgsi_shader_info *pPrevShader = &ctx->vs->info.base;
+
+   memcpy(&key.vs_output_semantic_name,
+          &pPrevShader->output_semantic_name,
+          sizeof(key.vs_output_semantic_name));
+   memcpy(&key.vs_output_semantic_idx,
+          &pPrevShader->output_semantic_index,
+          sizeof(key.vs_output_semantic_idx));
+
+   swr_generate_sampler_key(swr_tcs->info, ctx, PIPE_SHADER_TESS_CTRL, key);
+}
+
+void
+swr_generate_tes_key(struct swr_jit_tes_key &key,
+                     struct swr_context *ctx,
+                     swr_tess_eval_shader *swr_tes)
+{
+   memset(&key, 0, sizeof(key));
+
+   struct tgsi_shader_info *pPrevShader =
+      ctx->tcs ? &ctx->tcs->info.base : &ctx->vs->info.base;
+
+   memcpy(&key.tcs_output_semantic_name,
+          &pPrevShader->output_semantic_name,
+          sizeof(key.tcs_output_semantic_name));
+   memcpy(&key.tcs_output_semantic_idx,
+          &pPrevShader->output_semantic_index,
+          sizeof(key.tcs_output_semantic_idx));
+
+   key.clip_plane_mask =
+      swr_tes->info.base.clipdist_writemask ?
+      swr_tes->info.base.clipdist_writemask & ctx->rasterizer->clip_plane_enable :
+      ctx->rasterizer->clip_plane_enable;
+
+   swr_generate_sampler_key(swr_tes->info, ctx, PIPE_SHADER_TESS_EVAL, key);
+}
+
+void
+swr_generate_cs_key(struct swr_jit_cs_key &key,
+                    struct swr_context *ctx,
+                    swr_compute_shader *swr_cs,
+                    const uint32_t block_size[3])
+{
+   memset(&key, 0, sizeof(key));
+
+   swr_generate_sampler_key(swr_cs->info, ctx, PIPE_SHADER_COMPUTE, key);
+
+   key.block_size[0] = block_size[0];
+   key.block_size[1] = block_size[1];
+   key.block_size[2] = block_size[2];
+}
+
 struct BuilderSWR : public Builder {
    BuilderSWR(JitManager *pJitMgr, const char *pName)
       : Builder(pJitMgr)
@@ -214,19 +287,41 @@ struct BuilderSWR : public Builder {
       pJitMgr->SetupNewModule();
       gallivm = gallivm_create(pName, wrap(&JM()->mContext));
       pJitMgr->mpCurrentModule = unwrap(gallivm->module);
+      memset(&cached, 0, sizeof(cached));
+      pCachedBlob = NULL;
    }
 
    ~BuilderSWR() {
       gallivm_free_ir(gallivm);
+      free(pCachedBlob);
    }
 
+   bool LookupCachedShader(const char *name, const unsigned char *sha1,
+                           const void *key, size_t keySize,
+                           void *pMeta, size_t metaSize);
+   void StoreCachedShader(const void *pMeta, size_t metaSize);
+   func_pointer JitCachedShader(const char *name);
+
    void WriteVS(Value *pVal, Value *pVsContext, Value *pVtxOutput,
                 unsigned slot, unsigned channel);
+   void StoreVertexOutputs(struct swr_context *ctx,
+                           struct tgsi_shader_info *info,
+                           LLVMValueRef (*outputs)[TGSI_NUM_CHANNELS],
+                           Value *hPrivateData,
+                           const std::function<void(Value *, unsigned,
+                                                    unsigned)> &write);
 
    struct gallivm_state *gallivm;
+   struct lp_cached_code cached;
+   cache_key cacheKey;
+   void *pCachedBlob;
+
    PFN_VERTEX_FUNC CompileVS(struct swr_context *ctx, swr_jit_vs_key &key);
    PFN_PIXEL_KERNEL CompileFS(struct swr_context *ctx, swr_jit_fs_key &key);
    PFN_GS_FUNC CompileGS(struct swr_context *ctx, swr_jit_gs_key &key);
+   PFN_SWR_CS_FUNC CompileCS(struct swr_context *ctx, swr_jit_cs_key &key);
+   PFN_SWR_TCS_FUNC CompileTCS(struct swr_context *ctx, swr_jit_tcs_key &key);
+   PFN_DS_FUNC CompileTES(struct swr_context *ctx, swr_jit_tes_key &key);
 
    LLVMValueRef
    swr_gs_llvm_fetch_input(const struct lp_build_tgsi_gs_iface *gs_iface,
@@ -254,6 +349,55 @@ struct BuilderSWR : public Builder {
                         LLVMValueRef total_emitted_vertices_vec,
                         LLVMValueRef emitted_prims_vec);
 
+   void
+   swr_cs_llvm_emit_barrier(const struct lp_build_tgsi_cs_iface *cs_base,
+                            struct lp_build_tgsi_context * bld_base);
+
+   Value *
+   swr_tess_map_register(const uint32_t *map, Value *pMap,
+                         boolean is_indirect, LLVMValueRef index);
+   Value *
+   swr_tess_patch_offset(Value *offset,
+                         boolean is_vindex_indirect,
+                         LLVMValueRef vertex_index,
+                         unsigned channel);
+   LLVMValueRef
+   swr_tcs_llvm_fetch_input(const struct lp_build_tgsi_tess_iface *tess_iface,
+                            struct lp_build_tgsi_context * bld_base,
+                            boolean is_vindex_indirect,
+                            LLVMValueRef vertex_index,
+                            boolean is_aindex_indirect,
+                            LLVMValueRef attrib_index,
+                            LLVMValueRef swizzle_index);
+   LLVMValueRef
+   swr_tcs_llvm_fetch_output(const struct lp_build_tgsi_tess_iface *tess_iface,
+                             struct lp_build_tgsi_context * bld_base,
+                             boolean is_vindex_indirect,
+                             LLVMValueRef vertex_index,
+                             boolean is_aindex_indirect,
+                             LLVMValueRef attrib_index,
+                             LLVMValueRef swizzle_index);
+   void
+   swr_tcs_llvm_store_output(const struct lp_build_tgsi_tess_iface *tess_iface,
+                             struct lp_build_tgsi_context * bld_base,
+                             boolean is_vindex_indirect,
+                             LLVMValueRef vertex_index,
+                             boolean is_aindex_indirect,
+                             LLVMValueRef attrib_index,
+                             LLVMValueRef swizzle_index,
+                             LLVMValueRef value,
+                             LLVMValueRef mask_vec);
+   void
+   swr_tcs_llvm_emit_barrier(const struct lp_build_tgsi_tess_iface *tess_iface,
+                             struct lp_build_tgsi_context * bld_base);
+   LLVMValueRef
+   swr_tes_llvm_fetch_input(const struct lp_build_tgsi_tess_iface *tess_iface,
+                            struct lp_build_tgsi_context * bld_base,
+                            boolean is_vindex_indirect,
+                            LLVMValueRef vertex_index,
+                            boolean is_aindex_indirect,
+                            LLVMValueRef attrib_index,
+                            LLVMValueRef swizzle_index);
 };
 
 struct swr_gs_llvm_iface {
@@ -329,6 +473,76 @@ swr_gs_llvm_epilogue(const struct lp_build_tgsi_gs_iface *gs_base,
                                          emitted_prims_vec);
 }
 
+/*
+ * Object cache of the shaders.  Objects are keyed by the tokens and the
+ * variant key of a shader, so a cached variant is found before any IR is
+ * built.  Each entry is the driver state computed while building the IR
+ * (pMeta) followed by the object code.
+ */
+bool
+BuilderSWR::LookupCachedShader(const char *name, const unsigned char *sha1,
+                               const void *key, size_t keySize,
+                               void *pMeta, size_t metaSize)
+{
+   JitCache &cache = JM()->mCache;
+
+   if (!cache.IsEnabled())
+      return false;
+
+   std::string state((const char *)sha1, 20);
+   state.append((const char *)key, keySize);
+   cache.ComputeKey(name, state.data(), state.size(), cacheKey);
+
+   gallivm->cache = &cached;
+
+   size_t size;
+   pCachedBlob = cache.LoadObject(cacheKey, &size);
+   if (!pCachedBlob)
+      return false;
+
+   if (size <= metaSize) {
+      free(pCachedBlob);
+      pCachedBlob = NULL;
+      return false;
+   }
+
+   memcpy(pMeta, pCachedBlob, metaSize);
+   cached.data = (char *)pCachedBlob + metaSize;
+   cached.data_size = size - metaSize;
+
+   return true;
+}
+
+void
+BuilderSWR::StoreCachedShader(const void *pMeta, size_t metaSize)
+{
+   if (!cached.data)
+      return;
+
+   std::string blob;
+   blob.append((const char *)pMeta, metaSize);
+   blob.append((const char *)cached.data, cached.data_size);
+   JM()->mCache.StoreObject(cacheKey, blob.data(), blob.size());
+
+   free(cached.data);
+   cached.data = NULL;
+   cached.data_size = 0;
+}
+
+/* Loads the cached object of a shader instead of compiling its IR */
+func_pointer
+BuilderSWR::JitCachedShader(const char *name)
+{
+   Function *pFunction = JM()->CreateCachedFunction(name);
+
+   gallivm_compile_module(gallivm);
+   func_pointer pFunc = gallivm_jit_function(gallivm, wrap(pFunction));
+
+   JM()->mIsModuleFinalized = true;
+
+   return pFunc;
+}
+
 LLVMValueRef
 BuilderSWR::swr_gs_llvm_fetch_input(const struct lp_build_tgsi_gs_iface *gs_iface,
                            struct lp_build_tgsi_context * bld_base,
@@ -542,20 +756,6 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
    SWR_GS_STATE *pGS = &ctx->gs->gsState;
    struct tgsi_shader_info *info = &ctx->gs->info.base;
 
-   pGS->gsEnable = true;
-
-   pGS->numInputAttribs = info->num_inputs;
-   pGS->outputTopology =
-      swr_convert_prim_topology(info->properties[TGSI_PROPERTY_GS_OUTPUT_PRIM]);
-   pGS->maxNumVerts = info->properties[TGSI_PROPERTY_GS_MAX_OUTPUT_VERTICES];
-   pGS->instanceCount = info->properties[TGSI_PROPERTY_GS_INVOCATIONS];
-
-   // XXX: single stream for now...
-   pGS->isSingleStream = true;
-   pGS->singleStreamID = 0;
-
-   pGS->vertexAttribOffset = VERTEX_ATTRIB_START_SLOT; // TODO: optimize
-
    struct swr_geometry_shader *gs = ctx->gs;
 
    LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
@@ -609,17 +809,19 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
    system_values.prim_id = wrap(LOAD(pGsCtx, {0, SWR_GS_CONTEXT_PrimitiveID}));
    system_values.instance_id = wrap(LOAD(pGsCtx, {0, SWR_GS_CONTEXT_InstanceID}));
 
+   struct tgsi_shader_info *pPrevShader = swr_pre_gs_info(ctx);
+
    std::vector<Constant*> mapConstants;
    Value *vtxAttribMap = ALLOCA(ArrayType::get(mInt32Ty, PIPE_MAX_SHADER_INPUTS));
    for (unsigned slot = 0; slot < info->num_inputs; slot++) {
       ubyte semantic_name = info->input_semantic_name[slot];
       ubyte semantic_idx = info->input_semantic_index[slot];
 
-      unsigned vs_slot = locate_linkage(semantic_name, semantic_idx, &ctx->vs->info.base);
+      unsigned vs_slot = locate_linkage(semantic_name, semantic_idx, pPrevShader);
 
       vs_slot += VERTEX_ATTRIB_START_SLOT;
 
-      if (ctx->vs->info.base.output_semantic_name[0] == TGSI_SEMANTIC_POSITION)
+      if (pPrevShader->output_semantic_name[0] == TGSI_SEMANTIC_POSITION)
          vs_slot--;
 
       if (semantic_name == TGSI_SEMANTIC_POSITION)
@@ -667,7 +869,9 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
                      NULL, // thread data
                      sampler,
                      &gs->info.base,
-                     &gs_iface.base);
+                     &gs_iface.base,
+                     NULL, // compute shader face
+                     NULL); // tessellation shader face
 
    lp_build_mask_end(&mask);
 
@@ -691,41 +895,99 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
    return pFunc;
 }
 
+static void
+swr_init_gs_state(struct swr_geometry_shader *gs)
+{
+   SWR_GS_STATE *pGS = &gs->gsState;
+   struct tgsi_shader_info *info = &gs->info.base;
+
+   pGS->gsEnable = true;
+
+   pGS->numInputAttribs = info->num_inputs;
+   pGS->outputTopology =
+      swr_convert_prim_topology(info->properties[TGSI_PROPERTY_GS_OUTPUT_PRIM]);
+   pGS->maxNumVerts = info->properties[TGSI_PROPERTY_GS_MAX_OUTPUT_VERTICES];
+   pGS->instanceCount = info->properties[TGSI_PROPERTY_GS_INVOCATIONS];
+
+   // XXX: single stream for now...
+   pGS->isSingleStream = true;
+   pGS->singleStreamID = 0;
+
+   pGS->vertexAttribOffset = VERTEX_ATTRIB_START_SLOT; // TODO: optimize
+}
+
 PFN_GS_FUNC
 swr_compile_gs(struct swr_context *ctx, swr_jit_gs_key &key)
 {
    BuilderSWR builder(
       reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
       "GS");
-   PFN_GS_FUNC func = builder.CompileGS(ctx, key);
+   PFN_GS_FUNC func;
+
+   swr_init_gs_state(ctx->gs);
+
+   if (builder.LookupCachedShader("GS", ctx->gs->sha1, &key, sizeof(key),
+                                  NULL, 0)) {
+      func = (PFN_GS_FUNC)builder.JitCachedShader("GS");
+   } else {
+      func = builder.CompileGS(ctx, key);
+      builder.StoreCachedShader(NULL, 0);
+   }
 
    ctx->gs->map.insert(std::make_pair(key, make_unique<VariantGS>(builder.gallivm, func)));
    return func;
 }
 
+/* The compute shader runs on SIMD8 chunks of the work group, like the
+ * other stages */
+#define SWR_CS_SIMD_WIDTH 8
+
+/* Stack of each coroutine running a chunk of a work group, or an output
+ * control point of a TCS, with barriers */
+#define SWR_COROUTINE_STACK_SIZE (128 * 1024)
+
+struct swr_cs_llvm_iface {
+   struct lp_build_tgsi_cs_iface base;
+
+   BuilderSWR *pBuilder;
+
+   Value *pCsCtx;
+};
+
+// trampoline function so we can use the builder llvm construction methods
+static void
+swr_cs_llvm_emit_barrier(const struct lp_build_tgsi_cs_iface *cs_base,
+                         struct lp_build_tgsi_context * bld_base)
+{
+    swr_cs_llvm_iface *iface = (swr_cs_llvm_iface*)cs_base;
+
+    iface->pBuilder->swr_cs_llvm_emit_barrier(cs_base, bld_base);
+}
+
 void
-BuilderSWR::WriteVS(Value *pVal, Value *pVsContext, Value *pVtxOutput, unsigned slot, unsigned channel)
+BuilderSWR::swr_cs_llvm_emit_barrier(const struct lp_build_tgsi_cs_iface *cs_base,
+                                     struct lp_build_tgsi_context * bld_base)
 {
-#if USE_SIMD16_FRONTEND
-   // interleave the simdvertex components into the dest simd16vertex
-   //   slot16offset = slot8offset * 2
-   //   comp16offset = comp8offset * 2 + alternateOffset
+   swr_cs_llvm_iface *iface = (swr_cs_llvm_iface*)cs_base;
 
-   Value *offset = LOAD(pVsContext, { 0, SWR_VS_CONTEXT_AlternateOffset });
-   Value *pOut = GEP(pVtxOutput, { C(0), C(0), C(slot * 2), offset } );
-   STORE(pVal, pOut, {channel * 2});
-#else
-   Value *pOut = GEP(pVtxOutput, {0, 0, slot});
-   STORE(pVal, pOut, {0, channel});
-#endif
+   IRB()->SetInsertPoint(unwrap(LLVMGetInsertBlock(gallivm->builder)));
+
+   // yield to the other chunks of the work group, see swr_cs_run_group
+   std::vector<Type *> barrierArgs{PointerType::get(Gen_swr_cs_context(JM()), 0)};
+   FunctionType *barrierType =
+      FunctionType::get(Type::getVoidTy(JM()->mContext), barrierArgs, false);
+
+   Value *pfnBarrier = LOAD(iface->pCsCtx, {0, swr_cs_context_pfnBarrier});
+   pfnBarrier = BITCAST(pfnBarrier, PointerType::get(barrierType, 0));
+   CALL(pfnBarrier, {iface->pCsCtx});
 }
 
-PFN_VERTEX_FUNC
-BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
+PFN_SWR_CS_FUNC
+BuilderSWR::CompileCS(struct swr_context *ctx, swr_jit_cs_key &key)
 {
-   struct swr_vertex_shader *swr_vs = ctx->vs;
+   struct swr_compute_shader *cs = ctx->cs;
+   const uint32_t *block_size = key.block_size;
 
-   LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
    LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
 
    memset(outputs, 0, sizeof(outputs));
@@ -733,15 +995,15 @@ BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
    AttrBuilder attrBuilder;
    attrBuilder.addStackAlignmentAttr(JM()->mVWidth * sizeof(float));
 
-   std::vector<Type *> vsArgs{PointerType::get(Gen_swr_draw_context(JM()), 0),
-                              PointerType::get(Gen_SWR_VS_CONTEXT(JM()), 0)};
-   FunctionType *vsFuncType =
-      FunctionType::get(Type::getVoidTy(JM()->mContext), vsArgs, false);
+   std::vector<Type *> csArgs{PointerType::get(Gen_swr_draw_context(JM()), 0),
+                              PointerType::get(Gen_swr_cs_context(JM()), 0)};
+   FunctionType *csFuncType =
+      FunctionType::get(Type::getVoidTy(JM()->mContext), csArgs, false);
 
-   // create new vertex shader function
-   auto pFunction = Function::Create(vsFuncType,
+   // create new compute shader function
+   auto pFunction = Function::Create(csFuncType,
                                      GlobalValue::ExternalLinkage,
-                                     "VS",
+                                     "CS",
                                      JM()->mpCurrentModule);
 #if HAVE_LLVM < 0x0500
    AttributeSet attrSet = AttributeSet::get(
@@ -758,121 +1020,1190 @@ BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
    auto argitr = pFunction->arg_begin();
    Value *hPrivateData = &*argitr++;
    hPrivateData->setName("hPrivateData");
-   Value *pVsCtx = &*argitr++;
-   pVsCtx->setName("vsCtx");
-   
-   Value *consts_ptr = GEP(hPrivateData, {C(0), C(swr_draw_context_constantVS)});
+   Value *pCsCtx = &*argitr++;
+   pCsCtx->setName("csCtx");
 
-   consts_ptr->setName("vs_constants");
+   Value *consts_ptr =
+      GEP(hPrivateData, {C(0), C(swr_draw_context_constantCS)});
+   consts_ptr->setName("cs_constants");
    Value *const_sizes_ptr =
-      GEP(hPrivateData, {0, swr_draw_context_num_constantsVS});
-   const_sizes_ptr->setName("num_vs_constants");
-
-   Value *vtxInput = LOAD(pVsCtx, {0, SWR_VS_CONTEXT_pVin});
-
-   for (uint32_t attrib = 0; attrib < PIPE_MAX_SHADER_INPUTS; attrib++) {
-      const unsigned mask = swr_vs->info.base.input_usage_mask[attrib];
-      for (uint32_t channel = 0; channel < TGSI_NUM_CHANNELS; channel++) {
-         if (mask & (1 << channel)) {
-            inputs[attrib][channel] =
-               wrap(LOAD(vtxInput, {0, 0, attrib, channel}));
-         }
-      }
-   }
+      GEP(hPrivateData, {0, swr_draw_context_num_constantsCS});
+   const_sizes_ptr->setName("num_cs_constants");
 
    struct lp_build_sampler_soa *sampler =
-      swr_sampler_soa_create(key.sampler, PIPE_SHADER_VERTEX);
+      swr_sampler_soa_create(key.sampler, PIPE_SHADER_COMPUTE);
+
+   // flattened id of each lane within the work group
+   std::vector<Constant *> laneIds;
+   for (uint32_t lane = 0; lane < SWR_CS_SIMD_WIDTH; lane++)
+      laneIds.push_back(C(lane));
+   Value *vFlatId =
+      ADD(VBROADCAST(LOAD(pCsCtx, {0, swr_cs_context_first_invocation})),
+          ConstantVector::get(laneIds));
 
    struct lp_bld_tgsi_system_values system_values;
    memset(&system_values, 0, sizeof(system_values));
-   system_values.instance_id = wrap(LOAD(pVsCtx, {0, SWR_VS_CONTEXT_InstanceID}));
-   system_values.vertex_id = wrap(LOAD(pVsCtx, {0, SWR_VS_CONTEXT_VertexID}));
+   system_values.thread_id[0] =
+      wrap(UREM(vFlatId, VIMMED1(block_size[0])));
+   system_values.thread_id[1] =
+      wrap(UREM(UDIV(vFlatId, VIMMED1(block_size[0])),
+                VIMMED1(block_size[1])));
+   system_values.thread_id[2] =
+      wrap(UDIV(vFlatId, VIMMED1(block_size[0] * block_size[1])));
+   for (uint32_t i = 0; i < 3; i++) {
+      system_values.block_id[i] =
+         wrap(LOAD(pCsCtx, {0, swr_cs_context_block_id, i}));
+      system_values.grid_size[i] =
+         wrap(LOAD(pCsCtx, {0, swr_cs_context_grid_size, i}));
+      system_values.block_size[i] = wrap(C(block_size[i]));
+   }
+
+   // the last chunk of the work group may be partial
+   uint32_t group_size = block_size[0] * block_size[1] * block_size[2];
+   Value *mask_val = S_EXT(ICMP_ULT(vFlatId, VIMMED1(group_size)),
+                           mSimdInt32Ty);
+
+   struct lp_build_mask_context mask;
+   lp_build_mask_begin(&mask, gallivm,
+                       lp_type_float_vec(32, 32 * 8), wrap(mask_val));
+
+   struct swr_cs_llvm_iface cs_iface;
+   cs_iface.base.ssbo_ptr =
+      wrap(GEP(hPrivateData, {C(0), C(swr_draw_context_ssboCS)}));
+   cs_iface.base.ssbo_sizes_ptr =
+      wrap(GEP(hPrivateData, {C(0), C(swr_draw_context_ssbo_sizesCS)}));
+   cs_iface.base.shared_ptr =
+      wrap(LOAD(pCsCtx, {0, swr_cs_context_pSharedMem}));
+   cs_iface.base.shared_size = wrap(C(cs->pipe.req_local_mem));
+   cs_iface.base.emit_barrier = ::swr_cs_llvm_emit_barrier;
+   cs_iface.pBuilder = this;
+   cs_iface.pCsCtx = pCsCtx;
 
    lp_build_tgsi_soa(gallivm,
-                     swr_vs->pipe.tokens,
+                     (const struct tgsi_token *)cs->pipe.prog,
                      lp_type_float_vec(32, 32 * 8),
-                     NULL, // mask
+                     &mask,
                      wrap(consts_ptr),
                      wrap(const_sizes_ptr),
                      &system_values,
-                     inputs,
+                     NULL, // no inputs
                      outputs,
                      wrap(hPrivateData), // (sampler context)
                      NULL, // thread data
-                     sampler, // sampler
-                     &swr_vs->info.base,
-                     NULL); // geometry shader face
+                     sampler,
+                     &cs->info.base,
+                     NULL, // geometry shader face
+                     &cs_iface.base,
+                     NULL); // tessellation shader face
+
+   lp_build_mask_end(&mask);
 
    sampler->destroy(sampler);
 
    IRB()->SetInsertPoint(unwrap(LLVMGetInsertBlock(gallivm->builder)));
 
-   Value *vtxOutput = LOAD(pVsCtx, {0, SWR_VS_CONTEXT_pVout});
+   RET_VOID();
 
-   for (uint32_t channel = 0; channel < TGSI_NUM_CHANNELS; channel++) {
-      for (uint32_t attrib = 0; attrib < PIPE_MAX_SHADER_OUTPUTS; attrib++) {
-         if (!outputs[attrib][channel])
-            continue;
+   gallivm_verify_function(gallivm, wrap(pFunction));
+   gallivm_compile_module(gallivm);
 
-         Value *val;
-         uint32_t outSlot;
+   PFN_SWR_CS_FUNC pFunc =
+      (PFN_SWR_CS_FUNC)gallivm_jit_function(gallivm, wrap(pFunction));
 
-         if (swr_vs->info.base.output_semantic_name[attrib] == TGSI_SEMANTIC_PSIZE) {
-            if (channel != VERTEX_SGV_POINT_SIZE_COMP)
-               continue;
-            val = LOAD(unwrap(outputs[attrib][0]));
-            outSlot = VERTEX_SGV_SLOT;
-         } else if (swr_vs->info.base.output_semantic_name[attrib] == TGSI_SEMANTIC_POSITION) {
-            val = LOAD(unwrap(outputs[attrib][channel]));
-            outSlot = VERTEX_POSITION_SLOT;
-         } else {
-            val = LOAD(unwrap(outputs[attrib][channel]));
-            outSlot = VERTEX_ATTRIB_START_SLOT + attrib;
-            if (swr_vs->info.base.output_semantic_name[0] == TGSI_SEMANTIC_POSITION)
-               outSlot--;
-         }
+   debug_printf("comp shader  %p\n", pFunc);
+   assert(pFunc && "Error: CompShader = NULL");
 
-         WriteVS(val, pVsCtx, vtxOutput, outSlot, channel);
-      }
-   }
+   JM()->mIsModuleFinalized = true;
 
-   if (ctx->rasterizer->clip_plane_enable ||
-       swr_vs->info.base.culldist_writemask) {
-      unsigned clip_mask = ctx->rasterizer->clip_plane_enable;
+   return pFunc;
+}
 
-      unsigned cv = 0;
-      if (swr_vs->info.base.writes_clipvertex) {
-         cv = locate_linkage(TGSI_SEMANTIC_CLIPVERTEX, 0,
-                             &swr_vs->info.base);
-      } else {
-         for (int i = 0; i < PIPE_MAX_SHADER_OUTPUTS; i++) {
-            if (swr_vs->info.base.output_semantic_name[i] == TGSI_SEMANTIC_POSITION &&
-                swr_vs->info.base.output_semantic_index[i] == 0) {
-               cv = i;
-               break;
-            }
-         }
-      }
-      LLVMValueRef cx = LLVMBuildLoad(gallivm->builder, outputs[cv][0], "");
-      LLVMValueRef cy = LLVMBuildLoad(gallivm->builder, outputs[cv][1], "");
-      LLVMValueRef cz = LLVMBuildLoad(gallivm->builder, outputs[cv][2], "");
-      LLVMValueRef cw = LLVMBuildLoad(gallivm->builder, outputs[cv][3], "");
+PFN_SWR_CS_FUNC
+swr_compile_cs(struct swr_context *ctx, swr_jit_cs_key &key)
+{
+   BuilderSWR builder(
+      reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
+      "CS");
+   PFN_SWR_CS_FUNC func = builder.CompileCS(ctx, key);
 
-      for (unsigned val = 0; val < PIPE_MAX_CLIP_PLANES; val++) {
-         // clip distance overrides user clip planes
-         if ((swr_vs->info.base.clipdist_writemask & clip_mask & (1 << val)) ||
-             ((swr_vs->info.base.culldist_writemask << swr_vs->info.base.num_written_clipdistance) & (1 << val))) {
-            unsigned cv = locate_linkage(TGSI_SEMANTIC_CLIPDIST, val < 4 ? 0 : 1,
-                                         &swr_vs->info.base);
-            if (val < 4) {
-               LLVMValueRef dist = LLVMBuildLoad(gallivm->builder, outputs[cv][val], "");
-               WriteVS(unwrap(dist), pVsCtx, vtxOutput, VERTEX_CLIPCULL_DIST_LO_SLOT, val);
-            } else {
-               LLVMValueRef dist = LLVMBuildLoad(gallivm->builder, outputs[cv][val - 4], "");
-               WriteVS(unwrap(dist), pVsCtx, vtxOutput, VERTEX_CLIPCULL_DIST_HI_SLOT, val - 4);
-            }
-            continue;
-         }
+   ctx->cs->map.insert(std::make_pair(key, make_unique<VariantCS>(builder.gallivm, func)));
+   return func;
+}
+
+/*
+ * Work groups with barriers run their chunks as coroutines, so every chunk
+ * can run up to the barrier before any of them goes past it.  TCS output
+ * control points do the same.  Each SWR worker thread keeps its own
+ * coroutines around between draws and dispatches.
+ */
+struct swr_worker_coroutines {
+   struct util_coroutine_group *group = nullptr;
+
+   ~swr_worker_coroutines() {
+      if (group)
+         util_coroutine_group_destroy(group);
+   }
+};
+
+static thread_local swr_worker_coroutines worker_coroutines;
+
+static struct util_coroutine_group *
+swr_get_worker_coroutines()
+{
+   if (!worker_coroutines.group)
+      worker_coroutines.group =
+         util_coroutine_group_create(SWR_COROUTINE_STACK_SIZE);
+
+   return worker_coroutines.group;
+}
+
+/*
+ * Running the invocations one after the other would ignore the barriers,
+ * so the invocations are skipped when the coroutines can't be created.
+ */
+static void
+swr_report_coroutine_failure()
+{
+   static bool reported = false;
+
+   if (!reported) {
+      fprintf(stderr, "swr: out of memory for the coroutines of a shader "
+              "with barriers, skipping it\n");
+      reported = true;
+   }
+}
+
+struct swr_cs_group {
+   swr_draw_context *pDC;
+   PFN_SWR_CS_FUNC pfnCsFunc;
+   const swr_cs_context *pCsCtx;
+};
+
+static void __cdecl
+swr_cs_barrier(swr_cs_context *pCsCtx)
+{
+   if (pCsCtx->pCoroutines)
+      util_coroutine_group_barrier(
+         (struct util_coroutine_group *)pCsCtx->pCoroutines);
+}
+
+static void
+swr_cs_run_chunk(void *data, unsigned index)
+{
+   const swr_cs_group *group = (const swr_cs_group *)data;
+   swr_cs_context csCtx = *group->pCsCtx;
+
+   csCtx.first_invocation = index * SWR_CS_SIMD_WIDTH;
+   group->pfnCsFunc(group->pDC, &csCtx);
+}
+
+/*
+ * PFN_CS_FUNC of the SWR core: runs a whole work group on the calling
+ * worker thread.
+ */
+void __cdecl
+swr_cs_run_group(HANDLE hPrivateData, SWR_CS_CONTEXT *pCsContext)
+{
+   swr_draw_context *pDC = (swr_draw_context *)hPrivateData;
+   const swr_cs_dispatch *dispatch = pDC->pCsDispatch;
+   const uint32_t *dims = pCsContext->dispatchDims;
+   const uint32_t group_id = pCsContext->tileCounter;
+
+   swr_cs_context csCtx;
+   csCtx.block_id[0] = group_id % dims[0];
+   csCtx.block_id[1] = (group_id / dims[0]) % dims[1];
+   csCtx.block_id[2] = group_id / (dims[0] * dims[1]);
+   csCtx.grid_size[0] = dims[0];
+   csCtx.grid_size[1] = dims[1];
+   csCtx.grid_size[2] = dims[2];
+   csCtx.first_invocation = 0;
+   csCtx.pSharedMem = pCsContext->pTGSM;
+   csCtx.pCoroutines = nullptr;
+   csCtx.pfnBarrier = swr_cs_barrier;
+
+   const uint32_t group_size = dispatch->block_size[0] *
+      dispatch->block_size[1] * dispatch->block_size[2];
+   const uint32_t num_chunks =
+      (group_size + SWR_CS_SIMD_WIDTH - 1) / SWR_CS_SIMD_WIDTH;
+
+   if (dispatch->has_barrier && num_chunks > 1) {
+      struct util_coroutine_group *coroutines = swr_get_worker_coroutines();
+      swr_cs_group group = {pDC, dispatch->pfnCsFunc, &csCtx};
+
+      csCtx.pCoroutines = coroutines;
+      if (!coroutines ||
+          !util_coroutine_group_run(coroutines, num_chunks,
+                                    swr_cs_run_chunk, &group))
+         swr_report_coroutine_failure();
+      return;
+   }
+
+   for (uint32_t chunk = 0; chunk < num_chunks; chunk++) {
+      csCtx.first_invocation = chunk * SWR_CS_SIMD_WIDTH;
+      dispatch->pfnCsFunc(pDC, &csCtx);
+   }
+}
+
+/*
+ * Tessellation
+ *
+ * The SWR core runs the hull shader on a SIMD of patches, one patch per
+ * lane, and the domain shader on a SIMD of domain points of one patch.
+ * The TCS is compiled to run one output control point of every patch of
+ * the SIMD, swr_tcs_run() runs all of them.  Outputs of the TCS and inputs
+ * of the TES live in the ScalarPatch of each patch, see
+ * swr_tess_patch_layout().
+ */
+
+/*
+ * Slot of the HS context vertices holding the VS output name/index.  The
+ * HS inputs are assembled from the whole VS vertex, starting at its first
+ * slot (vertexAttribOffset of SWR_TS_STATE is 0).
+ */
+unsigned
+swr_hs_input_slot(ubyte name, ubyte index, struct tgsi_shader_info *vs_info)
+{
+   unsigned vs_slot;
+
+   if (name == TGSI_SEMANTIC_POSITION) {
+      vs_slot = VERTEX_POSITION_SLOT;
+   } else if (name == TGSI_SEMANTIC_PSIZE) {
+      vs_slot = VERTEX_SGV_SLOT;
+   } else {
+      unsigned attrib = locate_linkage(name, index, vs_info);
+
+      // not written by the VS, read anything
+      if (attrib >= PIPE_MAX_SHADER_OUTPUTS)
+         return VERTEX_ATTRIB_START_SLOT;
+
+      vs_slot = VERTEX_ATTRIB_START_SLOT + attrib;
+      if (vs_info->output_semantic_name[0] == TGSI_SEMANTIC_POSITION)
+         vs_slot--;
+   }
+
+   return MIN2(VERTEX_ATTRIB_START_SLOT + vs_slot, SWR_VTX_NUM_SLOTS - 1);
+}
+
+/*
+ * Byte offset in a ScalarPatch of each output of the stage feeding the
+ * TES.  Per-vertex outputs are packed in the control points, per-patch
+ * ones in patchData, and the tessellation factors go where the SWR
+ * tessellator expects them.
+ */
+void
+swr_tess_patch_layout(const struct tgsi_shader_info *info,
+                      uint32_t offsets[PIPE_MAX_SHADER_OUTPUTS])
+{
+   uint32_t num_cp_attribs = 0;
+   uint32_t num_patch_attribs = 0;
+
+   memset(offsets, 0, PIPE_MAX_SHADER_OUTPUTS * sizeof(offsets[0]));
+
+   for (unsigned i = 0; i < info->num_outputs; i++) {
+      switch (info->output_semantic_name[i]) {
+      case TGSI_SEMANTIC_TESSOUTER:
+         offsets[i] = offsetof(ScalarPatch, tessFactors.OuterTessFactors);
+         break;
+      case TGSI_SEMANTIC_TESSINNER:
+         offsets[i] = offsetof(ScalarPatch, tessFactors.InnerTessFactors);
+         break;
+      case TGSI_SEMANTIC_PATCH:
+         offsets[i] = offsetof(ScalarPatch, patchData) +
+            MIN2(num_patch_attribs++, SWR_VTX_NUM_SLOTS - 1) *
+            sizeof(ScalarAttrib);
+         break;
+      default:
+         offsets[i] = offsetof(ScalarPatch, cp) +
+            MIN2(num_cp_attribs++, SWR_VTX_NUM_SLOTS - 1) *
+            sizeof(ScalarAttrib);
+         break;
+      }
+   }
+}
+
+struct swr_tess_llvm_iface {
+   struct lp_build_tgsi_tess_iface base;
+
+   BuilderSWR *pBuilder;
+
+   // i8* to the ScalarPatch of the first lane (TCS) or of the patch (TES)
+   Value *pPatch;
+   // TCS only: byte offset of the ScalarPatch of each lane
+   Value *vLaneOffsets;
+   Value *pHsCtx;
+   Value *pTcsCtx;
+
+   // input register -> HS vertex slot (TCS) or patch offset (TES)
+   const uint32_t *input_map;
+   Value *pInputMap;
+   const ubyte *input_semantic_name;
+
+   // TCS only: output register -> patch offset
+   const uint32_t *output_map;
+   Value *pOutputMap;
+};
+
+// trampoline functions so we can use the builder llvm construction methods
+static LLVMValueRef
+swr_tcs_llvm_fetch_input(const struct lp_build_tgsi_tess_iface *tess_iface,
+                         struct lp_build_tgsi_context * bld_base,
+                         boolean is_vindex_indirect,
+                         LLVMValueRef vertex_index,
+                         boolean is_aindex_indirect,
+                         LLVMValueRef attrib_index,
+                         LLVMValueRef swizzle_index)
+{
+    swr_tess_llvm_iface *iface = (swr_tess_llvm_iface*)tess_iface;
+
+    return iface->pBuilder->swr_tcs_llvm_fetch_input(tess_iface, bld_base,
+                                                    is_vindex_indirect,
+                                                    vertex_index,
+                                                    is_aindex_indirect,
+                                                    attrib_index,
+                                                    swizzle_index);
+}
+
+static LLVMValueRef
+swr_tcs_llvm_fetch_output(const struct lp_build_tgsi_tess_iface *tess_iface,
+                          struct lp_build_tgsi_context * bld_base,
+                          boolean is_vindex_indirect,
+                          LLVMValueRef vertex_index,
+                          boolean is_aindex_indirect,
+                          LLVMValueRef attrib_index,
+                          LLVMValueRef swizzle_index)
+{
+    swr_tess_llvm_iface *iface = (swr_tess_llvm_iface*)tess_iface;
+
+    return iface->pBuilder->swr_tcs_llvm_fetch_output(tess_iface, bld_base,
+                                                     is_vindex_indirect,
+                                                     vertex_index,
+                                                     is_aindex_indirect,
+                                                     attrib_index,
+                                                     swizzle_index);
+}
+
+static void
+swr_tcs_llvm_store_output(const struct lp_build_tgsi_tess_iface *tess_iface,
+                          struct lp_build_tgsi_context * bld_base,
+                          boolean is_vindex_indirect,
+                          LLVMValueRef vertex_index,
+                          boolean is_aindex_indirect,
+                          LLVMValueRef attrib_index,
+                          LLVMValueRef swizzle_index,
+                          LLVMValueRef value,
+                          LLVMValueRef mask_vec)
+{
+    swr_tess_llvm_iface *iface = (swr_tess_llvm_iface*)tess_iface;
+
+    iface->pBuilder->swr_tcs_llvm_store_output(tess_iface, bld_base,
+                                              is_vindex_indirect,
+                                              vertex_index,
+                                              is_aindex_indirect,
+                                              attrib_index,
+                                              swizzle_index,
+                                              value,
+                                              mask_vec);
+}
+
+static void
+swr_tcs_llvm_emit_barrier(const struct lp_build_tgsi_tess_iface *tess_iface,
+                          struct lp_build_tgsi_context * bld_base)
+{
+    swr_tess_llvm_iface *iface = (swr_tess_llvm_iface*)tess_iface;
+
+    iface->pBuilder->swr_tcs_llvm_emit_barrier(tess_iface, bld_base);
+}
+
+static LLVMValueRef
+swr_tes_llvm_fetch_input(const struct lp_build_tgsi_tess_iface *tess_iface,
+                         struct lp_build_tgsi_context * bld_base,
+                         boolean is_vindex_indirect,
+                         LLVMValueRef vertex_index,
+                         boolean is_aindex_indirect,
+                         LLVMValueRef attrib_index,
+                         LLVMValueRef swizzle_index)
+{
+    swr_tess_llvm_iface *iface = (swr_tess_llvm_iface*)tess_iface;
+
+    return iface->pBuilder->swr_tes_llvm_fetch_input(tess_iface, bld_base,
+                                                    is_vindex_indirect,
+                                                    vertex_index,
+                                                    is_aindex_indirect,
+                                                    attrib_index,
+                                                    swizzle_index);
+}
+
+/*
+ * Looks up a register in one of the maps of the tessellation interface:
+ * a scalar for direct accesses, a vector of the value for each lane
+ * otherwise.
+ */
+Value *
+BuilderSWR::swr_tess_map_register(const uint32_t *map, Value *pMap,
+                                  boolean is_indirect, LLVMValueRef index)
+{
+   if (!is_indirect)
+      return C(map[LLVMConstIntGetZExtValue(index)]);
+
+   Value *vIndex = unwrap(index);
+   Value *vResult = VUNDEF_I();
+   for (uint32_t lane = 0; lane < mVWidth; lane++) {
+      Value *pEntry = GEP(pMap, {C(0), VEXTRACT(vIndex, C(lane))});
+      vResult = VINSERT(vResult, LOAD(pEntry), C(lane));
+   }
+
+   return vResult;
+}
+
+/*
+ * Adds the offsets of the vertex and of the channel to the offset of a
+ * register in a ScalarPatch.  The result is a vector as soon as one of the
+ * indices is.
+ */
+Value *
+BuilderSWR::swr_tess_patch_offset(Value *offset,
+                                  boolean is_vindex_indirect,
+                                  LLVMValueRef vertex_index,
+                                  unsigned channel)
+{
+   bool is_vector = offset->getType()->isVectorTy() || is_vindex_indirect;
+
+   if (is_vector && !offset->getType()->isVectorTy())
+      offset = VBROADCAST(offset);
+
+   uint32_t immediate = channel * sizeof(float);
+
+   if (vertex_index) {
+      if (is_vindex_indirect) {
+         Value *vVertex = unwrap(vertex_index);
+         vVertex = SELECT(ICMP_ULT(vVertex, VIMMED1(MAX_NUM_VERTS_PER_PRIM)),
+                          vVertex,
+                          VIMMED1(MAX_NUM_VERTS_PER_PRIM - 1));
+         offset = ADD(offset,
+                      MUL(vVertex, VIMMED1((uint32_t)sizeof(ScalarCPoint))));
+      } else {
+         immediate += LLVMConstIntGetZExtValue(vertex_index) *
+            sizeof(ScalarCPoint);
+      }
+   }
+
+   return ADD(offset, is_vector ? VIMMED1(immediate) : C(immediate));
+}
+
+LLVMValueRef
+BuilderSWR::swr_tcs_llvm_fetch_input(const struct lp_build_tgsi_tess_iface *tess_iface,
+                                     struct lp_build_tgsi_context * bld_base,
+                                     boolean is_vindex_indirect,
+                                     LLVMValueRef vertex_index,
+                                     boolean is_aindex_indirect,
+                                     LLVMValueRef attrib_index,
+                                     LLVMValueRef swizzle_index)
+{
+   swr_tess_llvm_iface *iface = (swr_tess_llvm_iface*)tess_iface;
+
+   IRB()->SetInsertPoint(unwrap(LLVMGetInsertBlock(gallivm->builder)));
+
+   unsigned channel = LLVMConstIntGetZExtValue(swizzle_index);
+
+   // the VS stores the point size in the SGV slot
+   if (!is_aindex_indirect &&
+       iface->input_semantic_name[LLVMConstIntGetZExtValue(attrib_index)] ==
+       TGSI_SEMANTIC_PSIZE)
+      channel = VERTEX_SGV_POINT_SIZE_COMP;
+
+   Value *slot = swr_tess_map_register(iface->input_map, iface->pInputMap,
+                                       is_aindex_indirect, attrib_index);
+
+   if (!is_vindex_indirect && !is_aindex_indirect) {
+      return wrap(LOAD(GEP(iface->pHsCtx,
+                           {C(0),
+                            C(SWR_HS_CONTEXT_vert),
+                            unwrap(vertex_index),
+                            C(0),
+                            slot,
+                            C(channel)})));
+   }
+
+   // gather the simdvertex components of each lane
+   if (!slot->getType()->isVectorTy())
+      slot = VBROADCAST(slot);
+
+   Value *vVertex = is_vindex_indirect ?
+      unwrap(vertex_index) : VBROADCAST(unwrap(vertex_index));
+   vVertex = SELECT(ICMP_ULT(vVertex, VIMMED1(MAX_NUM_VERTS_PER_PRIM)),
+                    vVertex,
+                    VIMMED1(MAX_NUM_VERTS_PER_PRIM - 1));
+
+   std::vector<Constant *> laneOffsets;
+   for (uint32_t lane = 0; lane < mVWidth; lane++)
+      laneOffsets.push_back(C((uint32_t)(offsetof(SWR_HS_CONTEXT, vert) +
+                                         channel * sizeof(simdscalar) +
+                                         lane * sizeof(float))));
+
+   Value *vOffsets =
+      ADD(MUL(vVertex, VIMMED1((uint32_t)sizeof(simdvertex))),
+          MUL(slot, VIMMED1((uint32_t)sizeof(simdvector))));
+   vOffsets = ADD(vOffsets, ConstantVector::get(laneOffsets));
+
+   return wrap(GATHERPS(VIMMED1(0.0f),
+                        BITCAST(iface->pHsCtx, PointerType::get(mInt8Ty, 0)),
+                        vOffsets,
+                        VIMMED1(-1),
+                        C((char)1)));
+}
+
+LLVMValueRef
+BuilderSWR::swr_tcs_llvm_fetch_output(const struct lp_build_tgsi_tess_iface *tess_iface,
+                                      struct lp_build_tgsi_context * bld_base,
+                                      boolean is_vindex_indirect,
+                                      LLVMValueRef vertex_index,
+                                      boolean is_aindex_indirect,
+                                      LLVMValueRef attrib_index,
+                                      LLVMValueRef swizzle_index)
+{
+   swr_tess_llvm_iface *iface = (swr_tess_llvm_iface*)tess_iface;
+
+   IRB()->SetInsertPoint(unwrap(LLVMGetInsertBlock(gallivm->builder)));
+
+   Value *offset = swr_tess_map_register(iface->output_map, iface->pOutputMap,
+                                         is_aindex_indirect, attrib_index);
+   offset = swr_tess_patch_offset(offset, is_vindex_indirect, vertex_index,
+                                  LLVMConstIntGetZExtValue(swizzle_index));
+   if (!offset->getType()->isVectorTy())
+      offset = VBROADCAST(offset);
+
+   // each lane reads the patch it is working on
+   return wrap(GATHERPS(VIMMED1(0.0f),
+                        iface->pPatch,
+                        ADD(offset, iface->vLaneOffsets),
+                        VIMMED1(-1),
+                        C((char)1)));
+}
+
+void
+BuilderSWR::swr_tcs_llvm_store_output(const struct lp_build_tgsi_tess_iface *tess_iface,
+                                      struct lp_build_tgsi_context * bld_base,
+                                      boolean is_vindex_indirect,
+                                      LLVMValueRef vertex_index,
+                                      boolean is_aindex_indirect,
+                                      LLVMValueRef attrib_index,
+                                      LLVMValueRef swizzle_index,
+                                      LLVMValueRef value,
+                                      LLVMValueRef mask_vec)
+{
+   swr_tess_llvm_iface *iface = (swr_tess_llvm_iface*)tess_iface;
+
+   IRB()->SetInsertPoint(unwrap(LLVMGetInsertBlock(gallivm->builder)));
+
+   Value *offset = swr_tess_map_register(iface->output_map, iface->pOutputMap,
+                                         is_aindex_indirect, attrib_index);
+   offset = swr_tess_patch_offset(offset, is_vindex_indirect, vertex_index,
+                                  LLVMConstIntGetZExtValue(swizzle_index));
+   if (!offset->getType()->isVectorTy())
+      offset = VBROADCAST(offset);
+
+   Value *vPtrs = GEP(iface->pPatch, ADD(offset, iface->vLaneOffsets));
+   vPtrs = BITCAST(vPtrs,
+                   VectorType::get(PointerType::get(mFP32Ty, 0), mVWidth));
+
+   Value *vMask = TRUNC(unwrap(mask_vec), VectorType::get(mInt1Ty, mVWidth));
+
+   MASKED_SCATTER(unwrap(value), vPtrs, sizeof(float), vMask);
+}
+
+void
+BuilderSWR::swr_tcs_llvm_emit_barrier(const struct lp_build_tgsi_tess_iface *tess_iface,
+                                      struct lp_build_tgsi_context * bld_base)
+{
+   swr_tess_llvm_iface *iface = (swr_tess_llvm_iface*)tess_iface;
+
+   IRB()->SetInsertPoint(unwrap(LLVMGetInsertBlock(gallivm->builder)));
+
+   // yield to the other output control points, see swr_tcs_run
+   std::vector<Type *> barrierArgs{PointerType::get(Gen_swr_tcs_context(JM()), 0)};
+   FunctionType *barrierType =
+      FunctionType::get(Type::getVoidTy(JM()->mContext), barrierArgs, false);
+
+   Value *pfnBarrier = LOAD(iface->pTcsCtx, {0, swr_tcs_context_pfnBarrier});
+   pfnBarrier = BITCAST(pfnBarrier, PointerType::get(barrierType, 0));
+   CALL(pfnBarrier, {iface->pTcsCtx});
+}
+
+LLVMValueRef
+BuilderSWR::swr_tes_llvm_fetch_input(const struct lp_build_tgsi_tess_iface *tess_iface,
+                                     struct lp_build_tgsi_context * bld_base,
+                                     boolean is_vindex_indirect,
+                                     LLVMValueRef vertex_index,
+                                     boolean is_aindex_indirect,
+                                     LLVMValueRef attrib_index,
+                                     LLVMValueRef swizzle_index)
+{
+   swr_tess_llvm_iface *iface = (swr_tess_llvm_iface*)tess_iface;
+
+   IRB()->SetInsertPoint(unwrap(LLVMGetInsertBlock(gallivm->builder)));
+
+   Value *offset = swr_tess_map_register(iface->input_map, iface->pInputMap,
+                                         is_aindex_indirect, attrib_index);
+   offset = swr_tess_patch_offset(offset, is_vindex_indirect, vertex_index,
+                                  LLVMConstIntGetZExtValue(swizzle_index));
+
+   // all lanes work on the same patch
+   if (!offset->getType()->isVectorTy()) {
+      Value *pInput = BITCAST(GEP(iface->pPatch, offset),
+                              PointerType::get(mFP32Ty, 0));
+      return wrap(VBROADCAST(LOAD(pInput)));
+   }
+
+   return wrap(GATHERPS(VIMMED1(0.0f),
+                        iface->pPatch,
+                        offset,
+                        VIMMED1(-1),
+                        C((char)1)));
+}
+
+PFN_SWR_TCS_FUNC
+BuilderSWR::CompileTCS(struct swr_context *ctx, swr_jit_tcs_key &key)
+{
+   struct swr_tess_ctrl_shader *tcs = ctx->tcs;
+   struct tgsi_shader_info *info = &tcs->info.base;
+
+   LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
+   LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
+
+   memset(outputs, 0, sizeof(outputs));
+
+   AttrBuilder attrBuilder;
+   attrBuilder.addStackAlignmentAttr(JM()->mVWidth * sizeof(float));
+
+   std::vector<Type *> tcsArgs{PointerType::get(Gen_swr_draw_context(JM()), 0),
+                               PointerType::get(Gen_SWR_HS_CONTEXT(JM()), 0),
+                               PointerType::get(Gen_swr_tcs_context(JM()), 0)};
+   FunctionType *tcsFuncType =
+      FunctionType::get(Type::getVoidTy(JM()->mContext), tcsArgs, false);
+
+   // create new tessellation control shader function
+   auto pFunction = Function::Create(tcsFuncType,
+                                     GlobalValue::ExternalLinkage,
+                                     "TCS",
+                                     JM()->mpCurrentModule);
+#if HAVE_LLVM < 0x0500
+   AttributeSet attrSet = AttributeSet::get(
+      JM()->mContext, AttributeSet::FunctionIndex, attrBuilder);
+   pFunction->addAttributes(AttributeSet::FunctionIndex, attrSet);
+#else
+   pFunction->addAttributes(AttributeList::FunctionIndex, attrBuilder);
+#endif
+
+   BasicBlock *block = BasicBlock::Create(JM()->mContext, "entry", pFunction);
+   IRB()->SetInsertPoint(block);
+   LLVMPositionBuilderAtEnd(gallivm->builder, wrap(block));
+
+   auto argitr = pFunction->arg_begin();
+   Value *hPrivateData = &*argitr++;
+   hPrivateData->setName("hPrivateData");
+   Value *pHsCtx = &*argitr++;
+   pHsCtx->setName("hsCtx");
+   Value *pTcsCtx = &*argitr++;
+   pTcsCtx->setName("tcsCtx");
+
+   Value *consts_ptr =
+      GEP(hPrivateData, {C(0), C(swr_draw_context_constantTCS)});
+   consts_ptr->setName("tcs_constants");
+   Value *const_sizes_ptr =
+      GEP(hPrivateData, {0, swr_draw_context_num_constantsTCS});
+   const_sizes_ptr->setName("num_tcs_constants");
+
+   struct lp_build_sampler_soa *sampler =
+      swr_sampler_soa_create(key.sampler, PIPE_SHADER_TESS_CTRL);
+
+   struct lp_bld_tgsi_system_values system_values;
+   memset(&system_values, 0, sizeof(system_values));
+   system_values.prim_id = wrap(LOAD(pHsCtx, {0, SWR_HS_CONTEXT_PrimitiveID}));
+   system_values.invocation_id =
+      wrap(LOAD(pTcsCtx, {0, swr_tcs_context_invocation_id}));
+   system_values.vertices_in =
+      wrap(LOAD(pTcsCtx, {0, swr_tcs_context_vertices_in}));
+
+   // inputs come from the VS vertices assembled by the SWR frontend
+   uint32_t input_map[PIPE_MAX_SHADER_INPUTS];
+   Value *pInputMap = ALLOCA(ArrayType::get(mInt32Ty, PIPE_MAX_SHADER_INPUTS));
+   for (unsigned slot = 0; slot < info->num_inputs; slot++) {
+      input_map[slot] = swr_hs_input_slot(info->input_semantic_name[slot],
+                                          info->input_semantic_index[slot],
+                                          &ctx->vs->info.base);
+      STORE(C(input_map[slot]), pInputMap, {0, slot});
+   }
+
+   uint32_t output_map[PIPE_MAX_SHADER_OUTPUTS];
+   Value *pOutputMap = ALLOCA(ArrayType::get(mInt32Ty, PIPE_MAX_SHADER_OUTPUTS));
+   swr_tess_patch_layout(info, output_map);
+   for (unsigned slot = 0; slot < info->num_outputs; slot++)
+      STORE(C(output_map[slot]), pOutputMap, {0, slot});
+
+   std::vector<Constant *> laneOffsets;
+   for (uint32_t lane = 0; lane < mVWidth; lane++)
+      laneOffsets.push_back(C((uint32_t)(lane * sizeof(ScalarPatch))));
+
+   struct lp_build_mask_context mask;
+   Value *mask_val = LOAD(pHsCtx, {0, SWR_HS_CONTEXT_mask}, "hsMask");
+   lp_build_mask_begin(&mask, gallivm,
+                       lp_type_float_vec(32, 32 * 8), wrap(mask_val));
+
+   struct swr_tess_llvm_iface tess_iface;
+   tess_iface.base.fetch_input = ::swr_tcs_llvm_fetch_input;
+   tess_iface.base.fetch_output = ::swr_tcs_llvm_fetch_output;
+   tess_iface.base.emit_store_output = ::swr_tcs_llvm_store_output;
+   tess_iface.base.emit_barrier = ::swr_tcs_llvm_emit_barrier;
+   tess_iface.pBuilder = this;
+   tess_iface.pPatch = BITCAST(LOAD(pHsCtx, {0, SWR_HS_CONTEXT_pCPout}),
+                               PointerType::get(mInt8Ty, 0));
+   tess_iface.vLaneOffsets = ConstantVector::get(laneOffsets);
+   tess_iface.pHsCtx = pHsCtx;
+   tess_iface.pTcsCtx = pTcsCtx;
+   tess_iface.input_map = input_map;
+   tess_iface.pInputMap = pInputMap;
+   tess_iface.input_semantic_name = info->input_semantic_name;
+   tess_iface.output_map = output_map;
+   tess_iface.pOutputMap = pOutputMap;
+
+   lp_build_tgsi_soa(gallivm,
+                     tcs->pipe.tokens,
+                     lp_type_float_vec(32, 32 * 8),
+                     &mask,
+                     wrap(consts_ptr),
+                     wrap(const_sizes_ptr),
+                     &system_values,
+                     inputs,
+                     outputs,
+                     wrap(hPrivateData), // (sampler context)
+                     NULL, // thread data
+                     sampler,
+                     info,
+                     NULL, // geometry shader face
+                     NULL, // compute shader face
+                     &tess_iface.base);
+
+   lp_build_mask_end(&mask);
+
+   sampler->destroy(sampler);
+
+   IRB()->SetInsertPoint(unwrap(LLVMGetInsertBlock(gallivm->builder)));
+
+   RET_VOID();
+
+   gallivm_verify_function(gallivm, wrap(pFunction));
+   gallivm_compile_module(gallivm);
+
+   PFN_SWR_TCS_FUNC pFunc =
+      (PFN_SWR_TCS_FUNC)gallivm_jit_function(gallivm, wrap(pFunction));
+
+   debug_printf("tess ctrl shader  %p\n", pFunc);
+   assert(pFunc && "Error: TessCtrlShader = NULL");
+
+   JM()->mIsModuleFinalized = true;
+
+   return pFunc;
+}
+
+PFN_SWR_TCS_FUNC
+swr_compile_tcs(struct swr_context *ctx, swr_jit_tcs_key &key)
+{
+   BuilderSWR builder(
+      reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
+      "TCS");
+   PFN_SWR_TCS_FUNC func = builder.CompileTCS(ctx, key);
+
+   ctx->tcs->map.insert(std::make_pair(key, make_unique<VariantTCS>(builder.gallivm, func)));
+   return func;
+}
+
+PFN_DS_FUNC
+BuilderSWR::CompileTES(struct swr_context *ctx, swr_jit_tes_key &key)
+{
+   struct swr_tess_eval_shader *tes = ctx->tes;
+   struct tgsi_shader_info *info = &tes->info.base;
+   struct tgsi_shader_info *pPrevShader =
+      ctx->tcs ? &ctx->tcs->info.base : &ctx->vs->info.base;
+
+   LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
+   LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
+
+   memset(outputs, 0, sizeof(outputs));
+
+   AttrBuilder attrBuilder;
+   attrBuilder.addStackAlignmentAttr(JM()->mVWidth * sizeof(float));
+
+   std::vector<Type *> tesArgs{PointerType::get(Gen_swr_draw_context(JM()), 0),
+                               PointerType::get(Gen_SWR_DS_CONTEXT(JM()), 0)};
+   FunctionType *tesFuncType =
+      FunctionType::get(Type::getVoidTy(JM()->mContext), tesArgs, false);
+
+   // create new tessellation evaluation shader function
+   auto pFunction = Function::Create(tesFuncType,
+                                     GlobalValue::ExternalLinkage,
+                                     "TES",
+                                     JM()->mpCurrentModule);
+#if HAVE_LLVM < 0x0500
+   AttributeSet attrSet = AttributeSet::get(
+      JM()->mContext, AttributeSet::FunctionIndex, attrBuilder);
+   pFunction->addAttributes(AttributeSet::FunctionIndex, attrSet);
+#else
+   pFunction->addAttributes(AttributeList::FunctionIndex, attrBuilder);
+#endif
+
+   BasicBlock *block = BasicBlock::Create(JM()->mContext, "entry", pFunction);
+   IRB()->SetInsertPoint(block);
+   LLVMPositionBuilderAtEnd(gallivm->builder, wrap(block));
+
+   auto argitr = pFunction->arg_begin();
+   Value *hPrivateData = &*argitr++;
+   hPrivateData->setName("hPrivateData");
+   Value *pDsCtx = &*argitr++;
+   pDsCtx->setName("dsCtx");
+
+   Value *consts_ptr =
+      GEP(hPrivateData, {C(0), C(swr_draw_context_constantTES)});
+   consts_ptr->setName("tes_constants");
+   Value *const_sizes_ptr =
+      GEP(hPrivateData, {0, swr_draw_context_num_constantsTES});
+   const_sizes_ptr->setName("num_tes_constants");
+
+   struct lp_build_sampler_soa *sampler =
+      swr_sampler_soa_create(key.sampler, PIPE_SHADER_TESS_EVAL);
+
+   Value *pPatch = BITCAST(LOAD(pDsCtx, {0, SWR_DS_CONTEXT_pCpIn}),
+                           PointerType::get(mInt8Ty, 0));
+   Value *vectorOffset = LOAD(pDsCtx, {0, SWR_DS_CONTEXT_vectorOffset});
+
+   struct lp_bld_tgsi_system_values system_values;
+   memset(&system_values, 0, sizeof(system_values));
+   system_values.prim_id =
+      wrap(VBROADCAST(LOAD(pDsCtx, {0, SWR_DS_CONTEXT_PrimitiveID})));
+   system_values.vertices_in =
+      wrap(LOAD(hPrivateData, {0, swr_draw_context_tesVerticesIn}));
+
+   Value *vU = LOAD(GEP(LOAD(pDsCtx, {0, SWR_DS_CONTEXT_pDomainU}),
+                        {vectorOffset}));
+   Value *vV = LOAD(GEP(LOAD(pDsCtx, {0, SWR_DS_CONTEXT_pDomainV}),
+                        {vectorOffset}));
+   system_values.tess_coord[0] = wrap(vU);
+   system_values.tess_coord[1] = wrap(vV);
+   system_values.tess_coord[2] = wrap(tes->tsState.domain == SWR_TS_TRI ?
+                                      FSUB(FSUB(VIMMED1(1.0f), vU), vV) :
+                                      VIMMED1(0.0f));
+
+   // swr_tcs_run swaps the isoline factors to the order of the tessellator
+   bool isolines = tes->tsState.domain == SWR_TS_ISOLINE;
+   for (unsigned i = 0; i < SWR_NUM_OUTER_TESS_FACTORS; i++) {
+      unsigned factor = isolines && i < 2 ? i ^ 1 : i;
+      Value *pFactor =
+         GEP(pPatch, C((uint32_t)(offsetof(ScalarPatch,
+                                           tessFactors.OuterTessFactors) +
+                                  factor * sizeof(float))));
+      system_values.tess_outer[i] =
+         wrap(LOAD(BITCAST(pFactor, PointerType::get(mFP32Ty, 0))));
+   }
+   for (unsigned i = 0; i < SWR_NUM_INNER_TESS_FACTORS; i++) {
+      Value *pFactor =
+         GEP(pPatch, C((uint32_t)(offsetof(ScalarPatch,
+                                           tessFactors.InnerTessFactors) +
+                                  i * sizeof(float))));
+      system_values.tess_inner[i] =
+         wrap(LOAD(BITCAST(pFactor, PointerType::get(mFP32Ty, 0))));
+   }
+
+   // inputs come from the patch written by the TCS or by swr_tcs_run
+   uint32_t patch_layout[PIPE_MAX_SHADER_OUTPUTS];
+   swr_tess_patch_layout(pPrevShader, patch_layout);
+
+   uint32_t input_map[PIPE_MAX_SHADER_INPUTS];
+   Value *pInputMap = ALLOCA(ArrayType::get(mInt32Ty, PIPE_MAX_SHADER_INPUTS));
+   for (unsigned slot = 0; slot < info->num_inputs; slot++) {
+      unsigned prev_slot = locate_linkage(info->input_semantic_name[slot],
+                                          info->input_semantic_index[slot],
+                                          pPrevShader);
+
+      input_map[slot] =
+         prev_slot < PIPE_MAX_SHADER_OUTPUTS ? patch_layout[prev_slot] : 0;
+      STORE(C(input_map[slot]), pInputMap, {0, slot});
+   }
+
+   struct lp_build_mask_context mask;
+   Value *mask_val = LOAD(pDsCtx, {0, SWR_DS_CONTEXT_mask}, "dsMask");
+   lp_build_mask_begin(&mask, gallivm,
+                       lp_type_float_vec(32, 32 * 8), wrap(mask_val));
+
+   struct swr_tess_llvm_iface tess_iface;
+   memset(&tess_iface, 0, sizeof(tess_iface));
+   tess_iface.base.fetch_input = ::swr_tes_llvm_fetch_input;
+   tess_iface.pBuilder = this;
+   tess_iface.pPatch = pPatch;
+   tess_iface.input_map = input_map;
+   tess_iface.pInputMap = pInputMap;
+   tess_iface.input_semantic_name = info->input_semantic_name;
+
+   lp_build_tgsi_soa(gallivm,
+                     tes->pipe.tokens,
+                     lp_type_float_vec(32, 32 * 8),
+                     &mask,
+                     wrap(consts_ptr),
+                     wrap(const_sizes_ptr),
+                     &system_values,
+                     inputs,
+                     outputs,
+                     wrap(hPrivateData), // (sampler context)
+                     NULL, // thread data
+                     sampler,
+                     info,
+                     NULL, // geometry shader face
+                     NULL, // compute shader face
+                     &tess_iface.base);
+
+   lp_build_mask_end(&mask);
+
+   sampler->destroy(sampler);
+
+   IRB()->SetInsertPoint(unwrap(LLVMGetInsertBlock(gallivm->builder)));
+
+   // one row of vectors per attribute component
+   Value *pOutputData = LOAD(pDsCtx, {0, SWR_DS_CONTEXT_pOutputData});
+   Value *vectorStride = LOAD(pDsCtx, {0, SWR_DS_CONTEXT_vectorStride});
+
+   StoreVertexOutputs(ctx, info, outputs, hPrivateData,
+                      [&](Value *val, unsigned slot, unsigned channel) {
+      Value *index =
+         ADD(MUL(C(slot * TGSI_NUM_CHANNELS + channel), vectorStride),
+             vectorOffset);
+      STORE(val, GEP(pOutputData, {index}));
+   });
+
+   RET_VOID();
+
+   gallivm_verify_function(gallivm, wrap(pFunction));
+   gallivm_compile_module(gallivm);
+
+   PFN_DS_FUNC pFunc =
+      (PFN_DS_FUNC)gallivm_jit_function(gallivm, wrap(pFunction));
+
+   debug_printf("tess eval shader  %p\n", pFunc);
+   assert(pFunc && "Error: TessEvalShader = NULL");
+
+   JM()->mIsModuleFinalized = true;
+
+   return pFunc;
+}
+
+PFN_DS_FUNC
+swr_compile_tes(struct swr_context *ctx, swr_jit_tes_key &key)
+{
+   BuilderSWR builder(
+      reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
+      "TES");
+   PFN_DS_FUNC func = builder.CompileTES(ctx, key);
+
+   ctx->tes->map.insert(std::make_pair(key, make_unique<VariantTES>(builder.gallivm, func)));
+   return func;
+}
+
+struct swr_tcs_invocations {
+   swr_draw_context *pDC;
+   const swr_tcs_dispatch *dispatch;
+   SWR_HS_CONTEXT *pHsCtx;
+   const swr_tcs_context *pTcsCtx;
+};
+
+static void __cdecl
+swr_tcs_barrier(swr_tcs_context *pTcsCtx)
+{
+   if (pTcsCtx->pCoroutines)
+      util_coroutine_group_barrier(
+         (struct util_coroutine_group *)pTcsCtx->pCoroutines);
+}
+
+static void
+swr_tcs_run_invocation(void *data, unsigned index)
+{
+   const swr_tcs_invocations *invocations = (const swr_tcs_invocations *)data;
+   swr_tcs_context tcsCtx = *invocations->pTcsCtx;
+
+   tcsCtx.invocation_id = index;
+   invocations->dispatch->pfnTcsFunc(invocations->pDC, invocations->pHsCtx,
+                                     &tcsCtx);
+}
+
+/*
+ * Without a TCS, the input control points go to the TES unchanged, with
+ * the default tessellation levels.
+ */
+static void
+swr_tcs_passthrough(const swr_tcs_dispatch *dispatch, SWR_HS_CONTEXT *pHsCtx)
+{
+   for (uint32_t lane = 0; lane < KNOB_SIMD_WIDTH; lane++) {
+      ScalarPatch *pPatch = &pHsCtx->pCPout[lane];
+
+      memcpy(pPatch->tessFactors.OuterTessFactors, dispatch->tess_outer,
+             sizeof(dispatch->tess_outer));
+      memcpy(pPatch->tessFactors.InnerTessFactors, dispatch->tess_inner,
+             sizeof(dispatch->tess_inner));
+
+      for (uint32_t i = 0; i < dispatch->num_copies; i++) {
+         const swr_tcs_copy *copy = &dispatch->copies[i];
+
+         for (uint32_t v = 0; v < dispatch->vertices_in; v++) {
+            const simdvector &src = pHsCtx->vert[v].attrib[copy->src_slot];
+            float *dst = (float *)((uint8_t *)pPatch + copy->dst_offset +
+                                   v * sizeof(ScalarCPoint));
+
+            if (copy->point_size) {
+               dst[0] = ((const float *)&src[VERTEX_SGV_POINT_SIZE_COMP])[lane];
+               continue;
+            }
+
+            for (uint32_t c = 0; c < TGSI_NUM_CHANNELS; c++)
+               dst[c] = ((const float *)&src[c])[lane];
+         }
+      }
+   }
+}
+
+/*
+ * PFN_HS_FUNC of the SWR core: runs the TCS once per output control point
+ * of the patches, as coroutines when the shader has barriers.
+ */
+void __cdecl
+swr_tcs_run(HANDLE hPrivateData, SWR_HS_CONTEXT *pHsCtx)
+{
+   swr_draw_context *pDC = (swr_draw_context *)hPrivateData;
+   const swr_tcs_dispatch *dispatch = pDC->pTcsDispatch;
+
+   if (!dispatch->pfnTcsFunc) {
+      swr_tcs_passthrough(dispatch, pHsCtx);
+   } else {
+      swr_tcs_context tcsCtx;
+      tcsCtx.invocation_id = 0;
+      tcsCtx.vertices_in = dispatch->vertices_in;
+      tcsCtx.pCoroutines = nullptr;
+      tcsCtx.pfnBarrier = swr_tcs_barrier;
+
+      if (dispatch->has_barrier && dispatch->vertices_out > 1) {
+         struct util_coroutine_group *coroutines = swr_get_worker_coroutines();
+         swr_tcs_invocations invocations = {pDC, dispatch, pHsCtx, &tcsCtx};
+
+         tcsCtx.pCoroutines = coroutines;
+         if (!coroutines ||
+             !util_coroutine_group_run(coroutines, dispatch->vertices_out,
+                                       swr_tcs_run_invocation, &invocations))
+            swr_report_coroutine_failure();
+      } else {
+         for (uint32_t id = 0; id < dispatch->vertices_out; id++) {
+            tcsCtx.invocation_id = id;
+            dispatch->pfnTcsFunc(pDC, pHsCtx, &tcsCtx);
+         }
+      }
+   }
+
+   // GL has the line density first, the SWR tessellator the line detail
+   if (dispatch->swap_line_factors) {
+      for (uint32_t lane = 0; lane < KNOB_SIMD_WIDTH; lane++) {
+         float *outer = pHsCtx->pCPout[lane].tessFactors.OuterTessFactors;
+         std::swap(outer[0], outer[1]);
+      }
+   }
+}
+
+void
+BuilderSWR::WriteVS(Value *pVal, Value *pVsContext, Value *pVtxOutput, unsigned slot, unsigned channel)
+{
+#if USE_SIMD16_FRONTEND
+   // interleave the simdvertex components into the dest simd16vertex
+   //   slot16offset = slot8offset * 2
+   //   comp16offset = comp8offset * 2 + alternateOffset
+
+   Value *offset = LOAD(pVsContext, { 0, SWR_VS_CONTEXT_AlternateOffset });
+   Value *pOut = GEP(pVtxOutput, { C(0), C(0), C(slot * 2), offset } );
+   STORE(pVal, pOut, {channel * 2});
+#else
+   Value *pOut = GEP(pVtxOutput, {0, 0, slot});
+   STORE(pVal, pOut, {0, channel});
+#endif
+}
+
+/*
+ * Writes the outputs of the last shader before the geometry shader or the
+ * clipper, in the vertex layout the SWR frontend expects, followed by the
+ * clip distances.
+ */
+void
+BuilderSWR::StoreVertexOutputs(struct swr_context *ctx,
+                               struct tgsi_shader_info *info,
+                               LLVMValueRef (*outputs)[TGSI_NUM_CHANNELS],
+                               Value *hPrivateData,
+                               const std::function<void(Value *, unsigned,
+                                                        unsigned)> &write)
+{
+   for (uint32_t channel = 0; channel < TGSI_NUM_CHANNELS; channel++) {
+      for (uint32_t attrib = 0; attrib < PIPE_MAX_SHADER_OUTPUTS; attrib++) {
+         if (!outputs[attrib][channel])
+            continue;
+
+         Value *val;
+         uint32_t outSlot;
+
+         if (info->output_semantic_name[attrib] == TGSI_SEMANTIC_PSIZE) {
+            if (channel != VERTEX_SGV_POINT_SIZE_COMP)
+               continue;
+            val = LOAD(unwrap(outputs[attrib][0]));
+            outSlot = VERTEX_SGV_SLOT;
+         } else if (info->output_semantic_name[attrib] == TGSI_SEMANTIC_POSITION) {
+            val = LOAD(unwrap(outputs[attrib][channel]));
+            outSlot = VERTEX_POSITION_SLOT;
+         } else {
+            val = LOAD(unwrap(outputs[attrib][channel]));
+            outSlot = VERTEX_ATTRIB_START_SLOT + attrib;
+            if (info->output_semantic_name[0] == TGSI_SEMANTIC_POSITION)
+               outSlot--;
+         }
+
+         write(val, outSlot, channel);
+      }
+   }
+
+   if (ctx->rasterizer->clip_plane_enable ||
+       info->culldist_writemask) {
+      unsigned clip_mask = ctx->rasterizer->clip_plane_enable;
+
+      unsigned cv = 0;
+      if (info->writes_clipvertex) {
+         cv = locate_linkage(TGSI_SEMANTIC_CLIPVERTEX, 0, info);
+      } else {
+         for (int i = 0; i < PIPE_MAX_SHADER_OUTPUTS; i++) {
+            if (info->output_semantic_name[i] == TGSI_SEMANTIC_POSITION &&
+                info->output_semantic_index[i] == 0) {
+               cv = i;
+               break;
+            }
+         }
+      }
+      LLVMValueRef cx = LLVMBuildLoad(gallivm->builder, outputs[cv][0], "");
+      LLVMValueRef cy = LLVMBuildLoad(gallivm->builder, outputs[cv][1], "");
+      LLVMValueRef cz = LLVMBuildLoad(gallivm->builder, outputs[cv][2], "");
+      LLVMValueRef cw = LLVMBuildLoad(gallivm->builder, outputs[cv][3], "");
+
+      for (unsigned val = 0; val < PIPE_MAX_CLIP_PLANES; val++) {
+         // clip distance overrides user clip planes
+         if ((info->clipdist_writemask & clip_mask & (1 << val)) ||
+             ((info->culldist_writemask << info->num_written_clipdistance) & (1 << val))) {
+            unsigned cv = locate_linkage(TGSI_SEMANTIC_CLIPDIST, val < 4 ? 0 : 1,
+                                         info);
+            if (val < 4) {
+               LLVMValueRef dist = LLVMBuildLoad(gallivm->builder, outputs[cv][val], "");
+               write(unwrap(dist), VERTEX_CLIPCULL_DIST_LO_SLOT, val);
+            } else {
+               LLVMValueRef dist = LLVMBuildLoad(gallivm->builder, outputs[cv][val - 4], "");
+               write(unwrap(dist), VERTEX_CLIPCULL_DIST_HI_SLOT, val - 4);
+            }
+            continue;
+         }
 
          if (!(clip_mask & (1 << val)))
             continue;
@@ -887,12 +2218,109 @@ BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
                                       FMUL(unwrap(cw), VBROADCAST(pw)))));
 
          if (val < 4)
-            WriteVS(dist, pVsCtx, vtxOutput, VERTEX_CLIPCULL_DIST_LO_SLOT, val);
+            write(dist, VERTEX_CLIPCULL_DIST_LO_SLOT, val);
          else
-            WriteVS(dist, pVsCtx, vtxOutput, VERTEX_CLIPCULL_DIST_HI_SLOT, val - 4);
+            write(dist, VERTEX_CLIPCULL_DIST_HI_SLOT, val - 4);
+      }
+   }
+}
+
+PFN_VERTEX_FUNC
+BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
+{
+   struct swr_vertex_shader *swr_vs = ctx->vs;
+
+   LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
+   LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
+
+   memset(outputs, 0, sizeof(outputs));
+
+   AttrBuilder attrBuilder;
+   attrBuilder.addStackAlignmentAttr(JM()->mVWidth * sizeof(float));
+
+   std::vector<Type *> vsArgs{PointerType::get(Gen_swr_draw_context(JM()), 0),
+                              PointerType::get(Gen_SWR_VS_CONTEXT(JM()), 0)};
+   FunctionType *vsFuncType =
+      FunctionType::get(Type::getVoidTy(JM()->mContext), vsArgs, false);
+
+   // create new vertex shader function
+   auto pFunction = Function::Create(vsFuncType,
+                                     GlobalValue::ExternalLinkage,
+                                     "VS",
+                                     JM()->mpCurrentModule);
+#if HAVE_LLVM < 0x0500
+   AttributeSet attrSet = AttributeSet::get(
+      JM()->mContext, AttributeSet::FunctionIndex, attrBuilder);
+   pFunction->addAttributes(AttributeSet::FunctionIndex, attrSet);
+#else
+   pFunction->addAttributes(AttributeList::FunctionIndex, attrBuilder);
+#endif
+
+   BasicBlock *block = BasicBlock::Create(JM()->mContext, "entry", pFunction);
+   IRB()->SetInsertPoint(block);
+   LLVMPositionBuilderAtEnd(gallivm->builder, wrap(block));
+
+   auto argitr = pFunction->arg_begin();
+   Value *hPrivateData = &*argitr++;
+   hPrivateData->setName("hPrivateData");
+   Value *pVsCtx = &*argitr++;
+   pVsCtx->setName("vsCtx");
+   
+   Value *consts_ptr = GEP(hPrivateData, {C(0), C(swr_draw_context_constantVS)});
+
+   consts_ptr->setName("vs_constants");
+   Value *const_sizes_ptr =
+      GEP(hPrivateData, {0, swr_draw_context_num_constantsVS});
+   const_sizes_ptr->setName("num_vs_constants");
+
+   Value *vtxInput = LOAD(pVsCtx, {0, SWR_VS_CONTEXT_pVin});
+
+   for (uint32_t attrib = 0; attrib < PIPE_MAX_SHADER_INPUTS; attrib++) {
+      const unsigned mask = swr_vs->info.base.input_usage_mask[attrib];
+      for (uint32_t channel = 0; channel < TGSI_NUM_CHANNELS; channel++) {
+         if (mask & (1 << channel)) {
+            inputs[attrib][channel] =
+               wrap(LOAD(vtxInput, {0, 0, attrib, channel}));
+         }
       }
    }
 
+   struct lp_build_sampler_soa *sampler =
+      swr_sampler_soa_create(key.sampler, PIPE_SHADER_VERTEX);
+
+   struct lp_bld_tgsi_system_values system_values;
+   memset(&system_values, 0, sizeof(system_values));
+   system_values.instance_id = wrap(LOAD(pVsCtx, {0, SWR_VS_CONTEXT_InstanceID}));
+   system_values.vertex_id = wrap(LOAD(pVsCtx, {0, SWR_VS_CONTEXT_VertexID}));
+
+   lp_build_tgsi_soa(gallivm,
+                     swr_vs->pipe.tokens,
+                     lp_type_float_vec(32, 32 * 8),
+                     NULL, // mask
+                     wrap(consts_ptr),
+                     wrap(const_sizes_ptr),
+                     &system_values,
+                     inputs,
+                     outputs,
+                     wrap(hPrivateData), // (sampler context)
+                     NULL, // thread data
+                     sampler, // sampler
+                     &swr_vs->info.base,
+                     NULL, // geometry shader face
+                     NULL, // compute shader face
+                     NULL); // tessellation shader face
+
+   sampler->destroy(sampler);
+
+   IRB()->SetInsertPoint(unwrap(LLVMGetInsertBlock(gallivm->builder)));
+
+   Value *vtxOutput = LOAD(pVsCtx, {0, SWR_VS_CONTEXT_pVout});
+
+   StoreVertexOutputs(ctx, &swr_vs->info.base, outputs, hPrivateData,
+                      [&](Value *val, unsigned slot, unsigned channel) {
+                         WriteVS(val, pVsCtx, vtxOutput, slot, channel);
+                      });
+
    RET_VOID();
 
    gallivm_verify_function(gallivm, wrap(pFunction));
@@ -920,7 +2348,15 @@ swr_compile_vs(struct swr_context *ctx, swr_jit_vs_key &key)
    BuilderSWR builder(
       reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
       "VS");
-   PFN_VERTEX_FUNC func = builder.CompileVS(ctx, key);
+   PFN_VERTEX_FUNC func;
+
+   if (builder.LookupCachedShader("VS", ctx->vs->sha1, &key, sizeof(key),
+                                  NULL, 0)) {
+      func = (PFN_VERTEX_FUNC)builder.JitCachedShader("VS");
+   } else {
+      func = builder.CompileVS(ctx, key);
+      builder.StoreCachedShader(NULL, 0);
+   }
 
    ctx->vs->map.insert(std::make_pair(key, make_unique<VariantVS>(builder.gallivm, func)));
    return func;
@@ -971,11 +2407,7 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
 {
    struct swr_fragment_shader *swr_fs = ctx->fs;
 
-   struct tgsi_shader_info *pPrevShader;
-   if (ctx->gs)
-      pPrevShader = &ctx->gs->info.base;
-   else
-      pPrevShader = &ctx->vs->info.base;
+   struct tgsi_shader_info *pPrevShader = swr_last_fe_info(ctx);
 
    LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
    LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
@@ -1274,7 +2706,9 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
                      NULL, // thread data
                      sampler, // sampler
                      &swr_fs->info.base,
-                     NULL); // geometry shader face
+                     NULL, // geometry shader face
+                     NULL, // compute shader face
+                     NULL); // tessellation shader face
 
    sampler->destroy(sampler);
 
@@ -1362,7 +2796,24 @@ swr_compile_fs(struct swr_context *ctx, swr_jit_fs_key &key)
    BuilderSWR builder(
       reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
       "FS");
-   PFN_PIXEL_KERNEL func = builder.CompileFS(ctx, key);
+   PFN_PIXEL_KERNEL func;
+
+   /* interpolation masks computed while building the shader */
+   uint32_t masks[3];
+
+   if (builder.LookupCachedShader("FS", ctx->fs->sha1, &key, sizeof(key),
+                                  masks, sizeof(masks))) {
+      func = (PFN_PIXEL_KERNEL)builder.JitCachedShader("FS");
+      ctx->fs->constantMask = masks[0];
+      ctx->fs->flatConstantMask = masks[1];
+      ctx->fs->pointSpriteMask = masks[2];
+   } else {
+      func = builder.CompileFS(ctx, key);
+      masks[0] = ctx->fs->constantMask;
+      masks[1] = ctx->fs->flatConstantMask;
+      masks[2] = ctx->fs->pointSpriteMask;
+      builder.StoreCachedShader(masks, sizeof(masks));
+   }
 
    ctx->fs->map.insert(std::make_pair(key, make_unique<VariantFS>(builder.gallivm, func)));
    return func;
@@ -26,9 +26,28 @@
 struct swr_vertex_shader;
 struct swr_fragment_shader;
 struct swr_geometry_shader;
+struct swr_tess_ctrl_shader;
+struct swr_tess_eval_shader;
+struct swr_compute_shader;
 struct swr_jit_fs_key;
 struct swr_jit_vs_key;
 struct swr_jit_gs_key;
+struct swr_jit_tcs_key;
+struct swr_jit_tes_key;
+struct swr_jit_cs_key;
+struct swr_draw_context;
+struct swr_cs_context;
+struct swr_tcs_context;
+
+/* JIT'ed compute shader, runs one SIMD chunk of a work group */
+typedef void(__cdecl *PFN_SWR_CS_FUNC)(struct swr_draw_context *pDC,
+                                       struct swr_cs_context *pCsCtx);
+
+/* JIT'ed tessellation control shader, runs one output control point of a
+ * SIMD of patches */
+typedef void(__cdecl *PFN_SWR_TCS_FUNC)(struct swr_draw_context *pDC,
+                                        SWR_HS_CONTEXT *pHsCtx,
+                                        struct swr_tcs_context *pTcsCtx);
 
 unsigned swr_so_adjust_attrib(unsigned in_attrib,
                               swr_vertex_shader *swr_vs);
@@ -42,6 +61,27 @@ swr_compile_fs(struct swr_context *ctx, swr_jit_fs_key &key);
 PFN_GS_FUNC
 swr_compile_gs(struct swr_context *ctx, swr_jit_gs_key &key);
 
+PFN_SWR_TCS_FUNC
+swr_compile_tcs(struct swr_context *ctx, swr_jit_tcs_key &key);
+
+PFN_DS_FUNC
+swr_compile_tes(struct swr_context *ctx, swr_jit_tes_key &key);
+
+PFN_SWR_CS_FUNC
+swr_compile_cs(struct swr_context *ctx, swr_jit_cs_key &key);
+
+void __cdecl
+swr_cs_run_group(HANDLE hPrivateData, SWR_CS_CONTEXT *pCsContext);
+
+void __cdecl
+swr_tcs_run(HANDLE hPrivateData, SWR_HS_CONTEXT *pHsContext);
+
+unsigned swr_hs_input_slot(ubyte name, ubyte index,
+                           struct tgsi_shader_info *vs_info);
+
+void swr_tess_patch_layout(const struct tgsi_shader_info *info,
+                           uint32_t offsets[PIPE_MAX_SHADER_OUTPUTS]);
+
 void swr_generate_fs_key(struct swr_jit_fs_key &key,
                          struct swr_context *ctx,
                          swr_fragment_shader *swr_fs);
@@ -57,6 +97,19 @@ void swr_generate_gs_key(struct swr_jit_gs_key &key,
                          struct swr_context *ctx,
                          swr_geometry_shader *swr_gs);
 
+void swr_generate_tcs_key(struct swr_jit_tcs_key &key,
+                          struct swr_context *ctx,
+                          swr_tess_ctrl_shader *swr_tcs);
+
+void swr_generate_tes_key(struct swr_jit_tes_key &key,
+                          struct swr_context *ctx,
+                          swr_tess_eval_shader *swr_tes);
+
+void swr_generate_cs_key(struct swr_jit_cs_key &key,
+                         struct swr_context *ctx,
+                         swr_compute_shader *swr_cs,
+                         const uint32_t block_size[3]);
+
 struct swr_jit_sampler_key {
    unsigned nr_samplers;
    unsigned nr_sampler_views;
@@ -85,6 +138,23 @@ struct swr_jit_gs_key : swr_jit_sampler_key {
    ubyte vs_output_semantic_idx[PIPE_MAX_SHADER_OUTPUTS];
 };
 
+struct swr_jit_tcs_key : swr_jit_sampler_key {
+   ubyte vs_output_semantic_name[PIPE_MAX_SHADER_OUTPUTS];
+   ubyte vs_output_semantic_idx[PIPE_MAX_SHADER_OUTPUTS];
+};
+
+struct swr_jit_tes_key : swr_jit_sampler_key {
+   /* outputs of the control shader, or of the vertex shader if there's no
+    * control shader */
+   ubyte tcs_output_semantic_name[PIPE_MAX_SHADER_OUTPUTS];
+   ubyte tcs_output_semantic_idx[PIPE_MAX_SHADER_OUTPUTS];
+   unsigned clip_plane_mask; // from rasterizer state & tes_info
+};
+
+struct swr_jit_cs_key : swr_jit_sampler_key {
+   uint32_t block_size[3]; // built into the local ids
+};
+
 namespace std
 {
 template <> struct hash<swr_jit_fs_key> {
@@ -114,9 +184,33 @@ template <> struct hash<swr_jit_gs_key> {
       return util_hash_crc32(&k, sizeof(k));
    }
 };
+
+template <> struct hash<swr_jit_tcs_key> {
+   std::size_t operator()(const swr_jit_tcs_key &k) const
+   {
+      return util_hash_crc32(&k, sizeof(k));
+   }
+};
+
+template <> struct hash<swr_jit_tes_key> {
+   std::size_t operator()(const swr_jit_tes_key &k) const
+   {
+      return util_hash_crc32(&k, sizeof(k));
+   }
+};
+
+template <> struct hash<swr_jit_cs_key> {
+   std::size_t operator()(const swr_jit_cs_key &k) const
+   {
+      return util_hash_crc32(&k, sizeof(k));
+   }
+};
 };
 
 bool operator==(const swr_jit_fs_key &lhs, const swr_jit_fs_key &rhs);
 bool operator==(const swr_jit_vs_key &lhs, const swr_jit_vs_key &rhs);
 bool operator==(const swr_jit_fetch_key &lhs, const swr_jit_fetch_key &rhs);
 bool operator==(const swr_jit_gs_key &lhs, const swr_jit_gs_key &rhs);
+bool operator==(const swr_jit_tcs_key &lhs, const swr_jit_tcs_key &rhs);
+bool operator==(const swr_jit_tes_key &lhs, const swr_jit_tes_key &rhs);
+bool operator==(const swr_jit_cs_key &lhs, const swr_jit_cs_key &rhs);
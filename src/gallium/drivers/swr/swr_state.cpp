@@ -42,6 +42,7 @@
 #include "util/u_framebuffer.h"
 #include "util/u_viewport.h"
 #include "util/u_prim.h"
+#include "util/mesa-sha1.h"
 
 #include "swr_state.h"
 #include "swr_context.h"
@@ -334,6 +335,9 @@ swr_create_vs_state(struct pipe_context *pipe,
    swr_vs->pipe.stream_output = vs->stream_output;
 
    lp_build_tgsi_info(vs->tokens, &swr_vs->info);
+   _mesa_sha1_compute(vs->tokens,
+                      tgsi_num_tokens(vs->tokens) * sizeof(struct tgsi_token),
+                      swr_vs->sha1);
 
    swr_vs->soState = {0};
 
@@ -393,6 +397,9 @@ swr_create_fs_state(struct pipe_context *pipe,
    swr_fs->pipe.tokens = tgsi_dup_tokens(fs->tokens);
 
    lp_build_tgsi_info(fs->tokens, &swr_fs->info);
+   _mesa_sha1_compute(fs->tokens,
+                      tgsi_num_tokens(fs->tokens) * sizeof(struct tgsi_token),
+                      swr_fs->sha1);
 
    return swr_fs;
 }
@@ -432,6 +439,9 @@ swr_create_gs_state(struct pipe_context *pipe,
    swr_gs->pipe.tokens = tgsi_dup_tokens(gs->tokens);
 
    lp_build_tgsi_info(gs->tokens, &swr_gs->info);
+   _mesa_sha1_compute(gs->tokens,
+                      tgsi_num_tokens(gs->tokens) * sizeof(struct tgsi_token),
+                      swr_gs->sha1);
 
    return swr_gs;
 }
@@ -460,6 +470,199 @@ swr_delete_gs_state(struct pipe_context *pipe, void *gs)
    swr_fence_work_delete_gs(screen->flush_fence, swr_gs);
 }
 
+static void *
+swr_create_tcs_state(struct pipe_context *pipe,
+                     const struct pipe_shader_state *tcs)
+{
+   struct swr_tess_ctrl_shader *swr_tcs = new swr_tess_ctrl_shader;
+   if (!swr_tcs)
+      return NULL;
+
+   swr_tcs->pipe.tokens = tgsi_dup_tokens(tcs->tokens);
+
+   lp_build_tgsi_info(tcs->tokens, &swr_tcs->info);
+
+   swr_tcs->has_barrier =
+      swr_tcs->info.base.opcode_count[TGSI_OPCODE_BARRIER] > 0;
+
+   return swr_tcs;
+}
+
+static void
+swr_bind_tcs_state(struct pipe_context *pipe, void *tcs)
+{
+   struct swr_context *ctx = swr_context(pipe);
+
+   if (ctx->tcs == tcs)
+      return;
+
+   ctx->tcs = (swr_tess_ctrl_shader *)tcs;
+   ctx->dirty |= SWR_NEW_TCS;
+}
+
+static void
+swr_delete_tcs_state(struct pipe_context *pipe, void *tcs)
+{
+   struct swr_tess_ctrl_shader *swr_tcs = (swr_tess_ctrl_shader *)tcs;
+   FREE((void *)swr_tcs->pipe.tokens);
+   struct swr_screen *screen = swr_screen(pipe->screen);
+
+   /* Defer deleton of tcs state */
+   swr_fence_work_delete_tcs(screen->flush_fence, swr_tcs);
+}
+
+static void *
+swr_create_tes_state(struct pipe_context *pipe,
+                     const struct pipe_shader_state *tes)
+{
+   struct swr_tess_eval_shader *swr_tes = new swr_tess_eval_shader;
+   if (!swr_tes)
+      return NULL;
+
+   swr_tes->pipe.tokens = tgsi_dup_tokens(tes->tokens);
+
+   lp_build_tgsi_info(tes->tokens, &swr_tes->info);
+
+   const struct tgsi_shader_info *info = &swr_tes->info.base;
+   SWR_TS_STATE *tsState = &swr_tes->tsState;
+
+   memset(tsState, 0, sizeof(*tsState));
+   tsState->tsEnable = true;
+
+   switch (info->properties[TGSI_PROPERTY_TES_PRIM_MODE]) {
+   case PIPE_PRIM_TRIANGLES:
+      tsState->domain = SWR_TS_TRI;
+      break;
+   case PIPE_PRIM_QUADS:
+      tsState->domain = SWR_TS_QUAD;
+      break;
+   default:
+      tsState->domain = SWR_TS_ISOLINE;
+      break;
+   }
+
+   switch (info->properties[TGSI_PROPERTY_TES_SPACING]) {
+   case PIPE_TESS_SPACING_FRACTIONAL_ODD:
+      tsState->partitioning = SWR_TS_ODD_FRACTIONAL;
+      break;
+   case PIPE_TESS_SPACING_FRACTIONAL_EVEN:
+      tsState->partitioning = SWR_TS_EVEN_FRACTIONAL;
+      break;
+   default:
+      tsState->partitioning = SWR_TS_INTEGER;
+      break;
+   }
+
+   if (info->properties[TGSI_PROPERTY_TES_POINT_MODE]) {
+      tsState->tsOutputTopology = SWR_TS_OUTPUT_POINT;
+      tsState->postDSTopology = TOP_POINT_LIST;
+   } else if (tsState->domain == SWR_TS_ISOLINE) {
+      tsState->tsOutputTopology = SWR_TS_OUTPUT_LINE;
+      tsState->postDSTopology = TOP_LINE_LIST;
+   } else {
+      /* The SWR tessellator domain is mirrored compared to GL's, which
+       * flips the winding of the triangles */
+      tsState->tsOutputTopology =
+         info->properties[TGSI_PROPERTY_TES_VERTEX_ORDER_CW] ?
+         SWR_TS_OUTPUT_TRI_CCW : SWR_TS_OUTPUT_TRI_CW;
+      tsState->postDSTopology = TOP_TRIANGLE_LIST;
+   }
+
+   /* whole ScalarCPoints are read by the TES */
+   tsState->numHsOutputAttribs = SWR_VTX_NUM_SLOTS;
+
+   return swr_tes;
+}
+
+static void
+swr_bind_tes_state(struct pipe_context *pipe, void *tes)
+{
+   struct swr_context *ctx = swr_context(pipe);
+
+   if (ctx->tes == tes)
+      return;
+
+   ctx->tes = (swr_tess_eval_shader *)tes;
+   ctx->dirty |= SWR_NEW_TES;
+}
+
+static void
+swr_delete_tes_state(struct pipe_context *pipe, void *tes)
+{
+   struct swr_tess_eval_shader *swr_tes = (swr_tess_eval_shader *)tes;
+   FREE((void *)swr_tes->pipe.tokens);
+   struct swr_screen *screen = swr_screen(pipe->screen);
+
+   /* Defer deleton of tes state */
+   swr_fence_work_delete_tes(screen->flush_fence, swr_tes);
+}
+
+static void
+swr_set_tess_state(struct pipe_context *pipe,
+                   const float default_outer_level[4],
+                   const float default_inner_level[2])
+{
+   struct swr_context *ctx = swr_context(pipe);
+
+   /* No dirty bit: swr_update_derived() copies these to the hull stage
+    * description of every draw */
+   memcpy(ctx->default_tess_outer, default_outer_level,
+          sizeof(ctx->default_tess_outer));
+   memcpy(ctx->default_tess_inner, default_inner_level,
+          sizeof(ctx->default_tess_inner));
+}
+
+static void *
+swr_create_compute_state(struct pipe_context *pipe,
+                         const struct pipe_compute_state *cs)
+{
+   if (cs->ir_type != PIPE_SHADER_IR_TGSI)
+      return NULL;
+
+   /* Shared memory can't be larger than the core's scratch */
+   if (cs->req_local_mem > SWR_MAX_SHARED_MEM_SIZE)
+      return NULL;
+
+   struct swr_compute_shader *swr_cs = new swr_compute_shader;
+   if (!swr_cs)
+      return NULL;
+
+   swr_cs->pipe = *cs;
+   swr_cs->pipe.prog = tgsi_dup_tokens((const struct tgsi_token *)cs->prog);
+
+   lp_build_tgsi_info((const struct tgsi_token *)cs->prog, &swr_cs->info);
+
+   const struct tgsi_shader_info *info = &swr_cs->info.base;
+   swr_cs->block_size[0] =
+      info->properties[TGSI_PROPERTY_CS_FIXED_BLOCK_WIDTH];
+   swr_cs->block_size[1] =
+      info->properties[TGSI_PROPERTY_CS_FIXED_BLOCK_HEIGHT];
+   swr_cs->block_size[2] =
+      info->properties[TGSI_PROPERTY_CS_FIXED_BLOCK_DEPTH];
+   swr_cs->has_barrier = info->opcode_count[TGSI_OPCODE_BARRIER] > 0;
+
+   return swr_cs;
+}
+
+static void
+swr_bind_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct swr_context *ctx = swr_context(pipe);
+
+   ctx->cs = (swr_compute_shader *)cs;
+}
+
+static void
+swr_delete_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct swr_compute_shader *swr_cs = (swr_compute_shader *)cs;
+   FREE((void *)swr_cs->pipe.prog);
+   struct swr_screen *screen = swr_screen(pipe->screen);
+
+   /* Defer deleton of cs state */
+   swr_fence_work_delete_cs(screen->flush_fence, swr_cs);
+}
+
 static void
 swr_set_constant_buffer(struct pipe_context *pipe,
                         enum pipe_shader_type shader,
@@ -481,6 +684,10 @@ swr_set_constant_buffer(struct pipe_context *pipe,
       ctx->dirty |= SWR_NEW_FSCONSTANTS;
    } else if (shader == PIPE_SHADER_GEOMETRY) {
       ctx->dirty |= SWR_NEW_GSCONSTANTS;
+   } else if (shader == PIPE_SHADER_TESS_CTRL) {
+      ctx->dirty |= SWR_NEW_TCSCONSTANTS;
+   } else if (shader == PIPE_SHADER_TESS_EVAL) {
+      ctx->dirty |= SWR_NEW_TESCONSTANTS;
    }
 
    if (cb && cb->user_buffer) {
@@ -488,6 +695,32 @@ swr_set_constant_buffer(struct pipe_context *pipe,
    }
 }
 
+static void
+swr_set_shader_buffers(struct pipe_context *pipe,
+                       enum pipe_shader_type shader,
+                       unsigned start_slot, unsigned count,
+                       const struct pipe_shader_buffer *buffers)
+{
+   struct swr_context *ctx = swr_context(pipe);
+
+   assert(shader < PIPE_SHADER_TYPES);
+   assert(start_slot + count <= ARRAY_SIZE(ctx->ssbos[shader]));
+
+   for (unsigned i = 0; i < count; i++) {
+      struct pipe_shader_buffer *dst = &ctx->ssbos[shader][start_slot + i];
+
+      if (buffers) {
+         pipe_resource_reference(&dst->buffer, buffers[i].buffer);
+         dst->buffer_offset = buffers[i].buffer_offset;
+         dst->buffer_size = buffers[i].buffer_size;
+      } else {
+         pipe_resource_reference(&dst->buffer, NULL);
+         dst->buffer_offset = 0;
+         dst->buffer_size = 0;
+      }
+   }
+}
+
 
 static void *
 swr_create_vertex_elements_state(struct pipe_context *pipe,
@@ -752,7 +985,8 @@ swr_update_resource_status(struct pipe_context *pipe,
    }
 
    /* texture sampler views */
-   for (uint32_t j : {PIPE_SHADER_VERTEX, PIPE_SHADER_FRAGMENT}) {
+   for (uint32_t j : {PIPE_SHADER_VERTEX, PIPE_SHADER_TESS_CTRL,
+                      PIPE_SHADER_TESS_EVAL, PIPE_SHADER_FRAGMENT}) {
       for (uint32_t i = 0; i < ctx->num_sampler_views[j]; i++) {
          struct pipe_sampler_view *view = ctx->sampler_views[j][i];
          if (view)
@@ -761,7 +995,8 @@ swr_update_resource_status(struct pipe_context *pipe,
    }
 
    /* constant buffers */
-   for (uint32_t j : {PIPE_SHADER_VERTEX, PIPE_SHADER_FRAGMENT}) {
+   for (uint32_t j : {PIPE_SHADER_VERTEX, PIPE_SHADER_TESS_CTRL,
+                      PIPE_SHADER_TESS_EVAL, PIPE_SHADER_FRAGMENT}) {
       for (uint32_t i = 0; i < PIPE_MAX_CONSTANT_BUFFERS; i++) {
          struct pipe_constant_buffer *cb = &ctx->constants[j][i];
          if (cb->buffer)
@@ -868,6 +1103,21 @@ swr_update_constants(struct swr_context *ctx, enum pipe_shader_type shaderType)
       num_constants = pDC->num_constantsGS;
       scratch = &ctx->scratch->gs_constants;
       break;
+   case PIPE_SHADER_COMPUTE:
+      constant = pDC->constantCS;
+      num_constants = pDC->num_constantsCS;
+      scratch = &ctx->scratch->cs_constants;
+      break;
+   case PIPE_SHADER_TESS_CTRL:
+      constant = pDC->constantTCS;
+      num_constants = pDC->num_constantsTCS;
+      scratch = &ctx->scratch->tcs_constants;
+      break;
+   case PIPE_SHADER_TESS_EVAL:
+      constant = pDC->constantTES;
+      num_constants = pDC->num_constantsTES;
+      scratch = &ctx->scratch->tes_constants;
+      break;
    default:
       debug_printf("Unsupported shader type constants\n");
       return;
@@ -1077,6 +1327,7 @@ swr_update_derived(struct pipe_context *pipe,
    /* Raster state */
    if (ctx->dirty & (SWR_NEW_RASTERIZER |
                      SWR_NEW_VS | // clipping
+                     SWR_NEW_TES |
                      SWR_NEW_FRAMEBUFFER)) {
       pipe_rasterizer_state *rasterizer = ctx->rasterizer;
       pipe_framebuffer_state *fb = &ctx->framebuffer;
@@ -1158,13 +1409,15 @@ swr_update_derived(struct pipe_context *pipe,
       rastState->depthClipEnable = rasterizer->depth_clip;
       rastState->clipHalfZ = rasterizer->clip_halfz;
 
+      struct tgsi_shader_info *pPreGS = swr_pre_gs_info(ctx);
+
       rastState->clipDistanceMask =
-         ctx->vs->info.base.num_written_clipdistance ?
-         ctx->vs->info.base.clipdist_writemask & rasterizer->clip_plane_enable :
+         pPreGS->num_written_clipdistance ?
+         pPreGS->clipdist_writemask & rasterizer->clip_plane_enable :
          rasterizer->clip_plane_enable;
 
       rastState->cullDistanceMask =
-         ctx->vs->info.base.culldist_writemask << ctx->vs->info.base.num_written_clipdistance;
+         pPreGS->culldist_writemask << pPreGS->num_written_clipdistance;
 
       ctx->api.pfnSwrSetRastState(ctx->swrContext, rastState);
    }
@@ -1353,6 +1606,7 @@ swr_update_derived(struct pipe_context *pipe,
    /* GeometryShader */
    if (ctx->dirty & (SWR_NEW_GS |
                      SWR_NEW_VS |
+                     SWR_NEW_TES |
                      SWR_NEW_SAMPLER |
                      SWR_NEW_SAMPLER_VIEW)) {
       if (ctx->gs) {
@@ -1425,6 +1679,119 @@ swr_update_derived(struct pipe_context *pipe,
       }
    }
 
+   /* Tessellation shaders */
+   if (ctx->dirty & (SWR_NEW_TCS |
+                     SWR_NEW_TES |
+                     SWR_NEW_VS |
+                     SWR_NEW_RASTERIZER | // for clip planes
+                     SWR_NEW_SAMPLER |
+                     SWR_NEW_SAMPLER_VIEW |
+                     SWR_NEW_FRAMEBUFFER)) {
+      ctx->derived.tcsFunc = NULL;
+
+      if (ctx->tes) {
+         swr_jit_tes_key key;
+         swr_generate_tes_key(key, ctx, ctx->tes);
+         auto search = ctx->tes->map.find(key);
+         PFN_DS_FUNC func;
+         if (search != ctx->tes->map.end()) {
+            func = search->second->shader;
+         } else {
+            func = swr_compile_tes(ctx, key);
+         }
+         ctx->api.pfnSwrSetHsFunc(ctx->swrContext, swr_tcs_run);
+         ctx->api.pfnSwrSetDsFunc(ctx->swrContext, func);
+
+         /* JIT sampler state */
+         if (ctx->dirty & SWR_NEW_SAMPLER) {
+            swr_update_sampler_state(ctx,
+                                     PIPE_SHADER_TESS_EVAL,
+                                     key.nr_samplers,
+                                     ctx->swrDC.samplersTES);
+         }
+
+         /* JIT sampler view state */
+         if (ctx->dirty & (SWR_NEW_SAMPLER_VIEW | SWR_NEW_FRAMEBUFFER)) {
+            swr_update_texture_state(ctx,
+                                     PIPE_SHADER_TESS_EVAL,
+                                     key.nr_sampler_views,
+                                     ctx->swrDC.texturesTES);
+         }
+
+         if (ctx->tcs) {
+            swr_jit_tcs_key tcs_key;
+            swr_generate_tcs_key(tcs_key, ctx, ctx->tcs);
+            auto tcs_search = ctx->tcs->map.find(tcs_key);
+            if (tcs_search != ctx->tcs->map.end()) {
+               ctx->derived.tcsFunc = tcs_search->second->shader;
+            } else {
+               ctx->derived.tcsFunc = swr_compile_tcs(ctx, tcs_key);
+            }
+
+            /* JIT sampler state */
+            if (ctx->dirty & SWR_NEW_SAMPLER) {
+               swr_update_sampler_state(ctx,
+                                        PIPE_SHADER_TESS_CTRL,
+                                        tcs_key.nr_samplers,
+                                        ctx->swrDC.samplersTCS);
+            }
+
+            /* JIT sampler view state */
+            if (ctx->dirty & (SWR_NEW_SAMPLER_VIEW | SWR_NEW_FRAMEBUFFER)) {
+               swr_update_texture_state(ctx,
+                                        PIPE_SHADER_TESS_CTRL,
+                                        tcs_key.nr_sampler_views,
+                                        ctx->swrDC.texturesTCS);
+            }
+         }
+      } else {
+         ctx->api.pfnSwrSetHsFunc(ctx->swrContext, NULL);
+         ctx->api.pfnSwrSetDsFunc(ctx->swrContext, NULL);
+      }
+   }
+
+   /* The hull stage description depends on the patch size of the draw, it
+    * lives as long as the draw */
+   if (ctx->tes && p_draw_info) {
+      swr_tcs_dispatch *dispatch = (swr_tcs_dispatch *)
+         ctx->api.pfnSwrAllocDrawContextMemory(ctx->swrContext,
+                                               sizeof(swr_tcs_dispatch),
+                                               sizeof(void *));
+      dispatch->pfnTcsFunc = ctx->derived.tcsFunc;
+      dispatch->vertices_in = p_draw_info->vertices_per_patch;
+      dispatch->vertices_out = ctx->tcs ?
+         ctx->tcs->info.base.properties[TGSI_PROPERTY_TCS_VERTICES_OUT] :
+         p_draw_info->vertices_per_patch;
+      dispatch->has_barrier = ctx->tcs && ctx->tcs->has_barrier;
+      dispatch->swap_line_factors = ctx->tes->tsState.domain == SWR_TS_ISOLINE;
+      memcpy(dispatch->tess_outer, ctx->default_tess_outer,
+             sizeof(dispatch->tess_outer));
+      memcpy(dispatch->tess_inner, ctx->default_tess_inner,
+             sizeof(dispatch->tess_inner));
+
+      /* Without a TCS, every VS output is copied to the patch */
+      dispatch->num_copies = 0;
+      if (!ctx->tcs) {
+         struct tgsi_shader_info *vs_info = &ctx->vs->info.base;
+         uint32_t patch_layout[PIPE_MAX_SHADER_OUTPUTS];
+
+         swr_tess_patch_layout(vs_info, patch_layout);
+         for (unsigned i = 0; i < vs_info->num_outputs; i++) {
+            swr_tcs_copy *copy = &dispatch->copies[dispatch->num_copies++];
+            copy->src_slot =
+               swr_hs_input_slot(vs_info->output_semantic_name[i],
+                                 vs_info->output_semantic_index[i],
+                                 vs_info);
+            copy->dst_offset = patch_layout[i];
+            copy->point_size =
+               vs_info->output_semantic_name[i] == TGSI_SEMANTIC_PSIZE;
+         }
+      }
+
+      ctx->swrDC.pTcsDispatch = dispatch;
+      ctx->swrDC.tesVerticesIn = dispatch->vertices_out;
+   }
+
    /* work around the fact that poly stipple also affects lines */
    /* and points, since we rasterize them as triangles, too */
    /* Has to be before fragment shader, since it sets SWR_NEW_FS */
@@ -1442,6 +1809,7 @@ swr_update_derived(struct pipe_context *pipe,
    if (ctx->dirty & (SWR_NEW_FS |
                      SWR_NEW_VS |
                      SWR_NEW_GS |
+                     SWR_NEW_TES |
                      SWR_NEW_RASTERIZER |
                      SWR_NEW_SAMPLER |
                      SWR_NEW_SAMPLER_VIEW |
@@ -1532,6 +1900,16 @@ swr_update_derived(struct pipe_context *pipe,
       swr_update_constants(ctx, PIPE_SHADER_GEOMETRY);
    }
 
+   /* Tessellation Control Shader Constants */
+   if (ctx->dirty & SWR_NEW_TCSCONSTANTS) {
+      swr_update_constants(ctx, PIPE_SHADER_TESS_CTRL);
+   }
+
+   /* Tessellation Evaluation Shader Constants */
+   if (ctx->dirty & SWR_NEW_TESCONSTANTS) {
+      swr_update_constants(ctx, PIPE_SHADER_TESS_EVAL);
+   }
+
    /* Depth/stencil state */
    if (ctx->dirty & (SWR_NEW_DEPTH_STENCIL_ALPHA | SWR_NEW_FRAMEBUFFER)) {
       struct pipe_depth_state *depth = &(ctx->depth_stencil->depth);
@@ -1718,10 +2096,11 @@ swr_update_derived(struct pipe_context *pipe,
       }
    }
 
-   if (ctx->dirty & (SWR_NEW_CLIP | SWR_NEW_RASTERIZER | SWR_NEW_VS)) {
+   if (ctx->dirty & (SWR_NEW_CLIP | SWR_NEW_RASTERIZER | SWR_NEW_VS |
+                     SWR_NEW_TES)) {
       // shader exporting clip distances overrides all user clip planes
       if (ctx->rasterizer->clip_plane_enable &&
-          !ctx->vs->info.base.num_written_clipdistance)
+          !swr_pre_gs_info(ctx)->num_written_clipdistance)
       {
          swr_draw_context *pDC = &ctx->swrDC;
          memcpy(pDC->userClipPlanes,
@@ -1732,19 +2111,20 @@ swr_update_derived(struct pipe_context *pipe,
 
    // set up backend state
    SWR_BACKEND_STATE backendState = {0};
+   struct tgsi_shader_info *pPreGS = swr_pre_gs_info(ctx);
    if (ctx->gs) {
       backendState.numAttributes = ctx->gs->info.base.num_outputs - 1;
    } else {
-      backendState.numAttributes = ctx->vs->info.base.num_outputs - 1;
+      backendState.numAttributes = pPreGS->num_outputs - 1;
       if (ctx->fs->info.base.uses_primid) {
          backendState.numAttributes++;
          backendState.swizzleEnable = true;
          for (unsigned i = 0; i < sizeof(backendState.numComponents); i++) {
             backendState.swizzleMap[i].sourceAttrib = i;
          }
-         backendState.swizzleMap[ctx->vs->info.base.num_outputs - 1].constantSource =
+         backendState.swizzleMap[pPreGS->num_outputs - 1].constantSource =
             SWR_CONSTANT_SOURCE_PRIM_ID;
-         backendState.swizzleMap[ctx->vs->info.base.num_outputs - 1].componentOverrideMask = 1;
+         backendState.swizzleMap[pPreGS->num_outputs - 1].componentOverrideMask = 1;
       }
    }
    if (ctx->rasterizer->sprite_coord_enable)
@@ -1758,10 +2138,7 @@ swr_update_derived(struct pipe_context *pipe,
       (ctx->rasterizer->flatshade ? ctx->fs->flatConstantMask : 0);
    backendState.pointSpriteTexCoordMask = ctx->fs->pointSpriteMask;
 
-   struct tgsi_shader_info *pLastFE =
-      ctx->gs ?
-      &ctx->gs->info.base :
-      &ctx->vs->info.base;
+   struct tgsi_shader_info *pLastFE = swr_last_fe_info(ctx);
    backendState.readRenderTargetArrayIndex = pLastFE->writes_layer;
    backendState.readViewportArrayIndex = pLastFE->writes_viewport_index;
    backendState.vertexAttribOffset = VERTEX_ATTRIB_START_SLOT; // TODO: optimize
@@ -1779,6 +2156,76 @@ swr_update_derived(struct pipe_context *pipe,
 }
 
 
+/*
+ * Compute state isn't dirty tracked: it's validated on every launch_grid,
+ * since draws reset ctx->dirty.
+ */
+void
+swr_update_compute_state(struct pipe_context *pipe,
+                         const uint32_t block_size[3])
+{
+   struct swr_context *ctx = swr_context(pipe);
+   struct swr_compute_shader *cs = ctx->cs;
+
+   swr_jit_cs_key key;
+   swr_generate_cs_key(key, ctx, cs, block_size);
+   auto search = cs->map.find(key);
+   PFN_SWR_CS_FUNC func;
+   if (search != cs->map.end()) {
+      func = search->second->shader;
+   } else {
+      func = swr_compile_cs(ctx, key);
+   }
+
+   swr_update_sampler_state(ctx,
+                            PIPE_SHADER_COMPUTE,
+                            key.nr_samplers,
+                            ctx->swrDC.samplersCS);
+   swr_update_texture_state(ctx,
+                            PIPE_SHADER_COMPUTE,
+                            key.nr_sampler_views,
+                            ctx->swrDC.texturesCS);
+   swr_update_constants(ctx, PIPE_SHADER_COMPUTE);
+
+   for (unsigned i = 0; i < PIPE_MAX_SHADER_BUFFERS; i++) {
+      struct pipe_shader_buffer *sb = &ctx->ssbos[PIPE_SHADER_COMPUTE][i];
+      if (sb->buffer) {
+         ctx->swrDC.ssboCS[i] =
+            swr_resource_data(sb->buffer) + sb->buffer_offset;
+         ctx->swrDC.ssbo_sizesCS[i] = sb->buffer_size;
+         swr_resource_write(sb->buffer);
+      } else {
+         ctx->swrDC.ssboCS[i] = NULL;
+         ctx->swrDC.ssbo_sizesCS[i] = 0;
+      }
+   }
+
+   for (unsigned i = 0; i < ctx->num_sampler_views[PIPE_SHADER_COMPUTE]; i++) {
+      struct pipe_sampler_view *view =
+         ctx->sampler_views[PIPE_SHADER_COMPUTE][i];
+      if (view)
+         swr_resource_read(view->texture);
+   }
+   for (unsigned i = 0; i < PIPE_MAX_CONSTANT_BUFFERS; i++) {
+      struct pipe_constant_buffer *cb = &ctx->constants[PIPE_SHADER_COMPUTE][i];
+      if (cb->buffer)
+         swr_resource_read(cb->buffer);
+   }
+
+   /* The dispatch description lives as long as the dispatch */
+   swr_cs_dispatch *dispatch = (swr_cs_dispatch *)
+      ctx->api.pfnSwrAllocDrawContextMemory(ctx->swrContext,
+                                            sizeof(swr_cs_dispatch),
+                                            sizeof(void *));
+   dispatch->pfnCsFunc = func;
+   dispatch->block_size[0] = block_size[0];
+   dispatch->block_size[1] = block_size[1];
+   dispatch->block_size[2] = block_size[2];
+   dispatch->has_barrier = cs->has_barrier;
+   ctx->swrDC.pCsDispatch = dispatch;
+}
+
+
 static struct pipe_stream_output_target *
 swr_create_so_target(struct pipe_context *pipe,
                      struct pipe_resource *buffer,
@@ -1870,7 +2317,22 @@ swr_state_init(struct pipe_context *pipe)
    pipe->bind_gs_state = swr_bind_gs_state;
    pipe->delete_gs_state = swr_delete_gs_state;
 
+   pipe->create_tcs_state = swr_create_tcs_state;
+   pipe->bind_tcs_state = swr_bind_tcs_state;
+   pipe->delete_tcs_state = swr_delete_tcs_state;
+
+   pipe->create_tes_state = swr_create_tes_state;
+   pipe->bind_tes_state = swr_bind_tes_state;
+   pipe->delete_tes_state = swr_delete_tes_state;
+
+   pipe->set_tess_state = swr_set_tess_state;
+
+   pipe->create_compute_state = swr_create_compute_state;
+   pipe->bind_compute_state = swr_bind_compute_state;
+   pipe->delete_compute_state = swr_delete_compute_state;
+
    pipe->set_constant_buffer = swr_set_constant_buffer;
+   pipe->set_shader_buffers = swr_set_shader_buffers;
 
    pipe->create_vertex_elements_state = swr_create_vertex_elements_state;
    pipe->bind_vertex_elements_state = swr_bind_vertex_elements_state;
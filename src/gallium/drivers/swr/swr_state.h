@@ -49,11 +49,15 @@ struct ShaderVariant {
 typedef ShaderVariant<PFN_VERTEX_FUNC> VariantVS;
 typedef ShaderVariant<PFN_PIXEL_KERNEL> VariantFS;
 typedef ShaderVariant<PFN_GS_FUNC> VariantGS;
+typedef ShaderVariant<PFN_SWR_TCS_FUNC> VariantTCS;
+typedef ShaderVariant<PFN_DS_FUNC> VariantTES;
+typedef ShaderVariant<PFN_SWR_CS_FUNC> VariantCS;
 
 /* skeleton */
 struct swr_vertex_shader {
    struct pipe_shader_state pipe;
    struct lp_tgsi_info info;
+   unsigned char sha1[20]; /* of the tokens, for the JIT object cache */
    std::unordered_map<swr_jit_vs_key, std::unique_ptr<VariantVS>> map;
    SWR_STREAMOUT_STATE soState;
    PFN_SO_FUNC soFunc[PIPE_PRIM_MAX] {0};
@@ -62,6 +66,7 @@ struct swr_vertex_shader {
 struct swr_fragment_shader {
    struct pipe_shader_state pipe;
    struct lp_tgsi_info info;
+   unsigned char sha1[20]; /* of the tokens, for the JIT object cache */
    uint32_t constantMask;
    uint32_t flatConstantMask;
    uint32_t pointSpriteMask;
@@ -71,11 +76,67 @@ struct swr_fragment_shader {
 struct swr_geometry_shader {
    struct pipe_shader_state pipe;
    struct lp_tgsi_info info;
+   unsigned char sha1[20]; /* of the tokens, for the JIT object cache */
    SWR_GS_STATE gsState;
 
    std::unordered_map<swr_jit_gs_key, std::unique_ptr<VariantGS>> map;
 };
 
+struct swr_tess_ctrl_shader {
+   struct pipe_shader_state pipe;
+   struct lp_tgsi_info info;
+   bool has_barrier;
+
+   std::unordered_map<swr_jit_tcs_key, std::unique_ptr<VariantTCS>> map;
+};
+
+struct swr_tess_eval_shader {
+   struct pipe_shader_state pipe;
+   struct lp_tgsi_info info;
+   SWR_TS_STATE tsState;
+
+   std::unordered_map<swr_jit_tes_key, std::unique_ptr<VariantTES>> map;
+};
+
+struct swr_compute_shader {
+   struct pipe_compute_state pipe;
+   struct lp_tgsi_info info;
+   uint32_t block_size[3];
+   bool has_barrier;
+
+   std::unordered_map<swr_jit_cs_key, std::unique_ptr<VariantCS>> map;
+};
+
+/* Compute state of one dispatch, read by swr_cs_run_group() */
+struct swr_cs_dispatch {
+   PFN_SWR_CS_FUNC pfnCsFunc;
+   uint32_t block_size[3];
+   bool has_barrier;
+};
+
+/* Copy of a vertex shader output into the patch, when there's no control
+ * shader */
+struct swr_tcs_copy {
+   uint32_t src_slot; // attribute of SWR_HS_CONTEXT::vert
+   uint32_t dst_offset; // in ScalarPatch::cp[]
+   bool point_size; // only copy the point size component of the SGV slot
+};
+
+/* Hull stage state of one draw, read by swr_tcs_run() */
+struct swr_tcs_dispatch {
+   PFN_SWR_TCS_FUNC pfnTcsFunc; // NULL passes the input patch through
+   uint32_t vertices_in;
+   uint32_t vertices_out;
+   bool has_barrier;
+   bool swap_line_factors;
+
+   float tess_outer[4];
+   float tess_inner[2];
+
+   uint32_t num_copies;
+   swr_tcs_copy copies[PIPE_MAX_SHADER_OUTPUTS];
+};
+
 /* Vertex element state */
 struct swr_vertex_element_state {
    FETCH_COMPILE_STATE fsState;
@@ -105,11 +166,15 @@ struct swr_derived_state {
    SWR_RASTSTATE rastState;
    SWR_VIEWPORT vp;
    SWR_VIEWPORT_MATRICES vpm;
+   PFN_SWR_TCS_FUNC tcsFunc; // variant of the bound TCS, if any
 };
 
 void swr_update_derived(struct pipe_context *,
                         const struct pipe_draw_info * = nullptr);
 
+void swr_update_compute_state(struct pipe_context *,
+                              const uint32_t block_size[3]);
+
 /*
  * Conversion functions: Convert mesa state defines to SWR.
  */
@@ -340,7 +405,8 @@ swr_convert_target_type(const enum pipe_texture_target target)
  * Convert mesa PIPE_PRIM_X to SWR enum PRIMITIVE_TOPOLOGY
  */
 static INLINE enum PRIMITIVE_TOPOLOGY
-swr_convert_prim_topology(const unsigned mode)
+swr_convert_prim_topology(const unsigned mode,
+                          const unsigned patch_vertices = 0)
 {
    switch (mode) {
    case PIPE_PRIM_POINTS:
@@ -371,6 +437,9 @@ swr_convert_prim_topology(const unsigned mode)
       return TOP_TRI_LIST_ADJ;
    case PIPE_PRIM_TRIANGLE_STRIP_ADJACENCY:
       return TOP_TRI_STRIP_ADJ;
+   case PIPE_PRIM_PATCHES:
+      assert(patch_vertices >= 1 && patch_vertices <= MAX_NUM_VERTS_PER_PRIM);
+      return (PRIMITIVE_TOPOLOGY)(TOP_PATCHLIST_BASE + patch_vertices);
    default:
       assert(0 && "Unknown topology");
       return TOP_UNKNOWN;
@@ -1531,31 +1531,62 @@ emit_coord_end(struct vc4_compile *c)
                 emit_point_size_write(c);
 }
 
+static bool
+vc4_nir_opt_peephole_select(nir_shader *s, const void *data)
+{
+        const unsigned *limit = data;
+
+        return nir_opt_peephole_select(s, *limit);
+}
+
+static bool
+vc4_nir_opt_loop_unroll(nir_shader *s, const void *data)
+{
+        const nir_variable_mode *indirect_mask = data;
+
+        return nir_opt_loop_unroll(s, *indirect_mask);
+}
+
 static void
 vc4_optimize_nir(struct nir_shader *s)
 {
-        bool progress;
-
-        do {
-                progress = false;
-
-                NIR_PASS_V(s, nir_lower_vars_to_ssa);
-                NIR_PASS(progress, s, nir_lower_alu_to_scalar);
-                NIR_PASS(progress, s, nir_lower_phis_to_scalar);
-                NIR_PASS(progress, s, nir_copy_prop);
-                NIR_PASS(progress, s, nir_opt_remove_phis);
-                NIR_PASS(progress, s, nir_opt_dce);
-                NIR_PASS(progress, s, nir_opt_dead_cf);
-                NIR_PASS(progress, s, nir_opt_cse);
-                NIR_PASS(progress, s, nir_opt_peephole_select, 8);
-                NIR_PASS(progress, s, nir_opt_algebraic);
-                NIR_PASS(progress, s, nir_opt_constant_folding);
-                NIR_PASS(progress, s, nir_opt_undef);
-                NIR_PASS(progress, s, nir_opt_loop_unroll,
-                         nir_var_shader_in |
-                         nir_var_shader_out |
-                         nir_var_local);
-        } while (progress);
+        const unsigned peephole_select_limit = 8;
+        const nir_variable_mode loop_unroll_indirect_mask =
+                nir_var_shader_in |
+                nir_var_shader_out |
+                nir_var_local;
+        nir_opt_scheduler *sched = nir_opt_scheduler_create(NULL);
+
+#define SHADER_PASS(pass) \
+        nir_opt_scheduler_add_shader_pass(sched, #pass, pass)
+#define SHADER_PASS_WITH_DATA(pass, data) \
+        nir_opt_scheduler_add_shader_pass_with_data(sched, #pass, pass, data)
+#define BLOCK_PASS(pass) \
+        nir_opt_scheduler_add_block_pass(sched, #pass, pass##_block)
+
+        SHADER_PASS(nir_lower_vars_to_ssa);
+        SHADER_PASS(nir_lower_alu_to_scalar);
+        SHADER_PASS(nir_lower_phis_to_scalar);
+        BLOCK_PASS(nir_copy_prop);
+        SHADER_PASS(nir_opt_remove_phis);
+        SHADER_PASS(nir_opt_dce);
+        SHADER_PASS(nir_opt_dead_cf);
+        SHADER_PASS(nir_opt_cse);
+        SHADER_PASS_WITH_DATA(vc4_nir_opt_peephole_select,
+                              &peephole_select_limit);
+        BLOCK_PASS(nir_opt_algebraic);
+        BLOCK_PASS(nir_opt_constant_folding);
+        SHADER_PASS(nir_opt_undef);
+        SHADER_PASS_WITH_DATA(vc4_nir_opt_loop_unroll,
+                              &loop_unroll_indirect_mask);
+
+#undef SHADER_PASS
+#undef SHADER_PASS_WITH_DATA
+#undef BLOCK_PASS
+
+        nir_opt_scheduler_run(sched, s);
+
+        ralloc_free(sched);
 }
 
 static int
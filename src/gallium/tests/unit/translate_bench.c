@@ -0,0 +1,214 @@
+/**************************************************************************
+ *
+ * Copyright 2017 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Measures the throughput of the translate backends on a few common vertex
+ * layouts, both with linear and indexed runs.
+ *
+ * Usage: ./translate_bench [generic|x86|gallivm]...
+ */
+
+#include <stdio.h>
+#include "translate/translate.h"
+#include "util/u_memory.h"
+#include "util/u_format.h"
+#include "util/u_cpu_detect.h"
+#include "os/os_time.h"
+
+#define NUM_VERTICES 4096
+#define MAX_VERTEX_SIZE 64
+#define RUN_TIME_NS 200000000
+
+struct bench_attrib {
+   enum pipe_format input_format;
+   enum pipe_format output_format;
+};
+
+struct bench_layout {
+   const char *name;
+   unsigned nr_attribs;
+   struct bench_attrib attribs[4];
+};
+
+static const struct bench_layout layouts[] = {
+   { "pos3f", 1,
+     { { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32_FLOAT } } },
+   { "pos3f+norm3f+tex2f", 3,
+     { { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32_FLOAT },
+       { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32_FLOAT },
+       { PIPE_FORMAT_R32G32_FLOAT, PIPE_FORMAT_R32G32_FLOAT } } },
+   { "pos3f->4f", 1,
+     { { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT } } },
+   { "color4ub->4f", 1,
+     { { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_R32G32B32A32_FLOAT } } },
+   { "pos3s+tex2s->f", 2,
+     { { PIPE_FORMAT_R16G16B16_SNORM, PIPE_FORMAT_R32G32B32_FLOAT },
+       { PIPE_FORMAT_R16G16_UNORM, PIPE_FORMAT_R32G32_FLOAT } } },
+   { "pos3h+color3ub->f", 2,
+     { { PIPE_FORMAT_R16G16B16_FLOAT, PIPE_FORMAT_R32G32B32_FLOAT },
+       { PIPE_FORMAT_R8G8B8_UNORM, PIPE_FORMAT_R32G32B32A32_FLOAT } } },
+};
+
+static void
+init_key(struct translate_key *key, const struct bench_layout *layout)
+{
+   unsigned input_offset = 0;
+   unsigned i;
+
+   memset(key, 0, sizeof(*key));
+
+   for (i = 0; i < layout->nr_attribs; i++) {
+      struct translate_element *element = &key->element[i];
+
+      element->type = TRANSLATE_ELEMENT_NORMAL;
+      element->input_format = layout->attribs[i].input_format;
+      element->output_format = layout->attribs[i].output_format;
+      element->input_buffer = 0;
+      element->input_offset = input_offset;
+      element->output_offset = key->output_stride;
+
+      input_offset += util_format_get_blocksize(element->input_format);
+      key->output_stride += util_format_get_blocksize(element->output_format);
+   }
+
+   key->nr_elements = layout->nr_attribs;
+}
+
+static unsigned
+input_stride(const struct translate_key *key)
+{
+   const struct translate_element *last = &key->element[key->nr_elements - 1];
+
+   return last->input_offset + util_format_get_blocksize(last->input_format);
+}
+
+/**
+ * Return the throughput in millions of vertices per second.
+ */
+static double
+bench(struct translate *translate, boolean indexed, const unsigned *elts,
+      void *output)
+{
+   int64_t start = os_time_get_nano();
+   int64_t elapsed;
+   unsigned iterations = 0;
+
+   do {
+      if (indexed)
+         translate->run_elts(translate, elts, NUM_VERTICES, 0, 0, output);
+      else
+         translate->run(translate, 0, NUM_VERTICES, 0, 0, output);
+      iterations++;
+      elapsed = os_time_get_nano() - start;
+   } while (elapsed < RUN_TIME_NS);
+
+   return (double)iterations * NUM_VERTICES * 1000.0 / elapsed;
+}
+
+int main(int argc, char** argv)
+{
+   static const struct {
+      const char *name;
+      struct translate *(*create)(const struct translate_key *key);
+   } backends[] = {
+      { "generic", translate_generic_create },
+      { "x86", translate_sse2_create },
+#if HAVE_LLVM
+      { "gallivm", translate_gallivm_create },
+#endif
+   };
+   uint8_t *input;
+   uint8_t *output;
+   unsigned *elts;
+   unsigned i, l, b;
+
+   util_cpu_detect();
+
+   input = align_malloc(NUM_VERTICES * MAX_VERTEX_SIZE, 64);
+   output = align_malloc(NUM_VERTICES * MAX_VERTEX_SIZE, 64);
+   elts = align_malloc(NUM_VERTICES * sizeof *elts, 64);
+
+   srand(4359025);
+   for (i = 0; i < NUM_VERTICES * MAX_VERTEX_SIZE; i++)
+      input[i] = rand();
+
+   /* roughly what a vertex cache friendly mesh looks like */
+   for (i = 0; i < NUM_VERTICES; i++)
+      elts[i] = (i / 3 + i % 3 * 7) % NUM_VERTICES;
+
+   printf("%-20s %-8s %14s %14s\n", "layout", "backend",
+          "linear Mv/s", "indexed Mv/s");
+
+   for (l = 0; l < ARRAY_SIZE(layouts); l++) {
+      struct translate_key key;
+
+      init_key(&key, &layouts[l]);
+
+      for (b = 0; b < ARRAY_SIZE(backends); b++) {
+         struct translate *translate;
+         double linear, indexed;
+
+         if (argc > 1) {
+            int a;
+
+            for (a = 1; a < argc; a++) {
+               if (!strcmp(argv[a], backends[b].name))
+                  break;
+            }
+            if (a == argc)
+               continue;
+         }
+
+         translate = backends[b].create(&key);
+         if (!translate) {
+            printf("%-20s %-8s %14s %14s\n", layouts[l].name,
+                   backends[b].name, "-", "-");
+            continue;
+         }
+
+         translate->set_buffer(translate, 0, input, input_stride(&key),
+                               NUM_VERTICES - 1);
+
+         /* warm up, which also compiles the gallivm functions */
+         translate->run(translate, 0, NUM_VERTICES, 0, 0, output);
+         translate->run_elts(translate, elts, NUM_VERTICES, 0, 0, output);
+
+         linear = bench(translate, FALSE, elts, output);
+         indexed = bench(translate, TRUE, elts, output);
+
+         printf("%-20s %-8s %14.1f %14.1f\n", layouts[l].name,
+                backends[b].name, linear, indexed);
+
+         translate->release(translate);
+      }
+   }
+
+   align_free(elts);
+   align_free(output);
+   align_free(input);
+
+   return 0;
+}
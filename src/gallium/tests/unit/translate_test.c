@@ -127,10 +127,14 @@ int main(int argc, char** argv)
       }
       create_fn = translate_sse2_create;
    }
+#if HAVE_LLVM
+   else if (!strcmp(argv[1], "gallivm"))
+      create_fn = translate_gallivm_create;
+#endif
 
    if (!create_fn)
    {
-      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1]\n");
+      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1|gallivm]\n");
       return 2;
    }
 
@@ -28,6 +28,7 @@
 #include "compiler/nir/nir.h"
 #include "main/errors.h"
 #include "util/debug.h"
+#include "util/register_allocate.h"
 
 #define COMMON_OPTIONS                                                        \
    .lower_sub = true,                                                         \
@@ -103,15 +104,318 @@ static const struct nir_shader_compiler_options vector_nir_options_gen6 = {
    .max_unroll_iterations = 32,
 };
 
+/**
+ * @{
+ * Serialization of the register sets.
+ *
+ * Building the register sets and their conflict bitsets is a noticeable
+ * part of creating a compiler, so drivers can stash the result of
+ * brw_compiler_serialize_reg_sets() somewhere, such as the disk cache, and
+ * hand it back to brw_compiler_create_with_reg_sets().
+ */
+
+#define BRW_REG_SETS_MAGIC 0x42525331 /* "BRS1" */
+
+/* More ra_regs than any register set has, one per GRF per VGRF size. */
+#define BRW_MAX_RA_REG_COUNT (BRW_MAX_GRF * MAX_VGRF_SIZE)
+
+/* The register sets only depend on these bits of the device info. */
+static uint32_t
+reg_sets_devinfo_key(const struct gen_device_info *devinfo)
+{
+   return devinfo->gen | devinfo->has_pln << 8;
+}
+
+struct reg_set_writer {
+   void *mem_ctx;
+   uint8_t *data;
+   size_t size;
+};
+
+static void
+write_bytes(struct reg_set_writer *w, const void *data, size_t size)
+{
+   const size_t aligned_size = ALIGN(size, sizeof(uint32_t));
+
+   w->data = reralloc_size(w->mem_ctx, w->data, w->size + aligned_size);
+   memcpy(w->data + w->size, data, size);
+   memset(w->data + w->size + size, 0, aligned_size - size);
+   w->size += aligned_size;
+}
+
+static void
+write_uint32(struct reg_set_writer *w, uint32_t value)
+{
+   write_bytes(w, &value, sizeof(value));
+}
+
+static void
+write_ra_set(struct reg_set_writer *w, const struct ra_regs *regs)
+{
+   size_t size;
+   void *data = ra_set_serialize(regs, NULL, &size);
+
+   write_uint32(w, size);
+   write_bytes(w, data, size);
+   ralloc_free(data);
+}
+
+struct reg_set_reader {
+   const uint8_t *data;
+   size_t size;
+   size_t offset;
+   bool overrun;
+};
+
+static const void *
+read_bytes(struct reg_set_reader *r, size_t size)
+{
+   const void *data = r->data + r->offset;
+
+   /* Check size before aligning it, so that a bogus size can't wrap. */
+   if (r->overrun || size > r->size - r->offset ||
+       ALIGN(size, sizeof(uint32_t)) > r->size - r->offset) {
+      r->overrun = true;
+      return NULL;
+   }
+
+   r->offset += ALIGN(size, sizeof(uint32_t));
+   return data;
+}
+
+static uint32_t
+read_uint32(struct reg_set_reader *r)
+{
+   const uint32_t *value = read_bytes(r, sizeof(uint32_t));
+
+   return value ? *value : 0;
+}
+
+static void *
+read_array(struct reg_set_reader *r, void *mem_ctx, size_t size)
+{
+   const void *data = read_bytes(r, size);
+   void *copy;
+
+   if (!data)
+      return NULL;
+
+   copy = ralloc_size(mem_ctx, size);
+   memcpy(copy, data, size);
+   return copy;
+}
+
+/* Whether the n ints of values are all in [min, max]. */
+static bool
+ints_in_range(const int *values, unsigned n, int min, int max)
+{
+   for (unsigned i = 0; i < n; i++) {
+      if (values[i] < min || values[i] > max)
+         return false;
+   }
+
+   return true;
+}
+
+/* Whether the n bytes of values are all below max. */
+static bool
+bytes_below(const uint8_t *values, unsigned n, unsigned max)
+{
+   for (unsigned i = 0; i < n; i++) {
+      if (values[i] >= max)
+         return false;
+   }
+
+   return true;
+}
+
+static struct ra_regs *
+read_ra_set(struct reg_set_reader *r, void *mem_ctx)
+{
+   const size_t size = read_uint32(r);
+   const void *data = read_bytes(r, size);
+
+   return data ? ra_set_deserialize(mem_ctx, data, size) : NULL;
+}
+
+void *
+brw_compiler_serialize_reg_sets(const struct brw_compiler *compiler,
+                                void *mem_ctx, size_t *size)
+{
+   struct reg_set_writer w = { mem_ctx, NULL, 0 };
+
+   write_uint32(&w, BRW_REG_SETS_MAGIC);
+   write_uint32(&w, reg_sets_devinfo_key(compiler->devinfo));
+
+   write_uint32(&w, compiler->vec4_reg_set.ra_reg_count);
+   write_bytes(&w, compiler->vec4_reg_set.classes,
+               MAX_VGRF_SIZE * sizeof(int));
+   write_bytes(&w, compiler->vec4_reg_set.ra_reg_to_grf,
+               compiler->vec4_reg_set.ra_reg_count);
+   write_ra_set(&w, compiler->vec4_reg_set.regs);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(compiler->fs_reg_sets); i++) {
+      /* On IVB+, the SIMD16 and SIMD32 sets are the SIMD8 one. */
+      const bool shared =
+         i > 0 && compiler->fs_reg_sets[i].regs == compiler->fs_reg_sets[0].regs;
+
+      write_uint32(&w, shared);
+      if (shared)
+         continue;
+
+      write_bytes(&w, compiler->fs_reg_sets[i].classes,
+                  sizeof(compiler->fs_reg_sets[i].classes));
+      write_bytes(&w, compiler->fs_reg_sets[i].class_to_ra_reg_range,
+                  sizeof(compiler->fs_reg_sets[i].class_to_ra_reg_range));
+      write_uint32(&w, compiler->fs_reg_sets[i].aligned_pairs_class);
+      write_bytes(&w, compiler->fs_reg_sets[i].ra_reg_to_grf,
+                  compiler->fs_reg_sets[i].class_to_ra_reg_range[MAX_VGRF_SIZE]);
+      write_ra_set(&w, compiler->fs_reg_sets[i].regs);
+   }
+
+   *size = w.size;
+   return w.data;
+}
+
+static bool
+brw_compiler_load_reg_sets(struct brw_compiler *compiler,
+                           const void *data, size_t size)
+{
+   struct reg_set_reader r = { data, size, 0, false };
+   void *mem_ctx = ralloc_context(NULL);
+   bool ok;
+
+   ok = read_uint32(&r) == BRW_REG_SETS_MAGIC &&
+        read_uint32(&r) == reg_sets_devinfo_key(compiler->devinfo);
+
+   if (ok) {
+      const uint32_t ra_reg_count = read_uint32(&r);
+
+      ok = ra_reg_count > 0 && ra_reg_count <= BRW_MAX_RA_REG_COUNT;
+      if (ok) {
+         compiler->vec4_reg_set.ra_reg_count = ra_reg_count;
+         compiler->vec4_reg_set.classes =
+            read_array(&r, mem_ctx, MAX_VGRF_SIZE * sizeof(int));
+         compiler->vec4_reg_set.ra_reg_to_grf =
+            read_array(&r, mem_ctx, ra_reg_count);
+         compiler->vec4_reg_set.regs = read_ra_set(&r, mem_ctx);
+         ok = compiler->vec4_reg_set.regs != NULL &&
+              compiler->vec4_reg_set.classes != NULL &&
+              compiler->vec4_reg_set.ra_reg_to_grf != NULL;
+      }
+
+      /* The tables index the set and the GRFs, so check them against what
+       * was actually read.
+       */
+      if (ok) {
+         const int class_count =
+            ra_get_class_count(compiler->vec4_reg_set.regs);
+
+         ok = ra_get_reg_count(compiler->vec4_reg_set.regs) == ra_reg_count &&
+              ints_in_range(compiler->vec4_reg_set.classes, MAX_VGRF_SIZE,
+                            0, class_count - 1) &&
+              bytes_below(compiler->vec4_reg_set.ra_reg_to_grf, ra_reg_count,
+                          BRW_MAX_GRF);
+      }
+   }
+
+   for (unsigned i = 0; ok && i < ARRAY_SIZE(compiler->fs_reg_sets); i++) {
+      const void *classes, *class_to_ra_reg_range;
+
+      if (read_uint32(&r)) {
+         ok = i > 0;
+         compiler->fs_reg_sets[i] = compiler->fs_reg_sets[0];
+         continue;
+      }
+
+      classes = read_bytes(&r, sizeof(compiler->fs_reg_sets[i].classes));
+      class_to_ra_reg_range =
+         read_bytes(&r, sizeof(compiler->fs_reg_sets[i].class_to_ra_reg_range));
+      if (!classes || !class_to_ra_reg_range) {
+         ok = false;
+         break;
+      }
+
+      /* The ranges must be increasing, ending with the number of ra_regs. */
+      ok = true;
+      for (unsigned j = 0; ok && j <= MAX_VGRF_SIZE; j++) {
+         const int *range = class_to_ra_reg_range;
+
+         ok = range[j] >= (j ? range[j - 1] : 0) &&
+              range[j] <= BRW_MAX_RA_REG_COUNT;
+      }
+      if (!ok || ((const int *)class_to_ra_reg_range)[MAX_VGRF_SIZE] == 0) {
+         ok = false;
+         break;
+      }
+
+      memcpy(compiler->fs_reg_sets[i].classes, classes,
+             sizeof(compiler->fs_reg_sets[i].classes));
+      memcpy(compiler->fs_reg_sets[i].class_to_ra_reg_range,
+             class_to_ra_reg_range,
+             sizeof(compiler->fs_reg_sets[i].class_to_ra_reg_range));
+      compiler->fs_reg_sets[i].aligned_pairs_class = read_uint32(&r);
+      compiler->fs_reg_sets[i].ra_reg_to_grf =
+         read_array(&r, mem_ctx,
+                    compiler->fs_reg_sets[i].class_to_ra_reg_range[MAX_VGRF_SIZE]);
+      compiler->fs_reg_sets[i].regs = read_ra_set(&r, mem_ctx);
+      if (!compiler->fs_reg_sets[i].regs ||
+          !compiler->fs_reg_sets[i].ra_reg_to_grf) {
+         ok = false;
+         break;
+      }
+
+      const int class_count =
+         ra_get_class_count(compiler->fs_reg_sets[i].regs);
+      const unsigned ra_reg_count =
+         compiler->fs_reg_sets[i].class_to_ra_reg_range[MAX_VGRF_SIZE];
+
+      ok = ra_get_reg_count(compiler->fs_reg_sets[i].regs) == ra_reg_count &&
+           ints_in_range(compiler->fs_reg_sets[i].classes,
+                         ARRAY_SIZE(compiler->fs_reg_sets[i].classes),
+                         0, class_count - 1) &&
+           compiler->fs_reg_sets[i].aligned_pairs_class >= -1 &&
+           compiler->fs_reg_sets[i].aligned_pairs_class < class_count &&
+           bytes_below(compiler->fs_reg_sets[i].ra_reg_to_grf, ra_reg_count,
+                       BRW_MAX_GRF);
+   }
+
+   ok = ok && !r.overrun && r.offset == r.size;
+
+   if (ok) {
+      ralloc_adopt(compiler, mem_ctx);
+   } else {
+      memset(&compiler->vec4_reg_set, 0, sizeof(compiler->vec4_reg_set));
+      memset(compiler->fs_reg_sets, 0, sizeof(compiler->fs_reg_sets));
+   }
+
+   ralloc_free(mem_ctx);
+
+   return ok;
+}
+
+/** @} */
+
 struct brw_compiler *
 brw_compiler_create(void *mem_ctx, const struct gen_device_info *devinfo)
+{
+   return brw_compiler_create_with_reg_sets(mem_ctx, devinfo, NULL, 0);
+}
+
+struct brw_compiler *
+brw_compiler_create_with_reg_sets(void *mem_ctx,
+                                  const struct gen_device_info *devinfo,
+                                  const void *reg_sets, size_t reg_sets_size)
 {
    struct brw_compiler *compiler = rzalloc(mem_ctx, struct brw_compiler);
 
    compiler->devinfo = devinfo;
 
-   brw_fs_alloc_reg_sets(compiler);
-   brw_vec4_alloc_reg_set(compiler);
+   if (!reg_sets ||
+       !brw_compiler_load_reg_sets(compiler, reg_sets, reg_sets_size)) {
+      brw_fs_alloc_reg_sets(compiler);
+      brw_vec4_alloc_reg_set(compiler);
+   }
    brw_init_compaction_tables(devinfo);
 
    compiler->precise_trig = env_var_as_boolean("INTEL_PRECISE_TRIG", false);
@@ -55,6 +55,9 @@ struct brw_compiler {
        * GRF for that object.
        */
       uint8_t *ra_reg_to_grf;
+
+      /** Number of registers in *regs. */
+      int ra_reg_count;
    } vec4_reg_set;
 
    struct {
@@ -992,6 +995,20 @@ DEFINE_PROG_DATA_DOWNCAST(sf)
 struct brw_compiler *
 brw_compiler_create(void *mem_ctx, const struct gen_device_info *devinfo);
 
+/**
+ * Like brw_compiler_create(), but takes the register sets from the output of
+ * brw_compiler_serialize_reg_sets() instead of building them, if it was
+ * produced for the same hardware generation.
+ */
+struct brw_compiler *
+brw_compiler_create_with_reg_sets(void *mem_ctx,
+                                  const struct gen_device_info *devinfo,
+                                  const void *reg_sets, size_t reg_sets_size);
+
+void *
+brw_compiler_serialize_reg_sets(const struct brw_compiler *compiler,
+                                void *mem_ctx, size_t *size);
+
 /**
  * Compile a vertex shader.
  *
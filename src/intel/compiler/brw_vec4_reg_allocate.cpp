@@ -112,6 +112,7 @@ brw_vec4_alloc_reg_set(struct brw_compiler *compiler)
 
    ralloc_free(compiler->vec4_reg_set.ra_reg_to_grf);
    compiler->vec4_reg_set.ra_reg_to_grf = ralloc_array(compiler, uint8_t, ra_reg_count);
+   compiler->vec4_reg_set.ra_reg_count = ra_reg_count;
    ralloc_free(compiler->vec4_reg_set.regs);
    compiler->vec4_reg_set.regs = ra_alloc_reg_set(compiler, ra_reg_count, false);
    if (compiler->devinfo->gen >= 6)
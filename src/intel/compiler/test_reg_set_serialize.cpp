@@ -0,0 +1,221 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include "brw_compiler.h"
+#include "util/ralloc.h"
+#include "util/register_allocate.h"
+
+class reg_set_serialize_test : public ::testing::Test {
+   virtual void SetUp();
+   virtual void TearDown();
+
+public:
+   void create_compiler(int gen);
+   bool loads_blob(const uint8_t *blob, size_t size);
+   size_t fs_set_offset(const uint8_t *blob);
+   uint8_t *copy_blob();
+
+   void *mem_ctx;
+   struct gen_device_info devinfo;
+   uint8_t *blob;
+   size_t blob_size;
+};
+
+void reg_set_serialize_test::SetUp()
+{
+   mem_ctx = ralloc_context(NULL);
+   blob = NULL;
+   blob_size = 0;
+}
+
+void reg_set_serialize_test::TearDown()
+{
+   ralloc_free(mem_ctx);
+}
+
+void
+reg_set_serialize_test::create_compiler(int gen)
+{
+   /* The register sets only depend on these. */
+   memset(&devinfo, 0, sizeof(devinfo));
+   devinfo.gen = gen;
+   devinfo.has_pln = gen >= 5;
+
+   struct brw_compiler *compiler = brw_compiler_create(mem_ctx, &devinfo);
+   blob = (uint8_t *)brw_compiler_serialize_reg_sets(compiler, mem_ctx,
+                                                     &blob_size);
+   ASSERT_TRUE(blob != NULL);
+}
+
+/**
+ * Creates a compiler out of the given blob and returns whether it uses the
+ * blob's register sets.  When it doesn't, it must have fallen back to
+ * building sets identical to the original ones.
+ */
+bool
+reg_set_serialize_test::loads_blob(const uint8_t *data, size_t size)
+{
+   struct brw_compiler *compiler =
+      brw_compiler_create_with_reg_sets(mem_ctx, &devinfo, data, size);
+   size_t new_size;
+   uint8_t *new_blob = (uint8_t *)
+      brw_compiler_serialize_reg_sets(compiler, mem_ctx, &new_size);
+
+   EXPECT_EQ(blob_size, new_size);
+   EXPECT_EQ(0, memcmp(blob, new_blob, MIN2(blob_size, new_size)));
+
+   return size == blob_size && memcmp(blob, data, size) == 0;
+}
+
+uint8_t *
+reg_set_serialize_test::copy_blob()
+{
+   uint8_t *data = (uint8_t *)ralloc_size(mem_ctx, blob_size);
+
+   memcpy(data, blob, blob_size);
+   return data;
+}
+
+/* Offset of the first FS register set in the blob. */
+size_t
+reg_set_serialize_test::fs_set_offset(const uint8_t *data)
+{
+   uint32_t ra_reg_count, ra_set_size;
+   size_t offset = 2 * sizeof(uint32_t);
+
+   memcpy(&ra_reg_count, data + offset, sizeof(ra_reg_count));
+   offset += sizeof(uint32_t) + 16 * sizeof(int) + ALIGN(ra_reg_count, 4);
+   memcpy(&ra_set_size, data + offset, sizeof(ra_set_size));
+   offset += sizeof(uint32_t) + ra_set_size;
+
+   return offset;
+}
+
+static struct ra_regs *
+create_ra_set(void *mem_ctx)
+{
+   /* Eight registers and the pairs of adjacent ones. */
+   struct ra_regs *regs = ra_alloc_reg_set(mem_ctx, 15, true);
+   unsigned int single_class = ra_alloc_reg_class(regs);
+   unsigned int pair_class = ra_alloc_reg_class(regs);
+
+   for (unsigned i = 0; i < 8; i++)
+      ra_class_add_reg(regs, single_class, i);
+
+   for (unsigned i = 0; i < 7; i++) {
+      ra_class_add_reg(regs, pair_class, 8 + i);
+      ra_add_reg_conflict(regs, 8 + i, i);
+      ra_add_reg_conflict(regs, 8 + i, i + 1);
+   }
+
+   ra_set_finalize(regs, NULL);
+
+   return regs;
+}
+
+TEST_F(reg_set_serialize_test, ra_set_round_trip)
+{
+   struct ra_regs *regs = create_ra_set(mem_ctx);
+   size_t size, new_size;
+   void *data = ra_set_serialize(regs, mem_ctx, &size);
+
+   struct ra_regs *new_regs = ra_set_deserialize(mem_ctx, data, size);
+   ASSERT_TRUE(new_regs != NULL);
+   EXPECT_EQ(15u, ra_get_reg_count(new_regs));
+   EXPECT_EQ(2u, ra_get_class_count(new_regs));
+
+   void *new_data = ra_set_serialize(new_regs, mem_ctx, &new_size);
+   ASSERT_EQ(size, new_size);
+   EXPECT_EQ(0, memcmp(data, new_data, size));
+}
+
+TEST_F(reg_set_serialize_test, ra_set_rejects_bad_data)
+{
+   struct ra_regs *regs = create_ra_set(mem_ctx);
+   size_t size;
+   uint32_t *data = (uint32_t *)ra_set_serialize(regs, mem_ctx, &size);
+
+   EXPECT_TRUE(ra_set_deserialize(mem_ctx, data, size - 4) == NULL);
+   EXPECT_TRUE(ra_set_deserialize(mem_ctx, data, 8) == NULL);
+
+   /* More classes than registers */
+   data[2] = 16;
+   EXPECT_TRUE(ra_set_deserialize(mem_ctx, data, size) == NULL);
+   data[2] = 2;
+
+   data[0] ^= 1;
+   EXPECT_TRUE(ra_set_deserialize(mem_ctx, data, size) == NULL);
+}
+
+TEST_F(reg_set_serialize_test, compiler_round_trip)
+{
+   static const int gens[] = { 4, 5, 6, 7, 8, 9 };
+
+   for (unsigned i = 0; i < ARRAY_SIZE(gens); i++) {
+      create_compiler(gens[i]);
+      EXPECT_TRUE(loads_blob(blob, blob_size)) << "gen " << gens[i];
+   }
+}
+
+TEST_F(reg_set_serialize_test, truncated_blob_falls_back)
+{
+   create_compiler(7);
+
+   EXPECT_FALSE(loads_blob(blob, blob_size - 4));
+   EXPECT_FALSE(loads_blob(blob, fs_set_offset(blob)));
+   EXPECT_FALSE(loads_blob(blob, 0));
+}
+
+TEST_F(reg_set_serialize_test, other_generation_falls_back)
+{
+   create_compiler(9);
+   uint8_t *gen9_blob = blob;
+   size_t gen9_blob_size = blob_size;
+
+   create_compiler(7);
+   EXPECT_FALSE(loads_blob(gen9_blob, gen9_blob_size));
+}
+
+TEST_F(reg_set_serialize_test, bad_grf_falls_back)
+{
+   create_compiler(7);
+   uint8_t *data = copy_blob();
+
+   /* The first entry of the vec4 ra_reg_to_grf table */
+   data[12 + 16 * sizeof(int)] = 200;
+   EXPECT_FALSE(loads_blob(data, blob_size));
+}
+
+TEST_F(reg_set_serialize_test, bad_class_falls_back)
+{
+   create_compiler(7);
+   uint8_t *data = copy_blob();
+   const size_t fs_classes = fs_set_offset(data) + sizeof(uint32_t);
+   int class_count = 16;
+
+   /* Gen7 has no aligned pairs class, so this is one past the last one. */
+   memcpy(data + fs_classes, &class_count, sizeof(class_count));
+   EXPECT_FALSE(loads_blob(data, blob_size));
+}
@@ -90,6 +90,30 @@ class PrintCode(gl_XML.gl_print_base):
         out('debug_print_sync_fallback("{0}");'.format(func.name))
         self.print_sync_call(func)
 
+    def print_call_after(self, func):
+        # Updates the glthread shadow state on the main thread, see
+        # glthread_shadow.c.
+        if func.marshal_call_after:
+            out('{0};'.format(func.marshal_call_after))
+
+    def print_shadow(self, func):
+        # Answers queries from the glthread shadow state when possible, so
+        # that we don't need to synchronize with the worker thread.
+        if not func.marshal_shadow:
+            return
+        args = ['ctx']
+        if func.get_called_parameter_string():
+            args.append(func.get_called_parameter_string())
+        if func.return_type != 'void':
+            out('{0} result;'.format(func.return_type))
+            args.append('&result')
+        out('if ({0}({1}))'.format(func.marshal_shadow, ', '.join(args)))
+        with indent():
+            if func.return_type != 'void':
+                out('return result;')
+            else:
+                out('return;')
+
     def print_sync_body(self, func):
         out('/* {0}: marshalled synchronously */'.format(func.name))
         out('static {0} GLAPIENTRY'.format(func.return_type))
@@ -97,9 +121,11 @@ class PrintCode(gl_XML.gl_print_base):
         out('{')
         with indent():
             out('GET_CURRENT_CONTEXT(ctx);')
+            self.print_shadow(func)
             out('_mesa_glthread_finish(ctx);')
             out('debug_print_sync("{0}");'.format(func.name))
             self.print_sync_call(func)
+            self.print_call_after(func)
         out('}')
         out('')
         out('')
@@ -253,9 +279,16 @@ class PrintCode(gl_XML.gl_print_base):
                     out('return;')
                 out('}')
 
+            if func.marshal_sync:
+                out('if ({0})'.format(func.marshal_sync))
+                with indent():
+                    out('goto fallback_to_sync;')
+                need_fallback_sync = True
+
             out('if (cmd_size <= MARSHAL_MAX_CMD_SIZE) {')
             with indent():
                 self.print_async_dispatch(func)
+                self.print_call_after(func)
                 out('return;')
             out('}')
 
@@ -265,6 +298,7 @@ class PrintCode(gl_XML.gl_print_base):
         with indent():
             out('_mesa_glthread_finish(ctx);')
             self.print_sync_dispatch(func)
+            self.print_call_after(func)
 
         out('}')
 
@@ -59,6 +59,9 @@ class marshal_function(gl_XML.gl_function):
         # Store the "marshal" attribute, if present.
         self.marshal = element.get('marshal')
         self.marshal_fail = element.get('marshal_fail')
+        self.marshal_sync = element.get('marshal_sync')
+        self.marshal_call_after = element.get('marshal_call_after')
+        self.marshal_shadow = element.get('marshal_shadow')
 
     def marshal_flavor(self):
         """Find out how this function should be marshalled between
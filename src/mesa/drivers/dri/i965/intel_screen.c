@@ -35,6 +35,7 @@
 #include "main/fbobject.h"
 #include "main/version.h"
 #include "swrast/s_renderbuffer.h"
+#include "util/disk_cache.h"
 #include "util/ralloc.h"
 #include "brw_defines.h"
 #include "brw_state.h"
@@ -1343,6 +1344,7 @@ intelDestroyScreen(__DRIscreen * sPriv)
 
    brw_bufmgr_destroy(screen->bufmgr);
    driDestroyOptionInfo(&screen->optionCache);
+   disk_cache_destroy(screen->disk_cache);
 
    ralloc_free(screen);
    sPriv->driverPrivate = NULL;
@@ -2012,6 +2014,53 @@ shader_perf_log_mesa(void *data, const char *fmt, ...)
    va_end(args);
 }
 
+/**
+ * Creates the backend compiler, taking its register sets from the disk
+ * cache when they're there.  Building them is a noticeable part of screen
+ * creation, which matters for short-lived GL clients.
+ */
+static void
+intel_screen_create_compiler(struct intel_screen *screen)
+{
+   const struct gen_device_info *devinfo = &screen->devinfo;
+   void *reg_sets = NULL;
+   size_t reg_sets_size = 0;
+   uint32_t timestamp;
+   cache_key key;
+
+   if (disk_cache_get_function_timestamp(intel_screen_create_compiler,
+                                         &timestamp)) {
+      char timestamp_str[16];
+
+      snprintf(timestamp_str, sizeof(timestamp_str), "%u", timestamp);
+      screen->disk_cache = disk_cache_create("i965", timestamp_str, 0);
+   }
+
+   if (screen->disk_cache) {
+      char key_str[64];
+
+      snprintf(key_str, sizeof(key_str), "register sets gen%d pln%d",
+               devinfo->gen, devinfo->has_pln);
+      disk_cache_compute_key(screen->disk_cache, key_str, strlen(key_str),
+                             key);
+      reg_sets = disk_cache_get(screen->disk_cache, key, &reg_sets_size);
+   }
+
+   screen->compiler = brw_compiler_create_with_reg_sets(screen, devinfo,
+                                                        reg_sets,
+                                                        reg_sets_size);
+
+   if (screen->disk_cache && !reg_sets) {
+      void *data = brw_compiler_serialize_reg_sets(screen->compiler, NULL,
+                                                   &reg_sets_size);
+
+      disk_cache_put(screen->disk_cache, key, data, reg_sets_size);
+      ralloc_free(data);
+   }
+
+   free(reg_sets);
+}
+
 static int
 parse_devid_override(const char *devid_override)
 {
@@ -2336,7 +2385,7 @@ __DRIconfig **intelInitScreen2(__DRIscreen *dri_screen)
    dri_screen->extensions = !screen->has_context_reset_notification
       ? screenExtensions : intelRobustScreenExtensions;
 
-   screen->compiler = brw_compiler_create(screen, devinfo);
+   intel_screen_create_compiler(screen);
    screen->compiler->shader_debug_log = shader_debug_log_mesa;
    screen->compiler->shader_perf_log = shader_perf_log_mesa;
    screen->compiler->constant_buffer_0_is_relative = devinfo->gen < 8;
@@ -93,6 +93,11 @@ struct intel_screen
 
    struct brw_compiler *compiler;
 
+   /**
+    * Disk cache used to skip building the compiler's register sets.
+    */
+   struct disk_cache *disk_cache;
+
    /**
    * Configuration cache with default values for all contexts
    */
@@ -52,6 +52,7 @@
 #include "varray.h"
 #include "main/dispatch.h"
 #include "util/bitscan.h"
+#include "util/u_atomic.h"
 
 
 /**
@@ -294,6 +295,20 @@ _mesa_initialize_vao(struct gl_context *ctx,
 
    _mesa_reference_buffer_object(ctx, &vao->IndexBufferObj,
                                  ctx->Shared->NullBufferObj);
+
+   _mesa_update_vao_stamp(vao);
+}
+
+
+/**
+ * Gives a new stamp to a VAO whose derived arrays have changed.
+ */
+void
+_mesa_update_vao_stamp(struct gl_vertex_array_object *vao)
+{
+   static uint32_t next_stamp = 0;
+
+   vao->_Stamp = p_atomic_inc_return(&next_stamp);
 }
 
 
@@ -307,6 +322,9 @@ _mesa_update_vao_client_arrays(struct gl_context *ctx,
 {
    GLbitfield64 arrays = vao->NewArrays;
 
+   if (arrays)
+      _mesa_update_vao_stamp(vao);
+
    while (arrays) {
       const int attrib = u_bit_scan64(&arrays);
       struct gl_vertex_array *client_array = &vao->_VertexAttrib[attrib];
@@ -1476,34 +1476,227 @@ alloc_instruction(struct gl_context *ctx, OpCode opcode, GLuint nparams)
 }
 
 
+/** Return the number of nodes of an instruction */
+static inline GLuint
+instruction_size(const struct gl_context *ctx, OpCode opcode)
+{
+   if (is_ext_opcode(opcode))
+      return ctx->ListExt->Opcode[opcode - OPCODE_EXT_0].Size;
+   return InstSize[opcode];
+}
+
+
+/**
+ * Whether an instruction sets a piece of state which the following
+ * instructions of this list can't observe without a draw, so that setting
+ * it again to the same value is useless.
+ */
+static bool
+is_simple_state_opcode(OpCode opcode)
+{
+   switch (opcode) {
+   case OPCODE_ALPHA_FUNC:
+   case OPCODE_BLEND_COLOR:
+   case OPCODE_BLEND_EQUATION:
+   case OPCODE_BLEND_FUNC_SEPARATE:
+   case OPCODE_COLOR_MASK:
+   case OPCODE_CULL_FACE:
+   case OPCODE_DEPTH_FUNC:
+   case OPCODE_DEPTH_MASK:
+   case OPCODE_DEPTH_RANGE:
+   case OPCODE_FRONT_FACE:
+   case OPCODE_LINE_WIDTH:
+   case OPCODE_LOGIC_OP:
+   case OPCODE_POINT_SIZE:
+   case OPCODE_SHADE_MODEL:
+      return true;
+   default:
+      return false;
+   }
+}
+
+
+/**
+ * Whether an instruction leaves the state tracked by
+ * struct redundant_state_tracker alone.
+ */
+static bool
+preserves_simple_state(OpCode opcode)
+{
+   if (is_ext_opcode(opcode))
+      return true;   /* the vbo vertex lists */
+
+   switch (opcode) {
+   case OPCODE_ATTR_1F_NV:
+   case OPCODE_ATTR_2F_NV:
+   case OPCODE_ATTR_3F_NV:
+   case OPCODE_ATTR_4F_NV:
+   case OPCODE_ATTR_1F_ARB:
+   case OPCODE_ATTR_2F_ARB:
+   case OPCODE_ATTR_3F_ARB:
+   case OPCODE_ATTR_4F_ARB:
+   case OPCODE_MATERIAL:
+   case OPCODE_BEGIN:
+   case OPCODE_END:
+   case OPCODE_RECTF:
+   case OPCODE_NOP:
+      return true;
+   default:
+      return false;
+   }
+}
+
+
+#define MAX_TRACKED_ENABLES 16
+
+/**
+ * The last instructions which set some simple state, to find the ones
+ * setting it again to the same value.
+ */
+struct redundant_state_tracker
+{
+   const Node *setter[OPCODE_END_OF_LIST];
+   struct {
+      GLenum cap;
+      OpCode opcode;   /**< OPCODE_ENABLE or OPCODE_DISABLE */
+   } enables[MAX_TRACKED_ENABLES];
+   GLuint num_enables;
+};
+
+
 /**
- * Called by EndList to try to reduce memory used for the list.
+ * Return true if the instruction n can be dropped from the list because
+ * it sets state to the value it already has.  Otherwise, record its
+ * effect; copy is where the instruction is going to be copied.
+ */
+static bool
+is_redundant_instruction(struct redundant_state_tracker *tracker,
+                         const Node *n, GLuint size, const Node *copy)
+{
+   const OpCode opcode = n[0].opcode;
+   GLuint i;
+
+   if (opcode == OPCODE_ENABLE || opcode == OPCODE_DISABLE) {
+      for (i = 0; i < tracker->num_enables; i++) {
+         if (tracker->enables[i].cap == n[1].e) {
+            if (tracker->enables[i].opcode == opcode)
+               return true;
+            tracker->enables[i].opcode = opcode;
+            return false;
+         }
+      }
+      if (tracker->num_enables < MAX_TRACKED_ENABLES) {
+         tracker->enables[i].cap = n[1].e;
+         tracker->enables[i].opcode = opcode;
+         tracker->num_enables++;
+      }
+      return false;
+   }
+
+   if (is_simple_state_opcode(opcode)) {
+      const Node *prev = tracker->setter[opcode];
+
+      if (prev && memcmp(prev + 1, n + 1, (size - 1) * sizeof(Node)) == 0)
+         return true;
+      tracker->setter[opcode] = copy;
+      return false;
+   }
+
+   if (!preserves_simple_state(opcode)) {
+      /* This may change anything, e.g. glPopAttrib, glCallList or
+       * glActiveTexture, which changes what texture enables refer to.
+       */
+      memset(tracker, 0, sizeof(*tracker));
+   }
+
+   return false;
+}
+
+
+/**
+ * Called by EndList to turn the chain of blocks of the list into a single
+ * array of instructions, without the OPCODE_CONTINUE jumps, and drop
+ * the state changes which don't change anything.  The list is compiled
+ * once but may be executed a lot, so this is worth a copy.  This also
+ * reduces the memory used by the many small lists apps like glXUseXFont
+ * create.
  */
 static void
-trim_list(struct gl_context *ctx)
-{
-   /* If the list we're ending only has one allocated block of nodes/tokens
-    * and its size isn't a full block size, realloc the block to use less
-    * memory.  This is important for apps that create many small display
-    * lists and apps that use glXUseXFont (many lists each containing one
-    * glBitmap call).
-    * Note: we currently only trim display lists that allocated one block
-    * of tokens.  That hits the short list case which is what we're mainly
-    * concerned with.  Trimming longer lists would involve traversing the
-    * linked list of blocks.
-    */
+compact_list(struct gl_context *ctx)
+{
    struct gl_dlist_state *list = &ctx->ListState;
+   struct redundant_state_tracker *tracker;
+   Node *n, *block, *head;
+   GLuint max_size = 0, pos = 0;
 
-   if ((list->CurrentList->Head == list->CurrentBlock) &&
-       (list->CurrentPos < BLOCK_SIZE)) {
-      /* There's only one block and it's not full, so realloc */
-      GLuint newSize = list->CurrentPos * sizeof(Node);
-      list->CurrentList->Head =
-      list->CurrentBlock = realloc(list->CurrentBlock, newSize);
-      if (!list->CurrentBlock) {
-         _mesa_error(ctx, GL_OUT_OF_MEMORY, "glEndList");
+   /* Upper bound of the size: the instructions and an alignment NOP for
+    * each of them.
+    */
+   n = list->CurrentList->Head;
+   while (n[0].opcode != OPCODE_END_OF_LIST) {
+      if (n[0].opcode == OPCODE_CONTINUE) {
+         n = (Node *) get_pointer(&n[1]);
+      }
+      else {
+         const GLuint size = instruction_size(ctx, n[0].opcode);
+         max_size += size + 1;
+         n += size;
       }
    }
+   max_size += InstSize[OPCODE_END_OF_LIST];
+
+   head = malloc(max_size * sizeof(Node));
+   tracker = calloc(1, sizeof(*tracker));
+   if (!head || !tracker) {
+      /* keep the list as is */
+      free(head);
+      free(tracker);
+      return;
+   }
+
+   n = block = list->CurrentList->Head;
+   for (;;) {
+      const OpCode opcode = n[0].opcode;
+      GLuint size;
+
+      if (opcode == OPCODE_CONTINUE) {
+         n = (Node *) get_pointer(&n[1]);
+         free(block);
+         block = n;
+         continue;
+      }
+
+      size = instruction_size(ctx, opcode);
+
+      if (opcode == OPCODE_NOP ||
+          is_redundant_instruction(tracker, n, size, head + pos)) {
+         n += size;
+         continue;
+      }
+
+      /* The vbo payloads need the same 8-byte alignment as in dlist_alloc */
+      if (sizeof(void *) > sizeof(Node) && is_ext_opcode(opcode) &&
+          pos % 2 == 0) {
+         head[pos++].opcode = OPCODE_NOP;
+      }
+
+      memcpy(head + pos, n, size * sizeof(Node));
+      pos += size;
+
+      if (opcode == OPCODE_END_OF_LIST)
+         break;
+
+      n += size;
+   }
+   free(block);
+   free(tracker);
+
+   assert(pos <= max_size);
+   list->CurrentList->Head = list->CurrentBlock =
+      realloc(head, pos * sizeof(Node));
+   if (!list->CurrentBlock)
+      list->CurrentList->Head = list->CurrentBlock = head;
+   list->CurrentPos = pos;
 }
 
 
@@ -9381,7 +9574,7 @@ _mesa_EndList(void)
 
    (void) alloc_instruction(ctx, OPCODE_END_OF_LIST, 0);
 
-   trim_list(ctx);
+   compact_list(ctx);
 
    /* Destroy old list, if any */
    destroy_list(ctx, ctx->ListState.CurrentList->Name);
@@ -0,0 +1,292 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * AVX2 versions of the common _mesa_swizzle_and_convert() conversions.
+ *
+ * This works like the SSE4.1 version (see format_convert_sse41.c) on
+ * twice as many pixels at a time.  Byte shuffles and packs operate within
+ * each 128-bit lane, which is fine for the shuffles as pixels never
+ * straddle lanes, but the packed results need to be put back in order.
+ */
+
+#include "main/format_convert_x86.h"
+#include <immintrin.h>
+
+static inline __m256i
+get_shuffle_mask(const uint8_t swizzle[4], unsigned chan_size)
+{
+   uint8_t mask[16];
+   _mesa_swizzle_convert_shuffle_mask(mask, swizzle, chan_size);
+   return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) mask));
+}
+
+static inline __m256i
+get_one_mask(const uint8_t swizzle[4], unsigned chan_size, uint32_t one)
+{
+   uint8_t mask[16];
+   _mesa_swizzle_convert_one_mask(mask, swizzle, chan_size, one);
+   return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) mask));
+}
+
+/**
+ * Same as _mesa_half_to_float() on 8 halves held in the low bits of
+ * 32-bit lanes.
+ */
+static inline __m256i
+half_to_float(__m256i h)
+{
+   const __m256i m = _mm256_and_si256(h, _mm256_set1_epi32(0x3ff));
+   const __m256i e = _mm256_and_si256(_mm256_srli_epi32(h, 10),
+                                      _mm256_set1_epi32(0x1f));
+   const __m256i s = _mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(0x8000)),
+                                       16);
+   /* regular numbers */
+   __m256i normal = _mm256_or_si256(_mm256_slli_epi32(_mm256_add_epi32(e, _mm256_set1_epi32(112)), 23),
+                                    _mm256_slli_epi32(m, 13));
+   /* zero and denorms, m * 2^-24 is exact */
+   __m256i denorm = _mm256_castps_si256(_mm256_mul_ps(_mm256_cvtepi32_ps(m),
+                                                      _mm256_set1_ps(1.0f / 16777216.0f)));
+   /* infinity and NaN, NaNs get a mantissa of 1 */
+   __m256i special = _mm256_or_si256(_mm256_set1_epi32(0x7f800000),
+                                     _mm256_min_epu32(m, _mm256_set1_epi32(1)));
+   __m256i r;
+
+   r = _mm256_blendv_epi8(normal, denorm,
+                          _mm256_cmpeq_epi32(e, _mm256_setzero_si256()));
+   r = _mm256_blendv_epi8(r, special,
+                          _mm256_cmpeq_epi32(e, _mm256_set1_epi32(0x1f)));
+   return _mm256_or_si256(r, s);
+}
+
+/**
+ * Same as _mesa_float_to_unorm(), minus the final truncation.  NaNs
+ * become 0, as with the C version.
+ */
+static inline __m256i
+float_to_unorm(__m256 f, __m256 max)
+{
+   f = _mm256_max_ps(f, _mm256_setzero_ps());
+   f = _mm256_min_ps(f, _mm256_set1_ps(1.0f));
+   return _mm256_cvtps_epi32(_mm256_mul_ps(f, max));
+}
+
+/**
+ * Swizzle between two formats of the same datatype, 32 bytes at a time.
+ */
+static int
+swizzle_same_type(void *void_dst, const void *void_src, unsigned chan_size,
+                  const uint8_t swizzle[4], uint32_t one, int count)
+{
+   const int pixels = 32 / (4 * chan_size);
+   const __m256i shuffle = get_shuffle_mask(swizzle, chan_size);
+   const __m256i ones = get_one_mask(swizzle, chan_size, one);
+   const uint8_t *src = void_src;
+   uint8_t *dst = void_dst;
+   int i;
+
+   for (i = 0; i + pixels <= count; i += pixels) {
+      __m256i v = _mm256_loadu_si256((const __m256i *) src);
+      v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), ones);
+      _mm256_storeu_si256((__m256i *) dst, v);
+      src += 32;
+      dst += 32;
+   }
+
+   return i;
+}
+
+static int
+convert_ubyte_to_float(float *dst, const uint8_t *src,
+                       const uint8_t swizzle[4], bool normalized, int count)
+{
+   const __m256i shuffle = get_shuffle_mask(swizzle, 1);
+   const __m256i ones = get_one_mask(swizzle, 4, 0x3f800000);
+   const __m256 scale = _mm256_set1_ps(normalized ? 1.0f / 255.0f : 1.0f);
+   int i, k;
+
+   for (i = 0; i + 8 <= count; i += 8) {
+      __m256i v = _mm256_loadu_si256((const __m256i *) src);
+      __m128i half[2];
+
+      v = _mm256_shuffle_epi8(v, shuffle);
+      half[0] = _mm256_castsi256_si128(v);
+      half[1] = _mm256_extracti128_si256(v, 1);
+
+      for (k = 0; k < 4; k++) {
+         __m128i b = k & 1 ? _mm_srli_si128(half[k / 2], 8) : half[k / 2];
+         __m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b)),
+                                  scale);
+         _mm256_storeu_si256((__m256i *) dst,
+                             _mm256_or_si256(_mm256_castps_si256(f), ones));
+         dst += 8;
+      }
+      src += 32;
+   }
+
+   return i;
+}
+
+static int
+convert_ushort_to_float(float *dst, const uint16_t *src,
+                        const uint8_t swizzle[4], bool normalized, bool half,
+                        int count)
+{
+   const __m256i shuffle = get_shuffle_mask(swizzle, 2);
+   const __m256i ones = get_one_mask(swizzle, 4, 0x3f800000);
+   const __m256 scale = _mm256_set1_ps(normalized ? 1.0f / 65535.0f : 1.0f);
+   int i, k;
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      __m256i v = _mm256_loadu_si256((const __m256i *) src);
+
+      v = _mm256_shuffle_epi8(v, shuffle);
+
+      for (k = 0; k < 2; k++) {
+         __m256i u = _mm256_cvtepu16_epi32(k ? _mm256_extracti128_si256(v, 1) :
+                                               _mm256_castsi256_si128(v));
+         __m256i f;
+
+         if (half)
+            f = half_to_float(u);
+         else
+            f = _mm256_castps_si256(_mm256_mul_ps(_mm256_cvtepi32_ps(u),
+                                                  scale));
+
+         _mm256_storeu_si256((__m256i *) dst, _mm256_or_si256(f, ones));
+         dst += 8;
+      }
+      src += 16;
+   }
+
+   return i;
+}
+
+static int
+convert_float_to_unorm8(uint8_t *dst, const float *src,
+                        const uint8_t swizzle[4], int count)
+{
+   const __m256i shuffle = get_shuffle_mask(swizzle, 4);
+   const __m256i ones = get_one_mask(swizzle, 1, UINT8_MAX);
+   /* undoes the lane interleaving of the two packs below */
+   const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+   const __m256 max = _mm256_set1_ps(255.0f);
+   __m256i u[4];
+   int i, k;
+
+   for (i = 0; i + 8 <= count; i += 8) {
+      for (k = 0; k < 4; k++) {
+         __m256i v = _mm256_loadu_si256((const __m256i *) src);
+         v = _mm256_shuffle_epi8(v, shuffle);
+         u[k] = float_to_unorm(_mm256_castsi256_ps(v), max);
+         src += 8;
+      }
+
+      u[0] = _mm256_packus_epi16(_mm256_packus_epi32(u[0], u[1]),
+                                 _mm256_packus_epi32(u[2], u[3]));
+      u[0] = _mm256_permutevar8x32_epi32(u[0], order);
+      _mm256_storeu_si256((__m256i *) dst, _mm256_or_si256(u[0], ones));
+      dst += 32;
+   }
+
+   return i;
+}
+
+static int
+convert_float_to_unorm16(uint16_t *dst, const float *src,
+                         const uint8_t swizzle[4], int count)
+{
+   const __m256i shuffle = get_shuffle_mask(swizzle, 4);
+   const __m256i ones = get_one_mask(swizzle, 2, UINT16_MAX);
+   const __m256 max = _mm256_set1_ps(65535.0f);
+   __m256i u[2];
+   int i, k;
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      __m256i p;
+
+      for (k = 0; k < 2; k++) {
+         __m256i v = _mm256_loadu_si256((const __m256i *) src);
+         v = _mm256_shuffle_epi8(v, shuffle);
+         u[k] = float_to_unorm(_mm256_castsi256_ps(v), max);
+         src += 8;
+      }
+
+      /* undo the lane interleaving of the pack */
+      p = _mm256_permute4x64_epi64(_mm256_packus_epi32(u[0], u[1]),
+                                   _MM_SHUFFLE(3, 1, 2, 0));
+      _mm256_storeu_si256((__m256i *) dst, _mm256_or_si256(p, ones));
+      dst += 16;
+   }
+
+   return i;
+}
+
+int
+_mesa_swizzle_and_convert_avx2(void *dst,
+                               enum mesa_array_format_datatype dst_type,
+                               int num_dst_channels,
+                               const void *src,
+                               enum mesa_array_format_datatype src_type,
+                               int num_src_channels,
+                               const uint8_t swizzle[4], bool normalized,
+                               int count)
+{
+   if (num_src_channels != 4 || num_dst_channels != 4)
+      return 0;
+
+   if (src_type == dst_type) {
+      return swizzle_same_type(dst, src,
+                               _mesa_array_format_datatype_get_size(src_type),
+                               swizzle,
+                               _mesa_swizzle_convert_one_bits(dst_type,
+                                                              normalized),
+                               count);
+   }
+
+   switch (dst_type) {
+   case MESA_ARRAY_FORMAT_TYPE_FLOAT:
+      switch (src_type) {
+      case MESA_ARRAY_FORMAT_TYPE_UBYTE:
+         return convert_ubyte_to_float(dst, src, swizzle, normalized, count);
+      case MESA_ARRAY_FORMAT_TYPE_USHORT:
+         return convert_ushort_to_float(dst, src, swizzle, normalized, false,
+                                        count);
+      case MESA_ARRAY_FORMAT_TYPE_HALF:
+         return convert_ushort_to_float(dst, src, swizzle, false, true,
+                                        count);
+      default:
+         return 0;
+      }
+   case MESA_ARRAY_FORMAT_TYPE_UBYTE:
+      if (src_type == MESA_ARRAY_FORMAT_TYPE_FLOAT && normalized)
+         return convert_float_to_unorm8(dst, src, swizzle, count);
+      return 0;
+   case MESA_ARRAY_FORMAT_TYPE_USHORT:
+      if (src_type == MESA_ARRAY_FORMAT_TYPE_FLOAT && normalized)
+         return convert_float_to_unorm16(dst, src, swizzle, count);
+      return 0;
+   default:
+      return 0;
+   }
+}
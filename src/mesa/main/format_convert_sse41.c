@@ -0,0 +1,284 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * SSE4.1 versions of the common _mesa_swizzle_and_convert() conversions.
+ *
+ * The swizzle is applied to the source pixels with a byte shuffle before
+ * converting, which works since all channels are converted the same way
+ * and a channel which reads as zero converts to zero.  Channels swizzled
+ * to one are ORed in afterwards.
+ */
+
+#include "main/format_convert_x86.h"
+#include <smmintrin.h>
+
+static inline __m128i
+load_mask(const uint8_t mask[16])
+{
+   return _mm_loadu_si128((const __m128i *) mask);
+}
+
+static inline __m128i
+get_shuffle_mask(const uint8_t swizzle[4], unsigned chan_size)
+{
+   uint8_t mask[16];
+   _mesa_swizzle_convert_shuffle_mask(mask, swizzle, chan_size);
+   return load_mask(mask);
+}
+
+static inline __m128i
+get_one_mask(const uint8_t swizzle[4], unsigned chan_size, uint32_t one)
+{
+   uint8_t mask[16];
+   _mesa_swizzle_convert_one_mask(mask, swizzle, chan_size, one);
+   return load_mask(mask);
+}
+
+/**
+ * Same as _mesa_half_to_float() on 4 halves held in the low bits of
+ * 32-bit lanes.
+ */
+static inline __m128i
+half_to_float(__m128i h)
+{
+   const __m128i m = _mm_and_si128(h, _mm_set1_epi32(0x3ff));
+   const __m128i e = _mm_and_si128(_mm_srli_epi32(h, 10),
+                                   _mm_set1_epi32(0x1f));
+   const __m128i s = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)),
+                                    16);
+   /* regular numbers */
+   __m128i normal = _mm_or_si128(_mm_slli_epi32(_mm_add_epi32(e, _mm_set1_epi32(112)), 23),
+                                 _mm_slli_epi32(m, 13));
+   /* zero and denorms, m * 2^-24 is exact */
+   __m128i denorm = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(m),
+                                                _mm_set1_ps(1.0f / 16777216.0f)));
+   /* infinity and NaN, NaNs get a mantissa of 1 */
+   __m128i special = _mm_or_si128(_mm_set1_epi32(0x7f800000),
+                                  _mm_min_epu32(m, _mm_set1_epi32(1)));
+   __m128i r;
+
+   r = _mm_blendv_epi8(normal, denorm,
+                       _mm_cmpeq_epi32(e, _mm_setzero_si128()));
+   r = _mm_blendv_epi8(r, special,
+                       _mm_cmpeq_epi32(e, _mm_set1_epi32(0x1f)));
+   return _mm_or_si128(r, s);
+}
+
+/**
+ * Same as _mesa_float_to_unorm(), minus the final truncation.  NaNs
+ * become 0, as with the C version.
+ */
+static inline __m128i
+float_to_unorm(__m128 f, __m128 max)
+{
+   f = _mm_max_ps(f, _mm_setzero_ps());
+   f = _mm_min_ps(f, _mm_set1_ps(1.0f));
+   return _mm_cvtps_epi32(_mm_mul_ps(f, max));
+}
+
+/**
+ * Swizzle between two formats of the same datatype, 16 bytes at a time.
+ */
+static int
+swizzle_same_type(void *void_dst, const void *void_src, unsigned chan_size,
+                  const uint8_t swizzle[4], uint32_t one, int count)
+{
+   const int pixels = 16 / (4 * chan_size);
+   const __m128i shuffle = get_shuffle_mask(swizzle, chan_size);
+   const __m128i ones = get_one_mask(swizzle, chan_size, one);
+   const uint8_t *src = void_src;
+   uint8_t *dst = void_dst;
+   int i;
+
+   for (i = 0; i + pixels <= count; i += pixels) {
+      __m128i v = _mm_loadu_si128((const __m128i *) src);
+      v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), ones);
+      _mm_storeu_si128((__m128i *) dst, v);
+      src += 16;
+      dst += 16;
+   }
+
+   return i;
+}
+
+static int
+convert_ubyte_to_float(float *dst, const uint8_t *src,
+                       const uint8_t swizzle[4], bool normalized, int count)
+{
+   const __m128i shuffle = get_shuffle_mask(swizzle, 1);
+   const __m128i ones = get_one_mask(swizzle, 4, 0x3f800000);
+   const __m128 scale = _mm_set1_ps(normalized ? 1.0f / 255.0f : 1.0f);
+   int i, k;
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *) src);
+      v = _mm_shuffle_epi8(v, shuffle);
+
+      for (k = 0; k < 4; k++) {
+         __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(v)), scale);
+         _mm_storeu_si128((__m128i *) dst,
+                          _mm_or_si128(_mm_castps_si128(f), ones));
+         v = _mm_srli_si128(v, 4);
+         dst += 4;
+      }
+      src += 16;
+   }
+
+   return i;
+}
+
+static int
+convert_ushort_to_float(float *dst, const uint16_t *src,
+                        const uint8_t swizzle[4], bool normalized, bool half,
+                        int count)
+{
+   const __m128i shuffle = get_shuffle_mask(swizzle, 2);
+   const __m128i ones = get_one_mask(swizzle, 4, 0x3f800000);
+   const __m128 scale = _mm_set1_ps(normalized ? 1.0f / 65535.0f : 1.0f);
+   int i, k;
+
+   for (i = 0; i + 2 <= count; i += 2) {
+      __m128i v = _mm_loadu_si128((const __m128i *) src);
+      v = _mm_shuffle_epi8(v, shuffle);
+
+      for (k = 0; k < 2; k++) {
+         __m128i u = _mm_cvtepu16_epi32(v);
+         __m128i f;
+
+         if (half)
+            f = half_to_float(u);
+         else
+            f = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(u), scale));
+
+         _mm_storeu_si128((__m128i *) dst, _mm_or_si128(f, ones));
+         v = _mm_srli_si128(v, 8);
+         dst += 4;
+      }
+      src += 8;
+   }
+
+   return i;
+}
+
+static int
+convert_float_to_unorm8(uint8_t *dst, const float *src,
+                        const uint8_t swizzle[4], int count)
+{
+   const __m128i shuffle = get_shuffle_mask(swizzle, 4);
+   const __m128i ones = get_one_mask(swizzle, 1, UINT8_MAX);
+   const __m128 max = _mm_set1_ps(255.0f);
+   __m128i u[4];
+   int i, k;
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      for (k = 0; k < 4; k++) {
+         __m128i v = _mm_loadu_si128((const __m128i *) src);
+         v = _mm_shuffle_epi8(v, shuffle);
+         u[k] = float_to_unorm(_mm_castsi128_ps(v), max);
+         src += 4;
+      }
+
+      u[0] = _mm_packus_epi16(_mm_packus_epi32(u[0], u[1]),
+                              _mm_packus_epi32(u[2], u[3]));
+      _mm_storeu_si128((__m128i *) dst, _mm_or_si128(u[0], ones));
+      dst += 16;
+   }
+
+   return i;
+}
+
+static int
+convert_float_to_unorm16(uint16_t *dst, const float *src,
+                         const uint8_t swizzle[4], int count)
+{
+   const __m128i shuffle = get_shuffle_mask(swizzle, 4);
+   const __m128i ones = get_one_mask(swizzle, 2, UINT16_MAX);
+   const __m128 max = _mm_set1_ps(65535.0f);
+   __m128i u[2];
+   int i, k;
+
+   for (i = 0; i + 2 <= count; i += 2) {
+      for (k = 0; k < 2; k++) {
+         __m128i v = _mm_loadu_si128((const __m128i *) src);
+         v = _mm_shuffle_epi8(v, shuffle);
+         u[k] = float_to_unorm(_mm_castsi128_ps(v), max);
+         src += 4;
+      }
+
+      _mm_storeu_si128((__m128i *) dst,
+                       _mm_or_si128(_mm_packus_epi32(u[0], u[1]), ones));
+      dst += 8;
+   }
+
+   return i;
+}
+
+int
+_mesa_swizzle_and_convert_sse41(void *dst,
+                                enum mesa_array_format_datatype dst_type,
+                                int num_dst_channels,
+                                const void *src,
+                                enum mesa_array_format_datatype src_type,
+                                int num_src_channels,
+                                const uint8_t swizzle[4], bool normalized,
+                                int count)
+{
+   if (num_src_channels != 4 || num_dst_channels != 4)
+      return 0;
+
+   if (src_type == dst_type) {
+      return swizzle_same_type(dst, src,
+                               _mesa_array_format_datatype_get_size(src_type),
+                               swizzle,
+                               _mesa_swizzle_convert_one_bits(dst_type,
+                                                              normalized),
+                               count);
+   }
+
+   switch (dst_type) {
+   case MESA_ARRAY_FORMAT_TYPE_FLOAT:
+      switch (src_type) {
+      case MESA_ARRAY_FORMAT_TYPE_UBYTE:
+         return convert_ubyte_to_float(dst, src, swizzle, normalized, count);
+      case MESA_ARRAY_FORMAT_TYPE_USHORT:
+         return convert_ushort_to_float(dst, src, swizzle, normalized, false,
+                                        count);
+      case MESA_ARRAY_FORMAT_TYPE_HALF:
+         return convert_ushort_to_float(dst, src, swizzle, false, true,
+                                        count);
+      default:
+         return 0;
+      }
+   case MESA_ARRAY_FORMAT_TYPE_UBYTE:
+      if (src_type == MESA_ARRAY_FORMAT_TYPE_FLOAT && normalized)
+         return convert_float_to_unorm8(dst, src, swizzle, count);
+      return 0;
+   case MESA_ARRAY_FORMAT_TYPE_USHORT:
+      if (src_type == MESA_ARRAY_FORMAT_TYPE_FLOAT && normalized)
+         return convert_float_to_unorm16(dst, src, swizzle, count);
+      return 0;
+   default:
+      return 0;
+   }
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef FORMAT_CONVERT_X86_H
+#define FORMAT_CONVERT_X86_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "main/formats.h"
+
+/**
+ * Vectorized versions of _mesa_swizzle_and_convert() for the most common
+ * conversions between 4-channel array formats.
+ *
+ * They give bit-identical results to the C conversion loops.  As the
+ * vectors hold several pixels, only a multiple of the vector width is
+ * converted; the number of pixels converted is returned, 0 if the
+ * conversion isn't supported.
+ */
+int
+_mesa_swizzle_and_convert_sse41(void *dst,
+                                enum mesa_array_format_datatype dst_type,
+                                int num_dst_channels,
+                                const void *src,
+                                enum mesa_array_format_datatype src_type,
+                                int num_src_channels,
+                                const uint8_t swizzle[4], bool normalized,
+                                int count);
+
+int
+_mesa_swizzle_and_convert_avx2(void *dst,
+                               enum mesa_array_format_datatype dst_type,
+                               int num_dst_channels,
+                               const void *src,
+                               enum mesa_array_format_datatype src_type,
+                               int num_src_channels,
+                               const uint8_t swizzle[4], bool normalized,
+                               int count);
+
+/* Helpers shared by the implementations above */
+
+/**
+ * Returns the bit pattern of the value a channel set to
+ * MESA_FORMAT_SWIZZLE_ONE has for the given datatype, as used by the C
+ * conversion loops.
+ */
+static inline uint32_t
+_mesa_swizzle_convert_one_bits(enum mesa_array_format_datatype type,
+                               bool normalized)
+{
+   switch (type) {
+   case MESA_ARRAY_FORMAT_TYPE_UBYTE:
+      return normalized ? UINT8_MAX : 1;
+   case MESA_ARRAY_FORMAT_TYPE_BYTE:
+      return normalized ? INT8_MAX : 1;
+   case MESA_ARRAY_FORMAT_TYPE_USHORT:
+      return normalized ? UINT16_MAX : 1;
+   case MESA_ARRAY_FORMAT_TYPE_SHORT:
+      return normalized ? INT16_MAX : 1;
+   case MESA_ARRAY_FORMAT_TYPE_UINT:
+      return normalized ? UINT32_MAX : 1;
+   case MESA_ARRAY_FORMAT_TYPE_INT:
+      return normalized ? INT32_MAX : 1;
+   case MESA_ARRAY_FORMAT_TYPE_HALF:
+      return 0x3c00;
+   case MESA_ARRAY_FORMAT_TYPE_FLOAT:
+      return 0x3f800000;
+   default:
+      return 0;
+   }
+}
+
+/**
+ * Fills 16 bytes of a byte shuffle mask (pshufb style) which applies the
+ * swizzle to each pixel of 4 channels of chan_size bytes.  Channels which
+ * don't come from the source select zero.
+ */
+static inline void
+_mesa_swizzle_convert_shuffle_mask(uint8_t mask[16], const uint8_t swizzle[4],
+                                   unsigned chan_size)
+{
+   const unsigned pixel_size = 4 * chan_size;
+   unsigned i;
+
+   for (i = 0; i < 16; i++) {
+      const unsigned pixel = i / pixel_size;
+      const unsigned chan = (i % pixel_size) / chan_size;
+      const unsigned byte = i % chan_size;
+
+      if (swizzle[chan] < 4)
+         mask[i] = pixel * pixel_size + swizzle[chan] * chan_size + byte;
+      else
+         mask[i] = 0x80;
+   }
+}
+
+/**
+ * Fills 16 bytes with the bits to OR into each pixel of 4 channels of
+ * chan_size bytes to set the channels swizzled to one.
+ */
+static inline void
+_mesa_swizzle_convert_one_mask(uint8_t mask[16], const uint8_t swizzle[4],
+                               unsigned chan_size, uint32_t one)
+{
+   const unsigned pixel_size = 4 * chan_size;
+   unsigned i;
+
+   for (i = 0; i < 16; i++) {
+      const unsigned chan = (i % pixel_size) / chan_size;
+      const unsigned byte = i % chan_size;
+
+      if (swizzle[chan] == MESA_FORMAT_SWIZZLE_ONE)
+         mask[i] = (one >> (8 * byte)) & 0xff;
+      else
+         mask[i] = 0;
+   }
+}
+
+#endif /* FORMAT_CONVERT_X86_H */
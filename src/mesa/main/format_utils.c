@@ -22,10 +22,18 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdlib.h>
+#if defined(HAVE_PTHREAD)
+#include <unistd.h>
+#endif
+
 #include "format_utils.h"
 #include "glformats.h"
 #include "format_pack.h"
 #include "format_unpack.h"
+#include "format_convert_x86.h"
+#include "x86/common_x86_asm.h"
+#include "util/u_queue.h"
 
 const mesa_array_format RGBA32_FLOAT =
    MESA_ARRAY_FORMAT(4, 1, 1, 1, 4, 0, 1, 2, 3);
@@ -237,36 +245,12 @@ convert_ubyte_rgba_to_bgra(size_t width, size_t height,
 
 
 /**
- * This can be used to convert between most color formats.
- *
- * Limitations:
- * - This function doesn't handle GL_COLOR_INDEX or YCBCR formats.
- * - This function doesn't handle byte-swapping or transferOps, these should
- *   be handled by the caller.
- *
- * \param void_dst  The address where converted color data will be stored.
- *                  The caller must ensure that the buffer is large enough
- *                  to hold the converted pixel data.
- * \param dst_format  The destination color format. It can be a mesa_format
- *                    or a mesa_array_format represented as an uint32_t.
- * \param dst_stride  The stride of the destination format in bytes.
- * \param void_src  The address of the source color data to convert.
- * \param src_format  The source color format. It can be a mesa_format
- *                    or a mesa_array_format represented as an uint32_t.
- * \param src_stride  The stride of the source format in bytes.
- * \param width  The width, in pixels, of the source image to convert.
- * \param height  The height, in pixels, of the source image to convert.
- * \param rebase_swizzle  A swizzle transform to apply during the conversion,
- *                        typically used to match a different internal base
- *                        format involved. NULL if no rebase transform is needed
- *                        (i.e. the internal base format and the base format of
- *                        the dst or the src -depending on whether we are doing
- *                        an upload or a download respectively- are the same).
+ * Does the actual work of _mesa_format_convert(), see below.
  */
-void
-_mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
-                     void *void_src, uint32_t src_format, size_t src_stride,
-                     size_t width, size_t height, uint8_t *rebase_swizzle)
+static void
+format_convert_rows(void *void_dst, uint32_t dst_format, size_t dst_stride,
+                    void *void_src, uint32_t src_format, size_t src_stride,
+                    size_t width, size_t height, uint8_t *rebase_swizzle)
 {
    uint8_t *dst = (uint8_t *)void_dst;
    uint8_t *src = (uint8_t *)void_src;
@@ -632,6 +616,146 @@ _mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
    }
 }
 
+
+/* Images with at least this many pixels are converted by several threads,
+ * each one converting a band of rows.
+ */
+#define CONVERT_THREAD_MIN_PIXELS (256 * 256)
+#define CONVERT_MAX_THREADS 8
+
+struct format_convert_job {
+   struct util_queue_fence fence;
+   uint8_t *dst;
+   uint32_t dst_format;
+   size_t dst_stride;
+   uint8_t *src;
+   uint32_t src_format;
+   size_t src_stride;
+   size_t width, height;
+   uint8_t *rebase_swizzle;
+};
+
+static struct util_queue convert_queue;
+static unsigned convert_num_threads = 1;
+static once_flag convert_queue_once = ONCE_FLAG_INIT;
+
+static void
+init_convert_queue(void)
+{
+   unsigned num_threads = 1;
+   const char *str;
+
+#if defined(HAVE_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+   long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   if (num_cpus > 0)
+      num_threads = MIN2(num_cpus, CONVERT_MAX_THREADS);
+#endif
+
+   /* MESA_FORMAT_CONVERT_THREADS=1 disables the threading */
+   str = getenv("MESA_FORMAT_CONVERT_THREADS");
+   if (str)
+      num_threads = CLAMP(atoi(str), 1, CONVERT_MAX_THREADS);
+
+   /* The calling thread converts a band too. */
+   if (num_threads > 1 &&
+       util_queue_init(&convert_queue, "mesacvt", CONVERT_MAX_THREADS,
+                       num_threads - 1, 0))
+      convert_num_threads = num_threads;
+}
+
+static void
+format_convert_job_execute(void *data, int thread_index)
+{
+   struct format_convert_job *job = data;
+
+   format_convert_rows(job->dst, job->dst_format, job->dst_stride,
+                       job->src, job->src_format, job->src_stride,
+                       job->width, job->height, job->rebase_swizzle);
+}
+
+/**
+ * This can be used to convert between most color formats.
+ *
+ * Limitations:
+ * - This function doesn't handle GL_COLOR_INDEX or YCBCR formats.
+ * - This function doesn't handle byte-swapping or transferOps, these should
+ *   be handled by the caller.
+ *
+ * \param void_dst  The address where converted color data will be stored.
+ *                  The caller must ensure that the buffer is large enough
+ *                  to hold the converted pixel data.
+ * \param dst_format  The destination color format. It can be a mesa_format
+ *                    or a mesa_array_format represented as an uint32_t.
+ * \param dst_stride  The stride of the destination format in bytes.
+ * \param void_src  The address of the source color data to convert.
+ * \param src_format  The source color format. It can be a mesa_format
+ *                    or a mesa_array_format represented as an uint32_t.
+ * \param src_stride  The stride of the source format in bytes.
+ * \param width  The width, in pixels, of the source image to convert.
+ * \param height  The height, in pixels, of the source image to convert.
+ * \param rebase_swizzle  A swizzle transform to apply during the conversion,
+ *                        typically used to match a different internal base
+ *                        format involved. NULL if no rebase transform is needed
+ *                        (i.e. the internal base format and the base format of
+ *                        the dst or the src -depending on whether we are doing
+ *                        an upload or a download respectively- are the same).
+ */
+void
+_mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
+                     void *void_src, uint32_t src_format, size_t src_stride,
+                     size_t width, size_t height, uint8_t *rebase_swizzle)
+{
+   struct format_convert_job jobs[CONVERT_MAX_THREADS];
+   size_t rows_per_job, row;
+   unsigned num_jobs, i;
+
+   if (width * height >= CONVERT_THREAD_MIN_PIXELS) {
+      call_once(&convert_queue_once, init_convert_queue);
+      num_jobs = MIN2(convert_num_threads, height);
+   } else {
+      num_jobs = 1;
+   }
+
+   if (num_jobs <= 1) {
+      format_convert_rows(void_dst, dst_format, dst_stride,
+                          void_src, src_format, src_stride,
+                          width, height, rebase_swizzle);
+      return;
+   }
+
+   /* Every row is converted independently, so split the image in bands
+    * of rows and hand all but the first one to the worker threads.
+    */
+   rows_per_job = DIV_ROUND_UP(height, num_jobs);
+   for (i = 0, row = 0; row < height; i++, row += rows_per_job) {
+      struct format_convert_job *job = &jobs[i];
+
+      job->dst = (uint8_t *)void_dst + row * dst_stride;
+      job->dst_format = dst_format;
+      job->dst_stride = dst_stride;
+      job->src = (uint8_t *)void_src + row * src_stride;
+      job->src_format = src_format;
+      job->src_stride = src_stride;
+      job->width = width;
+      job->height = MIN2(rows_per_job, height - row);
+      job->rebase_swizzle = rebase_swizzle;
+
+      if (i > 0) {
+         util_queue_fence_init(&job->fence);
+         util_queue_add_job(&convert_queue, job, &job->fence,
+                            format_convert_job_execute, NULL);
+      }
+   }
+   num_jobs = i;
+
+   format_convert_job_execute(&jobs[0], 0);
+
+   for (i = 1; i < num_jobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
 static const uint8_t map_identity[7] = { 0, 1, 2, 3, 4, 5, 6 };
 static const uint8_t map_3210[7] = { 3, 2, 1, 0, 4, 5, 6 };
 static const uint8_t map_1032[7] = { 1, 0, 3, 2, 4, 5, 6 };
@@ -777,6 +901,44 @@ swizzle_convert_try_memcpy(void *dst,
    return true;
 }
 
+/**
+ * Attempts to perform the given swizzle-and-convert operation with SIMD
+ * instructions.
+ *
+ * \return  the number of pixels converted, which may be less than count
+ *          since the vectors hold several pixels.
+ */
+static int
+swizzle_convert_try_simd(void *dst,
+                         enum mesa_array_format_datatype dst_type,
+                         int num_dst_channels,
+                         const void *src,
+                         enum mesa_array_format_datatype src_type,
+                         int num_src_channels,
+                         const uint8_t swizzle[4], bool normalized, int count)
+{
+   int converted = 0;
+
+#if defined(USE_AVX2)
+   if (cpu_has_avx2)
+      converted = _mesa_swizzle_and_convert_avx2(dst, dst_type,
+                                                 num_dst_channels,
+                                                 src, src_type,
+                                                 num_src_channels,
+                                                 swizzle, normalized, count);
+#endif
+#if defined(USE_SSE41)
+   if (!converted && cpu_has_sse4_1)
+      converted = _mesa_swizzle_and_convert_sse41(dst, dst_type,
+                                                  num_dst_channels,
+                                                  src, src_type,
+                                                  num_src_channels,
+                                                  swizzle, normalized, count);
+#endif
+
+   return converted;
+}
+
 /**
  * Represents a single instance of the standard swizzle-and-convert loop
  *
@@ -1491,11 +1653,27 @@ _mesa_swizzle_and_convert(void *void_dst, enum mesa_array_format_datatype dst_ty
                           const void *void_src, enum mesa_array_format_datatype src_type, int num_src_channels,
                           const uint8_t swizzle[4], bool normalized, int count)
 {
+   int converted;
+
    if (swizzle_convert_try_memcpy(void_dst, dst_type, num_dst_channels,
                                   void_src, src_type, num_src_channels,
                                   swizzle, normalized, count))
       return;
 
+   converted = swizzle_convert_try_simd(void_dst, dst_type, num_dst_channels,
+                                        void_src, src_type, num_src_channels,
+                                        swizzle, normalized, count);
+   if (converted) {
+      /* Convert the remaining pixels below */
+      void_dst = (uint8_t *)void_dst + converted * num_dst_channels *
+                 _mesa_array_format_datatype_get_size(dst_type);
+      void_src = (const uint8_t *)void_src + converted * num_src_channels *
+                 _mesa_array_format_datatype_get_size(src_type);
+      count -= converted;
+      if (!count)
+         return;
+   }
+
    switch (dst_type) {
    case MESA_ARRAY_FORMAT_TYPE_FLOAT:
       convert_float(void_dst, num_dst_channels, void_src, src_type,
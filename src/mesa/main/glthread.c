@@ -94,6 +94,7 @@ _mesa_glthread_init(struct gl_context *ctx)
    glthread->stats.queue = &glthread->queue;
    ctx->CurrentClientDispatch = ctx->MarshalExec;
    ctx->GLThread = glthread;
+   _mesa_glthread_init_shadow(ctx);
 
    /* Execute the thread initialization function in the thread. */
    struct util_queue_fence fence;
@@ -118,6 +119,7 @@ _mesa_glthread_destroy(struct gl_context *ctx)
    for (unsigned i = 0; i < MARSHAL_MAX_BATCHES; i++)
       util_queue_fence_destroy(&glthread->batches[i].fence);
 
+   _mesa_glthread_destroy_shadow(ctx);
    free(glthread);
    ctx->GLThread = NULL;
 
@@ -51,6 +51,103 @@
 
 enum marshal_dispatch_cmd_id;
 
+/**
+ * Groups of state mirrored by struct glthread_shadow, as bits of
+ * glthread_shadow::known.
+ */
+enum glthread_shadow_bit
+{
+   GLTHREAD_SHADOW_ACTIVE_TEXTURE        = (1 << 0),
+   GLTHREAD_SHADOW_CLIENT_ACTIVE_TEXTURE = (1 << 1),
+   GLTHREAD_SHADOW_MATRIX_MODE           = (1 << 2),
+   GLTHREAD_SHADOW_MODELVIEW             = (1 << 3),
+   GLTHREAD_SHADOW_PROJECTION            = (1 << 4),
+   GLTHREAD_SHADOW_ARRAY_BUFFER          = (1 << 5),
+   GLTHREAD_SHADOW_ELEMENT_ARRAY_BUFFER  = (1 << 6),
+   GLTHREAD_SHADOW_VERTEX_ARRAY          = (1 << 7),
+   GLTHREAD_SHADOW_PROGRAM               = (1 << 8),
+   GLTHREAD_SHADOW_FRAMEBUFFERS          = (1 << 9),
+   GLTHREAD_SHADOW_RENDERBUFFER          = (1 << 10),
+   GLTHREAD_SHADOW_TEXTURES              = (1 << 11),
+   GLTHREAD_SHADOW_VIEWPORT              = (1 << 12),
+   GLTHREAD_SHADOW_SCISSOR               = (1 << 13),
+   GLTHREAD_SHADOW_ENABLES               = (1 << 14),
+   GLTHREAD_SHADOW_CLIENT_ARRAYS         = (1 << 15),
+   GLTHREAD_SHADOW_PRIMITIVE_RESTART     = (1 << 16),
+   GLTHREAD_SHADOW_ALL                   = (1 << 17) - 1,
+};
+
+/** Texture targets whose bindings are mirrored, per texture unit. */
+enum glthread_shadow_texture_target
+{
+   GLTHREAD_SHADOW_TEXTURE_2D,
+   GLTHREAD_SHADOW_TEXTURE_3D,
+   GLTHREAD_SHADOW_TEXTURE_CUBE_MAP,
+   GLTHREAD_SHADOW_NUM_TEXTURE_TARGETS
+};
+
+/** Copy of the modelview or projection matrix stack. */
+struct glthread_matrix_stack
+{
+   GLmatrix *Stack;
+   GLuint Depth;
+   GLuint MaxDepth;
+};
+
+/** Vertex array of the default vertex array object. */
+struct glthread_attrib
+{
+   const GLubyte *Pointer;  /**< user pointer, or offset in the VBO */
+   GLsizei Stride;          /**< in bytes, never 0 */
+   GLuint ElementSize;      /**< in bytes */
+   GLuint Divisor;
+};
+
+/**
+ * Copy of the context state most often queried by applications, kept by the
+ * application thread so that glGet*() and glIsEnabled() can be answered
+ * without waiting for the worker thread.  See glthread_shadow.c.
+ */
+struct glthread_shadow
+{
+   /** GLTHREAD_SHADOW_* groups of state whose copy is up to date. */
+   GLbitfield known;
+
+   GLuint ActiveTexture;        /**< texture unit, not GL_TEXTUREi */
+   GLuint ClientActiveTexture;  /**< texture unit, not GL_TEXTUREi */
+   GLenum MatrixMode;
+   struct glthread_matrix_stack Modelview;
+   struct glthread_matrix_stack Projection;
+
+   GLuint ArrayBuffer;
+   GLuint ElementArrayBuffer;
+   GLuint VertexArray;
+   GLuint Program;
+   GLuint DrawFramebuffer;
+   GLuint ReadFramebuffer;
+   GLuint Renderbuffer;
+   GLuint Textures[MAX_COMBINED_TEXTURE_IMAGE_UNITS][GLTHREAD_SHADOW_NUM_TEXTURE_TARGETS];
+
+   GLfloat Viewport[4];
+   GLint Scissor[4];
+
+   /** Bitmask of the enabled caps, indexed like glthread_shadow.c's list. */
+   GLbitfield Enables;
+
+   /**
+    * Vertex arrays, which draws need to copy when they aren't in VBOs.  Only
+    * known for the default vertex array object, which is the only one usable
+    * with glthread in compatibility and GLES contexts.
+    */
+   struct glthread_attrib Attribs[VERT_ATTRIB_MAX];
+   GLbitfield64 EnabledAttribs;
+   GLbitfield64 UserAttribs;     /**< arrays not in a VBO */
+
+   bool PrimitiveRestart;
+   bool PrimitiveRestartFixedIndex;
+   GLuint RestartIndex;
+};
+
 /** A single batch of commands queued up for execution. */
 struct glthread_batch
 {
@@ -84,17 +181,8 @@ struct glthread_state
    /** Index of the batch being filled and about to be submitted. */
    unsigned next;
 
-   /**
-    * Tracks on the main thread side whether the current vertex array binding
-    * is in a VBO.
-    */
-   bool vertex_array_is_vbo;
-
-   /**
-    * Tracks on the main thread side whether the current element array (index
-    * buffer) binding is in a VBO.
-    */
-   bool element_array_is_vbo;
+   /** State mirrored for queries and draws. */
+   struct glthread_shadow shadow;
 };
 
 void _mesa_glthread_init(struct gl_context *ctx);
@@ -104,4 +192,101 @@ void _mesa_glthread_restore_dispatch(struct gl_context *ctx);
 void _mesa_glthread_flush_batch(struct gl_context *ctx);
 void _mesa_glthread_finish(struct gl_context *ctx);
 
+/* glthread_shadow.c */
+void _mesa_glthread_init_shadow(struct gl_context *ctx);
+void _mesa_glthread_destroy_shadow(struct gl_context *ctx);
+void _mesa_glthread_invalidate_shadow(struct gl_context *ctx,
+                                      GLbitfield bits);
+bool _mesa_glthread_sync_shadow(struct gl_context *ctx, GLbitfield bits);
+
+void _mesa_glthread_ActiveTexture(struct gl_context *ctx, GLenum texture);
+void _mesa_glthread_ClientActiveTexture(struct gl_context *ctx,
+                                        GLenum texture);
+void _mesa_glthread_MatrixMode(struct gl_context *ctx, GLenum mode);
+void _mesa_glthread_PushMatrix(struct gl_context *ctx);
+void _mesa_glthread_PopMatrix(struct gl_context *ctx);
+void _mesa_glthread_LoadIdentity(struct gl_context *ctx);
+void _mesa_glthread_LoadMatrixf(struct gl_context *ctx, const GLfloat *m);
+void _mesa_glthread_LoadMatrixd(struct gl_context *ctx, const GLdouble *m);
+void _mesa_glthread_LoadTransposeMatrixf(struct gl_context *ctx,
+                                         const GLfloat *m);
+void _mesa_glthread_LoadTransposeMatrixd(struct gl_context *ctx,
+                                         const GLdouble *m);
+void _mesa_glthread_MultMatrixf(struct gl_context *ctx, const GLfloat *m);
+void _mesa_glthread_MultMatrixd(struct gl_context *ctx, const GLdouble *m);
+void _mesa_glthread_MultTransposeMatrixf(struct gl_context *ctx,
+                                         const GLfloat *m);
+void _mesa_glthread_MultTransposeMatrixd(struct gl_context *ctx,
+                                         const GLdouble *m);
+void _mesa_glthread_Rotatef(struct gl_context *ctx, GLfloat angle,
+                            GLfloat x, GLfloat y, GLfloat z);
+void _mesa_glthread_Scalef(struct gl_context *ctx,
+                           GLfloat x, GLfloat y, GLfloat z);
+void _mesa_glthread_Translatef(struct gl_context *ctx,
+                               GLfloat x, GLfloat y, GLfloat z);
+void _mesa_glthread_Ortho(struct gl_context *ctx, GLdouble left,
+                          GLdouble right, GLdouble bottom, GLdouble top,
+                          GLdouble nearval, GLdouble farval);
+void _mesa_glthread_Frustum(struct gl_context *ctx, GLdouble left,
+                            GLdouble right, GLdouble bottom, GLdouble top,
+                            GLdouble nearval, GLdouble farval);
+void _mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                               GLuint buffer);
+void _mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *buffers);
+void _mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint array);
+void _mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                       const GLuint *arrays);
+void _mesa_glthread_UseProgram(struct gl_context *ctx, GLuint program);
+void _mesa_glthread_BindFramebuffer(struct gl_context *ctx, GLenum target,
+                                    GLuint framebuffer, bool allow_user_names);
+void _mesa_glthread_DeleteFramebuffers(struct gl_context *ctx, GLsizei n,
+                                       const GLuint *framebuffers);
+void _mesa_glthread_BindRenderbuffer(struct gl_context *ctx, GLenum target,
+                                     GLuint renderbuffer, bool allow_user_names);
+void _mesa_glthread_DeleteRenderbuffers(struct gl_context *ctx, GLsizei n,
+                                        const GLuint *renderbuffers);
+void _mesa_glthread_BindTexture(struct gl_context *ctx, GLenum target,
+                                GLuint texture);
+void _mesa_glthread_DeleteTextures(struct gl_context *ctx, GLsizei n,
+                                   const GLuint *textures);
+void _mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                             GLsizei width, GLsizei height);
+void _mesa_glthread_Scissor(struct gl_context *ctx, GLint x, GLint y,
+                            GLsizei width, GLsizei height);
+void _mesa_glthread_Enable(struct gl_context *ctx, GLenum cap,
+                           GLboolean state);
+void _mesa_glthread_PrimitiveRestartIndex(struct gl_context *ctx,
+                                          GLuint index);
+void _mesa_glthread_AttribPointer(struct gl_context *ctx,
+                                  gl_vert_attrib attrib, GLint size,
+                                  GLenum type, GLsizei stride,
+                                  const GLvoid *pointer);
+void _mesa_glthread_TexCoordPointer(struct gl_context *ctx, GLint size,
+                                    GLenum type, GLsizei stride,
+                                    const GLvoid *pointer);
+void _mesa_glthread_VertexAttribPointer(struct gl_context *ctx, GLuint index,
+                                        GLint size, GLenum type,
+                                        GLsizei stride, const GLvoid *pointer);
+void _mesa_glthread_EnableClientState(struct gl_context *ctx, GLenum array,
+                                      GLboolean state);
+void _mesa_glthread_EnableVertexAttribArray(struct gl_context *ctx,
+                                            GLuint index, GLboolean state);
+void _mesa_glthread_VertexAttribDivisor(struct gl_context *ctx, GLuint index,
+                                        GLuint divisor);
+
+bool _mesa_glthread_GetBooleanv(struct gl_context *ctx, GLenum pname,
+                                GLboolean *params);
+bool _mesa_glthread_GetIntegerv(struct gl_context *ctx, GLenum pname,
+                                GLint *params);
+bool _mesa_glthread_GetFloatv(struct gl_context *ctx, GLenum pname,
+                              GLfloat *params);
+bool _mesa_glthread_GetDoublev(struct gl_context *ctx, GLenum pname,
+                               GLdouble *params);
+bool _mesa_glthread_IsEnabled(struct gl_context *ctx, GLenum cap,
+                              GLboolean *result);
+
+/* glthread_draw.c */
+bool _mesa_glthread_has_user_arrays(const struct gl_context *ctx);
+
 #endif /* _GLTHREAD_H*/
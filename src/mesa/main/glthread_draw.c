@@ -0,0 +1,692 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** \file glthread_draw.c
+ *
+ * Marshalling of draws which may read vertices or indices from client
+ * memory.
+ *
+ * The application may change or free client memory as soon as the draw
+ * returns, so the vertices and indices the draw will read are copied on the
+ * application thread.  The range of vertices comes from the draw
+ * parameters, or from a scan of the indices.  The copies go in the command
+ * itself when they fit, and in a heap block otherwise.  The worker thread
+ * then points the vertex arrays at the copies for the duration of the draw,
+ * and the driver uploads them like any other user arrays.
+ *
+ * Which arrays are enabled and in client memory is known from the shadow
+ * state (see glthread_shadow.c).  Draws fall back to synchronizing when it
+ * isn't known, or when the indices are in a VBO with no range given.
+ */
+
+#include "main/glthread.h"
+#include "main/marshal.h"
+#include "main/dispatch.h"
+#include "main/marshal_generated.h"
+#include "main/varray.h"
+#include "util/bitscan.h"
+
+/** Parameters of all the draws marshalled here. */
+struct glthread_draw
+{
+   GLenum mode;
+   GLenum type;
+   GLint first;
+   GLsizei count;
+   GLsizei primcount;
+   GLint basevertex;
+   GLuint baseinstance;
+   GLuint start;
+   GLuint end;
+   const GLvoid *indices;
+};
+
+/** A copied vertex array, as seen by the draw. */
+struct glthread_draw_attrib
+{
+   GLuint attrib;
+   const GLubyte *pointer;
+};
+
+/* Draw*: marshalled asynchronously */
+struct marshal_cmd_Draw
+{
+   struct marshal_cmd_base cmd_base;
+   struct glthread_draw draw;
+   /** Copied data when it didn't fit in the command, freed by the worker. */
+   void *heap;
+   GLuint num_attribs;
+   /* Next: struct glthread_draw_attrib attribs[num_attribs] */
+   /* Next: the copied vertices and indices, unless in heap */
+};
+
+static void
+call_draw(struct gl_context *ctx, uint16_t cmd_id,
+          const struct glthread_draw *d)
+{
+   struct _glapi_table *dispatch = ctx->CurrentServerDispatch;
+
+   switch (cmd_id) {
+   case DISPATCH_CMD_DrawArrays:
+      CALL_DrawArrays(dispatch, (d->mode, d->first, d->count));
+      break;
+   case DISPATCH_CMD_DrawArraysInstancedARB:
+      CALL_DrawArraysInstancedARB(dispatch, (d->mode, d->first, d->count,
+                                             d->primcount));
+      break;
+   case DISPATCH_CMD_DrawArraysInstancedBaseInstance:
+      CALL_DrawArraysInstancedBaseInstance(dispatch,
+                                           (d->mode, d->first, d->count,
+                                            d->primcount, d->baseinstance));
+      break;
+   case DISPATCH_CMD_DrawElements:
+      CALL_DrawElements(dispatch, (d->mode, d->count, d->type, d->indices));
+      break;
+   case DISPATCH_CMD_DrawRangeElements:
+      CALL_DrawRangeElements(dispatch, (d->mode, d->start, d->end, d->count,
+                                        d->type, d->indices));
+      break;
+   case DISPATCH_CMD_DrawElementsInstancedARB:
+      CALL_DrawElementsInstancedARB(dispatch, (d->mode, d->count, d->type,
+                                               d->indices, d->primcount));
+      break;
+   case DISPATCH_CMD_DrawElementsBaseVertex:
+      CALL_DrawElementsBaseVertex(dispatch, (d->mode, d->count, d->type,
+                                             d->indices, d->basevertex));
+      break;
+   case DISPATCH_CMD_DrawRangeElementsBaseVertex:
+      CALL_DrawRangeElementsBaseVertex(dispatch,
+                                       (d->mode, d->start, d->end, d->count,
+                                        d->type, d->indices, d->basevertex));
+      break;
+   case DISPATCH_CMD_DrawElementsInstancedBaseVertex:
+      CALL_DrawElementsInstancedBaseVertex(dispatch,
+                                           (d->mode, d->count, d->type,
+                                            d->indices, d->primcount,
+                                            d->basevertex));
+      break;
+   case DISPATCH_CMD_DrawElementsInstancedBaseInstance:
+      CALL_DrawElementsInstancedBaseInstance(dispatch,
+                                             (d->mode, d->count, d->type,
+                                              d->indices, d->primcount,
+                                              d->baseinstance));
+      break;
+   case DISPATCH_CMD_DrawElementsInstancedBaseVertexBaseInstance:
+      CALL_DrawElementsInstancedBaseVertexBaseInstance(dispatch,
+                                                       (d->mode, d->count,
+                                                        d->type, d->indices,
+                                                        d->primcount,
+                                                        d->basevertex,
+                                                        d->baseinstance));
+      break;
+   default:
+      unreachable("not a glthread draw");
+   }
+}
+
+static void
+set_attrib_pointer(struct gl_context *ctx, GLuint attrib,
+                   const GLubyte *pointer)
+{
+   struct gl_vertex_array_object *vao = ctx->Array.VAO;
+
+   FLUSH_VERTICES(ctx, _NEW_ARRAY);
+   vao->VertexAttrib[attrib].Ptr = pointer;
+   vao->NewArrays |= VERT_BIT(attrib);
+}
+
+static void
+unmarshal_draw(struct gl_context *ctx, const struct marshal_cmd_Draw *cmd)
+{
+   struct gl_vertex_array_object *vao = ctx->Array.VAO;
+   const struct glthread_draw_attrib *attribs =
+      (const struct glthread_draw_attrib *) (cmd + 1);
+   const GLubyte *saved[VERT_ATTRIB_MAX];
+   GLuint i;
+
+   for (i = 0; i < cmd->num_attribs; i++) {
+      saved[i] = vao->VertexAttrib[attribs[i].attrib].Ptr;
+      set_attrib_pointer(ctx, attribs[i].attrib, attribs[i].pointer);
+   }
+
+   call_draw(ctx, cmd->cmd_base.cmd_id, &cmd->draw);
+
+   for (i = 0; i < cmd->num_attribs; i++)
+      set_attrib_pointer(ctx, attribs[i].attrib, saved[i]);
+
+   free(cmd->heap);
+}
+
+static unsigned
+get_index_size(GLenum type)
+{
+   switch (type) {
+   case GL_UNSIGNED_BYTE:
+      return 1;
+   case GL_UNSIGNED_SHORT:
+      return 2;
+   case GL_UNSIGNED_INT:
+      return 4;
+   default:
+      return 0;
+   }
+}
+
+/**
+ * Finds the smallest and largest index, ignoring the primitive restart
+ * index.  Returns false if all the indices are restart indices.
+ */
+static bool
+get_index_range(const struct glthread_shadow *shadow,
+                const struct glthread_draw *draw, unsigned index_size,
+                GLuint *min_index, GLuint *max_index)
+{
+   const bool restart = shadow->PrimitiveRestart ||
+                        shadow->PrimitiveRestartFixedIndex;
+   const GLuint restart_index = shadow->PrimitiveRestartFixedIndex ?
+      0xffffffffu >> 8 * (4 - index_size) : shadow->RestartIndex;
+   GLuint min = ~0u, max = 0;
+   GLsizei i;
+
+#define SCAN_INDICES(T)                                  \
+   do {                                                  \
+      const T *indices = (const T *) draw->indices;      \
+      for (i = 0; i < draw->count; i++) {                \
+         const GLuint index = indices[i];                \
+         if (restart && index == restart_index)          \
+            continue;                                    \
+         min = MIN2(min, index);                         \
+         max = MAX2(max, index);                         \
+      }                                                  \
+   } while (0)
+
+   switch (index_size) {
+   case 1:
+      SCAN_INDICES(GLubyte);
+      break;
+   case 2:
+      SCAN_INDICES(GLushort);
+      break;
+   default:
+      SCAN_INDICES(GLuint);
+      break;
+   }
+
+#undef SCAN_INDICES
+
+   *min_index = min;
+   *max_index = max;
+   return min <= max;
+}
+
+/**
+ * Copies the vertices of one array, from element \p start to \p start +
+ * \p num - 1, and returns where the draw should see the array start.
+ */
+static const GLubyte *
+copy_attrib(const struct glthread_attrib *array, GLubyte *dst,
+            GLuint start, GLuint num)
+{
+   const size_t offset = (size_t) start * array->Stride;
+
+   memcpy(dst, array->Pointer + offset,
+          (size_t) (num - 1) * array->Stride + array->ElementSize);
+   return (const GLubyte *) ((uintptr_t) dst - offset);
+}
+
+static void
+draw_sync(struct gl_context *ctx, uint16_t cmd_id,
+          const struct glthread_draw *draw)
+{
+   _mesa_glthread_finish(ctx);
+   call_draw(ctx, cmd_id, draw);
+}
+
+/**
+ * Queues a draw, with copies of the data it reads from client memory.
+ *
+ * \param indexed  whether the draw has indices
+ * \param range    whether draw->start and draw->end bound the indices
+ */
+static void
+marshal_draw(struct gl_context *ctx, uint16_t cmd_id,
+             const struct glthread_draw *draw, bool indexed, bool range)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   const unsigned index_size = indexed ? get_index_size(draw->type) : 0;
+   struct glthread_draw_attrib attribs[VERT_ATTRIB_MAX];
+   GLuint starts[VERT_ATTRIB_MAX], nums[VERT_ATTRIB_MAX];
+   GLbitfield64 user_attribs = 0;
+   bool user_indices = false;
+   GLuint num_attribs = 0;
+   struct marshal_cmd_Draw *cmd;
+   size_t cmd_size, data_size = 0;
+   GLubyte *data;
+
+   if (ctx->API != API_OPENGL_CORE) {
+      GLbitfield needed = GLTHREAD_SHADOW_CLIENT_ARRAYS;
+
+      if (indexed) {
+         needed |= GLTHREAD_SHADOW_ELEMENT_ARRAY_BUFFER |
+                   GLTHREAD_SHADOW_PRIMITIVE_RESTART;
+      }
+
+      /* Draw directly while the worker thread is idle anyway. */
+      if (_mesa_glthread_sync_shadow(ctx, needed) ||
+          (shadow->known & needed) != needed) {
+         debug_print_sync("Draw");
+         call_draw(ctx, cmd_id, draw);
+         return;
+      }
+
+      user_attribs = shadow->EnabledAttribs & shadow->UserAttribs;
+      user_indices = indexed && !shadow->ElementArrayBuffer;
+   }
+
+   /* Errors and empty draws don't read anything. */
+   if ((!user_attribs && !user_indices) ||
+       draw->count <= 0 || draw->primcount <= 0 ||
+       (indexed ? !index_size : draw->first < 0)) {
+      cmd = _mesa_glthread_allocate_command(ctx, cmd_id, sizeof(*cmd));
+      cmd->draw = *draw;
+      cmd->heap = NULL;
+      cmd->num_attribs = 0;
+      _mesa_post_marshal_hook(ctx);
+      return;
+   }
+
+   if (user_attribs) {
+      GLuint min_index, max_index;
+      int64_t min_vertex, max_vertex;
+
+      if (!indexed) {
+         min_index = draw->first;
+         max_index = draw->first + draw->count - 1;
+      } else if (user_indices) {
+         /* Nothing is drawn if all the indices are restart indices. */
+         if (!get_index_range(shadow, draw, index_size,
+                              &min_index, &max_index)) {
+            min_index = max_index = 0;
+            user_attribs = 0;
+         }
+      } else if (range) {
+         min_index = draw->start;
+         max_index = draw->end;
+      } else {
+         debug_print_sync("Draw");
+         draw_sync(ctx, cmd_id, draw);
+         return;
+      }
+
+      min_vertex = (int64_t) min_index + draw->basevertex;
+      max_vertex = (int64_t) max_index + draw->basevertex;
+      if (user_attribs && (min_vertex < 0 || max_vertex > UINT32_MAX ||
+                           max_vertex < min_vertex)) {
+         draw_sync(ctx, cmd_id, draw);
+         return;
+      }
+
+      while (user_attribs) {
+         const int i = u_bit_scan64(&user_attribs);
+         const struct glthread_attrib *array = &shadow->Attribs[i];
+
+         if (array->Divisor) {
+            starts[num_attribs] = draw->baseinstance;
+            nums[num_attribs] = (draw->primcount - 1) / array->Divisor + 1;
+         } else {
+            starts[num_attribs] = min_vertex;
+            nums[num_attribs] = max_vertex - min_vertex + 1;
+         }
+
+         attribs[num_attribs].attrib = i;
+         data_size += ALIGN((size_t) (nums[num_attribs] - 1) * array->Stride +
+                            array->ElementSize, 8);
+         num_attribs++;
+      }
+   }
+
+   if (user_indices)
+      data_size += ALIGN((size_t) draw->count * index_size, 8);
+
+   cmd_size = sizeof(*cmd) + num_attribs * sizeof(attribs[0]);
+   cmd_size = ALIGN(cmd_size, 8);
+
+   if (cmd_size + data_size <= MARSHAL_MAX_CMD_SIZE) {
+      cmd = _mesa_glthread_allocate_command(ctx, cmd_id,
+                                            cmd_size + data_size);
+      cmd->heap = NULL;
+      data = (GLubyte *) cmd + cmd_size;
+   } else {
+      void *heap = malloc(data_size);
+
+      if (!heap) {
+         draw_sync(ctx, cmd_id, draw);
+         return;
+      }
+
+      cmd = _mesa_glthread_allocate_command(ctx, cmd_id, cmd_size);
+      cmd->heap = heap;
+      data = heap;
+   }
+
+   cmd->draw = *draw;
+   cmd->num_attribs = num_attribs;
+
+   for (GLuint i = 0; i < num_attribs; i++) {
+      const struct glthread_attrib *array = &shadow->Attribs[attribs[i].attrib];
+
+      attribs[i].pointer = copy_attrib(array, data, starts[i], nums[i]);
+      data += ALIGN((size_t) (nums[i] - 1) * array->Stride +
+                    array->ElementSize, 8);
+   }
+   memcpy(cmd + 1, attribs, num_attribs * sizeof(attribs[0]));
+
+   if (user_indices) {
+      memcpy(data, draw->indices, (size_t) draw->count * index_size);
+      cmd->draw.indices = data;
+   }
+
+   _mesa_post_marshal_hook(ctx);
+}
+
+/**
+ * Whether draws may read vertices from client memory, for the draws which
+ * aren't marshalled here and have to synchronize in that case.
+ */
+bool
+_mesa_glthread_has_user_arrays(const struct gl_context *ctx)
+{
+   const struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (ctx->API == API_OPENGL_CORE)
+      return false;
+
+   if (!(shadow->known & GLTHREAD_SHADOW_CLIENT_ARRAYS))
+      return true;
+
+   return (shadow->EnabledAttribs & shadow->UserAttribs) != 0;
+}
+
+/* DrawArrays */
+void
+_mesa_unmarshal_DrawArrays(struct gl_context *ctx,
+                           const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_draw draw = {
+      .mode = mode, .first = first, .count = count, .primcount = 1,
+   };
+
+   debug_print_marshal("DrawArrays");
+   marshal_draw(ctx, DISPATCH_CMD_DrawArrays, &draw, false, false);
+}
+
+/* DrawArraysInstancedARB */
+void
+_mesa_unmarshal_DrawArraysInstancedARB(struct gl_context *ctx,
+                                       const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawArraysInstancedARB(GLenum mode, GLint first, GLsizei count,
+                                     GLsizei primcount)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_draw draw = {
+      .mode = mode, .first = first, .count = count, .primcount = primcount,
+   };
+
+   debug_print_marshal("DrawArraysInstancedARB");
+   marshal_draw(ctx, DISPATCH_CMD_DrawArraysInstancedARB, &draw,
+                false, false);
+}
+
+/* DrawArraysInstancedBaseInstance */
+void
+_mesa_unmarshal_DrawArraysInstancedBaseInstance(struct gl_context *ctx,
+                                                const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawArraysInstancedBaseInstance(GLenum mode, GLint first,
+                                              GLsizei count, GLsizei primcount,
+                                              GLuint baseinstance)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_draw draw = {
+      .mode = mode, .first = first, .count = count, .primcount = primcount,
+      .baseinstance = baseinstance,
+   };
+
+   debug_print_marshal("DrawArraysInstancedBaseInstance");
+   marshal_draw(ctx, DISPATCH_CMD_DrawArraysInstancedBaseInstance, &draw,
+                false, false);
+}
+
+/* DrawElements */
+void
+_mesa_unmarshal_DrawElements(struct gl_context *ctx,
+                             const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElements(GLenum mode, GLsizei count, GLenum type,
+                           const GLvoid *indices)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_draw draw = {
+      .mode = mode, .count = count, .type = type, .indices = indices,
+      .primcount = 1,
+   };
+
+   debug_print_marshal("DrawElements");
+   marshal_draw(ctx, DISPATCH_CMD_DrawElements, &draw, true, false);
+}
+
+/* DrawRangeElements */
+void
+_mesa_unmarshal_DrawRangeElements(struct gl_context *ctx,
+                                  const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElements(GLenum mode, GLuint start, GLuint end,
+                                GLsizei count, GLenum type,
+                                const GLvoid *indices)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_draw draw = {
+      .mode = mode, .start = start, .end = end, .count = count, .type = type,
+      .indices = indices, .primcount = 1,
+   };
+
+   debug_print_marshal("DrawRangeElements");
+   marshal_draw(ctx, DISPATCH_CMD_DrawRangeElements, &draw, true, true);
+}
+
+/* DrawElementsInstancedARB */
+void
+_mesa_unmarshal_DrawElementsInstancedARB(struct gl_context *ctx,
+                                         const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedARB(GLenum mode, GLsizei count,
+                                       GLenum type, const GLvoid *indices,
+                                       GLsizei primcount)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_draw draw = {
+      .mode = mode, .count = count, .type = type, .indices = indices,
+      .primcount = primcount,
+   };
+
+   debug_print_marshal("DrawElementsInstancedARB");
+   marshal_draw(ctx, DISPATCH_CMD_DrawElementsInstancedARB, &draw,
+                true, false);
+}
+
+/* DrawElementsBaseVertex */
+void
+_mesa_unmarshal_DrawElementsBaseVertex(struct gl_context *ctx,
+                                       const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type,
+                                     const GLvoid *indices, GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_draw draw = {
+      .mode = mode, .count = count, .type = type, .indices = indices,
+      .primcount = 1, .basevertex = basevertex,
+   };
+
+   debug_print_marshal("DrawElementsBaseVertex");
+   marshal_draw(ctx, DISPATCH_CMD_DrawElementsBaseVertex, &draw,
+                true, false);
+}
+
+/* DrawRangeElementsBaseVertex */
+void
+_mesa_unmarshal_DrawRangeElementsBaseVertex(struct gl_context *ctx,
+                                            const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElementsBaseVertex(GLenum mode, GLuint start,
+                                          GLuint end, GLsizei count,
+                                          GLenum type, const GLvoid *indices,
+                                          GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_draw draw = {
+      .mode = mode, .start = start, .end = end, .count = count, .type = type,
+      .indices = indices, .primcount = 1, .basevertex = basevertex,
+   };
+
+   debug_print_marshal("DrawRangeElementsBaseVertex");
+   marshal_draw(ctx, DISPATCH_CMD_DrawRangeElementsBaseVertex, &draw,
+                true, true);
+}
+
+/* DrawElementsInstancedBaseVertex */
+void
+_mesa_unmarshal_DrawElementsInstancedBaseVertex(struct gl_context *ctx,
+                                                const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseVertex(GLenum mode, GLsizei count,
+                                              GLenum type,
+                                              const GLvoid *indices,
+                                              GLsizei primcount,
+                                              GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_draw draw = {
+      .mode = mode, .count = count, .type = type, .indices = indices,
+      .primcount = primcount, .basevertex = basevertex,
+   };
+
+   debug_print_marshal("DrawElementsInstancedBaseVertex");
+   marshal_draw(ctx, DISPATCH_CMD_DrawElementsInstancedBaseVertex, &draw,
+                true, false);
+}
+
+/* DrawElementsInstancedBaseInstance */
+void
+_mesa_unmarshal_DrawElementsInstancedBaseInstance(struct gl_context *ctx,
+                                                  const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseInstance(GLenum mode, GLsizei count,
+                                                GLenum type,
+                                                const GLvoid *indices,
+                                                GLsizei primcount,
+                                                GLuint baseinstance)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_draw draw = {
+      .mode = mode, .count = count, .type = type, .indices = indices,
+      .primcount = primcount, .baseinstance = baseinstance,
+   };
+
+   debug_print_marshal("DrawElementsInstancedBaseInstance");
+   marshal_draw(ctx, DISPATCH_CMD_DrawElementsInstancedBaseInstance, &draw,
+                true, false);
+}
+
+/* DrawElementsInstancedBaseVertexBaseInstance */
+void
+_mesa_unmarshal_DrawElementsInstancedBaseVertexBaseInstance(struct gl_context *ctx,
+                                                            const struct marshal_cmd_Draw *cmd)
+{
+   unmarshal_draw(ctx, cmd);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseVertexBaseInstance(GLenum mode,
+                                                          GLsizei count,
+                                                          GLenum type,
+                                                          const GLvoid *indices,
+                                                          GLsizei primcount,
+                                                          GLint basevertex,
+                                                          GLuint baseinstance)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_draw draw = {
+      .mode = mode, .count = count, .type = type, .indices = indices,
+      .primcount = primcount, .basevertex = basevertex,
+      .baseinstance = baseinstance,
+   };
+
+   debug_print_marshal("DrawElementsInstancedBaseVertexBaseInstance");
+   marshal_draw(ctx, DISPATCH_CMD_DrawElementsInstancedBaseVertexBaseInstance,
+                &draw, true, false);
+}
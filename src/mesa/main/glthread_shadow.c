@@ -0,0 +1,1375 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file glthread_shadow.c
+ *
+ * State mirrored by the application thread for glthread.
+ *
+ * Functions returning values, like glGet*() and glIsEnabled(), are
+ * marshalled synchronously: the application thread waits for the worker
+ * thread to execute all the queued calls before looking at the context.
+ * Applications doing that many times per frame lose all the parallelism.
+ *
+ * Instead, the application thread keeps a copy of the state which is queried
+ * the most, updated by the marshal functions of the calls changing it (see
+ * marshal_call_after in the API XML), and answers the queries from it.
+ * Calls changing the state in ways we don't follow, such as glPopAttrib() or
+ * glCallList(), forget the copy of what they may change.  Querying state
+ * which isn't known synchronizes like before, and reloads the whole copy
+ * from the context, which is safe to read while the worker thread is idle.
+ *
+ * The vertex arrays and the primitive restart state are mirrored the same
+ * way, for draws whose vertices or indices are in client memory, which have
+ * to be copied before the draw is queued (see glthread_draw.c).
+ *
+ * Errors depending only on the arguments and the context limits are checked.
+ * When only the worker thread can tell whether a call succeeds, such as when
+ * binding a program which isn't linked or a texture created for another
+ * target, what it may change is forgotten instead.
+ */
+
+#include "main/mtypes.h"
+#include "main/context.h"
+#include "main/glformats.h"
+#include "main/glthread.h"
+#include "main/imports.h"
+#include "main/texstate.h"
+#include "main/varray.h"
+#include "math/m_matrix.h"
+
+
+/**
+ * Caps whose glEnable() state is mirrored.  Those which are only valid in
+ * compatibility contexts are only answered for those.
+ */
+static const struct {
+   GLenum cap;
+   bool compat_only;
+} shadow_caps[] = {
+   { GL_BLEND, false },
+   { GL_CULL_FACE, false },
+   { GL_DEPTH_TEST, false },
+   { GL_DITHER, false },
+   { GL_POLYGON_OFFSET_FILL, false },
+   { GL_SCISSOR_TEST, false },
+   { GL_STENCIL_TEST, false },
+   { GL_ALPHA_TEST, true },
+   { GL_COLOR_MATERIAL, true },
+   { GL_FOG, true },
+   { GL_LIGHTING, true },
+   { GL_NORMALIZE, true },
+};
+
+static int
+get_cap_index(const struct gl_context *ctx, GLenum cap)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(shadow_caps); i++) {
+      if (shadow_caps[i].cap == cap) {
+         if (shadow_caps[i].compat_only && ctx->API != API_OPENGL_COMPAT)
+            return -1;
+         return i;
+      }
+   }
+   return -1;
+}
+
+/** Same as glIsEnabled() for the caps of shadow_caps. */
+static GLboolean
+get_cap_from_context(const struct gl_context *ctx, GLenum cap)
+{
+   switch (cap) {
+   case GL_BLEND:
+      return ctx->Color.BlendEnabled & 1;
+   case GL_CULL_FACE:
+      return ctx->Polygon.CullFlag;
+   case GL_DEPTH_TEST:
+      return ctx->Depth.Test;
+   case GL_DITHER:
+      return ctx->Color.DitherFlag;
+   case GL_POLYGON_OFFSET_FILL:
+      return ctx->Polygon.OffsetFill;
+   case GL_SCISSOR_TEST:
+      return ctx->Scissor.EnableFlags & 1;
+   case GL_STENCIL_TEST:
+      return ctx->Stencil.Enabled;
+   case GL_ALPHA_TEST:
+      return ctx->Color.AlphaEnabled;
+   case GL_COLOR_MATERIAL:
+      return ctx->Light.ColorMaterialEnabled;
+   case GL_FOG:
+      return ctx->Fog.Enabled;
+   case GL_LIGHTING:
+      return ctx->Light.Enabled;
+   case GL_NORMALIZE:
+      return ctx->Transform.Normalize;
+   default:
+      unreachable("not a mirrored cap");
+   }
+}
+
+static int
+get_texture_target_index(GLenum target)
+{
+   switch (target) {
+   case GL_TEXTURE_2D:
+      return GLTHREAD_SHADOW_TEXTURE_2D;
+   case GL_TEXTURE_3D:
+      return GLTHREAD_SHADOW_TEXTURE_3D;
+   case GL_TEXTURE_CUBE_MAP:
+      return GLTHREAD_SHADOW_TEXTURE_CUBE_MAP;
+   default:
+      return -1;
+   }
+}
+
+static void
+init_matrix_stack(struct glthread_matrix_stack *stack, GLuint max_depth)
+{
+   stack->Stack = calloc(max_depth, sizeof(GLmatrix));
+   if (!stack->Stack)
+      return;
+
+   for (unsigned i = 0; i < max_depth; i++)
+      _math_matrix_ctr(&stack->Stack[i]);
+   stack->MaxDepth = max_depth;
+   stack->Depth = 0;
+}
+
+static void
+destroy_matrix_stack(struct glthread_matrix_stack *stack)
+{
+   if (!stack->Stack)
+      return;
+
+   for (unsigned i = 0; i < stack->MaxDepth; i++)
+      _math_matrix_dtr(&stack->Stack[i]);
+   free(stack->Stack);
+   stack->Stack = NULL;
+}
+
+static void
+load_matrix_stack(struct glthread_matrix_stack *stack,
+                  const struct gl_matrix_stack *from)
+{
+   assert(from->Depth < stack->MaxDepth);
+
+   for (unsigned i = 0; i <= from->Depth; i++)
+      _math_matrix_copy(&stack->Stack[i], &from->Stack[i]);
+   stack->Depth = from->Depth;
+}
+
+/**
+ * Reloads the whole copy from the context.  The worker thread must be idle.
+ */
+static void
+load_shadow(struct gl_context *ctx)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   shadow->ActiveTexture = ctx->Texture.CurrentUnit;
+   shadow->ClientActiveTexture = ctx->Array.ActiveTexture;
+   shadow->MatrixMode = ctx->Transform.MatrixMode;
+   shadow->known = GLTHREAD_SHADOW_ALL;
+
+   if (shadow->Modelview.Stack)
+      load_matrix_stack(&shadow->Modelview, &ctx->ModelviewMatrixStack);
+   else
+      shadow->known &= ~GLTHREAD_SHADOW_MODELVIEW;
+
+   if (shadow->Projection.Stack)
+      load_matrix_stack(&shadow->Projection, &ctx->ProjectionMatrixStack);
+   else
+      shadow->known &= ~GLTHREAD_SHADOW_PROJECTION;
+
+   shadow->ArrayBuffer = ctx->Array.ArrayBufferObj->Name;
+   shadow->ElementArrayBuffer = ctx->Array.VAO->IndexBufferObj->Name;
+   shadow->VertexArray = ctx->Array.VAO->Name;
+   shadow->Program =
+      ctx->Shader.ActiveProgram ? ctx->Shader.ActiveProgram->Name : 0;
+   shadow->DrawFramebuffer = ctx->DrawBuffer ? ctx->DrawBuffer->Name : 0;
+   shadow->ReadFramebuffer = ctx->ReadBuffer ? ctx->ReadBuffer->Name : 0;
+   shadow->Renderbuffer =
+      ctx->CurrentRenderbuffer ? ctx->CurrentRenderbuffer->Name : 0;
+
+   for (unsigned u = 0; u < ctx->Const.MaxCombinedTextureImageUnits; u++) {
+      struct gl_texture_object **tex = ctx->Texture.Unit[u].CurrentTex;
+
+      shadow->Textures[u][GLTHREAD_SHADOW_TEXTURE_2D] =
+         tex[TEXTURE_2D_INDEX]->Name;
+      shadow->Textures[u][GLTHREAD_SHADOW_TEXTURE_3D] =
+         tex[TEXTURE_3D_INDEX]->Name;
+      shadow->Textures[u][GLTHREAD_SHADOW_TEXTURE_CUBE_MAP] =
+         tex[TEXTURE_CUBE_INDEX]->Name;
+   }
+
+   shadow->Viewport[0] = ctx->ViewportArray[0].X;
+   shadow->Viewport[1] = ctx->ViewportArray[0].Y;
+   shadow->Viewport[2] = ctx->ViewportArray[0].Width;
+   shadow->Viewport[3] = ctx->ViewportArray[0].Height;
+
+   shadow->Scissor[0] = ctx->Scissor.ScissorArray[0].X;
+   shadow->Scissor[1] = ctx->Scissor.ScissorArray[0].Y;
+   shadow->Scissor[2] = ctx->Scissor.ScissorArray[0].Width;
+   shadow->Scissor[3] = ctx->Scissor.ScissorArray[0].Height;
+
+   shadow->Enables = 0;
+   for (unsigned i = 0; i < ARRAY_SIZE(shadow_caps); i++) {
+      if (get_cap_index(ctx, shadow_caps[i].cap) >= 0 &&
+          get_cap_from_context(ctx, shadow_caps[i].cap))
+         shadow->Enables |= 1u << i;
+   }
+
+   shadow->PrimitiveRestart = ctx->Array.PrimitiveRestart;
+   shadow->PrimitiveRestartFixedIndex = ctx->Array.PrimitiveRestartFixedIndex;
+   shadow->RestartIndex = ctx->Array.RestartIndex;
+
+   if (ctx->Array.VAO == ctx->Array.DefaultVAO) {
+      const struct gl_vertex_array_object *vao = ctx->Array.VAO;
+
+      shadow->EnabledAttribs = vao->_Enabled;
+      shadow->UserAttribs = 0;
+
+      for (unsigned i = 0; i < VERT_ATTRIB_MAX; i++) {
+         const struct gl_array_attributes *array = &vao->VertexAttrib[i];
+         const struct gl_vertex_buffer_binding *binding =
+            &vao->BufferBinding[array->BufferBindingIndex];
+         struct glthread_attrib *attrib = &shadow->Attribs[i];
+
+         attrib->Pointer = _mesa_vertex_attrib_address(array, binding);
+         attrib->Stride = binding->Stride;
+         attrib->ElementSize = array->_ElementSize;
+         attrib->Divisor = binding->InstanceDivisor;
+         if (!_mesa_is_bufferobj(binding->BufferObj))
+            shadow->UserAttribs |= VERT_BIT(i);
+      }
+   } else {
+      shadow->known &= ~GLTHREAD_SHADOW_CLIENT_ARRAYS;
+   }
+}
+
+void
+_mesa_glthread_init_shadow(struct gl_context *ctx)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   /* Nothing is known until the first query. */
+   shadow->known = 0;
+
+   /* The matrix stacks are only answered for compatibility contexts. */
+   if (ctx->API == API_OPENGL_COMPAT) {
+      init_matrix_stack(&shadow->Modelview,
+                        ctx->ModelviewMatrixStack.MaxDepth);
+      init_matrix_stack(&shadow->Projection,
+                        ctx->ProjectionMatrixStack.MaxDepth);
+   }
+}
+
+void
+_mesa_glthread_destroy_shadow(struct gl_context *ctx)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   destroy_matrix_stack(&shadow->Modelview);
+   destroy_matrix_stack(&shadow->Projection);
+}
+
+void
+_mesa_glthread_invalidate_shadow(struct gl_context *ctx, GLbitfield bits)
+{
+   ctx->GLThread->shadow.known &= ~bits;
+}
+
+/**
+ * Makes sure that the given groups of state are known, synchronizing and
+ * reloading the copy if they aren't.  Returns whether it synchronized.
+ */
+bool
+_mesa_glthread_sync_shadow(struct gl_context *ctx, GLbitfield bits)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if ((shadow->known & bits) == bits)
+      return false;
+
+   _mesa_glthread_finish(ctx);
+   load_shadow(ctx);
+   return true;
+}
+
+
+/* Tracking of the calls changing the mirrored state */
+
+void
+_mesa_glthread_ActiveTexture(struct gl_context *ctx, GLenum texture)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   const GLuint unit = texture - GL_TEXTURE0;
+
+   if (unit < _mesa_max_tex_unit(ctx)) {
+      shadow->ActiveTexture = unit;
+      shadow->known |= GLTHREAD_SHADOW_ACTIVE_TEXTURE;
+   }
+}
+
+void
+_mesa_glthread_ClientActiveTexture(struct gl_context *ctx, GLenum texture)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   const GLuint unit = texture - GL_TEXTURE0;
+
+   if (unit < ctx->Const.MaxTextureCoordUnits) {
+      shadow->ClientActiveTexture = unit;
+      shadow->known |= GLTHREAD_SHADOW_CLIENT_ACTIVE_TEXTURE;
+   }
+}
+
+void
+_mesa_glthread_MatrixMode(struct gl_context *ctx, GLenum mode)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   switch (mode) {
+   case GL_MODELVIEW:
+   case GL_PROJECTION:
+      shadow->MatrixMode = mode;
+      shadow->known |= GLTHREAD_SHADOW_MATRIX_MODE;
+      break;
+   default:
+      /* Whether the other modes are valid depends on more state. */
+      shadow->known &= ~GLTHREAD_SHADOW_MATRIX_MODE;
+      break;
+   }
+}
+
+/**
+ * Returns the copy of the current matrix stack, or NULL if matrix calls
+ * don't change mirrored state.  Without knowing the matrix mode, the calls
+ * could change any stack, so they are forgotten.
+ */
+static struct glthread_matrix_stack *
+get_current_stack(struct gl_context *ctx)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (!(shadow->known & GLTHREAD_SHADOW_MATRIX_MODE)) {
+      shadow->known &= ~(GLTHREAD_SHADOW_MODELVIEW |
+                         GLTHREAD_SHADOW_PROJECTION);
+      return NULL;
+   }
+
+   switch (shadow->MatrixMode) {
+   case GL_MODELVIEW:
+      if (shadow->known & GLTHREAD_SHADOW_MODELVIEW)
+         return &shadow->Modelview;
+      return NULL;
+   case GL_PROJECTION:
+      if (shadow->known & GLTHREAD_SHADOW_PROJECTION)
+         return &shadow->Projection;
+      return NULL;
+   default:
+      return NULL;
+   }
+}
+
+static GLmatrix *
+get_current_matrix(struct gl_context *ctx)
+{
+   struct glthread_matrix_stack *stack = get_current_stack(ctx);
+
+   return stack ? &stack->Stack[stack->Depth] : NULL;
+}
+
+void
+_mesa_glthread_PushMatrix(struct gl_context *ctx)
+{
+   struct glthread_matrix_stack *stack = get_current_stack(ctx);
+
+   if (!stack || stack->Depth + 1 >= stack->MaxDepth)
+      return;
+
+   _math_matrix_copy(&stack->Stack[stack->Depth + 1],
+                     &stack->Stack[stack->Depth]);
+   stack->Depth++;
+}
+
+void
+_mesa_glthread_PopMatrix(struct gl_context *ctx)
+{
+   struct glthread_matrix_stack *stack = get_current_stack(ctx);
+
+   if (!stack || stack->Depth == 0)
+      return;
+
+   stack->Depth--;
+}
+
+/* The matrix functions below apply the same math as matrix.c, so that the
+ * results are identical.
+ */
+
+void
+_mesa_glthread_LoadIdentity(struct gl_context *ctx)
+{
+   GLmatrix *mat = get_current_matrix(ctx);
+
+   if (mat)
+      _math_matrix_set_identity(mat);
+}
+
+void
+_mesa_glthread_LoadMatrixf(struct gl_context *ctx, const GLfloat *m)
+{
+   GLmatrix *mat = get_current_matrix(ctx);
+
+   if (mat && m && memcmp(m, mat->m, 16 * sizeof(GLfloat)) != 0)
+      _math_matrix_loadf(mat, m);
+}
+
+void
+_mesa_glthread_LoadMatrixd(struct gl_context *ctx, const GLdouble *m)
+{
+   GLfloat f[16];
+
+   if (!m)
+      return;
+   for (unsigned i = 0; i < 16; i++)
+      f[i] = (GLfloat) m[i];
+   _mesa_glthread_LoadMatrixf(ctx, f);
+}
+
+void
+_mesa_glthread_LoadTransposeMatrixf(struct gl_context *ctx, const GLfloat *m)
+{
+   GLfloat tm[16];
+
+   if (!m)
+      return;
+   _math_transposef(tm, m);
+   _mesa_glthread_LoadMatrixf(ctx, tm);
+}
+
+void
+_mesa_glthread_LoadTransposeMatrixd(struct gl_context *ctx, const GLdouble *m)
+{
+   GLfloat tm[16];
+
+   if (!m)
+      return;
+   _math_transposefd(tm, m);
+   _mesa_glthread_LoadMatrixf(ctx, tm);
+}
+
+void
+_mesa_glthread_MultMatrixf(struct gl_context *ctx, const GLfloat *m)
+{
+   GLmatrix *mat = get_current_matrix(ctx);
+
+   if (mat && m)
+      _math_matrix_mul_floats(mat, m);
+}
+
+void
+_mesa_glthread_MultMatrixd(struct gl_context *ctx, const GLdouble *m)
+{
+   GLfloat f[16];
+
+   if (!m)
+      return;
+   for (unsigned i = 0; i < 16; i++)
+      f[i] = (GLfloat) m[i];
+   _mesa_glthread_MultMatrixf(ctx, f);
+}
+
+void
+_mesa_glthread_MultTransposeMatrixf(struct gl_context *ctx, const GLfloat *m)
+{
+   GLfloat tm[16];
+
+   if (!m)
+      return;
+   _math_transposef(tm, m);
+   _mesa_glthread_MultMatrixf(ctx, tm);
+}
+
+void
+_mesa_glthread_MultTransposeMatrixd(struct gl_context *ctx, const GLdouble *m)
+{
+   GLfloat tm[16];
+
+   if (!m)
+      return;
+   _math_transposefd(tm, m);
+   _mesa_glthread_MultMatrixf(ctx, tm);
+}
+
+void
+_mesa_glthread_Rotatef(struct gl_context *ctx, GLfloat angle,
+                       GLfloat x, GLfloat y, GLfloat z)
+{
+   GLmatrix *mat = get_current_matrix(ctx);
+
+   if (mat && angle != 0.0F)
+      _math_matrix_rotate(mat, angle, x, y, z);
+}
+
+void
+_mesa_glthread_Scalef(struct gl_context *ctx, GLfloat x, GLfloat y, GLfloat z)
+{
+   GLmatrix *mat = get_current_matrix(ctx);
+
+   if (mat)
+      _math_matrix_scale(mat, x, y, z);
+}
+
+void
+_mesa_glthread_Translatef(struct gl_context *ctx,
+                          GLfloat x, GLfloat y, GLfloat z)
+{
+   GLmatrix *mat = get_current_matrix(ctx);
+
+   if (mat)
+      _math_matrix_translate(mat, x, y, z);
+}
+
+void
+_mesa_glthread_Ortho(struct gl_context *ctx, GLdouble left, GLdouble right,
+                     GLdouble bottom, GLdouble top,
+                     GLdouble nearval, GLdouble farval)
+{
+   GLmatrix *mat = get_current_matrix(ctx);
+
+   if (!mat || left == right || bottom == top || nearval == farval)
+      return;
+
+   _math_matrix_ortho(mat, (GLfloat) left, (GLfloat) right,
+                      (GLfloat) bottom, (GLfloat) top,
+                      (GLfloat) nearval, (GLfloat) farval);
+}
+
+void
+_mesa_glthread_Frustum(struct gl_context *ctx, GLdouble left, GLdouble right,
+                       GLdouble bottom, GLdouble top,
+                       GLdouble nearval, GLdouble farval)
+{
+   GLmatrix *mat = get_current_matrix(ctx);
+
+   if (!mat || nearval <= 0.0 || farval <= 0.0 || nearval == farval ||
+       left == right || top == bottom)
+      return;
+
+   _math_matrix_frustum(mat, (GLfloat) left, (GLfloat) right,
+                        (GLfloat) bottom, (GLfloat) top,
+                        (GLfloat) nearval, (GLfloat) farval);
+}
+
+void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   /* Core contexts only bind names returned by glGenBuffers(). */
+   if (buffer && ctx->API == API_OPENGL_CORE) {
+      switch (target) {
+      case GL_ARRAY_BUFFER:
+         shadow->known &= ~GLTHREAD_SHADOW_ARRAY_BUFFER;
+         break;
+      case GL_ELEMENT_ARRAY_BUFFER:
+         shadow->known &= ~GLTHREAD_SHADOW_ELEMENT_ARRAY_BUFFER;
+         break;
+      }
+      return;
+   }
+
+   switch (target) {
+   case GL_ARRAY_BUFFER:
+      shadow->ArrayBuffer = buffer;
+      shadow->known |= GLTHREAD_SHADOW_ARRAY_BUFFER;
+      break;
+   case GL_ELEMENT_ARRAY_BUFFER:
+      shadow->ElementArrayBuffer = buffer;
+      shadow->known |= GLTHREAD_SHADOW_ELEMENT_ARRAY_BUFFER;
+      break;
+   }
+}
+
+void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   /* Deleted buffers are unbound from the context and the current VAO. */
+   for (GLsizei i = 0; i < n; i++) {
+      if (!buffers[i])
+         continue;
+      if (shadow->ArrayBuffer == buffers[i])
+         shadow->ArrayBuffer = 0;
+      if (shadow->ElementArrayBuffer == buffers[i])
+         shadow->ElementArrayBuffer = 0;
+   }
+}
+
+void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint array)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   /* The element array buffer binding is part of the VAO. */
+   shadow->known &= ~(GLTHREAD_SHADOW_ELEMENT_ARRAY_BUFFER |
+                      GLTHREAD_SHADOW_CLIENT_ARRAYS);
+
+   /* Only names returned by glGenVertexArrays() can be bound. */
+   if (array) {
+      shadow->known &= ~GLTHREAD_SHADOW_VERTEX_ARRAY;
+      return;
+   }
+
+   shadow->VertexArray = array;
+   shadow->known |= GLTHREAD_SHADOW_VERTEX_ARRAY;
+}
+
+void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *arrays)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (!(shadow->known & GLTHREAD_SHADOW_VERTEX_ARRAY)) {
+      /* The current VAO might be deleted. */
+      shadow->known &= ~(GLTHREAD_SHADOW_ELEMENT_ARRAY_BUFFER |
+                         GLTHREAD_SHADOW_CLIENT_ARRAYS);
+      return;
+   }
+
+   for (GLsizei i = 0; i < n; i++) {
+      if (arrays[i] && shadow->VertexArray == arrays[i])
+         _mesa_glthread_BindVertexArray(ctx, 0);
+   }
+}
+
+void
+_mesa_glthread_UseProgram(struct gl_context *ctx, GLuint program)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   /* Programs which aren't linked can't be used. */
+   if (program) {
+      shadow->known &= ~GLTHREAD_SHADOW_PROGRAM;
+      return;
+   }
+
+   shadow->Program = program;
+   shadow->known |= GLTHREAD_SHADOW_PROGRAM;
+}
+
+void
+_mesa_glthread_BindFramebuffer(struct gl_context *ctx, GLenum target,
+                               GLuint framebuffer, bool allow_user_names)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   /* Without user names, only names returned by glGenFramebuffers() can be
+    * bound, as in bind_framebuffer().
+    */
+   if (framebuffer && !allow_user_names) {
+      switch (target) {
+      case GL_FRAMEBUFFER:
+      case GL_DRAW_FRAMEBUFFER:
+      case GL_READ_FRAMEBUFFER:
+         shadow->known &= ~GLTHREAD_SHADOW_FRAMEBUFFERS;
+         break;
+      }
+      return;
+   }
+
+   switch (target) {
+   case GL_FRAMEBUFFER:
+      shadow->DrawFramebuffer = framebuffer;
+      shadow->ReadFramebuffer = framebuffer;
+      shadow->known |= GLTHREAD_SHADOW_FRAMEBUFFERS;
+      break;
+   case GL_DRAW_FRAMEBUFFER:
+      shadow->DrawFramebuffer = framebuffer;
+      break;
+   case GL_READ_FRAMEBUFFER:
+      shadow->ReadFramebuffer = framebuffer;
+      break;
+   }
+}
+
+void
+_mesa_glthread_DeleteFramebuffers(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *framebuffers)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   for (GLsizei i = 0; i < n; i++) {
+      if (!framebuffers[i])
+         continue;
+      if (shadow->DrawFramebuffer == framebuffers[i])
+         shadow->DrawFramebuffer = 0;
+      if (shadow->ReadFramebuffer == framebuffers[i])
+         shadow->ReadFramebuffer = 0;
+   }
+}
+
+void
+_mesa_glthread_BindRenderbuffer(struct gl_context *ctx, GLenum target,
+                                GLuint renderbuffer, bool allow_user_names)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (target != GL_RENDERBUFFER)
+      return;
+
+   /* Without user names, only names returned by glGenRenderbuffers() can
+    * be bound, as in bind_renderbuffer().
+    */
+   if (renderbuffer && !allow_user_names) {
+      shadow->known &= ~GLTHREAD_SHADOW_RENDERBUFFER;
+      return;
+   }
+
+   shadow->Renderbuffer = renderbuffer;
+   shadow->known |= GLTHREAD_SHADOW_RENDERBUFFER;
+}
+
+void
+_mesa_glthread_DeleteRenderbuffers(struct gl_context *ctx, GLsizei n,
+                                   const GLuint *renderbuffers)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   for (GLsizei i = 0; i < n; i++) {
+      if (renderbuffers[i] && shadow->Renderbuffer == renderbuffers[i])
+         shadow->Renderbuffer = 0;
+   }
+}
+
+void
+_mesa_glthread_BindTexture(struct gl_context *ctx, GLenum target,
+                           GLuint texture)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   const int index = get_texture_target_index(target);
+
+   if (index < 0)
+      return;
+
+   /* Textures created for another target can't be bound, and core
+    * contexts only bind names returned by glGenTextures().
+    */
+   if (texture ||
+       !(shadow->known & GLTHREAD_SHADOW_ACTIVE_TEXTURE) ||
+       shadow->ActiveTexture >= ctx->Const.MaxCombinedTextureImageUnits) {
+      shadow->known &= ~GLTHREAD_SHADOW_TEXTURES;
+      return;
+   }
+
+   shadow->Textures[shadow->ActiveTexture][index] = texture;
+}
+
+void
+_mesa_glthread_DeleteTextures(struct gl_context *ctx, GLsizei n,
+                              const GLuint *textures)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (!(shadow->known & GLTHREAD_SHADOW_TEXTURES))
+      return;
+
+   /* Deleted textures are unbound from all units. */
+   for (GLsizei i = 0; i < n; i++) {
+      if (!textures[i])
+         continue;
+
+      for (unsigned u = 0; u < ctx->Const.MaxCombinedTextureImageUnits; u++) {
+         for (unsigned t = 0; t < GLTHREAD_SHADOW_NUM_TEXTURE_TARGETS; t++) {
+            if (shadow->Textures[u][t] == textures[i])
+               shadow->Textures[u][t] = 0;
+         }
+      }
+   }
+}
+
+void
+_mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                        GLsizei width, GLsizei height)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   GLfloat fx = x, fy = y, fw = width, fh = height;
+
+   if (width < 0 || height < 0)
+      return;
+
+   /* Same clamping as viewport.c. */
+   fw = MIN2(fw, (GLfloat) ctx->Const.MaxViewportWidth);
+   fh = MIN2(fh, (GLfloat) ctx->Const.MaxViewportHeight);
+   if (ctx->Extensions.ARB_viewport_array ||
+       (ctx->Extensions.OES_viewport_array &&
+        _mesa_is_gles31(ctx))) {
+      fx = CLAMP(fx,
+                 ctx->Const.ViewportBounds.Min, ctx->Const.ViewportBounds.Max);
+      fy = CLAMP(fy,
+                 ctx->Const.ViewportBounds.Min, ctx->Const.ViewportBounds.Max);
+   }
+
+   shadow->Viewport[0] = fx;
+   shadow->Viewport[1] = fy;
+   shadow->Viewport[2] = fw;
+   shadow->Viewport[3] = fh;
+   shadow->known |= GLTHREAD_SHADOW_VIEWPORT;
+}
+
+void
+_mesa_glthread_Scissor(struct gl_context *ctx, GLint x, GLint y,
+                       GLsizei width, GLsizei height)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (width < 0 || height < 0)
+      return;
+
+   shadow->Scissor[0] = x;
+   shadow->Scissor[1] = y;
+   shadow->Scissor[2] = width;
+   shadow->Scissor[3] = height;
+   shadow->known |= GLTHREAD_SHADOW_SCISSOR;
+}
+
+void
+_mesa_glthread_Enable(struct gl_context *ctx, GLenum cap, GLboolean state)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   const int index = get_cap_index(ctx, cap);
+
+   switch (cap) {
+   case GL_PRIMITIVE_RESTART:
+   case GL_PRIMITIVE_RESTART_NV:
+      shadow->PrimitiveRestart = state;
+      return;
+   case GL_PRIMITIVE_RESTART_FIXED_INDEX:
+      shadow->PrimitiveRestartFixedIndex = state;
+      return;
+   }
+
+   if (index < 0)
+      return;
+
+   if (state)
+      shadow->Enables |= 1u << index;
+   else
+      shadow->Enables &= ~(1u << index);
+}
+
+void
+_mesa_glthread_PrimitiveRestartIndex(struct gl_context *ctx, GLuint index)
+{
+   ctx->GLThread->shadow.RestartIndex = index;
+}
+
+/**
+ * Same as update_array() in varray.c.  Arrays set while a VBO is bound
+ * point into it, the others point to client memory.
+ */
+void
+_mesa_glthread_AttribPointer(struct gl_context *ctx, gl_vert_attrib attrib,
+                             GLint size, GLenum type, GLsizei stride,
+                             const GLvoid *pointer)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   struct glthread_attrib *array = &shadow->Attribs[attrib];
+   const int element_size =
+      _mesa_bytes_per_vertex_attrib(size == GL_BGRA ? 4 : size, type);
+
+   if (!(shadow->known & GLTHREAD_SHADOW_CLIENT_ARRAYS))
+      return;
+
+   /* Errors leave the array unchanged, let the context tell. */
+   if (!(shadow->known & GLTHREAD_SHADOW_ARRAY_BUFFER) ||
+       ((size < 1 || size > 4) && size != GL_BGRA) ||
+       element_size <= 0 || stride < 0) {
+      shadow->known &= ~GLTHREAD_SHADOW_CLIENT_ARRAYS;
+      return;
+   }
+
+   array->Pointer = pointer;
+   array->ElementSize = element_size;
+   array->Stride = stride ? stride : element_size;
+
+   if (shadow->ArrayBuffer)
+      shadow->UserAttribs &= ~VERT_BIT(attrib);
+   else
+      shadow->UserAttribs |= VERT_BIT(attrib);
+}
+
+void
+_mesa_glthread_TexCoordPointer(struct gl_context *ctx, GLint size,
+                               GLenum type, GLsizei stride,
+                               const GLvoid *pointer)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (!(shadow->known & GLTHREAD_SHADOW_CLIENT_ACTIVE_TEXTURE)) {
+      shadow->known &= ~GLTHREAD_SHADOW_CLIENT_ARRAYS;
+      return;
+   }
+
+   _mesa_glthread_AttribPointer(ctx,
+                                VERT_ATTRIB_TEX(shadow->ClientActiveTexture),
+                                size, type, stride, pointer);
+}
+
+void
+_mesa_glthread_VertexAttribPointer(struct gl_context *ctx, GLuint index,
+                                   GLint size, GLenum type, GLsizei stride,
+                                   const GLvoid *pointer)
+{
+   if (index >= ctx->Const.Program[MESA_SHADER_VERTEX].MaxAttribs)
+      return;
+
+   _mesa_glthread_AttribPointer(ctx, VERT_ATTRIB_GENERIC(index),
+                                size, type, stride, pointer);
+}
+
+/**
+ * Returns the vertex array enabled by glEnableClientState(), or -1.  Also
+ * -1 for texture coordinates if the client active texture isn't known.
+ */
+static int
+get_client_state_attrib(struct gl_context *ctx, GLenum array)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   switch (array) {
+   case GL_VERTEX_ARRAY:
+      return VERT_ATTRIB_POS;
+   case GL_NORMAL_ARRAY:
+      return VERT_ATTRIB_NORMAL;
+   case GL_COLOR_ARRAY:
+      return VERT_ATTRIB_COLOR0;
+   case GL_SECONDARY_COLOR_ARRAY:
+      return VERT_ATTRIB_COLOR1;
+   case GL_FOG_COORDINATE_ARRAY:
+      return VERT_ATTRIB_FOG;
+   case GL_INDEX_ARRAY:
+      return VERT_ATTRIB_COLOR_INDEX;
+   case GL_EDGE_FLAG_ARRAY:
+      return VERT_ATTRIB_EDGEFLAG;
+   case GL_POINT_SIZE_ARRAY_OES:
+      return VERT_ATTRIB_POINT_SIZE;
+   case GL_TEXTURE_COORD_ARRAY:
+      if (!(shadow->known & GLTHREAD_SHADOW_CLIENT_ACTIVE_TEXTURE)) {
+         shadow->known &= ~GLTHREAD_SHADOW_CLIENT_ARRAYS;
+         return -1;
+      }
+      return VERT_ATTRIB_TEX(shadow->ClientActiveTexture);
+   default:
+      return -1;
+   }
+}
+
+void
+_mesa_glthread_EnableClientState(struct gl_context *ctx, GLenum array,
+                                 GLboolean state)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   int attrib;
+
+   if (array == GL_PRIMITIVE_RESTART_NV) {
+      shadow->PrimitiveRestart = state;
+      return;
+   }
+
+   attrib = get_client_state_attrib(ctx, array);
+   if (attrib < 0)
+      return;
+
+   if (state)
+      shadow->EnabledAttribs |= VERT_BIT(attrib);
+   else
+      shadow->EnabledAttribs &= ~VERT_BIT(attrib);
+}
+
+void
+_mesa_glthread_EnableVertexAttribArray(struct gl_context *ctx, GLuint index,
+                                       GLboolean state)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (index >= ctx->Const.Program[MESA_SHADER_VERTEX].MaxAttribs)
+      return;
+
+   if (state)
+      shadow->EnabledAttribs |= VERT_BIT_GENERIC(index);
+   else
+      shadow->EnabledAttribs &= ~VERT_BIT_GENERIC(index);
+}
+
+void
+_mesa_glthread_VertexAttribDivisor(struct gl_context *ctx, GLuint index,
+                                   GLuint divisor)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (index >= ctx->Const.Program[MESA_SHADER_VERTEX].MaxAttribs)
+      return;
+
+   shadow->Attribs[VERT_ATTRIB_GENERIC(index)].Divisor = divisor;
+}
+
+
+/* Queries */
+
+enum shadow_value_type {
+   SHADOW_INT,
+   SHADOW_INT_4,
+   SHADOW_BOOLEAN,
+   SHADOW_FLOAT_4,
+   SHADOW_MATRIX,
+};
+
+struct shadow_value {
+   enum shadow_value_type type;
+   union {
+      GLint value_int_4[4];
+      GLfloat value_float_4[4];
+      GLboolean value_bool;
+      const GLfloat *value_matrix;
+   };
+};
+
+/**
+ * Returns which group of mirrored state has the value of pname, or 0 if it
+ * isn't mirrored in this context.
+ */
+static GLbitfield
+get_shadow_bit(struct gl_context *ctx, GLenum pname)
+{
+   const bool compat = ctx->API == API_OPENGL_COMPAT;
+
+   switch (pname) {
+   case GL_ACTIVE_TEXTURE:
+      return GLTHREAD_SHADOW_ACTIVE_TEXTURE;
+   case GL_CLIENT_ACTIVE_TEXTURE:
+      return compat ? GLTHREAD_SHADOW_CLIENT_ACTIVE_TEXTURE : 0;
+   case GL_MATRIX_MODE:
+      return compat ? GLTHREAD_SHADOW_MATRIX_MODE : 0;
+   case GL_MODELVIEW_MATRIX:
+   case GL_MODELVIEW_STACK_DEPTH:
+      return compat ? GLTHREAD_SHADOW_MODELVIEW : 0;
+   case GL_PROJECTION_MATRIX:
+   case GL_PROJECTION_STACK_DEPTH:
+      return compat ? GLTHREAD_SHADOW_PROJECTION : 0;
+   case GL_ARRAY_BUFFER_BINDING:
+      return GLTHREAD_SHADOW_ARRAY_BUFFER;
+   case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+      return GLTHREAD_SHADOW_ELEMENT_ARRAY_BUFFER;
+   case GL_VERTEX_ARRAY_BINDING:
+      return GLTHREAD_SHADOW_VERTEX_ARRAY;
+   case GL_CURRENT_PROGRAM:
+      return ctx->API != API_OPENGLES ? GLTHREAD_SHADOW_PROGRAM : 0;
+   case GL_DRAW_FRAMEBUFFER_BINDING:
+      return GLTHREAD_SHADOW_FRAMEBUFFERS;
+   case GL_READ_FRAMEBUFFER_BINDING:
+      return _mesa_is_desktop_gl(ctx) || _mesa_is_gles3(ctx) ?
+             GLTHREAD_SHADOW_FRAMEBUFFERS : 0;
+   case GL_RENDERBUFFER_BINDING:
+      return GLTHREAD_SHADOW_RENDERBUFFER;
+   case GL_TEXTURE_BINDING_2D:
+      return GLTHREAD_SHADOW_TEXTURES;
+   case GL_TEXTURE_BINDING_3D:
+      return _mesa_is_desktop_gl(ctx) ? GLTHREAD_SHADOW_TEXTURES : 0;
+   case GL_TEXTURE_BINDING_CUBE_MAP:
+      return ctx->Extensions.ARB_texture_cube_map ?
+             GLTHREAD_SHADOW_TEXTURES : 0;
+   case GL_VIEWPORT:
+      return GLTHREAD_SHADOW_VIEWPORT;
+   case GL_SCISSOR_BOX:
+      return GLTHREAD_SHADOW_SCISSOR;
+   default:
+      return get_cap_index(ctx, pname) >= 0 ? GLTHREAD_SHADOW_ENABLES : 0;
+   }
+}
+
+static GLuint
+get_texture_binding(const struct gl_context *ctx, int index)
+{
+   const struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   /* Units past the combined limit only exist when there are more texture
+    * coordinate units, and nothing can be bound to them.
+    */
+   if (shadow->ActiveTexture >= ctx->Const.MaxCombinedTextureImageUnits)
+      return 0;
+   return shadow->Textures[shadow->ActiveTexture][index];
+}
+
+/**
+ * Gets the value of a query from the mirrored state, synchronizing first if
+ * it isn't known.  Returns false if pname isn't mirrored.
+ */
+static bool
+get_shadow_value(struct gl_context *ctx, GLenum pname, bool allow_matrix,
+                 struct shadow_value *v)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   const GLbitfield bit = get_shadow_bit(ctx, pname);
+
+   if (!bit)
+      return false;
+
+   if (!allow_matrix &&
+       (pname == GL_MODELVIEW_MATRIX || pname == GL_PROJECTION_MATRIX))
+      return false;
+
+   if (!(shadow->known & bit)) {
+      _mesa_glthread_finish(ctx);
+      load_shadow(ctx);
+
+      if (!(shadow->known & bit))
+         return false;
+   }
+
+   v->type = SHADOW_INT;
+
+   switch (pname) {
+   case GL_ACTIVE_TEXTURE:
+      v->value_int_4[0] = GL_TEXTURE0 + shadow->ActiveTexture;
+      break;
+   case GL_CLIENT_ACTIVE_TEXTURE:
+      v->value_int_4[0] = GL_TEXTURE0 + shadow->ClientActiveTexture;
+      break;
+   case GL_MATRIX_MODE:
+      v->value_int_4[0] = shadow->MatrixMode;
+      break;
+   case GL_MODELVIEW_MATRIX:
+      v->type = SHADOW_MATRIX;
+      v->value_matrix = shadow->Modelview.Stack[shadow->Modelview.Depth].m;
+      break;
+   case GL_MODELVIEW_STACK_DEPTH:
+      v->value_int_4[0] = shadow->Modelview.Depth + 1;
+      break;
+   case GL_PROJECTION_MATRIX:
+      v->type = SHADOW_MATRIX;
+      v->value_matrix = shadow->Projection.Stack[shadow->Projection.Depth].m;
+      break;
+   case GL_PROJECTION_STACK_DEPTH:
+      v->value_int_4[0] = shadow->Projection.Depth + 1;
+      break;
+   case GL_ARRAY_BUFFER_BINDING:
+      v->value_int_4[0] = shadow->ArrayBuffer;
+      break;
+   case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+      v->value_int_4[0] = shadow->ElementArrayBuffer;
+      break;
+   case GL_VERTEX_ARRAY_BINDING:
+      v->value_int_4[0] = shadow->VertexArray;
+      break;
+   case GL_CURRENT_PROGRAM:
+      v->value_int_4[0] = shadow->Program;
+      break;
+   case GL_DRAW_FRAMEBUFFER_BINDING:
+      v->value_int_4[0] = shadow->DrawFramebuffer;
+      break;
+   case GL_READ_FRAMEBUFFER_BINDING:
+      v->value_int_4[0] = shadow->ReadFramebuffer;
+      break;
+   case GL_RENDERBUFFER_BINDING:
+      v->value_int_4[0] = shadow->Renderbuffer;
+      break;
+   case GL_TEXTURE_BINDING_2D:
+      v->value_int_4[0] =
+         get_texture_binding(ctx, GLTHREAD_SHADOW_TEXTURE_2D);
+      break;
+   case GL_TEXTURE_BINDING_3D:
+      v->value_int_4[0] =
+         get_texture_binding(ctx, GLTHREAD_SHADOW_TEXTURE_3D);
+      break;
+   case GL_TEXTURE_BINDING_CUBE_MAP:
+      v->value_int_4[0] =
+         get_texture_binding(ctx, GLTHREAD_SHADOW_TEXTURE_CUBE_MAP);
+      break;
+   case GL_VIEWPORT:
+      v->type = SHADOW_FLOAT_4;
+      memcpy(v->value_float_4, shadow->Viewport, sizeof(shadow->Viewport));
+      break;
+   case GL_SCISSOR_BOX:
+      v->type = SHADOW_INT_4;
+      memcpy(v->value_int_4, shadow->Scissor, sizeof(shadow->Scissor));
+      break;
+   default:
+      v->type = SHADOW_BOOLEAN;
+      v->value_bool = (shadow->Enables >> get_cap_index(ctx, pname)) & 1;
+      break;
+   }
+
+   return true;
+}
+
+/* The conversions below match get.c. */
+
+bool
+_mesa_glthread_GetBooleanv(struct gl_context *ctx, GLenum pname,
+                           GLboolean *params)
+{
+   struct shadow_value v;
+
+   if (!get_shadow_value(ctx, pname, false, &v))
+      return false;
+
+   switch (v.type) {
+   case SHADOW_INT_4:
+      params[3] = v.value_int_4[3] ? GL_TRUE : GL_FALSE;
+      params[2] = v.value_int_4[2] ? GL_TRUE : GL_FALSE;
+      params[1] = v.value_int_4[1] ? GL_TRUE : GL_FALSE;
+      /* fallthrough */
+   case SHADOW_INT:
+      params[0] = v.value_int_4[0] ? GL_TRUE : GL_FALSE;
+      break;
+   case SHADOW_BOOLEAN:
+      params[0] = v.value_bool;
+      break;
+   case SHADOW_FLOAT_4:
+      for (unsigned i = 0; i < 4; i++)
+         params[i] = v.value_float_4[i] ? GL_TRUE : GL_FALSE;
+      break;
+   default:
+      return false;
+   }
+
+   return true;
+}
+
+bool
+_mesa_glthread_GetIntegerv(struct gl_context *ctx, GLenum pname,
+                           GLint *params)
+{
+   struct shadow_value v;
+
+   if (!get_shadow_value(ctx, pname, false, &v))
+      return false;
+
+   switch (v.type) {
+   case SHADOW_INT_4:
+      params[3] = v.value_int_4[3];
+      params[2] = v.value_int_4[2];
+      params[1] = v.value_int_4[1];
+      /* fallthrough */
+   case SHADOW_INT:
+      params[0] = v.value_int_4[0];
+      break;
+   case SHADOW_BOOLEAN:
+      params[0] = (GLint) v.value_bool;
+      break;
+   case SHADOW_FLOAT_4:
+      for (unsigned i = 0; i < 4; i++)
+         params[i] = IROUND(v.value_float_4[i]);
+      break;
+   default:
+      return false;
+   }
+
+   return true;
+}
+
+bool
+_mesa_glthread_GetFloatv(struct gl_context *ctx, GLenum pname,
+                         GLfloat *params)
+{
+   struct shadow_value v;
+
+   if (!get_shadow_value(ctx, pname, true, &v))
+      return false;
+
+   switch (v.type) {
+   case SHADOW_INT_4:
+      params[3] = (GLfloat) v.value_int_4[3];
+      params[2] = (GLfloat) v.value_int_4[2];
+      params[1] = (GLfloat) v.value_int_4[1];
+      /* fallthrough */
+   case SHADOW_INT:
+      params[0] = (GLfloat) v.value_int_4[0];
+      break;
+   case SHADOW_BOOLEAN:
+      params[0] = v.value_bool ? 1.0F : 0.0F;
+      break;
+   case SHADOW_FLOAT_4:
+      memcpy(params, v.value_float_4, 4 * sizeof(GLfloat));
+      break;
+   case SHADOW_MATRIX:
+      memcpy(params, v.value_matrix, 16 * sizeof(GLfloat));
+      break;
+   }
+
+   return true;
+}
+
+bool
+_mesa_glthread_GetDoublev(struct gl_context *ctx, GLenum pname,
+                          GLdouble *params)
+{
+   struct shadow_value v;
+
+   if (!get_shadow_value(ctx, pname, true, &v))
+      return false;
+
+   switch (v.type) {
+   case SHADOW_INT_4:
+      params[3] = (GLdouble) v.value_int_4[3];
+      params[2] = (GLdouble) v.value_int_4[2];
+      params[1] = (GLdouble) v.value_int_4[1];
+      /* fallthrough */
+   case SHADOW_INT:
+      params[0] = (GLdouble) v.value_int_4[0];
+      break;
+   case SHADOW_BOOLEAN:
+      params[0] = v.value_bool;
+      break;
+   case SHADOW_FLOAT_4:
+      for (unsigned i = 0; i < 4; i++)
+         params[i] = v.value_float_4[i];
+      break;
+   case SHADOW_MATRIX:
+      for (unsigned i = 0; i < 16; i++)
+         params[i] = v.value_matrix[i];
+      break;
+   }
+
+   return true;
+}
+
+bool
+_mesa_glthread_IsEnabled(struct gl_context *ctx, GLenum cap,
+                         GLboolean *result)
+{
+   struct shadow_value v;
+
+   if (get_cap_index(ctx, cap) < 0 ||
+       !get_shadow_value(ctx, cap, false, &v))
+      return false;
+
+   *result = v.value_bool;
+   return true;
+}
@@ -40,6 +40,15 @@
 #include "util/half_float.h"
 #include "util/format_rgb9e5.h"
 #include "util/format_r11g11b10f.h"
+#include "util/u_queue.h"
+
+#if defined(HAVE_PTHREAD)
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 
 
@@ -138,6 +147,223 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
 /*@}*/
 
 
+#if defined(__SSE2__)
+
+/**
+ * \name SSE2 versions of the most common do_row() cases
+ *
+ * These only handle halving the width, where each dest pixel is the
+ * average of pixels 2i and 2i+1 of both source rows, and give the same
+ * results as the C code, including the order of the float additions.
+ * They return the number of dest pixels which were done.
+ */
+/*@{*/
+
+static GLint
+do_row_sse2_ubyte4(const GLubyte *rowA, const GLubyte *rowB,
+                   GLint dstWidth, GLubyte *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLint i;
+
+   for (i = 0; i + 4 <= dstWidth; i += 4) {
+      const __m128i a0 = _mm_loadu_si128((const __m128i *) (rowA + i * 8));
+      const __m128i a1 = _mm_loadu_si128((const __m128i *) (rowA + i * 8 + 16));
+      const __m128i b0 = _mm_loadu_si128((const __m128i *) (rowB + i * 8));
+      const __m128i b1 = _mm_loadu_si128((const __m128i *) (rowB + i * 8 + 16));
+      /* vertical sums of source pixels 0-1, 2-3, 4-5 and 6-7 */
+      const __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                                       _mm_unpacklo_epi8(b0, zero));
+      const __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                                       _mm_unpackhi_epi8(b0, zero));
+      const __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                                       _mm_unpacklo_epi8(b1, zero));
+      const __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                                       _mm_unpackhi_epi8(b1, zero));
+      /* horizontal sums */
+      const __m128i d0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1),
+                                       _mm_unpackhi_epi64(s0, s1));
+      const __m128i d1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3),
+                                       _mm_unpackhi_epi64(s2, s3));
+
+      _mm_storeu_si128((__m128i *) (dst + i * 4),
+                       _mm_packus_epi16(_mm_srli_epi16(d0, 2),
+                                        _mm_srli_epi16(d1, 2)));
+   }
+
+   return i;
+}
+
+static GLint
+do_row_sse2_ushort1(const GLushort *rowA, const GLushort *rowB,
+                    GLint dstWidth, GLushort *dst)
+{
+   const __m128i lo = _mm_set1_epi32(0xffff);
+   __m128i d[2];
+   GLint i, k;
+
+   for (i = 0; i + 8 <= dstWidth; i += 8) {
+      for (k = 0; k < 2; k++) {
+         const __m128i a = _mm_loadu_si128((const __m128i *) (rowA + i * 2 + k * 8));
+         const __m128i b = _mm_loadu_si128((const __m128i *) (rowB + i * 2 + k * 8));
+         __m128i s;
+
+         s = _mm_add_epi32(_mm_and_si128(a, lo), _mm_srli_epi32(a, 16));
+         s = _mm_add_epi32(s, _mm_and_si128(b, lo));
+         s = _mm_add_epi32(s, _mm_srli_epi32(b, 16));
+         s = _mm_srli_epi32(s, 2);
+         /* sign extend so that the signed pack below doesn't saturate */
+         d[k] = _mm_srai_epi32(_mm_slli_epi32(s, 16), 16);
+      }
+
+      _mm_storeu_si128((__m128i *) (dst + i), _mm_packs_epi32(d[0], d[1]));
+   }
+
+   return i;
+}
+
+/** Splits 8 dwords in even and odd ones */
+static inline void
+deinterleave_epi32(__m128i v0, __m128i v1, __m128i *even, __m128i *odd)
+{
+   *even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(v0),
+                                           _mm_castsi128_ps(v1),
+                                           _MM_SHUFFLE(2, 0, 2, 0)));
+   *odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(v0),
+                                          _mm_castsi128_ps(v1),
+                                          _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+static GLint
+do_row_sse2_uint1(const GLuint *rowA, const GLuint *rowB,
+                  GLint dstWidth, GLuint *dst)
+{
+   GLint i;
+
+   for (i = 0; i + 4 <= dstWidth; i += 4) {
+      __m128i aj, ak, bj, bk, s;
+
+      deinterleave_epi32(_mm_loadu_si128((const __m128i *) (rowA + i * 2)),
+                         _mm_loadu_si128((const __m128i *) (rowA + i * 2 + 4)),
+                         &aj, &ak);
+      deinterleave_epi32(_mm_loadu_si128((const __m128i *) (rowB + i * 2)),
+                         _mm_loadu_si128((const __m128i *) (rowB + i * 2 + 4)),
+                         &bj, &bk);
+
+      s = _mm_add_epi32(_mm_srli_epi32(aj, 2), _mm_srli_epi32(ak, 2));
+      s = _mm_add_epi32(s, _mm_srli_epi32(bj, 2));
+      s = _mm_add_epi32(s, _mm_srli_epi32(bk, 2));
+      _mm_storeu_si128((__m128i *) (dst + i), s);
+   }
+
+   return i;
+}
+
+static GLint
+do_row_sse2_z24_s8(const GLuint *rowA, const GLuint *rowB,
+                   GLint dstWidth, GLuint *dst)
+{
+   const __m128i s_mask = _mm_set1_epi32(0xff);
+   GLint i;
+
+   for (i = 0; i + 4 <= dstWidth; i += 4) {
+      __m128i aj, ak, bj, bk, z, s;
+
+      deinterleave_epi32(_mm_loadu_si128((const __m128i *) (rowA + i * 2)),
+                         _mm_loadu_si128((const __m128i *) (rowA + i * 2 + 4)),
+                         &aj, &ak);
+      deinterleave_epi32(_mm_loadu_si128((const __m128i *) (rowB + i * 2)),
+                         _mm_loadu_si128((const __m128i *) (rowB + i * 2 + 4)),
+                         &bj, &bk);
+
+      z = _mm_add_epi32(_mm_srli_epi32(aj, 8), _mm_srli_epi32(ak, 8));
+      z = _mm_add_epi32(z, _mm_srli_epi32(bj, 8));
+      z = _mm_add_epi32(z, _mm_srli_epi32(bk, 8));
+      z = _mm_slli_epi32(_mm_srli_epi32(z, 2), 8);
+
+      s = _mm_add_epi32(_mm_and_si128(aj, s_mask), _mm_and_si128(ak, s_mask));
+      s = _mm_add_epi32(s, _mm_and_si128(bj, s_mask));
+      s = _mm_add_epi32(s, _mm_and_si128(bk, s_mask));
+      s = _mm_srli_epi32(s, 2);
+
+      _mm_storeu_si128((__m128i *) (dst + i), _mm_or_si128(z, s));
+   }
+
+   return i;
+}
+
+static GLint
+do_row_sse2_float4(const GLfloat *rowA, const GLfloat *rowB,
+                   GLint dstWidth, GLfloat *dst)
+{
+   const __m128 quarter = _mm_set1_ps(0.25F);
+   GLint i;
+
+   for (i = 0; i < dstWidth; i++) {
+      __m128 s = _mm_add_ps(_mm_loadu_ps(rowA + i * 8),
+                            _mm_loadu_ps(rowA + i * 8 + 4));
+      s = _mm_add_ps(s, _mm_loadu_ps(rowB + i * 8));
+      s = _mm_add_ps(s, _mm_loadu_ps(rowB + i * 8 + 4));
+      _mm_storeu_ps(dst + i * 4, _mm_mul_ps(s, quarter));
+   }
+
+   return i;
+}
+
+static GLint
+do_row_sse2_float1(const GLfloat *rowA, const GLfloat *rowB,
+                   GLint dstWidth, GLfloat *dst)
+{
+   const __m128 quarter = _mm_set1_ps(0.25F);
+   GLint i;
+
+   for (i = 0; i + 4 <= dstWidth; i += 4) {
+      const __m128 a0 = _mm_loadu_ps(rowA + i * 2);
+      const __m128 a1 = _mm_loadu_ps(rowA + i * 2 + 4);
+      const __m128 b0 = _mm_loadu_ps(rowB + i * 2);
+      const __m128 b1 = _mm_loadu_ps(rowB + i * 2 + 4);
+      __m128 s;
+
+      s = _mm_add_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)),
+                     _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+      s = _mm_add_ps(s, _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+      s = _mm_add_ps(s, _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+      _mm_storeu_ps(dst + i, _mm_mul_ps(s, quarter));
+   }
+
+   return i;
+}
+
+static GLint
+do_row_sse2(GLenum datatype, GLuint comps,
+            const GLvoid *srcRowA, const GLvoid *srcRowB,
+            GLint dstWidth, GLvoid *dstRow)
+{
+   if (datatype == GL_UNSIGNED_BYTE && comps == 4)
+      return do_row_sse2_ubyte4(srcRowA, srcRowB, dstWidth, dstRow);
+   else if (datatype == GL_UNSIGNED_SHORT && comps == 1)
+      return do_row_sse2_ushort1(srcRowA, srcRowB, dstWidth, dstRow);
+   else if (datatype == GL_UNSIGNED_INT && comps == 1)
+      return do_row_sse2_uint1(srcRowA, srcRowB, dstWidth, dstRow);
+   else if (datatype == GL_UNSIGNED_INT_24_8_MESA && comps == 2)
+      return do_row_sse2_z24_s8(srcRowA, srcRowB, dstWidth, dstRow);
+   else if (datatype == GL_FLOAT && comps == 4)
+      return do_row_sse2_float4(srcRowA, srcRowB, dstWidth, dstRow);
+   else if (datatype == GL_FLOAT && comps == 1)
+      return do_row_sse2_float1(srcRowA, srcRowB, dstWidth, dstRow);
+   else
+      return 0;
+}
+/*@}*/
+
+#endif /* __SSE2__ */
+
+
+/* Cleared by the unit tests to compare the SIMD and C code paths */
+static bool mipmap_use_simd = true;
+static bool mipmap_use_threads = true;
+
+
 /**
  * Average together two rows of a source image to produce a single new
  * row in the dest image.  It's legal for the two source rows to point
@@ -151,6 +377,24 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
        const GLvoid *srcRowA, const GLvoid *srcRowB,
        GLint dstWidth, GLvoid *dstRow)
 {
+#if defined(__SSE2__)
+   if (srcWidth != dstWidth && mipmap_use_simd) {
+      const GLint bpt = bytes_per_pixel(datatype, comps);
+      const GLint done = do_row_sse2(datatype, comps, srcRowA, srcRowB,
+                                     dstWidth, dstRow);
+
+      if (done == dstWidth)
+         return;
+
+      /* do the remaining pixels below */
+      srcRowA = (const GLubyte *) srcRowA + 2 * done * bpt;
+      srcRowB = (const GLubyte *) srcRowB + 2 * done * bpt;
+      dstRow = (GLubyte *) dstRow + done * bpt;
+      srcWidth -= 2 * done;
+      dstWidth -= done;
+   }
+#endif
+
    const GLuint k0 = (srcWidth == dstWidth) ? 0 : 1;
    const GLuint colStride = (srcWidth == dstWidth) ? 1 : 2;
 
@@ -1442,43 +1686,239 @@ make_1d_mipmap(GLenum datatype, GLuint comps, GLint border,
 }
 
 
+/**
+ * Number of source rows sampled for each dest row of a 2D image, 1 or 2.
+ */
+static inline GLint
+src_row_step_2d(GLint srcHeight, GLint dstHeight)
+{
+   return (srcHeight > 1 && srcHeight > dstHeight) ? 2 : 1;
+}
+
+
+/**
+ * Filter rows [firstRow, firstRow + numRows) of the inside of a 2D image,
+ * not counting the border.
+ */
 static void
-make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
-               GLint srcWidth, GLint srcHeight,
-	       const GLubyte *srcPtr, GLint srcRowStride,
-               GLint dstWidth, GLint dstHeight,
-	       GLubyte *dstPtr, GLint dstRowStride)
+make_2d_mipmap_rows(GLenum datatype, GLuint comps, GLint border,
+                    GLint srcWidth, GLint srcHeight,
+                    const GLubyte *srcPtr, GLint srcRowStride,
+                    GLint dstWidth, GLint dstHeight,
+                    GLubyte *dstPtr, GLint dstRowStride,
+                    GLint firstRow, GLint numRows)
 {
    const GLint bpt = bytes_per_pixel(datatype, comps);
    const GLint srcWidthNB = srcWidth - 2 * border;  /* sizes w/out border */
    const GLint dstWidthNB = dstWidth - 2 * border;
-   const GLint dstHeightNB = dstHeight - 2 * border;
+   const GLint srcRowStep = src_row_step_2d(srcHeight, dstHeight);
    const GLubyte *srcA, *srcB;
    GLubyte *dst;
-   GLint row, srcRowStep;
+   GLint row;
 
    /* Compute src and dst pointers, skipping any border */
-   srcA = srcPtr + border * ((srcWidth + 1) * bpt);
-   if (srcHeight > 1 && srcHeight > dstHeight) {
+   srcA = srcPtr + border * ((srcWidth + 1) * bpt) +
+          firstRow * srcRowStep * srcRowStride;
+   if (srcRowStep == 2) {
       /* sample from two source rows */
       srcB = srcA + srcRowStride;
-      srcRowStep = 2;
    }
    else {
       /* sample from one source row */
       srcB = srcA;
-      srcRowStep = 1;
    }
 
-   dst = dstPtr + border * ((dstWidth + 1) * bpt);
+   dst = dstPtr + border * ((dstWidth + 1) * bpt) + firstRow * dstRowStride;
 
-   for (row = 0; row < dstHeightNB; row++) {
+   for (row = 0; row < numRows; row++) {
       do_row(datatype, comps, srcWidthNB, srcA, srcB,
              dstWidthNB, dst);
       srcA += srcRowStep * srcRowStride;
       srcB += srcRowStep * srcRowStride;
       dst += dstRowStride;
    }
+}
+
+
+/* 2D images with at least this many pixels are filtered by several
+ * threads, each one doing a band of MIPMAP_BAND_ROWS dest rows.
+ */
+#define MIPMAP_THREAD_MIN_PIXELS (256 * 256)
+#define MIPMAP_BAND_ROWS 32
+#define MIPMAP_MAX_THREADS 8
+
+struct mipmap_band_job {
+   struct util_queue_fence fence;
+   GLenum datatype;
+   GLuint comps;
+   const struct mipmap_level_map *src, *dst;
+   GLint firstRow, numRows;
+   /* the jobs writing the source rows, if the source is generated too */
+   struct mipmap_band_job *deps;
+   unsigned numDeps;
+};
+
+static struct util_queue mipmap_queue;
+static unsigned mipmap_num_threads = 1;
+static once_flag mipmap_queue_once = ONCE_FLAG_INIT;
+
+static void
+init_mipmap_queue(void)
+{
+   unsigned num_threads = 1;
+   const char *str;
+
+#if defined(HAVE_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+   long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   if (num_cpus > 0)
+      num_threads = MIN2(num_cpus, MIPMAP_MAX_THREADS);
+#endif
+
+   /* MESA_MIPMAP_THREADS=1 disables the threading */
+   str = getenv("MESA_MIPMAP_THREADS");
+   if (str)
+      num_threads = CLAMP(atoi(str), 1, MIPMAP_MAX_THREADS);
+
+   /* The calling thread only waits for the jobs. */
+   if (num_threads > 1 &&
+       util_queue_init(&mipmap_queue, "mesamip", 32, num_threads,
+                       UTIL_QUEUE_INIT_RESIZE_IF_FULL))
+      mipmap_num_threads = num_threads;
+}
+
+static void
+mipmap_band_job_execute(void *data, int thread_index)
+{
+   struct mipmap_band_job *job = data;
+   unsigned i;
+
+   /* The jobs of the previous level were queued first, so they're
+    * already running on other threads or done.
+    */
+   for (i = 0; i < job->numDeps; i++)
+      util_queue_fence_wait(&job->deps[i].fence);
+
+   make_2d_mipmap_rows(job->datatype, job->comps, 0,
+                       job->src->width, job->src->height,
+                       job->src->map, job->src->rowStride,
+                       job->dst->width, job->dst->height,
+                       job->dst->map, job->dst->rowStride,
+                       job->firstRow, job->numRows);
+}
+
+
+/**
+ * Generate levels[1..numLevels-1] of a 2D image without a border from
+ * levels[0], each level from the previous one.
+ *
+ * Every level is split in bands of rows filtered in parallel.  As a band
+ * only waits for the bands of the previous level it reads, the next
+ * level starts before the previous one is complete.
+ */
+void
+_mesa_generate_mipmap_chain_2d(GLenum datatype, GLuint comps,
+                               unsigned numLevels,
+                               const struct mipmap_level_map *levels)
+{
+   struct mipmap_band_job *jobs = NULL, *job, *prev = NULL;
+   unsigned numJobs = 0, prevBands = 0, level, i;
+
+   call_once(&mipmap_queue_once, init_mipmap_queue);
+
+   if (mipmap_num_threads > 1 && mipmap_use_threads) {
+      for (level = 1; level < numLevels; level++)
+         numJobs += DIV_ROUND_UP(levels[level].height, MIPMAP_BAND_ROWS);
+      jobs = calloc(numJobs, sizeof(*jobs));
+   }
+
+   if (!jobs) {
+      for (level = 1; level < numLevels; level++) {
+         const struct mipmap_level_map *src = &levels[level - 1];
+         const struct mipmap_level_map *dst = &levels[level];
+
+         make_2d_mipmap_rows(datatype, comps, 0,
+                             src->width, src->height,
+                             src->map, src->rowStride,
+                             dst->width, dst->height,
+                             dst->map, dst->rowStride,
+                             0, dst->height);
+      }
+      return;
+   }
+
+   job = jobs;
+   for (level = 1; level < numLevels; level++) {
+      const struct mipmap_level_map *src = &levels[level - 1];
+      const struct mipmap_level_map *dst = &levels[level];
+      const GLint srcRowStep = src_row_step_2d(src->height, dst->height);
+      const unsigned numBands = DIV_ROUND_UP(dst->height, MIPMAP_BAND_ROWS);
+      unsigned band;
+
+      for (band = 0; band < numBands; band++, job++) {
+         job->datatype = datatype;
+         job->comps = comps;
+         job->src = src;
+         job->dst = dst;
+         job->firstRow = band * MIPMAP_BAND_ROWS;
+         job->numRows = MIN2(MIPMAP_BAND_ROWS, dst->height - job->firstRow);
+
+         if (prev) {
+            /* the source rows of this band */
+            const unsigned firstRow = job->firstRow * srcRowStep;
+            const unsigned lastRow =
+               (job->firstRow + job->numRows) * srcRowStep - 1;
+            const unsigned firstDep = firstRow / MIPMAP_BAND_ROWS;
+            const unsigned lastDep = MIN2(lastRow / MIPMAP_BAND_ROWS,
+                                          prevBands - 1);
+
+            job->deps = prev + firstDep;
+            job->numDeps = lastDep - firstDep + 1;
+         }
+
+         util_queue_fence_init(&job->fence);
+         util_queue_add_job(&mipmap_queue, job, &job->fence,
+                            mipmap_band_job_execute, NULL);
+      }
+
+      prev = job - numBands;
+      prevBands = numBands;
+   }
+
+   for (i = 0; i < numJobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+   free(jobs);
+}
+
+
+static void
+make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
+               GLint srcWidth, GLint srcHeight,
+	       const GLubyte *srcPtr, GLint srcRowStride,
+               GLint dstWidth, GLint dstHeight,
+	       GLubyte *dstPtr, GLint dstRowStride)
+{
+   const GLint bpt = bytes_per_pixel(datatype, comps);
+   const GLint srcWidthNB = srcWidth - 2 * border;  /* sizes w/out border */
+   const GLint dstWidthNB = dstWidth - 2 * border;
+   const GLint dstHeightNB = dstHeight - 2 * border;
+   GLint row;
+
+   if (border == 0 && srcWidth * srcHeight >= MIPMAP_THREAD_MIN_PIXELS) {
+      const struct mipmap_level_map levels[2] = {
+         { srcWidth, srcHeight, (GLubyte *) srcPtr, srcRowStride },
+         { dstWidth, dstHeight, dstPtr, dstRowStride },
+      };
+
+      _mesa_generate_mipmap_chain_2d(datatype, comps, 2, levels);
+      return;
+   }
+
+   make_2d_mipmap_rows(datatype, comps, border,
+                       srcWidth, srcHeight, srcPtr, srcRowStride,
+                       dstWidth, dstHeight, dstPtr, dstRowStride,
+                       0, dstHeightNB);
 
    /* This is ugly but probably won't be used much */
    if (border > 0) {
@@ -1687,6 +2127,19 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
 }
 
 
+/**
+ * Select the code paths used to filter the images, for the unit tests.
+ * \param simd  whether rows may be filtered with SIMD instructions
+ * \param threads  whether big images may be filtered by several threads
+ */
+void
+_mesa_select_mipmap_paths(bool simd, bool threads)
+{
+   mipmap_use_simd = simd;
+   mipmap_use_threads = threads;
+}
+
+
 /**
  * Down-sample a texture image to produce the next lower mipmap level.
  * \param comps  components per texel (1, 2, 3 or 4)
@@ -1917,6 +2370,76 @@ _mesa_prepare_mipmap_levels(struct gl_context *ctx,
 }
 
 
+/**
+ * Generate all the levels of a large 2D image, 2D array or cube face
+ * without a border at once, so that the level chain can be pipelined.
+ * This needs every level to be mapped at the same time.
+ * \return GL_FALSE if the levels couldn't be mapped.
+ */
+static GLboolean
+generate_mipmap_2d_chain(struct gl_context *ctx, GLenum target,
+                         struct gl_texture_object *texObj,
+                         GLenum datatype, GLuint comps, GLuint maxLevel)
+{
+   struct gl_texture_image *images[MAX_TEXTURE_LEVELS];
+   struct mipmap_level_map *levels;
+   GLuint numLevels = 0, depth, level, slice;
+   GLboolean success = GL_TRUE;
+
+   for (level = texObj->BaseLevel;
+        level <= maxLevel && level < MAX_TEXTURE_LEVELS; level++) {
+      images[numLevels] = _mesa_select_tex_image(texObj, target, level);
+      if (!images[numLevels])
+         break;
+      numLevels++;
+   }
+
+   if (numLevels < 2)
+      return GL_TRUE;
+
+   depth = images[0]->Depth;
+   levels = calloc(depth * numLevels, sizeof(*levels));
+   if (!levels)
+      return GL_FALSE;
+
+   for (level = 0; level < numLevels && success; level++) {
+      /* all but the base level are read too, to make the next level */
+      const GLbitfield access =
+         level == 0 ? GL_MAP_READ_BIT : GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
+
+      for (slice = 0; slice < depth; slice++) {
+         struct mipmap_level_map *l = &levels[slice * numLevels + level];
+
+         l->width = images[level]->Width;
+         l->height = images[level]->Height;
+         ctx->Driver.MapTextureImage(ctx, images[level], slice,
+                                     0, 0, l->width, l->height, access,
+                                     &l->map, &l->rowStride);
+         if (!l->map) {
+            success = GL_FALSE;
+            break;
+         }
+      }
+   }
+
+   if (success) {
+      for (slice = 0; slice < depth; slice++)
+         _mesa_generate_mipmap_chain_2d(datatype, comps, numLevels,
+                                        &levels[slice * numLevels]);
+   }
+
+   for (level = 0; level < numLevels; level++) {
+      for (slice = 0; slice < depth; slice++) {
+         if (levels[slice * numLevels + level].map)
+            ctx->Driver.UnmapTextureImage(ctx, images[level], slice);
+      }
+   }
+   free(levels);
+
+   return success;
+}
+
+
 static void
 generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
 			     struct gl_texture_object *texObj,
@@ -1929,6 +2452,15 @@ generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
 
    _mesa_uncompressed_format_to_type_and_comps(srcImage->TexFormat, &datatype, &comps);
 
+   if (target != GL_TEXTURE_1D && target != GL_TEXTURE_1D_ARRAY &&
+       target != GL_TEXTURE_3D && srcImage->Border == 0 &&
+       srcImage->Width * srcImage->Height >= MIPMAP_THREAD_MIN_PIXELS) {
+      /* If mapping all the levels failed, try one level at a time */
+      if (generate_mipmap_2d_chain(ctx, target, texObj, datatype, comps,
+                                   maxLevel))
+         return;
+   }
+
    for (level = texObj->BaseLevel; level < maxLevel; level++) {
       /* generate image[level+1] from image[level] */
       struct gl_texture_image *srcImage, *dstImage;
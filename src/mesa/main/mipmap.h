@@ -28,6 +28,16 @@
 
 #include "mtypes.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A mapped slice of a mipmap level without a border */
+struct mipmap_level_map {
+   GLint width, height;
+   GLubyte *map;
+   GLint rowStride;
+};
 
 extern void
 _mesa_generate_mipmap_level(GLenum target,
@@ -40,6 +50,14 @@ _mesa_generate_mipmap_level(GLenum target,
                             GLubyte **dstData,
                             GLint dstRowStride);
 
+extern void
+_mesa_generate_mipmap_chain_2d(GLenum datatype, GLuint comps,
+                               unsigned numLevels,
+                               const struct mipmap_level_map *levels);
+
+extern void
+_mesa_select_mipmap_paths(bool simd, bool threads);
+
 void
 _mesa_prepare_mipmap_levels(struct gl_context *ctx,
                             struct gl_texture_object *texObj,
@@ -54,4 +72,8 @@ _mesa_next_mipmap_level_size(GLenum target, GLint border,
                        GLint srcWidth, GLint srcHeight, GLint srcDepth,
                        GLint *dstWidth, GLint *dstHeight, GLint *dstDepth);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* MIPMAP_H */
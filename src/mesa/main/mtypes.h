@@ -1551,6 +1551,13 @@ struct gl_vertex_array_object
    /** Mask of VERT_BIT_* values indicating changed/dirty arrays */
    GLbitfield64 NewArrays;
 
+   /**
+    * Changes whenever _VertexAttrib is updated.  Stamps are unique across
+    * all VAOs, so drivers can use them to validate state derived from the
+    * arrays of a VAO.
+    */
+   GLuint _Stamp;
+
    /** The index buffer (also known as the element array buffer in OpenGL). */
    struct gl_buffer_object *IndexBufferObj;
 };
@@ -3138,6 +3145,12 @@ struct gl_shader_compiler_options
    /** Clamp UBO and SSBO block indices so they don't go out-of-bounds. */
    GLboolean ClampBlockIndicesToArrayBounds;
 
+   /**
+    * Only run the GLSL IR optimizations needed to link the shader, and
+    * leave the rest to NIR.
+    */
+   GLboolean OptimizeInNIR;
+
    const struct nir_shader_compiler_options *NirOptions;
 };
 
@@ -0,0 +1,184 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name format_convert.cpp
+ *
+ * Verify that the vectorized and multithreaded paths of
+ * _mesa_swizzle_and_convert() and _mesa_format_convert() give the same
+ * results as converting one pixel, or one row, at a time.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <math.h>
+
+#include "main/format_utils.h"
+#include "x86/common_x86_asm.h"
+
+namespace {
+
+const enum mesa_array_format_datatype types[] = {
+   MESA_ARRAY_FORMAT_TYPE_UBYTE,
+   MESA_ARRAY_FORMAT_TYPE_USHORT,
+   MESA_ARRAY_FORMAT_TYPE_HALF,
+   MESA_ARRAY_FORMAT_TYPE_FLOAT,
+};
+
+const uint8_t swizzles[][4] = {
+   { 0, 1, 2, 3 },
+   { 2, 1, 0, 3 },
+   { 0, 1, 2, MESA_FORMAT_SWIZZLE_ONE },
+   { 3, MESA_FORMAT_SWIZZLE_ZERO, 1, MESA_FORMAT_SWIZZLE_ONE },
+};
+
+const int num_pixels = 67;
+
+class FormatConvertTest : public ::testing::Test {
+protected:
+   virtual void SetUp();
+
+   void fill_source(enum mesa_array_format_datatype type);
+
+   uint32_t seed;
+   uint8_t src[num_pixels * 16];
+   uint8_t dst[num_pixels * 16];
+   uint8_t expected[num_pixels * 16];
+};
+
+void
+FormatConvertTest::SetUp()
+{
+   seed = 1;
+#if defined(USE_X86_ASM) || defined(USE_X86_64_ASM)
+   _mesa_get_x86_features();
+#endif
+}
+
+void
+FormatConvertTest::fill_source(enum mesa_array_format_datatype type)
+{
+   for (unsigned i = 0; i < sizeof(src); i++) {
+      seed = seed * 1103515245 + 12345;
+      src[i] = seed >> 16;
+   }
+
+   /* Keep floats mostly within [0, 1], with some special values */
+   if (type == MESA_ARRAY_FORMAT_TYPE_FLOAT) {
+      float *f = (float *) src;
+      for (int i = 0; i < num_pixels * 4; i++) {
+         switch (i % 7) {
+         case 0: f[i] = NAN; break;
+         case 1: f[i] = -0.5f; break;
+         case 2: f[i] = 1.5f; break;
+         default: f[i] = (src[i] | (src[i + 1] << 8)) / 65535.0f; break;
+         }
+      }
+   }
+}
+
+} /* anonymous namespace */
+
+/**
+ * Converting all pixels at once may use SIMD instructions, while
+ * converting one pixel at a time always uses the C code.
+ */
+TEST_F(FormatConvertTest, SwizzleAndConvertMatchesScalar)
+{
+   for (unsigned d = 0; d < ARRAY_SIZE(types); d++) {
+      for (unsigned s = 0; s < ARRAY_SIZE(types); s++) {
+         for (unsigned sw = 0; sw < ARRAY_SIZE(swizzles); sw++) {
+            for (int normalized = 0; normalized < 2; normalized++) {
+               const int dst_size =
+                  _mesa_array_format_datatype_get_size(types[d]) * 4;
+               const int src_size =
+                  _mesa_array_format_datatype_get_size(types[s]) * 4;
+
+               /* Non-normalized float to integer conversions with
+                * out-of-range values aren't well defined.
+                */
+               if (!normalized && types[s] == MESA_ARRAY_FORMAT_TYPE_FLOAT &&
+                   types[d] != MESA_ARRAY_FORMAT_TYPE_FLOAT &&
+                   types[d] != MESA_ARRAY_FORMAT_TYPE_HALF)
+                  continue;
+
+               SCOPED_TRACE(testing::Message() << "dst type " << types[d]
+                            << ", src type " << types[s]
+                            << ", swizzle " << sw
+                            << ", normalized " << normalized);
+
+               fill_source(types[s]);
+               memset(dst, 0, sizeof(dst));
+               memset(expected, 0, sizeof(expected));
+
+               _mesa_swizzle_and_convert(dst, types[d], 4, src, types[s], 4,
+                                         swizzles[sw], normalized,
+                                         num_pixels);
+
+               for (int i = 0; i < num_pixels; i++) {
+                  _mesa_swizzle_and_convert(expected + i * dst_size,
+                                            types[d], 4,
+                                            src + i * src_size,
+                                            types[s], 4,
+                                            swizzles[sw], normalized, 1);
+               }
+
+               EXPECT_EQ(0, memcmp(dst, expected, num_pixels * dst_size));
+            }
+         }
+      }
+   }
+}
+
+/**
+ * Big images are split in bands converted by several threads.
+ */
+TEST_F(FormatConvertTest, ThreadedConvertMatchesRows)
+{
+   const size_t width = 300, height = 301;
+   const size_t src_stride = width * 4 + 12, dst_stride = width * 16;
+   uint8_t *img_src = (uint8_t *) malloc(src_stride * height);
+   float *img_dst = (float *) malloc(dst_stride * height);
+   float *img_expected = (float *) malloc(dst_stride * height);
+
+   for (size_t i = 0; i < src_stride * height; i++)
+      img_src[i] = i * 7 + (i >> 8);
+
+   _mesa_format_convert(img_dst, RGBA32_FLOAT, dst_stride,
+                        img_src, MESA_FORMAT_B8G8R8A8_UNORM, src_stride,
+                        width, height, NULL);
+
+   for (size_t y = 0; y < height; y++) {
+      _mesa_format_convert((uint8_t *) img_expected + y * dst_stride,
+                           RGBA32_FLOAT, dst_stride,
+                           img_src + y * src_stride,
+                           MESA_FORMAT_B8G8R8A8_UNORM, src_stride,
+                           width, 1, NULL);
+   }
+
+   EXPECT_EQ(0, memcmp(img_dst, img_expected, dst_stride * height));
+
+   free(img_src);
+   free(img_dst);
+   free(img_expected);
+}
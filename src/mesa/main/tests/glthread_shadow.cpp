@@ -0,0 +1,321 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name glthread_shadow.cpp
+ *
+ * Run frames mixing state changes and the queries applications commonly do
+ * through glthread, and count how many times the application thread has to
+ * wait for the worker thread.  Queries answered from the shadow state must
+ * not synchronize, and must return the same values as the context.  Draws
+ * from client memory must not synchronize either, and must see the data as
+ * it was when they were called.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/enums.h"
+#include "main/marshal_generated.h"
+#include "main/glthread.h"
+#include "main/vtxfmt.h"
+#include "glapi/glapi.h"
+#include "util/u_atomic.h"
+#include "drivers/common/driverfuncs.h"
+#include "vbo/vbo.h"
+
+#ifndef GLAPIENTRYP
+#define GLAPIENTRYP GL_APIENTRYP
+#endif
+
+#include "main/dispatch.h"
+
+namespace {
+
+const unsigned num_frames = 100;
+
+void
+set_background_context(struct gl_context *ctx,
+                       struct util_queue_monitoring *queue_info)
+{
+}
+
+/** Vertex positions seen by the last draw, in the worker thread. */
+GLfloat drawn[16][2];
+
+void GLAPIENTRY
+record_draw_elements(GLenum mode, GLsizei count, GLenum type,
+                     const GLvoid *indices)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct gl_array_attributes *array =
+      &ctx->Array.VAO->VertexAttrib[VERT_ATTRIB_POS];
+   const GLfloat *vertices = (const GLfloat *) array->Ptr;
+   const GLushort *elements = (const GLushort *) indices;
+
+   ASSERT_EQ((GLenum) GL_UNSIGNED_SHORT, type);
+   ASSERT_LE(count, 16);
+   for (int i = 0; i < count; i++) {
+      drawn[i][0] = vertices[elements[i] * 2];
+      drawn[i][1] = vertices[elements[i] * 2 + 1];
+   }
+}
+
+class GLThreadShadowTest : public ::testing::Test {
+protected:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void run_frame();
+   unsigned get_syncs();
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+   struct _glapi_table *exec;
+};
+
+void
+GLThreadShadowTest::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+   driver_functions.SetBackgroundContext = set_background_context;
+
+   _mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual, NULL,
+                            &driver_functions);
+   _vbo_CreateContext(&ctx);
+   ctx.Version = 30;
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+
+   _glapi_set_context(&ctx);
+   _glapi_set_dispatch(ctx.CurrentServerDispatch);
+
+   _mesa_glthread_init(&ctx);
+   ASSERT_TRUE(ctx.GLThread != NULL);
+   exec = ctx.MarshalExec;
+}
+
+void
+GLThreadShadowTest::TearDown()
+{
+   _mesa_glthread_destroy(&ctx);
+   _glapi_set_context(NULL);
+}
+
+unsigned
+GLThreadShadowTest::get_syncs()
+{
+   return p_atomic_read(&ctx.GLThread->stats.num_syncs);
+}
+
+/**
+ * A frame of a typical older application: set up the transforms and the
+ * fixed-function state, and query some of it back as middleware does.
+ */
+void
+GLThreadShadowTest::run_frame()
+{
+   GLfloat matrix[16];
+   GLint viewport[4], value;
+   GLboolean enabled;
+
+   CALL_Viewport(exec, (0, 0, 640, 480));
+   CALL_GetIntegerv(exec, (GL_VIEWPORT, viewport));
+
+   CALL_MatrixMode(exec, (GL_PROJECTION));
+   CALL_LoadIdentity(exec, ());
+   CALL_Frustum(exec, (-1.0, 1.0, -0.75, 0.75, 1.0, 100.0));
+   CALL_MatrixMode(exec, (GL_MODELVIEW));
+   CALL_LoadIdentity(exec, ());
+
+   CALL_Enable(exec, (GL_DEPTH_TEST));
+   CALL_Disable(exec, (GL_BLEND));
+
+   for (int i = 0; i < 10; i++) {
+      CALL_PushMatrix(exec, ());
+      CALL_Translatef(exec, (i * 0.5f, 0.0f, -10.0f));
+      CALL_Rotatef(exec, (i * 10.0f, 0.0f, 1.0f, 0.0f));
+      CALL_GetFloatv(exec, (GL_MODELVIEW_MATRIX, matrix));
+
+      CALL_ActiveTexture(exec, (GL_TEXTURE0 + i % 2));
+      CALL_BindTexture(exec, (GL_TEXTURE_2D, i + 1));
+      CALL_GetIntegerv(exec, (GL_TEXTURE_BINDING_2D, &value));
+
+      CALL_BindBuffer(exec, (GL_ARRAY_BUFFER, 0));
+      CALL_GetIntegerv(exec, (GL_ARRAY_BUFFER_BINDING, &value));
+
+      enabled = CALL_IsEnabled(exec, (GL_BLEND));
+      if (enabled)
+         CALL_Disable(exec, (GL_BLEND));
+
+      CALL_GetIntegerv(exec, (GL_CURRENT_PROGRAM, &value));
+      CALL_UseProgram(exec, (0));
+      CALL_PopMatrix(exec, ());
+   }
+
+   CALL_GetIntegerv(exec, (GL_MODELVIEW_STACK_DEPTH, &value));
+   CALL_GetIntegerv(exec, (GL_ACTIVE_TEXTURE, &value));
+   CALL_Flush(exec, ());
+}
+
+} /* anonymous namespace */
+
+TEST_F(GLThreadShadowTest, SyncsPerFrame)
+{
+   unsigned first_frame_syncs, syncs;
+
+   run_frame();
+   first_frame_syncs = get_syncs();
+
+   for (unsigned i = 0; i < num_frames; i++)
+      run_frame();
+   syncs = get_syncs() - first_frame_syncs;
+
+   printf("glthread syncs: %u in the first frame, %.2f per frame after\n",
+          first_frame_syncs, (double) syncs / num_frames);
+
+   /* Only the first query loads the shadow state. */
+   EXPECT_LE(first_frame_syncs, 1u);
+   EXPECT_EQ(0u, syncs);
+}
+
+TEST_F(GLThreadShadowTest, MatchesContext)
+{
+   static const GLenum pnames[] = {
+      GL_ACTIVE_TEXTURE,
+      GL_CLIENT_ACTIVE_TEXTURE,
+      GL_MATRIX_MODE,
+      GL_MODELVIEW_STACK_DEPTH,
+      GL_PROJECTION_STACK_DEPTH,
+      GL_ARRAY_BUFFER_BINDING,
+      GL_ELEMENT_ARRAY_BUFFER_BINDING,
+      GL_CURRENT_PROGRAM,
+      GL_TEXTURE_BINDING_2D,
+      GL_TEXTURE_BINDING_CUBE_MAP,
+      GL_SCISSOR_BOX,
+      GL_VIEWPORT,
+      GL_BLEND,
+      GL_DEPTH_TEST,
+      GL_LIGHTING,
+   };
+   static const GLenum matrices[] = {
+      GL_MODELVIEW_MATRIX,
+      GL_PROJECTION_MATRIX,
+   };
+   const GLuint deleted = 2;
+
+   run_frame();
+   CALL_PushMatrix(exec, ());
+   CALL_Scalef(exec, (2.0f, 3.0f, 4.0f));
+   CALL_ClientActiveTexture(exec, (GL_TEXTURE1));
+   CALL_Scissor(exec, (1, 2, 30, 40));
+   CALL_Enable(exec, (GL_LIGHTING));
+   CALL_ActiveTexture(exec, (GL_TEXTURE1));
+   CALL_BindTexture(exec, (GL_TEXTURE_CUBE_MAP, 42));
+   CALL_DeleteTextures(exec, (1, &deleted));
+
+   for (unsigned i = 0; i < ARRAY_SIZE(pnames); i++) {
+      GLint shadow[4] = { 0 }, real[4] = { 0 };
+      GLdouble shadow_d[4] = { 0 }, real_d[4] = { 0 };
+
+      CALL_GetIntegerv(exec, (pnames[i], shadow));
+      CALL_GetDoublev(exec, (pnames[i], shadow_d));
+
+      _mesa_glthread_finish(&ctx);
+      CALL_GetIntegerv(ctx.CurrentServerDispatch, (pnames[i], real));
+      CALL_GetDoublev(ctx.CurrentServerDispatch, (pnames[i], real_d));
+
+      EXPECT_EQ(0, memcmp(shadow, real, sizeof(real)))
+         << _mesa_enum_to_string(pnames[i]);
+      EXPECT_EQ(0, memcmp(shadow_d, real_d, sizeof(real_d)))
+         << _mesa_enum_to_string(pnames[i]);
+   }
+
+   for (unsigned i = 0; i < ARRAY_SIZE(matrices); i++) {
+      GLfloat shadow[16], real[16];
+
+      CALL_GetFloatv(exec, (matrices[i], shadow));
+      _mesa_glthread_finish(&ctx);
+      CALL_GetFloatv(ctx.CurrentServerDispatch, (matrices[i], real));
+
+      EXPECT_EQ(0, memcmp(shadow, real, sizeof(real)))
+         << _mesa_enum_to_string(matrices[i]);
+   }
+
+   EXPECT_EQ(GL_TRUE, CALL_IsEnabled(exec, (GL_LIGHTING)));
+   EXPECT_EQ(GL_FALSE, CALL_IsEnabled(exec, (GL_BLEND)));
+}
+
+TEST_F(GLThreadShadowTest, UserArrayDraws)
+{
+   static const GLushort elements[6] = { 10, 11, 12, 12, 11, 13 };
+   GLfloat vertices[100][2];
+   GLushort indices[6];
+   unsigned syncs;
+
+   SET_DrawElements(ctx.CurrentServerDispatch, record_draw_elements);
+
+   CALL_BindBuffer(exec, (GL_ARRAY_BUFFER, 0));
+   CALL_BindBuffer(exec, (GL_ELEMENT_ARRAY_BUFFER, 0));
+   CALL_VertexPointer(exec, (2, GL_FLOAT, 0, vertices));
+   CALL_EnableClientState(exec, (GL_VERTEX_ARRAY));
+
+   /* The first draw loads the shadow state. */
+   CALL_DrawElements(exec, (GL_TRIANGLES, 0, GL_UNSIGNED_SHORT, indices));
+   _mesa_glthread_finish(&ctx);
+   syncs = get_syncs();
+
+   for (unsigned frame = 0; frame < num_frames; frame++) {
+      for (int i = 0; i < 100; i++) {
+         vertices[i][0] = i + frame;
+         vertices[i][1] = -i;
+      }
+      memcpy(indices, elements, sizeof(indices));
+
+      CALL_DrawElements(exec, (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices));
+
+      /* The draw must have copied what it reads. */
+      memset(vertices, 0, sizeof(vertices));
+      memset(indices, 0, sizeof(indices));
+      _mesa_glthread_finish(&ctx);
+
+      for (int i = 0; i < 6; i++) {
+         EXPECT_EQ(elements[i] + frame, drawn[i][0]);
+         EXPECT_EQ(-elements[i], drawn[i][1]);
+      }
+   }
+
+   /* Only the _mesa_glthread_finish() calls of the test synchronize. */
+   EXPECT_EQ(syncs + num_frames, get_syncs());
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name mipmap.cpp
+ *
+ * Verify that the SIMD and multithreaded paths of the software mipmap
+ * generation give the same results as the C code, byte for byte.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main/mipmap.h"
+
+namespace {
+
+struct mipmap_format {
+   const char *name;
+   GLenum datatype;
+   GLuint comps;
+   GLint bpp;
+};
+
+const struct mipmap_format formats[] = {
+   { "RGBA8",   GL_UNSIGNED_BYTE,          4,  4 },
+   { "RGBA32F", GL_FLOAT,                  4, 16 },
+   { "Z16",     GL_UNSIGNED_SHORT,         1,  2 },
+   { "Z32",     GL_UNSIGNED_INT,           1,  4 },
+   { "Z24S8",   GL_UNSIGNED_INT_24_8_MESA, 2,  4 },
+};
+
+/* odd and non-power-of-two sizes, some of them with several bands */
+const struct {
+   GLint width, height;
+} sizes[] = {
+   { 257, 131 },
+   { 300, 260 },
+   { 33, 517 },
+   { 1023, 7 },
+};
+
+/* extra bytes at the end of every row */
+const GLint row_padding = 12;
+
+class MipmapTest : public ::testing::Test {
+protected:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   unsigned setup_levels(const struct mipmap_format *format,
+                         GLint width, GLint height);
+   void generate(const struct mipmap_format *format, unsigned num_levels,
+                 bool simd, bool threads, GLubyte *out);
+
+   struct mipmap_level_map levels[32];
+   size_t level_offsets[32];
+   size_t total_size;
+   GLubyte *base;
+};
+
+void
+MipmapTest::SetUp()
+{
+   /* Use several threads even on machines with a single CPU.  This is
+    * read the first time mipmaps are generated.
+    */
+   setenv("MESA_MIPMAP_THREADS", "4", 0);
+}
+
+void
+MipmapTest::TearDown()
+{
+   _mesa_select_mipmap_paths(true, true);
+}
+
+unsigned
+MipmapTest::setup_levels(const struct mipmap_format *format,
+                         GLint width, GLint height)
+{
+   GLint depth = 1;
+   unsigned n = 0;
+
+   total_size = 0;
+   for (;;) {
+      levels[n].width = width;
+      levels[n].height = height;
+      levels[n].rowStride = width * format->bpp + row_padding;
+      level_offsets[n] = total_size;
+      total_size += (size_t) levels[n].rowStride * height;
+      n++;
+
+      if (!_mesa_next_mipmap_level_size(GL_TEXTURE_2D, 0,
+                                        width, height, depth,
+                                        &width, &height, &depth))
+         break;
+   }
+
+   return n;
+}
+
+/**
+ * Fill the base level of \p out from \p base and generate the other levels
+ * with the given code paths.  The padding is left as is, so that writes
+ * past the end of the rows show up as differences.
+ */
+void
+MipmapTest::generate(const struct mipmap_format *format, unsigned num_levels,
+                     bool simd, bool threads, GLubyte *out)
+{
+   memset(out, 0xcd, total_size);
+   memcpy(out, base, level_offsets[1]);
+
+   for (unsigned i = 0; i < num_levels; i++)
+      levels[i].map = out + level_offsets[i];
+
+   _mesa_select_mipmap_paths(simd, threads);
+   _mesa_generate_mipmap_chain_2d(format->datatype, format->comps,
+                                  num_levels, levels);
+}
+
+} /* anonymous namespace */
+
+TEST_F(MipmapTest, SimdAndThreadsMatchScalar)
+{
+   for (unsigned f = 0; f < ARRAY_SIZE(formats); f++) {
+      for (unsigned s = 0; s < ARRAY_SIZE(sizes); s++) {
+         const struct mipmap_format *format = &formats[f];
+         const unsigned num_levels =
+            setup_levels(format, sizes[s].width, sizes[s].height);
+         uint32_t seed = 1;
+
+         SCOPED_TRACE(testing::Message() << format->name << " "
+                      << sizes[s].width << "x" << sizes[s].height);
+
+         base = (GLubyte *) malloc(level_offsets[1]);
+         GLubyte *expected = (GLubyte *) malloc(total_size);
+         GLubyte *simd = (GLubyte *) malloc(total_size);
+         GLubyte *threaded = (GLubyte *) malloc(total_size);
+
+         /* Keep the floats within [-1, 1], without NaNs */
+         if (format->datatype == GL_FLOAT) {
+            GLfloat *f = (GLfloat *) base;
+            for (size_t i = 0; i < level_offsets[1] / 4; i++) {
+               seed = seed * 1103515245 + 12345;
+               f[i] = (int16_t) (seed >> 16) / 32767.0f;
+            }
+         } else {
+            for (size_t i = 0; i < level_offsets[1]; i++) {
+               seed = seed * 1103515245 + 12345;
+               base[i] = seed >> 16;
+            }
+         }
+
+         generate(format, num_levels, false, false, expected);
+         generate(format, num_levels, true, false, simd);
+         generate(format, num_levels, true, true, threaded);
+
+         for (unsigned l = 1; l < num_levels; l++) {
+            const size_t offset = level_offsets[l];
+            const size_t size = (size_t) levels[l].rowStride *
+                                levels[l].height;
+
+            EXPECT_EQ(0, memcmp(simd + offset, expected + offset, size))
+               << "SIMD, level " << l;
+            EXPECT_EQ(0, memcmp(threaded + offset, expected + offset, size))
+               << "threads, level " << l;
+         }
+
+         free(base);
+         free(expected);
+         free(simd);
+         free(threaded);
+      }
+   }
+}
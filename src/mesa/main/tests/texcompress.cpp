@@ -0,0 +1,176 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name texcompress.cpp
+ *
+ * Verify that compressing BPTC and RGTC images on several threads gives
+ * the same blocks as compressing them on a single thread.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main/mtypes.h"
+#include "main/formats.h"
+#include "main/texcompress.h"
+#include "main/texcompress_bptc.h"
+#include "main/texcompress_rgtc.h"
+
+namespace {
+
+typedef GLboolean (*store_func)(TEXSTORE_PARAMS);
+
+struct compressor {
+   const char *name;
+   store_func store;
+   mesa_format format;
+   GLenum base_format;
+   GLenum src_format;
+   GLuint src_comps;
+   bool float_src;
+};
+
+const struct compressor compressors[] = {
+   { "BPTC_RGBA_UNORM", _mesa_texstore_bptc_rgba_unorm,
+     MESA_FORMAT_BPTC_RGBA_UNORM, GL_RGBA, GL_RGBA, 4, false },
+   { "BPTC_RGB_SIGNED_FLOAT", _mesa_texstore_bptc_rgb_signed_float,
+     MESA_FORMAT_BPTC_RGB_SIGNED_FLOAT, GL_RGB, GL_RGB, 3, true },
+   { "BPTC_RGB_UNSIGNED_FLOAT", _mesa_texstore_bptc_rgb_unsigned_float,
+     MESA_FORMAT_BPTC_RGB_UNSIGNED_FLOAT, GL_RGB, GL_RGB, 3, true },
+   { "RGTC1_UNORM", _mesa_texstore_red_rgtc1,
+     MESA_FORMAT_R_RGTC1_UNORM, GL_RED, GL_RED, 1, false },
+   { "RGTC1_SNORM", _mesa_texstore_signed_red_rgtc1,
+     MESA_FORMAT_R_RGTC1_SNORM, GL_RED, GL_RED, 1, true },
+   { "RGTC2_UNORM", _mesa_texstore_rg_rgtc2,
+     MESA_FORMAT_RG_RGTC2_UNORM, GL_RG, GL_RG, 2, false },
+   { "RGTC2_SNORM", _mesa_texstore_signed_rg_rgtc2,
+     MESA_FORMAT_RG_RGTC2_SNORM, GL_RG, GL_RG, 2, true },
+};
+
+/* Big enough to be split in bands, with partial blocks at the edges */
+const GLint width = 301, height = 203;
+
+class TexCompressTest : public ::testing::Test {
+protected:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void compress(const struct compressor *comp, const void *src,
+                 GLint dst_stride, GLubyte *dst);
+
+   struct gl_context *ctx;
+};
+
+void
+TexCompressTest::SetUp()
+{
+   /* Use several threads even on machines with a single CPU.  This is
+    * read the first time an image is compressed.
+    */
+   setenv("MESA_TEXCOMPRESS_THREADS", "4", 0);
+
+   ctx = (struct gl_context *) calloc(1, sizeof(*ctx));
+}
+
+void
+TexCompressTest::TearDown()
+{
+   _mesa_limit_compress_threads(~0u);
+   free(ctx);
+}
+
+void
+TexCompressTest::compress(const struct compressor *comp, const void *src,
+                          GLint dst_stride, GLubyte *dst)
+{
+   struct gl_pixelstore_attrib packing;
+
+   memset(&packing, 0, sizeof(packing));
+   packing.Alignment = 1;
+
+   EXPECT_TRUE(comp->store(ctx, 2, comp->base_format, comp->format,
+                           dst_stride, &dst, width, height, 1,
+                           comp->src_format,
+                           comp->float_src ? GL_FLOAT : GL_UNSIGNED_BYTE,
+                           src, &packing));
+}
+
+} /* anonymous namespace */
+
+TEST_F(TexCompressTest, ThreadedMatchesSingleThread)
+{
+   for (unsigned c = 0; c < ARRAY_SIZE(compressors); c++) {
+      const struct compressor *comp = &compressors[c];
+      const GLint dst_stride = (width + 3) / 4 *
+                               _mesa_get_format_bytes(comp->format);
+      const size_t dst_size = (size_t) dst_stride * ((height + 3) / 4);
+      const size_t num_values = (size_t) width * height * comp->src_comps;
+      void *src;
+      uint32_t seed = 1;
+
+      SCOPED_TRACE(comp->name);
+
+      /* Smooth gradients with some noise, so that the compressors pick
+       * different modes in different blocks.
+       */
+      if (comp->float_src) {
+         GLfloat *f = (GLfloat *) malloc(num_values * sizeof(GLfloat));
+         for (size_t i = 0; i < num_values; i++) {
+            seed = seed * 1103515245 + 12345;
+            f[i] = (GLfloat) (i % (width * comp->src_comps)) / width -
+                   0.5f + ((seed >> 16) & 0xff) / 1024.0f;
+         }
+         src = f;
+      } else {
+         GLubyte *b = (GLubyte *) malloc(num_values);
+         for (size_t i = 0; i < num_values; i++) {
+            seed = seed * 1103515245 + 12345;
+            b[i] = i / (width * comp->src_comps) + ((seed >> 16) & 0x1f);
+         }
+         src = b;
+      }
+
+      GLubyte *expected = (GLubyte *) malloc(dst_size);
+      GLubyte *dst = (GLubyte *) malloc(dst_size);
+
+      /* The RGTC encoder doesn't write the second endpoint of blocks of a
+       * single value, so start from the same contents.
+       */
+      memset(expected, 0, dst_size);
+      memset(dst, 0, dst_size);
+
+      _mesa_limit_compress_threads(1);
+      compress(comp, src, dst_stride, expected);
+
+      _mesa_limit_compress_threads(~0u);
+      compress(comp, src, dst_stride, dst);
+
+      EXPECT_EQ(0, memcmp(dst, expected, dst_size));
+
+      free(src);
+      free(expected);
+      free(dst);
+   }
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file texcompress_bench.c
+ *
+ * Measures the speed of the software texture compressors used when
+ * uploading uncompressed data to a compressed internal format.
+ *
+ * Usage: texcompress-bench [WIDTHxHEIGHT:file.rgba]...
+ *
+ * Without arguments, a corpus of generated images is used.  Otherwise the
+ * files hold raw RGBA8 images.  The speed is reported in MB/s of
+ * uncompressed RGBA8 data.  MESA_TEXCOMPRESS_THREADS sets the number of
+ * threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "main/mtypes.h"
+#include "main/formats.h"
+#include "main/glformats.h"
+#include "main/texstore.h"
+#include "main/texcompress_bptc.h"
+#include "main/texcompress_rgtc.h"
+#include "main/texcompress_s3tc.h"
+
+struct image {
+   const char *name;
+   int width, height;
+   GLubyte *rgba;
+   GLfloat *rgb_float;
+};
+
+typedef GLboolean (*store_func)(TEXSTORE_PARAMS);
+
+struct compressor {
+   const char *name;
+   store_func store;
+   mesa_format format;
+   GLenum base_format;
+   GLenum src_format;
+   bool float_src;
+   bool needs_dxtn;
+};
+
+static const struct compressor compressors[] = {
+   { "BPTC_RGBA_UNORM", _mesa_texstore_bptc_rgba_unorm,
+     MESA_FORMAT_BPTC_RGBA_UNORM, GL_RGBA, GL_RGBA, false, false },
+   { "BPTC_RGB_UNSIGNED_FLOAT", _mesa_texstore_bptc_rgb_unsigned_float,
+     MESA_FORMAT_BPTC_RGB_UNSIGNED_FLOAT, GL_RGB, GL_RGB, true, false },
+   { "RGTC1_UNORM", _mesa_texstore_red_rgtc1,
+     MESA_FORMAT_R_RGTC1_UNORM, GL_RED, GL_RED, false, false },
+   { "RGTC2_UNORM", _mesa_texstore_rg_rgtc2,
+     MESA_FORMAT_RG_RGTC2_UNORM, GL_RG, GL_RG, false, false },
+   { "RGTC2_SNORM", _mesa_texstore_signed_rg_rgtc2,
+     MESA_FORMAT_RG_RGTC2_SNORM, GL_RG, GL_RG, true, false },
+   { "DXT1_RGB", _mesa_texstore_rgb_dxt1,
+     MESA_FORMAT_RGB_DXT1, GL_RGB, GL_RGB, false, true },
+   { "DXT5_RGBA", _mesa_texstore_rgba_dxt5,
+     MESA_FORMAT_RGBA_DXT5, GL_RGBA, GL_RGBA, false, true },
+};
+
+static double
+get_time(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+make_float_data(struct image *image)
+{
+   int i;
+
+   image->rgb_float = malloc(image->width * image->height * 4 * sizeof(GLfloat));
+   for (i = 0; i < image->width * image->height * 4; i++)
+      image->rgb_float[i] = image->rgba[i] / 255.0f * 4.0f;
+}
+
+/** Generates a kind of image found in games: noise, gradients, etc. */
+static void
+generate_image(struct image *image, int kind, int size)
+{
+   static const char *names[] = { "noise", "gradient", "smooth", "tiles" };
+   unsigned seed = 1;
+   int x, y;
+
+   image->name = names[kind];
+   image->width = image->height = size;
+   image->rgba = malloc(size * size * 4);
+
+   for (y = 0; y < size; y++) {
+      for (x = 0; x < size; x++) {
+         GLubyte *p = image->rgba + (y * size + x) * 4;
+         int c;
+
+         for (c = 0; c < 4; c++) {
+            seed = seed * 1103515245 + 12345;
+            switch (kind) {
+            case 0:
+               p[c] = seed >> 16;
+               break;
+            case 1:
+               p[c] = (x * (c + 1) + y * (4 - c)) * 255 / (size * 5);
+               break;
+            case 2:
+               p[c] = 127.5 + 127.5 * sin(x * 0.01 * (c + 1)) *
+                      cos(y * 0.013 * (4 - c)) + ((seed >> 16) & 7);
+               break;
+            default:
+               p[c] = ((x / 24 + y / 24) & 1) ? 220 - c * 30 : 20 + c * 40;
+               break;
+            }
+         }
+      }
+   }
+
+   make_float_data(image);
+}
+
+static bool
+load_image(struct image *image, const char *arg)
+{
+   const char *path = strchr(arg, ':');
+   size_t size;
+   FILE *f;
+
+   if (!path || sscanf(arg, "%dx%d", &image->width, &image->height) != 2)
+      return false;
+
+   image->name = ++path;
+   size = (size_t) image->width * image->height * 4;
+   image->rgba = malloc(size);
+
+   f = fopen(path, "rb");
+   if (!f)
+      return false;
+   if (fread(image->rgba, 1, size, f) != size) {
+      fclose(f);
+      return false;
+   }
+   fclose(f);
+
+   make_float_data(image);
+   return true;
+}
+
+/**
+ * Returns the speed of a compressor on an image, in MB/s.
+ */
+static double
+run(struct gl_context *ctx, const struct compressor *comp,
+    const struct image *image)
+{
+   const struct gl_pixelstore_attrib packing = { .Alignment = 1 };
+   const int components = _mesa_components_in_format(comp->src_format);
+   const int dst_stride = (image->width + 3) / 4 *
+                          _mesa_get_format_bytes(comp->format);
+   GLubyte *dst = malloc(dst_stride * ((image->height + 3) / 4));
+   void *src;
+   double start, elapsed;
+   int i, iterations = 0;
+
+   /* Repack the source with the number of components of the format */
+   if (comp->float_src) {
+      GLfloat *f = malloc(image->width * image->height * components * 4);
+      for (i = 0; i < image->width * image->height * components; i++)
+         f[i] = image->rgb_float[i / components * 4 + i % components];
+      src = f;
+   } else {
+      GLubyte *b = malloc(image->width * image->height * components);
+      for (i = 0; i < image->width * image->height * components; i++)
+         b[i] = image->rgba[i / components * 4 + i % components];
+      src = b;
+   }
+
+   start = get_time();
+   do {
+      comp->store(ctx, 2, comp->base_format, comp->format,
+                  dst_stride, &dst, image->width, image->height, 1,
+                  comp->src_format,
+                  comp->float_src ? GL_FLOAT : GL_UNSIGNED_BYTE,
+                  src, &packing);
+      iterations++;
+      elapsed = get_time() - start;
+   } while (elapsed < 0.5);
+
+   free(src);
+   free(dst);
+
+   return iterations * (double) image->width * image->height * 4 /
+          (elapsed * 1024 * 1024);
+}
+
+int
+main(int argc, char **argv)
+{
+   struct gl_context *ctx = calloc(1, sizeof(*ctx));
+   struct image *images;
+   int num_images, i, c;
+
+   if (argc > 1) {
+      num_images = argc - 1;
+      images = calloc(num_images, sizeof(*images));
+      for (i = 0; i < num_images; i++) {
+         if (!load_image(&images[i], argv[i + 1])) {
+            fprintf(stderr, "couldn't load %s, expected WIDTHxHEIGHT:file\n",
+                    argv[i + 1]);
+            return 1;
+         }
+      }
+   } else {
+      num_images = 4;
+      images = calloc(num_images, sizeof(*images));
+      for (i = 0; i < num_images; i++)
+         generate_image(&images[i], i, 1024);
+   }
+
+   _mesa_init_texture_s3tc(ctx);
+
+   for (c = 0; c < ARRAY_SIZE(compressors); c++) {
+      const struct compressor *comp = &compressors[c];
+      double total = 0.0;
+
+      if (comp->needs_dxtn && !ctx->Mesa_DXTn) {
+         printf("%-24s skipped, no DXTn library\n", comp->name);
+         continue;
+      }
+
+      for (i = 0; i < num_images; i++) {
+         const double speed = run(ctx, comp, &images[i]);
+         printf("%-24s %-12s %4dx%-4d %8.1f MB/s\n", comp->name,
+                images[i].name, images[i].width, images[i].height, speed);
+         total += speed;
+      }
+      printf("%-24s %-12s %9s %8.1f MB/s\n", comp->name, "average", "",
+             total / num_images);
+   }
+
+   for (i = 0; i < num_images; i++) {
+      free(images[i].rgba);
+      free(images[i].rgb_float);
+   }
+   free(images);
+   free(ctx);
+
+   return 0;
+}
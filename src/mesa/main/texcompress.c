@@ -42,6 +42,11 @@
 #include "texcompress_s3tc.h"
 #include "texcompress_etc.h"
 #include "texcompress_bptc.h"
+#include "util/u_queue.h"
+
+#if defined(HAVE_PTHREAD)
+#include <unistd.h>
+#endif
 
 
 /**
@@ -944,3 +949,120 @@ _mesa_decompress_image(mesa_format format, GLuint width, GLuint height,
       }
    }
 }
+
+
+/* Images with at least this many pixels are compressed by several threads,
+ * each one compressing a band of block rows.
+ */
+#define COMPRESS_THREAD_MIN_PIXELS (128 * 128)
+#define COMPRESS_MAX_THREADS 8
+
+struct compress_rows_job {
+   struct util_queue_fence fence;
+   compress_rows_func func;
+   void *data;
+   GLint y, height;
+};
+
+static struct util_queue compress_queue;
+static unsigned compress_num_threads = 1;
+static unsigned compress_max_jobs = COMPRESS_MAX_THREADS;
+static once_flag compress_queue_once = ONCE_FLAG_INIT;
+
+static void
+init_compress_queue(void)
+{
+   unsigned num_threads = 1;
+   const char *str;
+
+#if defined(HAVE_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+   long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   if (num_cpus > 0)
+      num_threads = MIN2(num_cpus, COMPRESS_MAX_THREADS);
+#endif
+
+   /* MESA_TEXCOMPRESS_THREADS=1 disables the threading */
+   str = getenv("MESA_TEXCOMPRESS_THREADS");
+   if (str)
+      num_threads = CLAMP(atoi(str), 1, COMPRESS_MAX_THREADS);
+
+   /* The calling thread compresses a band too. */
+   if (num_threads > 1 &&
+       util_queue_init(&compress_queue, "mesacmp", COMPRESS_MAX_THREADS,
+                       num_threads - 1, 0))
+      compress_num_threads = num_threads;
+}
+
+static void
+compress_rows_job_execute(void *data, int thread_index)
+{
+   struct compress_rows_job *job = data;
+
+   job->func(job->data, job->y, job->height);
+}
+
+
+/**
+ * Compress an image with func(data, y, height), which compresses the rows
+ * [y, y + height) of the image.  Large images are split in bands of whole
+ * block rows compressed by several threads, so func must only write the
+ * blocks of its rows.
+ * \param blockHeight  height of the blocks of the compressed format
+ */
+void
+_mesa_compress_image_rows(GLint width, GLint height, GLint blockHeight,
+                          compress_rows_func func, void *data)
+{
+   struct compress_rows_job jobs[COMPRESS_MAX_THREADS];
+   GLint rowsPerJob, y;
+   unsigned numJobs, i;
+
+   if (width * height >= COMPRESS_THREAD_MIN_PIXELS) {
+      call_once(&compress_queue_once, init_compress_queue);
+      numJobs = MIN3(compress_num_threads, compress_max_jobs,
+                     DIV_ROUND_UP(height, blockHeight));
+   } else {
+      numJobs = 1;
+   }
+
+   if (numJobs <= 1) {
+      func(data, 0, height);
+      return;
+   }
+
+   rowsPerJob = DIV_ROUND_UP(DIV_ROUND_UP(height, blockHeight), numJobs) *
+                blockHeight;
+   for (i = 0, y = 0; y < height; i++, y += rowsPerJob) {
+      struct compress_rows_job *job = &jobs[i];
+
+      job->func = func;
+      job->data = data;
+      job->y = y;
+      job->height = MIN2(rowsPerJob, height - y);
+
+      if (i > 0) {
+         util_queue_fence_init(&job->fence);
+         util_queue_add_job(&compress_queue, job, &job->fence,
+                            compress_rows_job_execute, NULL);
+      }
+   }
+   numJobs = i;
+
+   compress_rows_job_execute(&jobs[0], 0);
+
+   for (i = 1; i < numJobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
+
+/**
+ * Limit the number of threads compressing an image, for the unit tests.
+ * Limiting it to 1 is the same as setting MESA_TEXCOMPRESS_THREADS=1.
+ */
+void
+_mesa_limit_compress_threads(unsigned num_threads)
+{
+   compress_max_jobs = CLAMP(num_threads, 1, COMPRESS_MAX_THREADS);
+}
@@ -28,6 +28,10 @@
 #include "formats.h"
 #include "glheader.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct gl_context;
 
 extern GLenum
@@ -63,4 +67,22 @@ _mesa_decompress_image(mesa_format format, GLuint width, GLuint height,
                        const GLubyte *src, GLint srcRowStride,
                        GLfloat *dest);
 
+
+/**
+ * A function compressing the rows [y, y + height) of an image, y being a
+ * multiple of the block height.
+ */
+typedef void (*compress_rows_func)(void *data, GLint y, GLint height);
+
+extern void
+_mesa_compress_image_rows(GLint width, GLint height, GLint blockHeight,
+                          compress_rows_func func, void *data);
+
+extern void
+_mesa_limit_compress_threads(unsigned num_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* TEXCOMPRESS_H */
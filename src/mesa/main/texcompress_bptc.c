@@ -35,6 +35,10 @@
 #include "macros.h"
 #include "image.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define BLOCK_SIZE 4
 #define N_PARTITIONS 64
 #define BLOCK_BYTES 16
@@ -1006,23 +1010,21 @@ get_average_luminance_alpha_unorm(int width, int height,
 }
 
 static void
-get_rgba_endpoints_unorm(int width, int height,
-                         const uint8_t *src, int src_rowstride,
-                         int average_luminance, int average_alpha,
-                         uint8_t endpoints[][4])
+get_rgba_endpoint_sums_unorm(int width, int height,
+                             const uint8_t *src, int src_rowstride,
+                             int average_luminance, int average_alpha,
+                             int sums[][4],
+                             int *rgb_left_endpoint_count_out,
+                             int *alpha_left_endpoint_count_out)
 {
-   int endpoint_luminances[2];
-   int midpoint;
-   int sums[2][4];
    int endpoint;
    int luminance;
-   uint8_t temp[3];
    const uint8_t *p = src;
    int rgb_left_endpoint_count = 0;
    int alpha_left_endpoint_count = 0;
    int y, x, i;
 
-   memset(sums, 0, sizeof sums);
+   memset(sums, 0, 2 * sizeof sums[0]);
 
    for (y = 0; y < height; y++) {
       for (x = 0; x < width; x++) {
@@ -1050,6 +1052,100 @@ get_rgba_endpoints_unorm(int width, int height,
       p += src_rowstride - width * 4;
    }
 
+   *rgb_left_endpoint_count_out = rgb_left_endpoint_count;
+   *alpha_left_endpoint_count_out = alpha_left_endpoint_count;
+}
+
+#if defined(__SSE2__)
+
+static inline int
+sum_epi32(__m128i v)
+{
+   v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+   v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+   return _mm_cvtsi128_si32(v);
+}
+
+/**
+ * Same as get_average_luminance_alpha_unorm() followed by
+ * get_rgba_endpoint_sums_unorm() on a whole block, with a row of the block
+ * in each vector.
+ */
+static void
+get_rgba_endpoint_sums_unorm_sse2(const uint8_t *src, int src_rowstride,
+                                  int sums[][4],
+                                  int *rgb_left_endpoint_count,
+                                  int *alpha_left_endpoint_count)
+{
+   const __m128i byte_mask = _mm_set1_epi32(0xff);
+   __m128i c[BLOCK_SIZE][4], luminance[BLOCK_SIZE];
+   __m128i luminance_sum = _mm_setzero_si128();
+   __m128i alpha_sum = _mm_setzero_si128();
+   __m128i average_luminance, average_alpha;
+   __m128i left_sums[4], right_sums[4];
+   __m128i rgb_left = _mm_setzero_si128(), alpha_left = _mm_setzero_si128();
+   int y, i;
+
+   for (y = 0; y < BLOCK_SIZE; y++) {
+      const __m128i row =
+         _mm_loadu_si128((const __m128i *) (src + y * src_rowstride));
+
+      for (i = 0; i < 4; i++)
+         c[y][i] = _mm_and_si128(_mm_srli_epi32(row, 8 * i), byte_mask);
+
+      luminance[y] = _mm_add_epi32(_mm_add_epi32(c[y][0], c[y][1]), c[y][2]);
+      luminance_sum = _mm_add_epi32(luminance_sum, luminance[y]);
+      alpha_sum = _mm_add_epi32(alpha_sum, c[y][3]);
+   }
+
+   /* the sums are positive, so the divisions by 16 are shifts */
+   average_luminance = _mm_set1_epi32(sum_epi32(luminance_sum) >> 4);
+   average_alpha = _mm_set1_epi32(sum_epi32(alpha_sum) >> 4);
+
+   for (i = 0; i < 4; i++)
+      left_sums[i] = right_sums[i] = _mm_setzero_si128();
+
+   for (y = 0; y < BLOCK_SIZE; y++) {
+      const __m128i rgb_mask = _mm_cmplt_epi32(luminance[y], average_luminance);
+      /* like the C version, this compares the blue component */
+      const __m128i alpha_mask = _mm_cmplt_epi32(c[y][2], average_alpha);
+
+      for (i = 0; i < 4; i++) {
+         const __m128i mask = i < 3 ? rgb_mask : alpha_mask;
+         left_sums[i] = _mm_add_epi32(left_sums[i],
+                                      _mm_and_si128(mask, c[y][i]));
+         right_sums[i] = _mm_add_epi32(right_sums[i],
+                                       _mm_andnot_si128(mask, c[y][i]));
+      }
+
+      rgb_left = _mm_sub_epi32(rgb_left, rgb_mask);
+      alpha_left = _mm_sub_epi32(alpha_left, alpha_mask);
+   }
+
+   for (i = 0; i < 4; i++) {
+      sums[0][i] = sum_epi32(left_sums[i]);
+      sums[1][i] = sum_epi32(right_sums[i]);
+   }
+   *rgb_left_endpoint_count = sum_epi32(rgb_left);
+   *alpha_left_endpoint_count = sum_epi32(alpha_left);
+}
+
+#endif /* __SSE2__ */
+
+static void
+get_rgba_endpoints_unorm(int width, int height,
+                         const uint8_t *src,
+                         int sums[][4],
+                         int rgb_left_endpoint_count,
+                         int alpha_left_endpoint_count,
+                         uint8_t endpoints[][4])
+{
+   int endpoint_luminances[2];
+   int midpoint;
+   int endpoint;
+   uint8_t temp[3];
+   int i;
+
    if (rgb_left_endpoint_count == 0 ||
        rgb_left_endpoint_count == width * height) {
       for (i = 0; i < 3; i++)
@@ -1209,14 +1305,33 @@ compress_rgba_unorm_block(int src_width, int src_height,
                           uint8_t *dst)
 {
    int average_luminance, average_alpha;
+   int sums[2][4];
+   int rgb_left_endpoint_count, alpha_left_endpoint_count;
    uint8_t endpoints[2][4];
    struct bit_writer writer;
    int component, endpoint;
 
-   get_average_luminance_alpha_unorm(src_width, src_height, src, src_rowstride,
-                                     &average_luminance, &average_alpha);
-   get_rgba_endpoints_unorm(src_width, src_height, src, src_rowstride,
-                            average_luminance, average_alpha,
+#if defined(__SSE2__)
+   if (src_width == BLOCK_SIZE && src_height == BLOCK_SIZE) {
+      get_rgba_endpoint_sums_unorm_sse2(src, src_rowstride, sums,
+                                        &rgb_left_endpoint_count,
+                                        &alpha_left_endpoint_count);
+   } else
+#endif
+   {
+      get_average_luminance_alpha_unorm(src_width, src_height,
+                                        src, src_rowstride,
+                                        &average_luminance, &average_alpha);
+      get_rgba_endpoint_sums_unorm(src_width, src_height, src, src_rowstride,
+                                   average_luminance, average_alpha,
+                                   sums,
+                                   &rgb_left_endpoint_count,
+                                   &alpha_left_endpoint_count);
+   }
+   get_rgba_endpoints_unorm(src_width, src_height, src,
+                            sums,
+                            rgb_left_endpoint_count,
+                            alpha_left_endpoint_count,
                             endpoints);
 
    writer.dst = dst;
@@ -1246,32 +1361,66 @@ compress_rgba_unorm_block(int src_width, int src_height,
                              endpoints);
 }
 
+/** The parameters of an image compression, split in bands of rows */
+struct compress_image_data {
+   int width;
+   const void *src;
+   int src_rowstride;
+   uint8_t *dst;
+   int dst_block_rowstride; /* stride between rows of blocks */
+   bool is_signed;
+};
+
+static int
+get_dst_block_rowstride(int width, int dst_rowstride)
+{
+   /* a stride smaller than a row means rows of blocks are packed */
+   if (dst_rowstride >= width * 4)
+      return dst_rowstride;
+   else
+      return ((width + 3) & ~3) * 4;
+}
+
 static void
-compress_rgba_unorm(int width, int height,
-                    const uint8_t *src, int src_rowstride,
-                    uint8_t *dst, int dst_rowstride)
+compress_rgba_unorm_rows(void *data, GLint y0, GLint height)
 {
-   int dst_row_diff;
+   const struct compress_image_data *image = data;
+   const uint8_t *src = image->src;
    int y, x;
 
-   if (dst_rowstride >= width * 4)
-      dst_row_diff = dst_rowstride - ((width + 3) & ~3) * 4;
-   else
-      dst_row_diff = 0;
-
-   for (y = 0; y < height; y += BLOCK_SIZE) {
-      for (x = 0; x < width; x += BLOCK_SIZE) {
-         compress_rgba_unorm_block(MIN2(width - x, BLOCK_SIZE),
-                                   MIN2(height - y, BLOCK_SIZE),
-                                   src + x * 4 + y * src_rowstride,
-                                   src_rowstride,
+   for (y = y0; y < y0 + height; y += BLOCK_SIZE) {
+      uint8_t *dst = image->dst +
+                     y / BLOCK_SIZE * image->dst_block_rowstride;
+
+      for (x = 0; x < image->width; x += BLOCK_SIZE) {
+         compress_rgba_unorm_block(MIN2(image->width - x, BLOCK_SIZE),
+                                   MIN2(y0 + height - y, BLOCK_SIZE),
+                                   src + x * 4 + y * image->src_rowstride,
+                                   image->src_rowstride,
                                    dst);
          dst += BLOCK_BYTES;
       }
-      dst += dst_row_diff;
    }
 }
 
+static void
+compress_rgba_unorm(int width, int height,
+                    const uint8_t *src, int src_rowstride,
+                    uint8_t *dst, int dst_rowstride)
+{
+   struct compress_image_data image;
+
+   image.width = width;
+   image.src = src;
+   image.src_rowstride = src_rowstride;
+   image.dst = dst;
+   image.dst_block_rowstride = get_dst_block_rowstride(width, dst_rowstride);
+   image.is_signed = false;
+
+   _mesa_compress_image_rows(width, height, BLOCK_SIZE,
+                             compress_rgba_unorm_rows, &image);
+}
+
 GLboolean
 _mesa_texstore_bptc_rgba_unorm(TEXSTORE_PARAMS)
 {
@@ -1555,34 +1704,48 @@ compress_rgb_float_block(int src_width, int src_height,
 }
 
 static void
-compress_rgb_float(int width, int height,
-                   const float *src, int src_rowstride,
-                   uint8_t *dst, int dst_rowstride,
-                   bool is_signed)
+compress_rgb_float_rows(void *data, GLint y0, GLint height)
 {
-   int dst_row_diff;
+   const struct compress_image_data *image = data;
+   const float *src = image->src;
    int y, x;
 
-   if (dst_rowstride >= width * 4)
-      dst_row_diff = dst_rowstride - ((width + 3) & ~3) * 4;
-   else
-      dst_row_diff = 0;
+   for (y = y0; y < y0 + height; y += BLOCK_SIZE) {
+      uint8_t *dst = image->dst +
+                     y / BLOCK_SIZE * image->dst_block_rowstride;
 
-   for (y = 0; y < height; y += BLOCK_SIZE) {
-      for (x = 0; x < width; x += BLOCK_SIZE) {
-         compress_rgb_float_block(MIN2(width - x, BLOCK_SIZE),
-                                  MIN2(height - y, BLOCK_SIZE),
+      for (x = 0; x < image->width; x += BLOCK_SIZE) {
+         compress_rgb_float_block(MIN2(image->width - x, BLOCK_SIZE),
+                                  MIN2(y0 + height - y, BLOCK_SIZE),
                                   src + x * 3 +
-                                  y * src_rowstride / sizeof (float),
-                                  src_rowstride,
+                                  y * image->src_rowstride / sizeof (float),
+                                  image->src_rowstride,
                                   dst,
-                                  is_signed);
+                                  image->is_signed);
          dst += BLOCK_BYTES;
       }
-      dst += dst_row_diff;
    }
 }
 
+static void
+compress_rgb_float(int width, int height,
+                   const float *src, int src_rowstride,
+                   uint8_t *dst, int dst_rowstride,
+                   bool is_signed)
+{
+   struct compress_image_data image;
+
+   image.width = width;
+   image.src = src;
+   image.src_rowstride = src_rowstride;
+   image.dst = dst;
+   image.dst_block_rowstride = get_dst_block_rowstride(width, dst_rowstride);
+   image.is_signed = is_signed;
+
+   _mesa_compress_image_rows(width, height, BLOCK_SIZE,
+                             compress_rgb_float_rows, &image);
+}
+
 static GLboolean
 texstore_bptc_rgb_float(TEXSTORE_PARAMS,
                         bool is_signed)
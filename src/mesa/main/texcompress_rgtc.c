@@ -72,17 +72,111 @@ static void extractsrc_s( GLbyte srcpixels[4][4], const GLfloat *srcaddr,
 }
 
 
+/** An image to compress, split in bands of rows */
+struct rgtc_compress_image {
+   const void *src;
+   GLint width;
+   GLint comps;        /* 1 for RGTC1 or 2 for RGTC2 */
+   GLubyte *dst;
+   GLint dstBlockRowStride;
+};
+
+static GLint
+rgtc_block_row_stride(GLint width, GLint comps, GLint dstRowStride)
+{
+   /* a stride smaller than a row means rows of blocks are packed */
+   if (dstRowStride >= width * 2 * comps)
+      return dstRowStride;
+   else
+      return ((width + 3) & ~3) * 2 * comps;
+}
+
+static void
+compress_unsigned_rgtc_rows(void *data, GLint y, GLint height)
+{
+   const struct rgtc_compress_image *image = data;
+   const GLubyte *tempImage = image->src;
+   GLubyte srcpixels[4][4];
+   int i, j, c;
+   int numxpixels, numypixels;
+
+   for (j = y; j < y + height; j += 4) {
+      const GLubyte *srcaddr = tempImage + j * image->width * image->comps;
+      GLubyte *blkaddr = image->dst + j / 4 * image->dstBlockRowStride;
+
+      numypixels = MIN2(y + height - j, 4);
+      for (i = 0; i < image->width; i += 4) {
+	 numxpixels = MIN2(image->width - i, 4);
+	 for (c = 0; c < image->comps; c++) {
+	    extractsrc_u(srcpixels, srcaddr + c, image->width,
+	                 numxpixels, numypixels, image->comps);
+	    util_format_unsigned_encode_rgtc_ubyte(blkaddr, srcpixels,
+	                                           numxpixels, numypixels);
+	    blkaddr += 8;
+	 }
+	 srcaddr += numxpixels * image->comps;
+      }
+   }
+}
+
+static void
+compress_signed_rgtc_rows(void *data, GLint y, GLint height)
+{
+   const struct rgtc_compress_image *image = data;
+   const GLfloat *tempImage = image->src;
+   GLbyte srcpixels[4][4];
+   int i, j, c;
+   int numxpixels, numypixels;
+
+   for (j = y; j < y + height; j += 4) {
+      const GLfloat *srcaddr = tempImage + j * image->width * image->comps;
+      GLbyte *blkaddr = (GLbyte *) image->dst + j / 4 * image->dstBlockRowStride;
+
+      numypixels = MIN2(y + height - j, 4);
+      for (i = 0; i < image->width; i += 4) {
+	 numxpixels = MIN2(image->width - i, 4);
+	 for (c = 0; c < image->comps; c++) {
+	    extractsrc_s(srcpixels, srcaddr + c, image->width,
+	                 numxpixels, numypixels, image->comps);
+	    util_format_signed_encode_rgtc_ubyte(blkaddr, srcpixels,
+	                                         numxpixels, numypixels);
+	    blkaddr += 8;
+	 }
+	 srcaddr += numxpixels * image->comps;
+      }
+   }
+}
+
+/**
+ * Compress a temporary image of 1 or 2 components, in bands of block rows
+ * possibly done by several threads.
+ */
+static void
+compress_rgtc(const void *tempImage, GLint srcWidth, GLint srcHeight,
+              GLint comps, GLboolean isSigned,
+              GLubyte *dst, GLint dstRowStride)
+{
+   struct rgtc_compress_image image;
+
+   image.src = tempImage;
+   image.width = srcWidth;
+   image.comps = comps;
+   image.dst = dst;
+   image.dstBlockRowStride = rgtc_block_row_stride(srcWidth, comps,
+                                                   dstRowStride);
+
+   _mesa_compress_image_rows(srcWidth, srcHeight, 4,
+                             isSigned ? compress_signed_rgtc_rows
+                                      : compress_unsigned_rgtc_rows,
+                             &image);
+}
+
+
 GLboolean
 _mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
 {
-   GLubyte *dst;
    const GLubyte *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLubyte *srcaddr;
-   GLubyte srcpixels[4][4];
-   GLubyte *blkaddr;
-   GLint dstRowDiff, redRowStride;
+   GLint redRowStride;
    GLubyte *tempImageSlices[1];
 
    assert(dstFormat == MESA_FORMAT_R_RGTC1_UNORM ||
@@ -101,24 +195,8 @@ _mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
                   srcFormat, srcType, srcAddr,
                   srcPacking);
 
-   dst = dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 2) ? dstRowStride - (((srcWidth + 3) & ~3) * 2) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_u(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 1);
-	 util_format_unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 srcaddr += numxpixels;
-	 blkaddr += 8;
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(tempImage, srcWidth, srcHeight, 1, GL_FALSE,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -128,14 +206,8 @@ _mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
 GLboolean
 _mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
 {
-   GLbyte *dst;
    const GLfloat *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLfloat *srcaddr;
-   GLbyte srcpixels[4][4];
-   GLbyte *blkaddr;
-   GLint dstRowDiff, redRowStride;
+   GLint redRowStride;
    GLfloat *tempImageSlices[1];
 
    assert(dstFormat == MESA_FORMAT_R_RGTC1_SNORM ||
@@ -154,24 +226,8 @@ _mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
                   srcFormat, srcType, srcAddr,
                   srcPacking);
 
-   dst = (GLbyte *) dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 2) ? dstRowStride - (((srcWidth + 3) & ~3) * 2) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_s(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 1);
-	 util_format_signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 srcaddr += numxpixels;
-	 blkaddr += 8;
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(tempImage, srcWidth, srcHeight, 1, GL_TRUE,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -181,14 +237,8 @@ _mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
 GLboolean
 _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
 {
-   GLubyte *dst;
    const GLubyte *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLubyte *srcaddr;
-   GLubyte srcpixels[4][4];
-   GLubyte *blkaddr;
-   GLint dstRowDiff, rgRowStride;
+   GLint rgRowStride;
    mesa_format tempFormat;
    GLubyte *tempImageSlices[1];
 
@@ -215,30 +265,8 @@ _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
                   srcFormat, srcType, srcAddr,
                   srcPacking);
 
-   dst = dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 4) ? dstRowStride - (((srcWidth + 3) & ~3) * 4) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth * 2;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_u(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 2);
-	 util_format_unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-
-	 blkaddr += 8;
-	 extractsrc_u(srcpixels, (GLubyte *)srcaddr + 1, srcWidth, numxpixels, numypixels, 2);
-	 util_format_unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-
-	 blkaddr += 8;
-
-	 srcaddr += numxpixels * 2;
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(tempImage, srcWidth, srcHeight, 2, GL_FALSE,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -248,14 +276,8 @@ _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
 GLboolean
 _mesa_texstore_signed_rg_rgtc2(TEXSTORE_PARAMS)
 {
-   GLbyte *dst;
    const GLfloat *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLfloat *srcaddr;
-   GLbyte srcpixels[4][4];
-   GLbyte *blkaddr;
-   GLint dstRowDiff, rgRowStride;
+   GLint rgRowStride;
    mesa_format tempFormat;
    GLfloat *tempImageSlices[1];
 
@@ -280,31 +302,8 @@ _mesa_texstore_signed_rg_rgtc2(TEXSTORE_PARAMS)
                   srcFormat, srcType, srcAddr,
                   srcPacking);
 
-   dst = (GLbyte *) dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 4) ? dstRowStride - (((srcWidth + 3) & ~3) * 4) : 0;
-   for (j = 0; j < srcHeight; j += 4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth * 2;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-
-	 extractsrc_s(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 2);
-	 util_format_signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 blkaddr += 8;
-
-	 extractsrc_s(srcpixels, srcaddr + 1, srcWidth, numxpixels, numypixels, 2);
-	 util_format_signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 blkaddr += 8;
-
-	 srcaddr += numxpixels * 2;
-
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(tempImage, srcWidth, srcHeight, 2, GL_TRUE,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -27,6 +27,10 @@
 #include "glheader.h"
 #include "texstore.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 
 extern GLboolean
 _mesa_texstore_red_rgtc1(TEXSTORE_PARAMS);
@@ -43,5 +47,8 @@ _mesa_texstore_signed_rg_rgtc2(TEXSTORE_PARAMS);
 extern compressed_fetch_func
 _mesa_get_compressed_rgtc_func(mesa_format format);
 
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -64,6 +64,9 @@ typedef void (*dxtCompressTexFuncExt)(GLint srccomps, GLint width,
                                       GLenum destformat, GLubyte *dest,
                                       GLint dstRowStride);
 
+/* The library isn't known to be reentrant, so unlike the BPTC and RGTC
+ * compressors, it's only called from one thread at a time.
+ */
 static dxtCompressTexFuncExt ext_tx_compress_dxtn = NULL;
 
 static void *dxtlibhandle = NULL;
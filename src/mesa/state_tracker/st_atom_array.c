@@ -42,11 +42,13 @@
 #include "st_draw.h"
 #include "st_program.h"
 
+#include "cso_cache/cso_cache.h"
 #include "cso_cache/cso_context.h"
 #include "util/u_math.h"
 #include "util/u_upload_mgr.h"
 #include "main/bufferobj.h"
 #include "main/glformats.h"
+#include "util/hash_table.h"
 
 /* vertex_formats[gltype - GL_BYTE][integer*2 + normalized][size - 1] */
 static const uint16_t vertex_formats[][4][4] = {
@@ -426,81 +428,168 @@ static void init_velement_lowered(const struct st_vertex_program *vp,
    *attr_idx = idx;
 }
 
+/** Number of entries of the vertex layout cache, must be a power of two. */
+#define ST_VERTEX_LAYOUT_CACHE_SIZE 32
+
+/**
+ * The format of an array which doesn't belong to the VAO, so the
+ * VAO stamp doesn't tell when it changes.
+ */
+struct st_array_format
+{
+   GLint Size;
+   GLenum Type;
+   GLenum Format;
+   GLsizei StrideB;
+   GLuint InstanceDivisor;
+   GLboolean Normalized;
+   GLboolean Integer;
+   GLboolean Doubles;
+};
+
+/**
+ * The vertex elements and the assignment of arrays to vertex buffers
+ * derived from the arrays of a VAO.
+ *
+ * They only change when the VAO's arrays are respecified, so they are
+ * cached per VAO; drawing with a VAO again only rebinds its buffers.
+ */
+struct st_vertex_layout
+{
+   /* The key. */
+   GLuint vao_stamp;  /**< 0 if the entry is unused */
+   unsigned num_inputs;
+   ubyte index_to_input[PIPE_MAX_ATTRIBS];
+   const struct gl_vertex_array *arrays[PIPE_MAX_ATTRIBS];
+   struct st_array_format formats[PIPE_MAX_ATTRIBS];
+
+   /* The derived state. */
+   bool interleaved;
+   unsigned num_vbuffers;
+   ubyte vbuffer_attr[PIPE_MAX_ATTRIBS];  /**< VERT_ATTRIB_x per vbuffer */
+   const GLubyte *low_addr;  /**< base of the interleaved arrays */
+   struct cso_velems_state velems;
+   unsigned velems_hash;
+};
+
+static bool
+is_vao_array(const struct gl_vertex_array_object *vao,
+             const struct gl_vertex_array *array)
+{
+   return array >= vao->_VertexAttrib &&
+          array < vao->_VertexAttrib + ARRAY_SIZE(vao->_VertexAttrib);
+}
+
 static void
-set_vertex_attribs(struct st_context *st,
-                   struct pipe_vertex_buffer *vbuffers,
-                   unsigned num_vbuffers,
-                   struct pipe_vertex_element *velements,
-                   unsigned num_velements)
+get_array_format(struct st_array_format *format,
+                 const struct gl_vertex_array *array)
 {
-   struct cso_context *cso = st->cso_context;
+   memset(format, 0, sizeof(*format));
+   format->Size = array->Size;
+   format->Type = array->Type;
+   format->Format = array->Format;
+   format->StrideB = array->StrideB;
+   format->InstanceDivisor = array->InstanceDivisor;
+   format->Normalized = array->Normalized;
+   format->Integer = array->Integer;
+   format->Doubles = array->Doubles;
+}
 
-   cso_set_vertex_buffers(cso, 0, num_vbuffers, vbuffers);
-   if (st->last_num_vbuffers > num_vbuffers) {
-      /* Unbind remaining buffers, if any. */
-      cso_set_vertex_buffers(cso, num_vbuffers,
-                             st->last_num_vbuffers - num_vbuffers, NULL);
+/**
+ * Set the key of a vertex layout.  Returns false if the layout can't be
+ * cached, because some arrays may change without the VAO stamp changing.
+ * That is the case of the arrays of immediate mode and of split draws,
+ * while the zero-stride current value arrays only need their format to
+ * be checked.
+ */
+static bool
+init_layout_key(struct st_vertex_layout *layout,
+                const struct gl_vertex_array_object *vao,
+                const struct st_vertex_program *vp,
+                const struct gl_vertex_array **arrays,
+                unsigned num_inputs)
+{
+   bool cacheable = true;
+   GLuint attr;
+
+   layout->vao_stamp = vao->_Stamp;
+   layout->num_inputs = num_inputs;
+   memcpy(layout->index_to_input, vp->index_to_input, num_inputs);
+
+   for (attr = 0; attr < num_inputs; attr++) {
+      const struct gl_vertex_array *array =
+         get_client_array(arrays, vp->index_to_input[attr]);
+
+      layout->arrays[attr] = array;
+      if (array && !is_vao_array(vao, array)) {
+         get_array_format(&layout->formats[attr], array);
+         if (array->StrideB != 0)
+            cacheable = false;
+      }
+   }
+
+   return cacheable;
+}
+
+static bool
+layout_key_matches(const struct st_vertex_layout *layout,
+                   const struct gl_vertex_array_object *vao,
+                   const struct st_vertex_program *vp,
+                   const struct gl_vertex_array **arrays,
+                   unsigned num_inputs)
+{
+   GLuint attr;
+
+   if (layout->vao_stamp != vao->_Stamp ||
+       layout->num_inputs != num_inputs ||
+       memcmp(layout->index_to_input, vp->index_to_input, num_inputs))
+      return false;
+
+   for (attr = 0; attr < num_inputs; attr++) {
+      const struct gl_vertex_array *array =
+         get_client_array(arrays, vp->index_to_input[attr]);
+
+      if (array != layout->arrays[attr])
+         return false;
+
+      if (array && !is_vao_array(vao, array)) {
+         struct st_array_format format;
+
+         get_array_format(&format, array);
+         if (memcmp(&format, &layout->formats[attr], sizeof(format)))
+            return false;
+      }
    }
-   st->last_num_vbuffers = num_vbuffers;
-   cso_set_vertex_elements(cso, num_velements, velements);
+
+   return true;
 }
 
 /**
- * Set up for drawing interleaved arrays that all live in one VBO
- * or all live in user space.
- * \param vbuffer  returns vertex buffer info
- * \param velements  returns vertex element info
+ * Set up the vertex elements of interleaved arrays that all live in one
+ * VBO or all live in user space.
  */
 static void
-setup_interleaved_attribs(struct st_context *st,
-                          const struct st_vertex_program *vp,
-                          const struct gl_vertex_array **arrays,
-                          unsigned num_inputs)
+init_interleaved_layout(struct st_vertex_layout *layout,
+                        const struct st_vertex_program *vp,
+                        const struct gl_vertex_array **arrays,
+                        unsigned num_inputs)
 {
-   struct pipe_vertex_buffer vbuffer;
-   struct pipe_vertex_element velements[PIPE_MAX_ATTRIBS] = {{0}};
+   struct pipe_vertex_element *velements = layout->velems.velems;
    GLuint attr;
    const GLubyte *low_addr = NULL;
-   GLboolean usingVBO;      /* all arrays in a VBO? */
-   struct gl_buffer_object *bufobj;
-   GLsizei stride;
 
-   /* Find the lowest address of the arrays we're drawing,
-    * Init bufobj and stride.
-    */
+   /* Find the lowest address of the arrays we're drawing */
    if (num_inputs) {
-      const struct gl_vertex_array *array;
-
-      array = get_client_array(arrays, vp->index_to_input[0]);
-      assert(array);
-
-      /* Since we're doing interleaved arrays, we know there'll be at most
-       * one buffer object and the stride will be the same for all arrays.
-       * Grab them now.
-       */
-      bufobj = array->BufferObj;
-      stride = array->StrideB;
-
       low_addr = arrays[vp->index_to_input[0]]->Ptr;
 
       for (attr = 1; attr < num_inputs; attr++) {
-         const GLubyte *start;
+         const struct gl_vertex_array *array;
          array = get_client_array(arrays, vp->index_to_input[attr]);
          if (!array)
             continue;
-         start = array->Ptr;
-         low_addr = MIN2(low_addr, start);
+         low_addr = MIN2(low_addr, array->Ptr);
       }
    }
-   else {
-      /* not sure we'll ever have zero inputs, but play it safe */
-      bufobj = NULL;
-      stride = 0;
-      low_addr = 0;
-   }
-
-   /* are the arrays in user space? */
-   usingVBO = _mesa_is_bufferobj(bufobj);
 
    for (attr = 0; attr < num_inputs;) {
       const struct gl_vertex_array *array;
@@ -525,69 +614,32 @@ setup_interleaved_attribs(struct st_context *st,
                             array->Size, array->Doubles, &attr);
    }
 
-   /*
-    * Return the vbuffer info and setup user-space attrib info, if needed.
+   /* Since we're doing interleaved arrays, there'll be at most one
+    * buffer and the stride will be the same for all arrays.
     */
-   if (num_inputs == 0) {
-      /* just defensive coding here */
-      vbuffer.buffer.resource = NULL;
-      vbuffer.is_user_buffer = false;
-      vbuffer.buffer_offset = 0;
-      vbuffer.stride = 0;
-   }
-   else if (usingVBO) {
-      /* all interleaved arrays in a VBO */
-      struct st_buffer_object *stobj = st_buffer_object(bufobj);
-
-      if (!stobj || !stobj->buffer) {
-         st->vertex_array_out_of_memory = true;
-         return; /* out-of-memory error probably */
-      }
-
-      vbuffer.buffer.resource = stobj->buffer;
-      vbuffer.is_user_buffer = false;
-      vbuffer.buffer_offset = pointer_to_offset(low_addr);
-      vbuffer.stride = stride;
-   }
-   else {
-      /* all interleaved arrays in user memory */
-      vbuffer.buffer.user = low_addr;
-      vbuffer.is_user_buffer = !!low_addr; /* if NULL, then unbind */
-      vbuffer.buffer_offset = 0;
-      vbuffer.stride = stride;
-
-      if (low_addr)
-         st->draw_needs_minmax_index = true;
-   }
-
-   set_vertex_attribs(st, &vbuffer, num_inputs ? 1 : 0,
-                      velements, num_inputs);
+   layout->interleaved = true;
+   layout->num_vbuffers = num_inputs ? 1 : 0;
+   layout->vbuffer_attr[0] = num_inputs ? vp->index_to_input[0] : 0;
+   layout->low_addr = low_addr;
 }
 
 /**
- * Set up a separate pipe_vertex_buffer and pipe_vertex_element for each
- * vertex attribute.
- * \param vbuffer  returns vertex buffer info
- * \param velements  returns vertex element info
+ * Set up a separate vertex buffer and vertex element for each vertex
+ * attribute.
  */
 static void
-setup_non_interleaved_attribs(struct st_context *st,
-                              const struct st_vertex_program *vp,
-                              const struct gl_vertex_array **arrays,
-                              unsigned num_inputs)
+init_non_interleaved_layout(struct st_vertex_layout *layout,
+                            const struct st_vertex_program *vp,
+                            const struct gl_vertex_array **arrays,
+                            unsigned num_inputs)
 {
-   struct gl_context *ctx = st->ctx;
-   struct pipe_vertex_buffer vbuffer[PIPE_MAX_ATTRIBS];
-   struct pipe_vertex_element velements[PIPE_MAX_ATTRIBS] = {{0}};
+   struct pipe_vertex_element *velements = layout->velems.velems;
    unsigned num_vbuffers = 0;
-   unsigned unref_buffers = 0;
    GLuint attr;
 
    for (attr = 0; attr < num_inputs;) {
       const unsigned mesaAttr = vp->index_to_input[attr];
       const struct gl_vertex_array *array;
-      struct gl_buffer_object *bufobj;
-      GLsizei stride;
       unsigned src_format;
       unsigned bufidx;
 
@@ -595,70 +647,11 @@ setup_non_interleaved_attribs(struct st_context *st,
       assert(array);
 
       bufidx = num_vbuffers++;
+      layout->vbuffer_attr[bufidx] = mesaAttr;
 
-      stride = array->StrideB;
-      bufobj = array->BufferObj;
       assert(array->_ElementSize ==
              _mesa_bytes_per_vertex_attrib(array->Size, array->Type));
 
-      if (_mesa_is_bufferobj(bufobj)) {
-         /* Attribute data is in a VBO.
-          * Recall that for VBOs, the gl_vertex_array->Ptr field is
-          * really an offset from the start of the VBO, not a pointer.
-          */
-         struct st_buffer_object *stobj = st_buffer_object(bufobj);
-
-         if (!stobj || !stobj->buffer) {
-            st->vertex_array_out_of_memory = true;
-            return; /* out-of-memory error probably */
-         }
-
-         vbuffer[bufidx].buffer.resource = stobj->buffer;
-         vbuffer[bufidx].is_user_buffer = false;
-         vbuffer[bufidx].buffer_offset = pointer_to_offset(array->Ptr);
-      }
-      else {
-         if (stride == 0) {
-            unsigned size = array->_ElementSize;
-            /* This is optimal for GPU cache line usage if the upload size
-             * is <= cache line size.
-             */
-            unsigned alignment = util_next_power_of_two(size);
-            void *ptr = array->Ptr ? (void*)array->Ptr :
-                                     (void*)ctx->Current.Attrib[mesaAttr];
-
-            vbuffer[bufidx].is_user_buffer = false;
-            vbuffer[bufidx].buffer.resource = NULL;
-
-            /* Use const_uploader for zero-stride vertex attributes, because
-             * it may use a better memory placement than stream_uploader.
-             * The reason is that zero-stride attributes can be fetched many
-             * times (thousands of times), so a better placement is going to
-             * perform better.
-             *
-             * Upload the maximum possible size, which is 4x GLdouble = 32.
-             */
-            u_upload_data(st->can_bind_const_buffer_as_vertex ?
-                             st->pipe->const_uploader :
-                             st->pipe->stream_uploader,
-                          0, size, alignment, ptr,
-                          &vbuffer[bufidx].buffer_offset,
-                          &vbuffer[bufidx].buffer.resource);
-            unref_buffers |= 1u << bufidx;
-         } else {
-            assert(array->Ptr);
-            vbuffer[bufidx].buffer.user = array->Ptr;
-            vbuffer[bufidx].is_user_buffer = true;
-            vbuffer[bufidx].buffer_offset = 0;
-
-            if (!array->InstanceDivisor)
-               st->draw_needs_minmax_index = true;
-         }
-      }
-
-      /* common-case setup */
-      vbuffer[bufidx].stride = stride; /* in bytes */
-
       src_format = st_pipe_vertex_format(array->Type,
                                          array->Size,
                                          array->Format,
@@ -670,15 +663,191 @@ setup_non_interleaved_attribs(struct st_context *st,
                             array->Size, array->Doubles, &attr);
    }
 
-   if (!ctx->Const.AllowMappedBuffersDuringExecution) {
-      u_upload_unmap(st->pipe->stream_uploader);
+   layout->interleaved = false;
+   layout->num_vbuffers = num_vbuffers;
+   layout->low_addr = NULL;
+}
+
+static void
+init_layout(struct st_vertex_layout *layout,
+            const struct st_vertex_program *vp,
+            const struct gl_vertex_array **arrays,
+            unsigned num_inputs)
+{
+   memset(&layout->velems, 0, sizeof(layout->velems));
+   layout->velems.count = num_inputs;
+
+   if (is_interleaved_arrays(vp, arrays, num_inputs))
+      init_interleaved_layout(layout, vp, arrays, num_inputs);
+   else
+      init_non_interleaved_layout(layout, vp, arrays, num_inputs);
+
+   layout->velems_hash = cso_hash_vertex_elements(&layout->velems);
+}
+
+/**
+ * Fill in the vertex buffer of interleaved arrays.
+ * Returns false if the buffer has no storage.
+ */
+static bool
+setup_interleaved_vbuffer(struct st_context *st,
+                          const struct st_vertex_layout *layout,
+                          const struct gl_vertex_array **arrays,
+                          struct pipe_vertex_buffer *vbuffer)
+{
+   const struct gl_vertex_array *array = arrays[layout->vbuffer_attr[0]];
+   struct gl_buffer_object *bufobj = array->BufferObj;
+
+   if (_mesa_is_bufferobj(bufobj)) {
+      /* all interleaved arrays in a VBO */
+      struct st_buffer_object *stobj = st_buffer_object(bufobj);
+
+      if (!stobj || !stobj->buffer)
+         return false; /* out-of-memory error probably */
+
+      vbuffer->buffer.resource = stobj->buffer;
+      vbuffer->is_user_buffer = false;
+      vbuffer->buffer_offset = pointer_to_offset(layout->low_addr);
+   }
+   else {
+      /* all interleaved arrays in user memory */
+      vbuffer->buffer.user = layout->low_addr;
+      vbuffer->is_user_buffer = !!layout->low_addr; /* if NULL, then unbind */
+      vbuffer->buffer_offset = 0;
+
+      if (layout->low_addr)
+         st->draw_needs_minmax_index = true;
    }
 
-   set_vertex_attribs(st, vbuffer, num_vbuffers, velements, num_inputs);
+   vbuffer->stride = array->StrideB;
+   return true;
+}
+
+/**
+ * Fill in the vertex buffer of a single attribute, uploading zero-stride
+ * attributes which aren't in a VBO.
+ * Returns false if the buffer has no storage.
+ */
+static bool
+setup_attrib_vbuffer(struct st_context *st, unsigned mesaAttr,
+                     const struct gl_vertex_array *array,
+                     struct pipe_vertex_buffer *vbuffer)
+{
+   struct gl_context *ctx = st->ctx;
+   struct gl_buffer_object *bufobj = array->BufferObj;
+   GLsizei stride = array->StrideB;
+
+   if (_mesa_is_bufferobj(bufobj)) {
+      /* Attribute data is in a VBO.
+       * Recall that for VBOs, the gl_vertex_array->Ptr field is
+       * really an offset from the start of the VBO, not a pointer.
+       */
+      struct st_buffer_object *stobj = st_buffer_object(bufobj);
+
+      if (!stobj || !stobj->buffer)
+         return false; /* out-of-memory error probably */
+
+      vbuffer->buffer.resource = stobj->buffer;
+      vbuffer->is_user_buffer = false;
+      vbuffer->buffer_offset = pointer_to_offset(array->Ptr);
+   }
+   else {
+      if (stride == 0) {
+         unsigned size = array->_ElementSize;
+         /* This is optimal for GPU cache line usage if the upload size
+          * is <= cache line size.
+          */
+         unsigned alignment = util_next_power_of_two(size);
+         void *ptr = array->Ptr ? (void*)array->Ptr :
+                                  (void*)ctx->Current.Attrib[mesaAttr];
+
+         vbuffer->is_user_buffer = false;
+         vbuffer->buffer.resource = NULL;
+
+         /* Use const_uploader for zero-stride vertex attributes, because
+          * it may use a better memory placement than stream_uploader.
+          * The reason is that zero-stride attributes can be fetched many
+          * times (thousands of times), so a better placement is going to
+          * perform better.
+          *
+          * Upload the maximum possible size, which is 4x GLdouble = 32.
+          */
+         u_upload_data(st->can_bind_const_buffer_as_vertex ?
+                          st->pipe->const_uploader :
+                          st->pipe->stream_uploader,
+                       0, size, alignment, ptr,
+                       &vbuffer->buffer_offset,
+                       &vbuffer->buffer.resource);
+      } else {
+         assert(array->Ptr);
+         vbuffer->buffer.user = array->Ptr;
+         vbuffer->is_user_buffer = true;
+         vbuffer->buffer_offset = 0;
+
+         if (!array->InstanceDivisor)
+            st->draw_needs_minmax_index = true;
+      }
+   }
+
+   /* common-case setup */
+   vbuffer->stride = stride; /* in bytes */
+   return true;
+}
+
+/**
+ * Bind the vertex elements of a layout and the buffers of the arrays.
+ */
+static void
+bind_layout(struct st_context *st, const struct st_vertex_layout *layout,
+            const struct gl_vertex_array **arrays)
+{
+   struct gl_context *ctx = st->ctx;
+   struct cso_context *cso = st->cso_context;
+   struct pipe_vertex_buffer vbuffer[PIPE_MAX_ATTRIBS];
+   unsigned num_vbuffers = layout->num_vbuffers;
+   unsigned unref_buffers = 0;
+   unsigned i;
+
+   if (layout->interleaved) {
+      if (num_vbuffers &&
+          !setup_interleaved_vbuffer(st, layout, arrays, vbuffer)) {
+         st->vertex_array_out_of_memory = true;
+         return;
+      }
+   } else {
+      for (i = 0; i < num_vbuffers; i++) {
+         const unsigned mesaAttr = layout->vbuffer_attr[i];
+
+         if (!setup_attrib_vbuffer(st, mesaAttr, arrays[mesaAttr],
+                                   &vbuffer[i])) {
+            st->vertex_array_out_of_memory = true;
+            break;
+         }
+         if (!vbuffer[i].is_user_buffer && !_mesa_is_bufferobj(
+                arrays[mesaAttr]->BufferObj))
+            unref_buffers |= 1u << i;
+      }
+
+      if (!ctx->Const.AllowMappedBuffersDuringExecution) {
+         u_upload_unmap(st->pipe->stream_uploader);
+      }
+   }
+
+   if (!st->vertex_array_out_of_memory) {
+      cso_set_vertex_buffers(cso, 0, num_vbuffers, vbuffer);
+      if (st->last_num_vbuffers > num_vbuffers) {
+         /* Unbind remaining buffers, if any. */
+         cso_set_vertex_buffers(cso, num_vbuffers,
+                                st->last_num_vbuffers - num_vbuffers, NULL);
+      }
+      st->last_num_vbuffers = num_vbuffers;
+      cso_set_vertex_elements_hashed(cso, &layout->velems,
+                                     layout->velems_hash);
+   }
 
    /* Unreference uploaded zero-stride vertex buffers. */
    while (unref_buffers) {
-      unsigned i = u_bit_scan(&unref_buffers);
+      i = u_bit_scan(&unref_buffers);
       pipe_resource_reference(&vbuffer[i].buffer.resource, NULL);
    }
 }
@@ -687,8 +856,11 @@ void st_update_array(struct st_context *st)
 {
    struct gl_context *ctx = st->ctx;
    const struct gl_vertex_array **arrays = ctx->Array._DrawArrays;
+   const struct gl_vertex_array_object *vao = ctx->Array.VAO;
    const struct st_vertex_program *vp;
+   struct st_vertex_layout layout, *entry = NULL;
    unsigned num_inputs;
+   bool cacheable;
 
    st->vertex_array_out_of_memory = FALSE;
    st->draw_needs_minmax_index = false;
@@ -701,8 +873,25 @@ void st_update_array(struct st_context *st)
    vp = st->vp;
    num_inputs = st->vp_variant->num_inputs;
 
-   if (is_interleaved_arrays(vp, arrays, num_inputs))
-      setup_interleaved_attribs(st, vp, arrays, num_inputs);
-   else
-      setup_non_interleaved_attribs(st, vp, arrays, num_inputs);
+   if (!st->vertex_layouts) {
+      st->vertex_layouts = calloc(ST_VERTEX_LAYOUT_CACHE_SIZE,
+                                  sizeof(struct st_vertex_layout));
+   }
+
+   if (st->vertex_layouts) {
+      entry = &st->vertex_layouts[_mesa_hash_pointer(vao) &
+                                  (ST_VERTEX_LAYOUT_CACHE_SIZE - 1)];
+
+      if (layout_key_matches(entry, vao, vp, arrays, num_inputs)) {
+         bind_layout(st, entry, arrays);
+         return;
+      }
+   }
+
+   cacheable = init_layout_key(&layout, vao, vp, arrays, num_inputs);
+   init_layout(&layout, vp, arrays, num_inputs);
+   if (cacheable && entry)
+      *entry = layout;
+
+   bind_layout(st, &layout, arrays);
 }
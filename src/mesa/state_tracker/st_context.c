@@ -271,6 +271,8 @@ st_destroy_context_priv(struct st_context *st, bool destroy_pipe)
       }
    }
 
+   free(st->vertex_layouts);
+
    /* free glDrawPixels cache data */
    free(st->drawpix_cache.image);
    pipe_resource_reference(&st->drawpix_cache.texture, NULL);
@@ -48,6 +48,7 @@ struct gen_mipmap_state;
 struct st_context;
 struct st_fragment_program;
 struct st_perf_monitor_group;
+struct st_vertex_layout;
 struct u_upload_mgr;
 
 
@@ -265,6 +266,9 @@ struct st_context
    /* The number of vertex buffers from the last call of validate_arrays. */
    unsigned last_num_vbuffers;
 
+   /** Vertex layouts of recently drawn VAOs, see st_atom_array.c */
+   struct st_vertex_layout *vertex_layouts;
+
    int32_t draw_stamp;
    int32_t read_stamp;
 
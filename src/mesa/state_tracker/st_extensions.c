@@ -42,6 +42,8 @@
 #include "st_format.h"
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(nir_optimize, "ST_NIR_OPTIMIZE", FALSE)
+
 /*
  * Note: we use these function rather than the MIN2, MAX2, CLAMP macros to
  * avoid evaluating arguments (which are often function calls) more than once.
@@ -307,6 +309,18 @@ void st_init_limits(struct pipe_screen *screen,
 
       options->LowerCombinedClipCullDistance = true;
       options->LowerBufferInterfaceBlocks = true;
+
+      /* glsl_to_nir is only used for VS, FS and CS.  Drivers without
+       * control flow still need the GLSL IR loop unrolling and if
+       * lowering.
+       */
+      if (debug_get_option_nir_optimize() &&
+          (sh == PIPE_SHADER_VERTEX || sh == PIPE_SHADER_FRAGMENT ||
+           sh == PIPE_SHADER_COMPUTE) &&
+          options->MaxIfDepth &&
+          screen->get_shader_param(screen, sh, PIPE_SHADER_CAP_PREFERRED_IR) ==
+          PIPE_SHADER_IR_NIR)
+         options->OptimizeInNIR = true;
    }
 
    c->GLSLOptimizeConservatively =
@@ -7139,7 +7139,18 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
          lower_discard(ir);
       }
 
-      if (ctx->Const.GLSLOptimizeConservatively) {
+      if (options->OptimizeInNIR) {
+         /* The linker ran the optimizations once, which doesn't inline
+          * functions with early returns since they are only lowered later
+          * in the same pass list.  NIR drivers expect a single function, so
+          * repeat them until no calls are left.  The rest is optimized
+          * after glsl_to_nir.
+          */
+         while (has_unsupported_control_flow(ir, options)) {
+            do_common_optimization(ir, true, true, options,
+                                   ctx->Const.NativeIntegers);
+         }
+      } else if (ctx->Const.GLSLOptimizeConservatively) {
          /* Do it once and repeat only if there's unsupported control flow. */
          do {
             do_common_optimization(ir, true, true, options,
@@ -7149,12 +7160,17 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
          } while (has_unsupported_control_flow(ir, options));
       } else {
          /* Repeat it until it stops making changes. */
+         opt_tracker tracker;
          bool progress;
          do {
             progress = do_common_optimization(ir, true, true, options,
-                                              ctx->Const.NativeIntegers);
-            progress |= lower_if_to_cond_assign((gl_shader_stage)i, ir,
-                                                options->MaxIfDepth, if_threshold);
+                                              ctx->Const.NativeIntegers,
+                                              &tracker);
+            if (lower_if_to_cond_assign((gl_shader_stage)i, ir,
+                                        options->MaxIfDepth, if_threshold)) {
+               tracker.ir_changed();
+               progress = true;
+            }
          } while (progress);
       }
 
@@ -45,6 +45,25 @@ struct vbo_save_copied_vtx {
 };
 
 
+/* The primitives of a vertex list converted to a few indexed draws:
+ * consecutive primitives of the same kind are merged, line strips become
+ * lines, fans and polygons become triangles and triangle strips are
+ * joined with degenerate triangles.  The indices live in one buffer
+ * object.
+ *
+ * Some of these conversions are only invisible with the usual state, see
+ * vbo_save_playback_vertex_list(); the original primitives are drawn
+ * otherwise.
+ */
+struct vbo_save_merged_prims {
+   struct _mesa_prim *prim;
+   GLuint prim_count;
+   struct _mesa_index_buffer ib;
+   GLboolean split_fans;      /**< fans or polygons turned into triangles */
+   GLboolean degenerate_tris; /**< strips joined with degenerate triangles */
+};
+
+
 /* For display lists, this structure holds a run of vertices of the
  * same format, and a strictly well-formed set of begin/end pairs,
  * starting on the first vertex and ending at the last.  Vertex
@@ -82,6 +101,9 @@ struct vbo_save_vertex_list {
    struct _mesa_prim *prim;
    GLuint prim_count;
 
+   /** The primitives as indexed draws, or NULL if that doesn't help */
+   struct vbo_save_merged_prims *merged;
+
    struct vbo_save_vertex_store *vertex_store;
    struct vbo_save_primitive_store *prim_store;
 };
@@ -97,7 +119,7 @@ struct vbo_save_vertex_list {
  * internally even though this probably isn't allowed for client VBOs?
  */
 #define VBO_SAVE_BUFFER_SIZE (256*1024) /* dwords */
-#define VBO_SAVE_PRIM_SIZE   128
+#define VBO_SAVE_PRIM_SIZE   1024
 #define VBO_SAVE_PRIM_MODE_MASK         0x3f
 #define VBO_SAVE_PRIM_WEAK              0x40
 #define VBO_SAVE_PRIM_NO_CURRENT_UPDATE 0x80
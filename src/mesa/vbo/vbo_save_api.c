@@ -407,6 +407,219 @@ convert_line_loop_to_strip(struct vbo_save_context *save,
 }
 
 
+/**
+ * Return the mode of the indexed draw a primitive is converted to.
+ */
+static GLenum
+merged_prim_mode(GLenum mode)
+{
+   switch (mode) {
+   case GL_LINE_STRIP:
+      return GL_LINES;
+   case GL_TRIANGLE_FAN:
+   case GL_POLYGON:
+      return GL_TRIANGLES;
+   default:
+      return mode;
+   }
+}
+
+
+/**
+ * Whether consecutive draws of this mode can be combined into one.
+ */
+static bool
+can_merge_mode(GLenum mode)
+{
+   switch (mode) {
+   case GL_POINTS:
+   case GL_LINES:
+   case GL_TRIANGLES:
+   case GL_QUADS:
+   case GL_TRIANGLE_STRIP:
+      return true;
+   default:
+      return false;
+   }
+}
+
+
+/**
+ * Append the indices of a primitive to an indexed draw of mode
+ * merged_prim_mode(prim->mode) and return the new index count.
+ *
+ * The triangles of fans and polygons keep the vertex which is provoking
+ * with GL_LAST_VERTEX_CONVENTION last.
+ */
+static GLuint
+emit_prim_indices(const struct _mesa_prim *prim, GLuint *indices,
+                  GLuint count)
+{
+   const GLuint start = prim->start;
+   GLuint i;
+
+   switch (prim->mode) {
+   case GL_LINES:
+      for (i = 0; i < (prim->count & ~1u); i++)
+         indices[count++] = start + i;
+      break;
+   case GL_TRIANGLES:
+      for (i = 0; i < prim->count - prim->count % 3; i++)
+         indices[count++] = start + i;
+      break;
+   case GL_QUADS:
+      for (i = 0; i < (prim->count & ~3u); i++)
+         indices[count++] = start + i;
+      break;
+   case GL_LINE_STRIP:
+      for (i = 0; i + 1 < prim->count; i++) {
+         indices[count++] = start + i;
+         indices[count++] = start + i + 1;
+      }
+      break;
+   case GL_TRIANGLE_FAN:
+      for (i = 0; i + 2 < prim->count; i++) {
+         indices[count++] = start;
+         indices[count++] = start + i + 1;
+         indices[count++] = start + i + 2;
+      }
+      break;
+   case GL_POLYGON:
+      /* the first vertex is the provoking one */
+      for (i = 0; i + 2 < prim->count; i++) {
+         indices[count++] = start + i + 1;
+         indices[count++] = start + i + 2;
+         indices[count++] = start;
+      }
+      break;
+   default:
+      for (i = 0; i < prim->count; i++)
+         indices[count++] = start + i;
+      break;
+   }
+
+   return count;
+}
+
+
+/**
+ * Convert the primitives of a vertex list into as few indexed draws as
+ * possible.  Legacy applications often compile lots of small glBegin/glEnd
+ * blocks into a list, which would otherwise cost a draw each.
+ */
+static void
+build_merged_prims(struct gl_context *ctx, struct vbo_save_vertex_list *node)
+{
+   struct vbo_save_merged_prims *merged;
+   struct _mesa_prim *out = NULL;
+   GLuint *indices;
+   GLuint max_indices = 0, num_indices = 0;
+   GLuint index_size;
+   GLuint i;
+
+   node->merged = NULL;
+
+   if (node->prim_count < 2 || node->count == 0)
+      return;
+
+   for (i = 0; i < node->prim_count; i++)
+      max_indices += 3 * node->prim[i].count + 3;
+
+   merged = CALLOC_STRUCT(vbo_save_merged_prims);
+   if (!merged)
+      return;
+
+   merged->prim = malloc(node->prim_count * sizeof(struct _mesa_prim));
+   indices = malloc(max_indices * sizeof(GLuint));
+   if (!merged->prim || !indices)
+      goto fail;
+
+   for (i = 0; i < node->prim_count; i++) {
+      const struct _mesa_prim *prim = &node->prim[i];
+      const GLenum mode = merged_prim_mode(prim->mode);
+      const GLuint first = num_indices;
+
+      if (out && out->mode == mode && can_merge_mode(mode)) {
+         if (mode == GL_TRIANGLE_STRIP) {
+            if (prim->count < 3)
+               continue;
+
+            /* Join the strips with degenerate triangles, keeping the
+             * winding of the new strip's first triangle.
+             */
+            indices[num_indices] = indices[num_indices - 1];
+            indices[num_indices + 1] = prim->start;
+            if (out->count % 2)
+               indices[num_indices + 2] = prim->start;
+            num_indices += 2 + out->count % 2;
+            merged->degenerate_tris = GL_TRUE;
+         }
+
+         num_indices = emit_prim_indices(prim, indices, num_indices);
+         out->count += num_indices - first;
+         continue;
+      }
+
+      num_indices = emit_prim_indices(prim, indices, num_indices);
+      if (num_indices == first)
+         continue;
+
+      out = out ? out + 1 : merged->prim;
+      *out = *prim;
+      out->mode = mode;
+      out->indexed = 1;
+      out->begin = 1;
+      out->end = 1;
+      out->start = first;
+      out->count = num_indices - first;
+      out->basevertex = 0;
+
+      if (prim->mode == GL_TRIANGLE_FAN || prim->mode == GL_POLYGON)
+         merged->split_fans = GL_TRUE;
+   }
+
+   if (!out)
+      goto fail;
+
+   merged->prim_count = out - merged->prim + 1;
+   if (merged->prim_count >= node->prim_count)
+      goto fail;
+
+   /* Use 16-bit indices when possible */
+   if (node->count <= 0xffff) {
+      GLushort *indices16 = (GLushort *) indices;
+
+      for (i = 0; i < num_indices; i++)
+         indices16[i] = indices[i];
+      index_size = sizeof(GLushort);
+   }
+   else {
+      index_size = sizeof(GLuint);
+   }
+
+   merged->ib.count = num_indices;
+   merged->ib.index_size = index_size;
+   merged->ib.ptr = NULL;
+   merged->ib.obj = ctx->Driver.NewBufferObject(ctx, VBO_BUF_ID);
+   if (!merged->ib.obj ||
+       !ctx->Driver.BufferData(ctx, GL_ELEMENT_ARRAY_BUFFER_ARB,
+                               num_indices * index_size, indices,
+                               GL_STATIC_DRAW_ARB, 0, merged->ib.obj))
+      goto fail;
+
+   free(indices);
+   node->merged = merged;
+   return;
+
+fail:
+   if (merged->ib.obj)
+      _mesa_reference_buffer_object(ctx, &merged->ib.obj, NULL);
+   free(indices);
+   free(merged->prim);
+   free(merged);
+}
+
+
 /**
  * Insert the active immediate struct onto the display list currently
  * being built.
@@ -495,6 +708,8 @@ _save_compile_vertex_list(struct gl_context *ctx)
 
    merge_prims(node->prim, &node->prim_count);
 
+   build_merged_prims(ctx, node);
+
    /* Deal with GL_COMPILE_AND_EXECUTE:
     */
    if (ctx->ExecuteFlag) {
@@ -1650,6 +1865,13 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
 
    free(node->current_data);
    node->current_data = NULL;
+
+   if (node->merged) {
+      _mesa_reference_buffer_object(ctx, &node->merged->ib.obj, NULL);
+      free(node->merged->prim);
+      free(node->merged);
+      node->merged = NULL;
+   }
 }
 
 
@@ -1678,6 +1900,11 @@ vbo_print_vertex_list(struct gl_context *ctx, void *data, FILE *f)
              (prim->begin) ? "BEGIN" : "(wrap)",
              (prim->end) ? "END" : "(wrap)");
    }
+
+   if (node->merged) {
+      fprintf(f, "   merged into %u indexed primitives, %u indices\n",
+              node->merged->prim_count, node->merged->ib.count);
+   }
 }
 
 
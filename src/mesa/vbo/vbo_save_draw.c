@@ -34,6 +34,7 @@
 #include "main/macros.h"
 #include "main/light.h"
 #include "main/state.h"
+#include "main/transformfeedback.h"
 #include "util/bitscan.h"
 
 #include "vbo_context.h"
@@ -243,6 +244,48 @@ vbo_save_loopback_vertex_list(struct gl_context *ctx,
 }
 
 
+/**
+ * Whether the merged primitives of a vertex list render the same as the
+ * original ones with the current state.
+ */
+static bool
+can_draw_merged_prims(const struct gl_context *ctx,
+                      const struct vbo_save_merged_prims *merged)
+{
+   /* Feedback and selection report the primitives as drawn: line strip
+    * segments would get reset tokens, polygons would come back as several
+    * triangles and degenerate triangles would show up.
+    */
+   if (ctx->RenderMode != GL_RENDER)
+      return false;
+
+   /* Line strips became lines, which restart the stipple pattern. */
+   if (ctx->Line.StippleFlag)
+      return false;
+
+   /* Polygons became triangles, which have more edges, and degenerate
+    * triangles become visible.
+    */
+   if (ctx->Polygon.FrontMode != GL_FILL || ctx->Polygon.BackMode != GL_FILL)
+      return false;
+
+   if (merged->split_fans &&
+       ctx->Light.ProvokingVertex != GL_LAST_VERTEX_CONVENTION_EXT)
+      return false;
+
+   /* Degenerate triangles are counted, captured and seen by geometry
+    * shaders.
+    */
+   if (merged->degenerate_tris &&
+       (_mesa_is_xfb_active_and_unpaused(ctx) ||
+        ctx->Query.PrimitivesGenerated[0] ||
+        ctx->_Shader->CurrentProgram[MESA_SHADER_GEOMETRY]))
+      return false;
+
+   return true;
+}
+
+
 /**
  * Execute the buffer and save copied verts.
  * This is called from the display list code when executing
@@ -311,7 +354,18 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
       if (ctx->NewState)
 	 _mesa_update_state( ctx );
 
-      if (node->count > 0) {
+      if (node->count > 0 && node->merged &&
+          can_draw_merged_prims(ctx, node->merged)) {
+         vbo_context(ctx)->draw_prims(ctx,
+                                      node->merged->prim,
+                                      node->merged->prim_count,
+                                      &node->merged->ib,
+                                      GL_TRUE,
+                                      0,
+                                      node->count - 1,
+                                      NULL, 0, NULL);
+      }
+      else if (node->count > 0) {
          vbo_context(ctx)->draw_prims(ctx, 
                                       node->prim,
                                       node->prim_count,
@@ -391,6 +391,151 @@ ra_set_finalize(struct ra_regs *regs, unsigned int **q_values)
    }
 }
 
+#define RA_SET_SERIALIZE_MAGIC 0x52415331 /* "RAS1" */
+
+/* Larger sets are rejected by ra_set_deserialize(), so that their size
+ * can't overflow.
+ */
+#define RA_SET_SERIALIZE_MAX_REGS (1 << 16)
+
+static uint64_t
+ra_set_serialized_size(unsigned int count, unsigned int class_count)
+{
+   uint64_t words = 4;
+
+   words += (uint64_t)count * BITSET_WORDS(count);
+   words += (uint64_t)class_count * (1 + BITSET_WORDS(count) + class_count);
+
+   return words * sizeof(uint32_t);
+}
+
+/**
+ * Serializes a finalized register set into a buffer allocated out of
+ * mem_ctx, which ra_set_deserialize() can turn back into the same set.
+ *
+ * This lets drivers with large register sets cache them instead of
+ * building them and computing their conflicts every time a compiler is
+ * created.
+ */
+void *
+ra_set_serialize(const struct ra_regs *regs, void *mem_ctx, size_t *size)
+{
+   unsigned int words = BITSET_WORDS(regs->count);
+   uint32_t *data, *p;
+   unsigned int i, c;
+
+   STATIC_ASSERT(sizeof(BITSET_WORD) == sizeof(uint32_t));
+
+   *size = ra_set_serialized_size(regs->count, regs->class_count);
+   data = p = ralloc_size(mem_ctx, *size);
+   if (!data)
+      return NULL;
+
+   *p++ = RA_SET_SERIALIZE_MAGIC;
+   *p++ = regs->count;
+   *p++ = regs->class_count;
+   *p++ = regs->round_robin;
+
+   for (i = 0; i < regs->count; i++) {
+      memcpy(p, regs->regs[i].conflicts, words * sizeof(uint32_t));
+      p += words;
+   }
+
+   for (c = 0; c < regs->class_count; c++) {
+      struct ra_class *class = regs->classes[c];
+
+      assert(class->q);
+
+      *p++ = class->p;
+      memcpy(p, class->regs, words * sizeof(uint32_t));
+      p += words;
+      memcpy(p, class->q, regs->class_count * sizeof(uint32_t));
+      p += regs->class_count;
+   }
+
+   assert((char *)p - (char *)data == *size);
+
+   return data;
+}
+
+/**
+ * Recreates a register set from the output of ra_set_serialize().
+ *
+ * The set is ready to use for allocation, as if ra_set_finalize() had been
+ * called on it.  Returns NULL if the data doesn't look like a serialized
+ * register set.
+ */
+struct ra_regs *
+ra_set_deserialize(void *mem_ctx, const void *data, size_t size)
+{
+   const uint32_t *p = data;
+   struct ra_regs *regs;
+   BITSET_WORD *conflicts;
+   unsigned int count, class_count, words;
+   unsigned int i, c;
+
+   if (size < 4 * sizeof(uint32_t) || p[0] != RA_SET_SERIALIZE_MAGIC)
+      return NULL;
+
+   count = p[1];
+   class_count = p[2];
+   if (count == 0 || count > RA_SET_SERIALIZE_MAX_REGS ||
+       class_count > count ||
+       size != ra_set_serialized_size(count, class_count))
+      return NULL;
+
+   words = BITSET_WORDS(count);
+
+   regs = rzalloc(mem_ctx, struct ra_regs);
+   regs->count = count;
+   regs->round_robin = p[3];
+   regs->regs = rzalloc_array(regs, struct ra_reg, count);
+   p += 4;
+
+   /* The conflict lists are only needed while building the set, so all
+    * that's left to restore is one bitset per register.
+    */
+   conflicts = ralloc_array(regs->regs, BITSET_WORD, (size_t)count * words);
+   memcpy(conflicts, p, (size_t)count * words * sizeof(BITSET_WORD));
+   p += (size_t)count * words;
+
+   for (i = 0; i < count; i++)
+      regs->regs[i].conflicts = &conflicts[i * words];
+
+   regs->classes = ralloc_array(regs->regs, struct ra_class *, class_count);
+   regs->class_count = class_count;
+
+   for (c = 0; c < class_count; c++) {
+      struct ra_class *class = rzalloc(regs, struct ra_class);
+
+      class->p = *p++;
+      class->regs = ralloc_array(class, BITSET_WORD, words);
+      memcpy(class->regs, p, words * sizeof(BITSET_WORD));
+      p += words;
+      class->q = ralloc_array(regs, unsigned int, class_count);
+      memcpy(class->q, p, class_count * sizeof(unsigned int));
+      p += class_count;
+
+      regs->classes[c] = class;
+   }
+
+   return regs;
+}
+
+/** Returns the number of registers in the set. */
+unsigned int
+ra_get_reg_count(const struct ra_regs *regs)
+{
+   return regs->count;
+}
+
+/** Returns the number of classes allocated in the set. */
+unsigned int
+ra_get_class_count(const struct ra_regs *regs)
+{
+   return regs->class_count;
+}
+
 static void
 ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 {
@@ -478,8 +623,152 @@ pq_test(struct ra_graph *g, unsigned int n)
    return g->nodes[n].q_total < g->regs->classes[n_class]->p;
 }
 
+/**
+ * Worklists used by ra_simplify().
+ *
+ * Rather than rescanning the whole graph every time a node is removed,
+ * the trivially colorable nodes are tracked in a bitset as their q_total
+ * drops, and the remaining nodes are kept in a heap ordered by q_total for
+ * picking an optimistic candidate.  The heap is only built once the first
+ * optimistic candidate is needed, since most graphs never get that far.
+ */
+struct ra_simplify_state {
+   BITSET_WORD *colorable;
+   unsigned int colorable_count;
+
+   /* Count of nodes which are neither in the stack nor precolored. */
+   unsigned int remaining;
+
+   /* Heap of the remaining nodes, and each node's index in it. */
+   unsigned int *heap;
+   unsigned int *heap_index;
+   unsigned int heap_count;
+};
+
+/**
+ * Returns whether node a is a better optimistic candidate than node b.
+ *
+ * Ties go to the higher-numbered node, which is the one a scan from the
+ * top of the graph would have found first.
+ */
+static bool
+heap_less(struct ra_graph *g, unsigned int a, unsigned int b)
+{
+   return g->nodes[a].q_total < g->nodes[b].q_total ||
+          (g->nodes[a].q_total == g->nodes[b].q_total && a > b);
+}
+
+static void
+heap_swap(struct ra_simplify_state *s, unsigned int i, unsigned int j)
+{
+   unsigned int n = s->heap[i];
+
+   s->heap[i] = s->heap[j];
+   s->heap[j] = n;
+   s->heap_index[s->heap[i]] = i;
+   s->heap_index[s->heap[j]] = j;
+}
+
+static void
+heap_sift_up(struct ra_graph *g, struct ra_simplify_state *s, unsigned int i)
+{
+   while (i > 0) {
+      unsigned int parent = (i - 1) / 2;
+
+      if (!heap_less(g, s->heap[i], s->heap[parent]))
+         break;
+
+      heap_swap(s, i, parent);
+      i = parent;
+   }
+}
+
+static void
+heap_sift_down(struct ra_graph *g, struct ra_simplify_state *s, unsigned int i)
+{
+   while (true) {
+      unsigned int best = i;
+      unsigned int left = 2 * i + 1;
+      unsigned int right = 2 * i + 2;
+
+      if (left < s->heap_count && heap_less(g, s->heap[left], s->heap[best]))
+         best = left;
+      if (right < s->heap_count && heap_less(g, s->heap[right], s->heap[best]))
+         best = right;
+
+      if (best == i)
+         break;
+
+      heap_swap(s, i, best);
+      i = best;
+   }
+}
+
+static void
+heap_build(struct ra_graph *g, struct ra_simplify_state *s)
+{
+   unsigned int i;
+
+   s->heap = malloc(s->remaining * sizeof(unsigned int));
+   s->heap_index = malloc(g->count * sizeof(unsigned int));
+   s->heap_count = 0;
+
+   for (i = 0; i < g->count; i++) {
+      if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
+         continue;
+
+      s->heap_index[i] = s->heap_count;
+      s->heap[s->heap_count++] = i;
+   }
+
+   for (i = s->heap_count / 2; i-- > 0;)
+      heap_sift_down(g, s, i);
+}
+
+static void
+heap_remove(struct ra_graph *g, struct ra_simplify_state *s, unsigned int n)
+{
+   unsigned int i = s->heap_index[n];
+
+   s->heap_count--;
+   if (i == s->heap_count)
+      return;
+
+   heap_swap(s, i, s->heap_count);
+   heap_sift_up(g, s, i);
+   heap_sift_down(g, s, s->heap_index[s->heap[i]]);
+}
+
+/**
+ * Returns the highest-numbered trivially colorable node below limit, or ~0
+ * if there is none.
+ */
+static unsigned int
+find_colorable_below(struct ra_simplify_state *s, unsigned int limit)
+{
+   BITSET_WORD mask;
+   int w;
+
+   if (limit == 0)
+      return ~0U;
+
+   w = BITSET_BITWORD(limit - 1);
+   mask = BITSET_MASK((limit - 1) % BITSET_WORDBITS + 1);
+
+   for (; w >= 0; w--) {
+      BITSET_WORD word = s->colorable[w] & mask;
+
+      if (word)
+         return w * BITSET_WORDBITS + util_last_bit(word) - 1;
+
+      mask = ~0;
+   }
+
+   return ~0U;
+}
+
 static void
-decrement_q(struct ra_graph *g, unsigned int n)
+decrement_q(struct ra_graph *g, struct ra_simplify_state *s, unsigned int n)
 {
    unsigned int i;
    int n_class = g->nodes[n].class;
@@ -491,6 +780,17 @@ decrement_q(struct ra_graph *g, unsigned int n)
       if (!g->nodes[n2].in_stack) {
          assert(g->nodes[n2].q_total >= g->regs->classes[n2_class]->q[n_class]);
          g->nodes[n2].q_total -= g->regs->classes[n2_class]->q[n_class];
+
+         if (g->nodes[n2].reg != NO_REG)
+            continue;
+
+         if (!BITSET_TEST(s->colorable, n2) && pq_test(g, n2)) {
+            BITSET_SET(s->colorable, n2);
+            s->colorable_count++;
+         }
+
+         if (s->heap)
+            heap_sift_up(g, s, s->heap_index[n2]);
       }
    }
 }
@@ -504,51 +804,70 @@ decrement_q(struct ra_graph *g, unsigned int n)
  * we optimistically choose a node and push it on the stack. We heuristically
  * push the node with the lowest total q value, since it has the fewest
  * neighbors and therefore is most likely to be allocated.
+ *
+ * Nodes are pushed in the same order as repeatedly sweeping the graph from
+ * the highest-numbered node down would: the next node is the highest
+ * colorable node below the last one pushed, wrapping around to the top of
+ * the graph once the sweep runs out.
  */
 static void
 ra_simplify(struct ra_graph *g)
 {
-   bool progress = true;
+   struct ra_simplify_state s;
    unsigned int stack_optimistic_start = UINT_MAX;
-   int i;
-
-   while (progress) {
-      unsigned int best_optimistic_node = ~0;
-      unsigned int lowest_q_total = ~0;
-
-      progress = false;
-
-      for (i = g->count - 1; i >= 0; i--) {
-	 if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
-	    continue;
-
-	 if (pq_test(g, i)) {
-	    decrement_q(g, i);
-	    g->stack[g->stack_count] = i;
-	    g->stack_count++;
-	    g->nodes[i].in_stack = true;
-	    progress = true;
-	 } else {
-	    unsigned int new_q_total = g->nodes[i].q_total;
-	    if (new_q_total < lowest_q_total) {
-	       best_optimistic_node = i;
-	       lowest_q_total = new_q_total;
-	    }
-	 }
+   unsigned int cursor = g->count;
+   unsigned int i;
+
+   memset(&s, 0, sizeof(s));
+   s.colorable = calloc(BITSET_WORDS(g->count), sizeof(BITSET_WORD));
+
+   for (i = 0; i < g->count; i++) {
+      if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
+         continue;
+
+      s.remaining++;
+      if (pq_test(g, i)) {
+         BITSET_SET(s.colorable, i);
+         s.colorable_count++;
       }
+   }
+
+   while (s.remaining) {
+      unsigned int n;
+
+      if (s.colorable_count) {
+         n = find_colorable_below(&s, cursor);
+         if (n == ~0U)
+            n = find_colorable_below(&s, g->count);
+
+         BITSET_CLEAR(s.colorable, n);
+         s.colorable_count--;
+         cursor = n;
+      } else {
+         if (!s.heap)
+            heap_build(g, &s);
 
-      if (!progress && best_optimistic_node != ~0U) {
          if (stack_optimistic_start == UINT_MAX)
             stack_optimistic_start = g->stack_count;
 
-	 decrement_q(g, best_optimistic_node);
-	 g->stack[g->stack_count] = best_optimistic_node;
-	 g->stack_count++;
-	 g->nodes[best_optimistic_node].in_stack = true;
-	 progress = true;
+         n = s.heap[0];
+         cursor = g->count;
       }
+
+      if (s.heap)
+         heap_remove(g, &s, n);
+      s.remaining--;
+
+      g->nodes[n].in_stack = true;
+      decrement_q(g, &s, n);
+      g->stack[g->stack_count] = n;
+      g->stack_count++;
    }
 
+   free(s.colorable);
+   free(s.heap);
+   free(s.heap_index);
+
    g->stack_optimistic_start = stack_optimistic_start;
 }
 
@@ -29,6 +29,7 @@
 #define REGISTER_ALLOCATE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "util/bitset.h"
 
 #ifdef __cplusplus
@@ -60,6 +61,12 @@ void ra_class_add_reg(struct ra_regs *regs, unsigned int c, unsigned int reg);
 void ra_set_num_conflicts(struct ra_regs *regs, unsigned int class_a,
                           unsigned int class_b, unsigned int num_conflicts);
 void ra_set_finalize(struct ra_regs *regs, unsigned int **conflicts);
+void *ra_set_serialize(const struct ra_regs *regs, void *mem_ctx,
+                       size_t *size);
+struct ra_regs *ra_set_deserialize(void *mem_ctx, const void *data,
+                                   size_t size);
+unsigned int ra_get_reg_count(const struct ra_regs *regs);
+unsigned int ra_get_class_count(const struct ra_regs *regs);
 /** @} */
 
 /** @{ Interference graph setup.
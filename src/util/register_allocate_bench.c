@@ -0,0 +1,218 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Measures ra_allocate() on large synthetic interference graphs.
+ *
+ * The graphs are built from randomly sized live ranges over a set of 128
+ * registers with classes of 1, 2 and 4 contiguous registers, which is
+ * roughly what the i965 scalar backend sees.  Every graph is generated from
+ * a fixed seed, and a hash of the resulting coloring is printed so that the
+ * output can be compared across changes to the allocator.
+ *
+ * Usage: ./register_allocate_bench [node_count]...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "macros.h"
+#include "ralloc.h"
+#include "rand_xor.h"
+#include "register_allocate.h"
+
+#define NUM_REGS 128
+#define NUM_CLASSES 3
+
+static const unsigned class_sizes[NUM_CLASSES] = { 1, 2, 4 };
+
+static int64_t
+get_time_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static struct ra_regs *
+create_reg_set(unsigned *classes)
+{
+   struct ra_regs *regs;
+   unsigned class_reg_count = 0;
+   unsigned c, i, r;
+
+   for (c = 0; c < NUM_CLASSES; c++)
+      class_reg_count += NUM_REGS - class_sizes[c] + 1;
+
+   regs = ra_alloc_reg_set(NULL, NUM_REGS + class_reg_count, true);
+
+   r = NUM_REGS;
+   for (c = 0; c < NUM_CLASSES; c++) {
+      classes[c] = ra_alloc_reg_class(regs);
+
+      for (i = 0; i + class_sizes[c] <= NUM_REGS; i++) {
+         unsigned base;
+
+         ra_class_add_reg(regs, classes[c], r);
+         for (base = i; base < i + class_sizes[c]; base++)
+            ra_add_transitive_reg_conflict(regs, base, r);
+         r++;
+      }
+   }
+
+   ra_set_finalize(regs, NULL);
+
+   return regs;
+}
+
+struct live_range {
+   unsigned start, end, class;
+};
+
+/**
+ * Builds a graph whose nodes are live ranges starting at consecutive
+ * instructions.  Most ranges are short, with a tail of long ones that keeps
+ * the register pressure high enough for optimistic coloring to kick in.
+ */
+static struct ra_graph *
+create_graph(struct ra_regs *regs, const unsigned *classes,
+             unsigned node_count, uint64_t *seed, unsigned *edge_count)
+{
+   struct live_range *ranges = malloc(node_count * sizeof(*ranges));
+   unsigned *active = malloc(node_count * sizeof(*active));
+   unsigned active_count = 0;
+   struct ra_graph *g;
+   unsigned i, j;
+
+   *edge_count = 0;
+
+   for (i = 0; i < node_count; i++) {
+      uint64_t r = rand_xorshift128plus(seed);
+      unsigned length;
+
+      if (r % 8 == 0)
+         length = 64 + (r >> 8) % 512;
+      else
+         length = 1 + (r >> 8) % 24;
+
+      ranges[i].start = i;
+      ranges[i].end = i + length;
+      ranges[i].class = (r >> 32) % 8 == 0 ? 2 : (r >> 32) % 8 < 3 ? 1 : 0;
+   }
+
+   g = ra_alloc_interference_graph(regs, node_count);
+
+   for (i = 0; i < node_count; i++)
+      ra_set_node_class(g, i, classes[ranges[i].class]);
+
+   for (i = 0; i < node_count; i++) {
+      unsigned new_active_count = 0;
+
+      for (j = 0; j < active_count; j++) {
+         unsigned n = active[j];
+
+         if (ranges[n].end <= ranges[i].start)
+            continue;
+
+         ra_add_node_interference(g, i, n);
+         active[new_active_count++] = n;
+         (*edge_count)++;
+      }
+
+      active_count = new_active_count;
+      active[active_count++] = i;
+   }
+
+   /* Pin a few nodes at the start of the program, like a thread payload. */
+   for (i = 0; i < node_count && i < 8; i++) {
+      if (ranges[i].class == 0)
+         ra_set_node_reg(g, i, NUM_REGS + i);
+   }
+
+   for (i = 0; i < node_count; i++)
+      ra_set_node_spill_cost(g, i, ranges[i].end - ranges[i].start);
+
+   free(active);
+   free(ranges);
+
+   return g;
+}
+
+static uint32_t
+hash_coloring(struct ra_graph *g, unsigned node_count)
+{
+   uint32_t hash = 2166136261u;
+   unsigned i;
+
+   for (i = 0; i < node_count; i++) {
+      hash ^= ra_get_node_reg(g, i);
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+int main(int argc, char **argv)
+{
+   static const unsigned default_sizes[] = { 1000, 4000, 16000, 32000 };
+   unsigned classes[NUM_CLASSES];
+   struct ra_regs *regs;
+   unsigned i;
+
+   regs = create_reg_set(classes);
+
+   printf("%8s %10s %8s %12s %10s\n", "nodes", "edges", "result",
+          "alloc ms", "hash");
+
+   for (i = 0; i < (argc > 1 ? (unsigned)argc - 1 : ARRAY_SIZE(default_sizes));
+        i++) {
+      unsigned node_count = argc > 1 ? strtoul(argv[i + 1], NULL, 0) :
+                                       default_sizes[i];
+      uint64_t seed[2] = { 0x5eed, node_count };
+      struct ra_graph *g;
+      unsigned edge_count;
+      int64_t start, end;
+      bool ok;
+
+      if (node_count == 0)
+         continue;
+
+      g = create_graph(regs, classes, node_count, seed, &edge_count);
+
+      start = get_time_ns();
+      ok = ra_allocate(g);
+      end = get_time_ns();
+
+      printf("%8u %10u %8s %12.2f %10x\n", node_count, edge_count,
+             ok ? "colored" : "spill", (end - start) / 1000000.0,
+             hash_coloring(g, node_count));
+
+      ralloc_free(g);
+   }
+
+   ralloc_free(regs);
+
+   return 0;
+}